@@ -1,8 +1,13 @@
 #include "audio.h"
 
+#include "null_audio_impl.h"
 #include "rtaudio_impl.h"
 
-std::unique_ptr<AudioManager> AudioManager::CreateAudioManager()
+std::unique_ptr<AudioManager> AudioManager::CreateAudioManager(AudioBackend backend)
 {
+    if (backend == AudioBackend::kNull)
+    {
+        return std::make_unique<NullAudioManagerImpl>();
+    }
     return std::make_unique<RtAudioManagerImpl>();
 }
\ No newline at end of file
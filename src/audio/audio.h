@@ -1,11 +1,23 @@
 #pragma once
 
+#include <iosfwd>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "audio_file_manager.h"
 
+class LatencyProbe;
+class LiveInputProcessor;
+class StreamRenderer;
+struct DeadlineStats;
+
+enum class AudioBackend
+{
+    kRtAudio, ///< The sound cards, through RtAudio
+    kNull,    ///< No sound card, the callback is driven by a thread, see NullAudioManagerImpl
+};
+
 using AudioStreamInfo = struct _AudioStreamInfo
 {
     unsigned int sample_rate;
@@ -17,7 +29,7 @@ using AudioStreamInfo = struct _AudioStreamInfo
 class AudioManager
 {
   public:
-    static std::unique_ptr<AudioManager> CreateAudioManager();
+    static std::unique_ptr<AudioManager> CreateAudioManager(AudioBackend backend = AudioBackend::kRtAudio);
 
     AudioManager() = default;
     virtual ~AudioManager() = default;
@@ -41,6 +53,32 @@ class AudioManager
     virtual void PlayTestTone(bool play) = 0;
 
     virtual AudioFileManager* GetAudioFileManager() = 0;
+    virtual StreamRenderer* GetStreamRenderer() = 0;
+
+    /**
+     * @brief Gets the processor playing a source driven by the selected input channel.
+     */
+    virtual LiveInputProcessor* GetLiveInputProcessor() = 0;
+
+    /**
+     * @brief Gets the probe measuring the round trip from the output back to the input.
+     */
+    virtual LatencyProbe* GetLatencyProbe() = 0;
+
+    /**
+     * @brief Gets the time spent in the audio callback against the duration of its buffers.
+     */
+    virtual DeadlineStats GetCallbackStats() const = 0;
+
+    /**
+     * @brief Clears the statistics of the audio callback and of the stream renderer.
+     */
+    virtual void ResetDeadlineStats() = 0;
+
+    /**
+     * @brief Writes the statistics of the audio callback and of the stream renderer, for a stats dump.
+     */
+    virtual void WriteStats(std::ostream& stream) const = 0;
 
     virtual void Hit() = 0;
 };
@@ -0,0 +1,285 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "audio_processor.h"
+#include "deadline_monitor.h"
+#include "listener.h"
+#include "nanobench.h"
+#include "null_audio_impl.h"
+#include "quality_controller.h"
+#include "rimguide.h"
+#include "rimguide_utils.h"
+#include "trimesh.h"
+#include "wave_math.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ankerl;
+using namespace std::chrono_literals;
+
+// Times the audio callback on the null backend, no sound card needed. nanobench measures the callbacks run back to
+// back, the DeadlineMonitor of the AudioProcessor gives the percentiles against the buffer deadline.
+
+namespace
+{
+constexpr uint32_t kDeviceSampleRate = 48000;
+constexpr uint32_t kBufferSize = 256;
+constexpr size_t kCallbackCount = kDeviceSampleRate / kBufferSize; // About a second of audio
+
+constexpr float kSampleRate = 11025;
+constexpr float kDensity = 0.262;
+constexpr float kTension = 3325.f;
+constexpr float kDecay = 25.f;
+
+std::unique_ptr<Mesh2D> create_drum(float radius)
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(radius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(radius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(radius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, radius, std::placeholders::_1);
+
+    auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+    auto mask = mesh->get_mask_for_radius(max_radius);
+    mesh->init(mask);
+    mesh->init_boundary(info);
+    mesh->set_input(0.1f * radius, {0.f, 0.f});
+    mesh->set_output(0.5, 0.5);
+    mesh->start_threads();
+    return mesh;
+}
+
+/**
+ * @brief A drum and its listener, struck by the hits and driven by the live input.
+ */
+class DrumSource : public StreamSource
+{
+  public:
+    explicit DrumSource(float radius)
+        : mesh_(create_drum(radius))
+    {
+        ListenerInfo listener_info{};
+        listener_info.type = ListenerType::ALL;
+        listener_info.samplerate = kSampleRate;
+        listener_info.position = {-0.4f, 0.f, 0.8f};
+        listener_.init(*mesh_, listener_info);
+    }
+
+    uint32_t GetSampleRate() const override
+    {
+        return static_cast<uint32_t>(kSampleRate);
+    }
+
+    void HandleCommand(const StreamCommand& command) override
+    {
+        if (command.type == StreamCommandType::kHit)
+        {
+            hit_position_ = 0;
+        }
+    }
+
+    void Render(float* out_buffer, size_t frame_size) override
+    {
+        RenderWithInput(nullptr, out_buffer, frame_size);
+    }
+
+    void RenderWithInput(const float* in_buffer, float* out_buffer, size_t frame_size) override
+    {
+        for (size_t i = 0; i < frame_size; ++i)
+        {
+            float input = hit_position_ < kHitLength ? -1.f : 0.f;
+            ++hit_position_;
+            if (in_buffer != nullptr)
+            {
+                input -= in_buffer[i];
+            }
+            mesh_->tick(input);
+            out_buffer[i] = listener_.tick();
+        }
+    }
+
+  private:
+    static constexpr size_t kHitLength = 32;
+
+    std::unique_ptr<Mesh2D> mesh_;
+    Listener listener_;
+    size_t hit_position_ = kHitLength;
+};
+
+} // namespace
+
+TEST_CASE("Audio callback")
+{
+    nanobench::Bench bench;
+    bench.title(std::format("Audio callback - {} hz, {} frames", kDeviceSampleRate, kBufferSize));
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    {
+        NullAudioManagerImpl audio(kDeviceSampleRate, kBufferSize);
+        bench.run("Idle", [&] { REQUIRE(audio.RunCallbacks(kCallbackCount)); });
+        WriteDeadlineStats(std::cout, "Idle", audio.GetCallbackStats());
+    }
+
+    {
+        NullAudioManagerImpl audio(kDeviceSampleRate, kBufferSize);
+        audio.PlayTestTone(true);
+        bench.run("Test tone", [&] { REQUIRE(audio.RunCallbacks(kCallbackCount)); });
+        WriteDeadlineStats(std::cout, "Test tone", audio.GetCallbackStats());
+    }
+
+    for (float radius : {0.1f, 0.2f})
+    {
+        // The mesh is rendered in the callback itself, its cost adds to the deadline
+        NullAudioManagerImpl audio(kDeviceSampleRate, kBufferSize);
+        REQUIRE(audio.GetLiveInputProcessor()->Start(std::make_unique<DrumSource>(radius)));
+
+        const std::string name = std::format("Live input - {} m drum", radius);
+        bench.run(name, [&] {
+            audio.Hit();
+            REQUIRE(audio.RunCallbacks(kCallbackCount));
+        });
+        WriteDeadlineStats(std::cout, name, audio.GetCallbackStats());
+    }
+}
+
+TEST_CASE("Audio callback - Real-time pace")
+{
+    // The stream renderer fills its buffer on its own thread while the callbacks come at the pace of a device
+    NullAudioManagerImpl audio(kDeviceSampleRate, kBufferSize);
+    audio.SetRealTime(true);
+    REQUIRE(audio.GetStreamRenderer()->Start(std::make_unique<DrumSource>(0.2f)));
+
+    REQUIRE(audio.StartAudioStream());
+    for (size_t i = 0; i < 4; ++i)
+    {
+        audio.Hit();
+        std::this_thread::sleep_for(250ms);
+    }
+    audio.StopAudioStream();
+
+    audio.WriteStats(std::cout);
+    std::cout << "Underruns: " << audio.GetStreamRenderer()->GetUnderrunCount() << std::endl;
+
+    // Paced, a second of callbacks with room for a loaded machine
+    const DeadlineStats stats = audio.GetCallbackStats();
+    CHECK(stats.block_count > kCallbackCount / 2);
+    CHECK(stats.block_count < kCallbackCount * 3 / 2);
+
+    // Each block is rendered once, ahead of the callbacks
+    const DeadlineStats render_stats = audio.GetStreamRenderer()->GetRenderStats();
+    CHECK(render_stats.block_count > kCallbackCount / 2);
+    CHECK(render_stats.budget_us == doctest::Approx(stats.budget_us));
+}
+
+TEST_CASE("Quality controller")
+{
+    // Synthetic render times, 10 ms blocks at a steady load
+    constexpr uint64_t kBudgetNs = 10000000;
+    constexpr float kSettleSeconds = 0.25f; // Exact in binary, a whole number of blocks
+    auto get_switch_time = [](QualityController& controller, float load, float max_seconds) {
+        const size_t tier = controller.GetTier();
+        const auto duration_ns = static_cast<uint64_t>(load * kBudgetNs);
+        for (size_t block = 1; block * kBudgetNs <= max_seconds * 1e9f; ++block)
+        {
+            if (controller.Update(duration_ns, kBudgetNs) != tier)
+            {
+                return block * kBudgetNs / 1e9f;
+            }
+        }
+        return -1.f;
+    };
+
+    QualityController controller(0.75f, 0.35f);
+    controller.SetTierCount(3);
+    controller.SetSettleTime(kSettleSeconds);
+
+    SUBCASE("Hysteresis")
+    {
+        // Between the upgrade and the degrade loads, no tier is left
+        CHECK(get_switch_time(controller, 0.5f, 60.f) < 0.f);
+        CHECK(get_switch_time(controller, 0.9f, 1.f) > 0.f);
+        CHECK(controller.GetTier() == 1);
+        CHECK(get_switch_time(controller, 0.5f, 60.f) < 0.f);
+        CHECK(controller.GetSwitchCount() == 1);
+    }
+
+    SUBCASE("Settle time")
+    {
+        // The blocks rendered during the crossfade are ignored, however slow
+        CHECK(get_switch_time(controller, 0.9f, 1.f) == doctest::Approx(0.01f));
+        CHECK(get_switch_time(controller, 0.9f, 1.f) == doctest::Approx(kSettleSeconds + 0.01f));
+        CHECK(controller.GetTier() == 2);
+
+        // The cheapest tier is kept whatever the load
+        CHECK(get_switch_time(controller, 2.f, 10.f) < 0.f);
+    }
+
+    SUBCASE("Upgrade back-off")
+    {
+        REQUIRE(get_switch_time(controller, 0.9f, 1.f) > 0.f);
+
+        // Each upgrade that does not fit doubles the time before the next one, up to 32 s
+        for (float hold_seconds : {2.f, 4.f, 8.f, 16.f, 32.f, 32.f})
+        {
+            CHECK(get_switch_time(controller, 0.1f, 60.f) == doctest::Approx(kSettleSeconds + hold_seconds));
+            CHECK(controller.GetTier() == 0);
+            CHECK(get_switch_time(controller, 0.9f, 1.f) == doctest::Approx(kSettleSeconds + 0.01f));
+            CHECK(controller.GetTier() == 1);
+        }
+
+        // An upgrade that holds brings the time back to 2 s
+        CHECK(get_switch_time(controller, 0.1f, 60.f) == doctest::Approx(kSettleSeconds + 32.f));
+        CHECK(get_switch_time(controller, 0.5f, 40.f) < 0.f);
+        CHECK(get_switch_time(controller, 0.9f, 1.f) > 0.f);
+        CHECK(get_switch_time(controller, 0.1f, 60.f) == doctest::Approx(kSettleSeconds + 2.f));
+    }
+}
+
+TEST_CASE("Deadline monitor - Xrun prediction")
+{
+    constexpr uint64_t kBudgetNs = 10000000;
+    constexpr size_t kBlockCount = 8 * DeadlineMonitor::kWindowSize;
+    DeadlineMonitor monitor(0.8f, 0.9f);
+
+    // One slow block in 100 keeps the recent 99th percentile right around the prediction ratio, one episode
+    size_t started_count = 0;
+    for (size_t block = 0; block < kBlockCount; ++block)
+    {
+        started_count += monitor.Record(block % 100 == 99 ? kBudgetNs * 95 / 100 : kBudgetNs / 2, kBudgetNs);
+    }
+    CHECK(started_count == 1);
+    CHECK(monitor.GetStats().is_xrun_predicted);
+
+    // Ends once the slow blocks leave the window, the next burst is a new episode
+    for (size_t block = 0; block < DeadlineMonitor::kWindowSize; ++block)
+    {
+        started_count += monitor.Record(kBudgetNs / 2, kBudgetNs);
+    }
+    CHECK(!monitor.GetStats().is_xrun_predicted);
+    for (size_t block = 0; block < DeadlineMonitor::kWindowSize / 10; ++block)
+    {
+        started_count += monitor.Record(kBudgetNs, kBudgetNs);
+    }
+    CHECK(started_count == 2);
+    CHECK(monitor.GetStats().prediction_count == 2);
+}
@@ -0,0 +1,134 @@
+#include "audio_processor.h"
+
+#include "rt_log.h"
+#include "sndfile_manager_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+AudioProcessor::AudioProcessor()
+    : audio_file_manager_(std::make_unique<SndFileManagerImpl>())
+{
+}
+
+void AudioProcessor::SetFormat(uint32_t sample_rate, uint32_t buffer_size, uint32_t output_channel_count)
+{
+    sample_rate_ = sample_rate;
+    output_channel_count_ = output_channel_count;
+
+    stream_buffer_.assign(buffer_size, 0.f);
+    stream_renderer_.SetDeviceFormat(sample_rate, buffer_size);
+    live_buffer_.assign(buffer_size, 0.f);
+    live_input_.SetDeviceFormat(sample_rate, buffer_size);
+    latency_probe_.SetSampleRate(sample_rate);
+    test_tone_.SetSampleRate(sample_rate);
+}
+
+void AudioProcessor::Process(const float* input, float* output, size_t frame_count)
+{
+    const auto start = std::chrono::steady_clock::now();
+    Mix(input, output, frame_count);
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto duration_ns = static_cast<uint64_t>(std::chrono::nanoseconds(end - start).count());
+    const uint64_t budget_ns = frame_count * 1000000000ull / sample_rate_;
+    if (callback_monitor_.Record(duration_ns, budget_ns))
+    {
+        get_rt_log().log(RtLogLevel::WARNING, "Xrun predicted: the audio callback nears {:.0f} us per buffer",
+                         budget_ns / 1000.0);
+    }
+}
+
+void AudioProcessor::PlayTestTone(bool play)
+{
+    play_test_tone_ = play;
+}
+
+void AudioProcessor::Hit()
+{
+    stream_renderer_.PostCommand({StreamCommandType::kHit, 0, 1.f});
+    live_input_.PostCommand({StreamCommandType::kHit, 0, 1.f});
+}
+
+AudioFileManager* AudioProcessor::GetAudioFileManager()
+{
+    return audio_file_manager_.get();
+}
+
+StreamRenderer* AudioProcessor::GetStreamRenderer()
+{
+    return &stream_renderer_;
+}
+
+LiveInputProcessor* AudioProcessor::GetLiveInputProcessor()
+{
+    return &live_input_;
+}
+
+LatencyProbe* AudioProcessor::GetLatencyProbe()
+{
+    return &latency_probe_;
+}
+
+DeadlineStats AudioProcessor::GetCallbackStats() const
+{
+    return callback_monitor_.GetStats();
+}
+
+void AudioProcessor::ResetDeadlineStats()
+{
+    callback_monitor_.Reset();
+    stream_renderer_.ResetRenderStats();
+}
+
+void AudioProcessor::WriteStats(std::ostream& stream) const
+{
+    WriteDeadlineStats(stream, "Audio callback", callback_monitor_.GetStats());
+    WriteDeadlineStats(stream, "Stream renderer", stream_renderer_.GetRenderStats());
+}
+
+void AudioProcessor::Mix(const float* input, float* output, size_t frame_count)
+{
+    const size_t channel_count = output_channel_count_;
+    std::fill(output, output + frame_count * channel_count, 0.f);
+    audio_file_manager_->ProcessBlock(output, frame_count, channel_count);
+
+    if (stream_renderer_.IsRunning() && frame_count <= stream_buffer_.size())
+    {
+        stream_renderer_.Process(stream_buffer_.data(), frame_count);
+        for (size_t i = 0; i < frame_count; ++i)
+        {
+            for (size_t j = 0; j < channel_count; ++j)
+            {
+                output[(i * channel_count) + j] += stream_buffer_[i];
+            }
+        }
+    }
+
+    const bool is_live = live_input_.IsRunning() || latency_probe_.IsRunning();
+    if (is_live && frame_count <= live_buffer_.size())
+    {
+        live_input_.Process(input, live_buffer_.data(), frame_count);
+        latency_probe_.Process(input, live_buffer_.data(), frame_count);
+        for (size_t i = 0; i < frame_count; ++i)
+        {
+            for (size_t j = 0; j < channel_count; ++j)
+            {
+                output[(i * channel_count) + j] += live_buffer_[i];
+            }
+        }
+    }
+
+    if (play_test_tone_)
+    {
+        for (size_t i = 0; i < frame_count; ++i)
+        {
+            const float tone = test_tone_.Tick();
+            for (size_t j = 0; j < channel_count; ++j)
+            {
+                output[(i * channel_count) + j] += tone;
+            }
+        }
+    }
+}
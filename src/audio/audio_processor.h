@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include "audio_file_manager.h"
+#include "deadline_monitor.h"
+#include "latency_probe.h"
+#include "live_input_processor.h"
+#include "stream_renderer.h"
+#include "test_tone.h"
+
+/**
+ * @brief Everything an audio callback plays, independent of the device driving it.
+ *
+ * The backends of AudioManager own one and call Process() from their callback: the sound file, the stream renderer,
+ * the live input with its latency probe and the test tone are mixed the same way whatever the device, so the
+ * callback path can be timed and tested without a sound card. Each call is recorded by a DeadlineMonitor against
+ * the duration of the buffer.
+ */
+class AudioProcessor
+{
+  public:
+    AudioProcessor();
+    ~AudioProcessor() = default;
+
+    AudioProcessor(const AudioProcessor&) = delete;
+    AudioProcessor& operator=(const AudioProcessor&) = delete;
+
+    /**
+     * @brief Sets the format of the device.
+     * @note Must not be called while the callback may be running.
+     */
+    void SetFormat(uint32_t sample_rate, uint32_t buffer_size, uint32_t output_channel_count);
+
+    /**
+     * @brief Renders one device buffer, called from the audio callback.
+     * @param input Mono input, or nullptr without an input device.
+     * @param output Interleaved output of SetFormat() channels.
+     */
+    void Process(const float* input, float* output, size_t frame_count);
+
+    void PlayTestTone(bool play);
+
+    /**
+     * @brief Strikes the sources played by the stream renderer and the live input, if any.
+     */
+    void Hit();
+
+    AudioFileManager* GetAudioFileManager();
+    StreamRenderer* GetStreamRenderer();
+    LiveInputProcessor* GetLiveInputProcessor();
+    LatencyProbe* GetLatencyProbe();
+
+    /**
+     * @brief Gets the time spent in the callback against the duration of its buffers.
+     */
+    DeadlineStats GetCallbackStats() const;
+
+    /**
+     * @brief Clears the statistics of the callback and of the stream renderer.
+     */
+    void ResetDeadlineStats();
+
+    /**
+     * @brief Writes the statistics of the callback and of the stream renderer.
+     */
+    void WriteStats(std::ostream& stream) const;
+
+  private:
+    void Mix(const float* input, float* output, size_t frame_count);
+
+    uint32_t sample_rate_ = 48000;
+    uint32_t output_channel_count_ = 2;
+
+    std::atomic_bool play_test_tone_ = false;
+    TestToneGenerator test_tone_;
+
+    std::unique_ptr<AudioFileManager> audio_file_manager_;
+
+    StreamRenderer stream_renderer_;
+    std::vector<float> stream_buffer_; ///< Mono output of the stream renderer, one device buffer
+
+    LiveInputProcessor live_input_;
+    LatencyProbe latency_probe_;
+    std::vector<float> live_buffer_; ///< Mono output of the live input and the latency probe, one device buffer
+
+    DeadlineMonitor callback_monitor_;
+};
@@ -0,0 +1,192 @@
+#include "deadline_monitor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <ostream>
+
+namespace
+{
+constexpr size_t k_min_window_size = DeadlineMonitor::kWindowSize / 4; // The first blocks are often slower
+constexpr float k_prediction_percentile = 0.99f;
+
+void Increment(std::atomic<uint64_t>& value)
+{
+    value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void Decrement(std::atomic<uint64_t>& value)
+{
+    value.store(value.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+} // namespace
+
+DeadlineMonitor::DeadlineMonitor(float near_miss_ratio, float prediction_ratio)
+    : near_miss_ratio_(near_miss_ratio)
+    , prediction_bin_(std::min(static_cast<size_t>(std::ceil(prediction_ratio * kBinsPerBudget)), kBinCount - 1))
+{
+}
+
+bool DeadlineMonitor::Record(uint64_t duration_ns, uint64_t budget_ns)
+{
+    if (reset_requested_.exchange(false, std::memory_order_relaxed))
+    {
+        Clear();
+    }
+    if (budget_ns == 0)
+    {
+        return false;
+    }
+
+    const double ratio = static_cast<double>(duration_ns) / static_cast<double>(budget_ns);
+    const size_t bin = std::min(static_cast<size_t>(ratio * kBinsPerBudget), kBinCount - 1);
+
+    Increment(bins_[bin]);
+    Increment(block_count_);
+    total_ns_.store(total_ns_.load(std::memory_order_relaxed) + duration_ns, std::memory_order_relaxed);
+    total_budget_ns_.store(total_budget_ns_.load(std::memory_order_relaxed) + budget_ns, std::memory_order_relaxed);
+    max_ns_.store(std::max(max_ns_.load(std::memory_order_relaxed), duration_ns), std::memory_order_relaxed);
+    budget_ns_.store(budget_ns, std::memory_order_relaxed);
+    if (duration_ns > budget_ns)
+    {
+        Increment(late_count_);
+    }
+    else if (ratio >= near_miss_ratio_)
+    {
+        Increment(near_miss_count_);
+    }
+
+    // The oldest block of a full window makes room for this one
+    if (window_size_ == kWindowSize)
+    {
+        const size_t oldest_bin = window_[window_position_];
+        Decrement(window_bins_[oldest_bin]);
+        if (oldest_bin >= prediction_bin_)
+        {
+            --window_over_count_;
+        }
+    }
+    else
+    {
+        ++window_size_;
+    }
+    window_[window_position_] = static_cast<uint16_t>(bin);
+    window_position_ = (window_position_ + 1) % kWindowSize;
+    Increment(window_bins_[bin]);
+    if (bin >= prediction_bin_)
+    {
+        ++window_over_count_;
+    }
+
+    // Once predicted, the xrun stays so until fewer than half the allowed blocks are over the prediction ratio, a
+    // recent 99th percentile hovering around it is one episode rather than a prediction every few blocks
+    const auto allowed_over_count = static_cast<size_t>((1.f - k_prediction_percentile) * window_size_);
+    const bool was_predicted = is_xrun_predicted_.load(std::memory_order_relaxed);
+    const bool is_predicted = was_predicted
+                                  ? 2 * window_over_count_ >= allowed_over_count
+                                  : window_size_ >= k_min_window_size && window_over_count_ > allowed_over_count;
+    is_xrun_predicted_.store(is_predicted, std::memory_order_relaxed);
+    if (is_predicted && !was_predicted)
+    {
+        Increment(prediction_count_);
+        return true;
+    }
+    return false;
+}
+
+DeadlineStats DeadlineMonitor::GetStats() const
+{
+    DeadlineStats stats;
+    stats.block_count = block_count_.load(std::memory_order_relaxed);
+    stats.late_count = late_count_.load(std::memory_order_relaxed);
+    stats.near_miss_count = near_miss_count_.load(std::memory_order_relaxed);
+    stats.prediction_count = prediction_count_.load(std::memory_order_relaxed);
+    stats.budget_us = static_cast<float>(budget_ns_.load(std::memory_order_relaxed)) / 1000.f;
+    stats.max_us = static_cast<float>(max_ns_.load(std::memory_order_relaxed)) / 1000.f;
+    stats.is_xrun_predicted = is_xrun_predicted_.load(std::memory_order_relaxed);
+
+    const auto total_ns = static_cast<double>(total_ns_.load(std::memory_order_relaxed));
+    const auto total_budget_ns = static_cast<double>(total_budget_ns_.load(std::memory_order_relaxed));
+    if (stats.block_count > 0)
+    {
+        stats.mean_us = static_cast<float>(total_ns / static_cast<double>(stats.block_count) / 1000.0);
+    }
+    if (total_budget_ns > 0.0)
+    {
+        stats.load = static_cast<float>(total_ns / total_budget_ns);
+    }
+
+    uint64_t count = 0;
+    uint64_t window_count = 0;
+    for (size_t i = 0; i < kBinCount; ++i)
+    {
+        count += bins_[i].load(std::memory_order_relaxed);
+        window_count += window_bins_[i].load(std::memory_order_relaxed);
+    }
+
+    stats.p50_us = std::min(GetPercentile(bins_, count, 0.5f) * stats.budget_us, stats.max_us);
+    stats.p99_us = std::min(GetPercentile(bins_, count, 0.99f) * stats.budget_us, stats.max_us);
+    stats.p999_us = std::min(GetPercentile(bins_, count, 0.999f) * stats.budget_us, stats.max_us);
+    stats.recent_p99_us = std::min(GetPercentile(window_bins_, window_count, 0.99f) * stats.budget_us, stats.max_us);
+    return stats;
+}
+
+void DeadlineMonitor::Reset()
+{
+    reset_requested_ = true;
+}
+
+void DeadlineMonitor::Clear()
+{
+    for (size_t i = 0; i < kBinCount; ++i)
+    {
+        bins_[i].store(0, std::memory_order_relaxed);
+        window_bins_[i].store(0, std::memory_order_relaxed);
+    }
+    block_count_.store(0, std::memory_order_relaxed);
+    late_count_.store(0, std::memory_order_relaxed);
+    near_miss_count_.store(0, std::memory_order_relaxed);
+    prediction_count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    total_budget_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+    is_xrun_predicted_.store(false, std::memory_order_relaxed);
+
+    window_position_ = 0;
+    window_size_ = 0;
+    window_over_count_ = 0;
+}
+
+float DeadlineMonitor::GetPercentile(const std::array<std::atomic<uint64_t>, kBinCount>& bins, uint64_t count,
+                                     float percentile) const
+{
+    if (count == 0)
+    {
+        return 0.f;
+    }
+
+    // Upper edge of the bin holding the percentile, the last bin is only bounded by the maximum
+    const auto rank = static_cast<uint64_t>(std::ceil(percentile * static_cast<double>(count)));
+    uint64_t cumulated = 0;
+    for (size_t i = 0; i < kBinCount - 1; ++i)
+    {
+        cumulated += bins[i].load(std::memory_order_relaxed);
+        if (cumulated >= rank)
+        {
+            return static_cast<float>(i + 1) / kBinsPerBudget;
+        }
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+void WriteDeadlineStats(std::ostream& stream, std::string_view name, const DeadlineStats& stats)
+{
+    stream << std::format("{}: {} blocks, budget {:.1f} us, load {:.1f}%\n", name, stats.block_count, stats.budget_us,
+                          100.f * stats.load);
+    stream << std::format("  mean {:.1f} us, p50 {:.1f} us, p99 {:.1f} us, p99.9 {:.1f} us, max {:.1f} us\n",
+                          stats.mean_us, stats.p50_us, stats.p99_us, stats.p999_us, stats.max_us);
+    stream << std::format("  {} late, {} near misses, recent p99 {:.1f} us, xrun {} ({} times)\n", stats.late_count,
+                          stats.near_miss_count, stats.recent_p99_us,
+                          stats.is_xrun_predicted ? "predicted" : "not predicted", stats.prediction_count);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+/**
+ * @brief Time taken by the blocks of a real-time path against their budget, see DeadlineMonitor.
+ */
+struct DeadlineStats
+{
+    uint64_t block_count = 0;
+    uint64_t late_count = 0;       ///< Blocks over their budget, an xrun when the path is the audio callback
+    uint64_t near_miss_count = 0;  ///< Blocks over the near miss ratio of their budget, but within it
+    uint64_t prediction_count = 0; ///< Episodes of xrun prediction
+
+    float budget_us = 0.f; ///< Budget of the last block
+    float mean_us = 0.f;
+    float p50_us = 0.f;
+    float p99_us = 0.f;
+    float p999_us = 0.f;
+    float max_us = 0.f;
+    float load = 0.f; ///< Time spent over the budgets, 1 uses all of it
+
+    float recent_p99_us = 0.f;      ///< 99th percentile of the last DeadlineMonitor::kWindowSize blocks
+    bool is_xrun_predicted = false; ///< The recent 99th percentile is over the prediction ratio of the budget
+};
+
+/**
+ * @brief Records how close each block of a real-time path comes to its deadline.
+ *
+ * Each block is recorded as a fraction of its budget, the duration of the audio it renders, in a histogram of
+ * kBinsPerBudget bins per budget up to kMaxLoad budgets. The percentiles are read from the histogram, to a fraction of
+ * a percent of the budget, so recording costs a few increments whatever the number of blocks.
+ *
+ * A second histogram only counts the last kWindowSize blocks. When more than 1% of them take more than the prediction
+ * ratio of their budget, i.e. the recent 99th percentile crosses it, an xrun is predicted: the path runs too close to
+ * its deadline and the next scheduling hiccup will be heard. The mesh should then be smaller or the buffer larger. The
+ * prediction ends when fewer than half of that 1% are left, so a path hovering around the ratio makes one episode.
+ *
+ * Record() is called by the real-time thread only and never blocks nor allocates, GetStats() can be called from any
+ * thread.
+ */
+class DeadlineMonitor
+{
+  public:
+    static constexpr size_t kBinsPerBudget = 128;
+    static constexpr size_t kMaxLoad = 2;
+    static constexpr size_t kBinCount = kBinsPerBudget * kMaxLoad + 1; ///< The last bin holds the blocks over kMaxLoad
+    static constexpr size_t kWindowSize = 1024;
+
+    /**
+     * @param near_miss_ratio Fraction of the budget above which a block is a near miss.
+     * @param prediction_ratio Fraction of the budget the recent 99th percentile must stay below.
+     */
+    DeadlineMonitor(float near_miss_ratio = 0.8f, float prediction_ratio = 0.9f);
+
+    DeadlineMonitor(const DeadlineMonitor&) = delete;
+    DeadlineMonitor& operator=(const DeadlineMonitor&) = delete;
+
+    /**
+     * @brief Records a block, called by the real-time thread.
+     * @return True if the block started an xrun prediction.
+     */
+    bool Record(uint64_t duration_ns, uint64_t budget_ns);
+
+    DeadlineStats GetStats() const;
+
+    /**
+     * @brief Clears the statistics, from the next block on.
+     */
+    void Reset();
+
+  private:
+    void Clear();
+    float GetPercentile(const std::array<std::atomic<uint64_t>, kBinCount>& bins, uint64_t count,
+                        float percentile) const;
+
+    float near_miss_ratio_;
+    size_t prediction_bin_; ///< First bin over the prediction ratio
+
+    std::atomic_bool reset_requested_ = false;
+
+    // Written by the real-time thread only, a load and a store are enough
+    std::array<std::atomic<uint64_t>, kBinCount> bins_{};
+    std::array<std::atomic<uint64_t>, kBinCount> window_bins_{};
+    std::atomic<uint64_t> block_count_ = 0;
+    std::atomic<uint64_t> late_count_ = 0;
+    std::atomic<uint64_t> near_miss_count_ = 0;
+    std::atomic<uint64_t> prediction_count_ = 0;
+    std::atomic<uint64_t> total_ns_ = 0;
+    std::atomic<uint64_t> total_budget_ns_ = 0;
+    std::atomic<uint64_t> max_ns_ = 0;
+    std::atomic<uint64_t> budget_ns_ = 0;
+    std::atomic_bool is_xrun_predicted_ = false;
+
+    // Real-time thread
+    std::array<uint16_t, kWindowSize> window_{}; ///< Bins of the last blocks, oldest first from window_position_
+    size_t window_position_ = 0;
+    size_t window_size_ = 0;
+    size_t window_over_count_ = 0; ///< Blocks of the window over the prediction ratio
+};
+
+/**
+ * @brief Writes the statistics of a real-time path, one line per value, for a stats dump.
+ */
+void WriteDeadlineStats(std::ostream& stream, std::string_view name, const DeadlineStats& stats);
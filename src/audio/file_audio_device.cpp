@@ -0,0 +1,128 @@
+#include "file_audio_device.h"
+
+#include "latency_probe.h"
+#include "live_input_processor.h"
+
+#include <sndfile.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+
+FileAudioDevice::FileAudioDevice(uint32_t buffer_size)
+    : buffer_size_(std::max<uint32_t>(buffer_size, 1))
+{
+}
+
+bool FileAudioDevice::OpenInput(std::string_view file_name, uint32_t channel)
+{
+    const std::string name(file_name);
+    SF_INFO sf_info{0};
+    SNDFILE* file = sf_open(name.c_str(), SFM_READ, &sf_info);
+    if (!file)
+    {
+        std::cerr << "Failed to open input file " << name << std::endl;
+        return false;
+    }
+    if (channel >= static_cast<uint32_t>(sf_info.channels))
+    {
+        std::cerr << "Input file " << name << " has no channel " << channel << std::endl;
+        sf_close(file);
+        return false;
+    }
+
+    std::vector<float> frames(static_cast<size_t>(sf_info.frames) * sf_info.channels);
+    const sf_count_t frame_count = sf_readf_float(file, frames.data(), sf_info.frames);
+    sf_close(file);
+
+    std::vector<float> input(static_cast<size_t>(frame_count));
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        input[i] = frames[i * sf_info.channels + channel];
+    }
+    SetInput(std::move(input), static_cast<uint32_t>(sf_info.samplerate));
+    return true;
+}
+
+void FileAudioDevice::SetInput(std::vector<float> input, uint32_t sample_rate)
+{
+    input_ = std::move(input);
+    sample_rate_ = sample_rate;
+}
+
+void FileAudioDevice::SetLoopback(uint32_t delay_frames, float gain)
+{
+    loopback_delay_ = std::max(delay_frames, buffer_size_);
+    loopback_gain_ = gain;
+}
+
+uint32_t FileAudioDevice::GetSampleRate() const
+{
+    return sample_rate_;
+}
+
+uint32_t FileAudioDevice::GetBufferSize() const
+{
+    return buffer_size_;
+}
+
+bool FileAudioDevice::Run(LiveInputProcessor& processor, LatencyProbe* probe, std::string_view output_file_name,
+                          float tail_seconds)
+{
+    const size_t tail_frames = static_cast<size_t>(std::max(tail_seconds, 0.f) * sample_rate_);
+    const size_t block_count = (input_.size() + tail_frames + buffer_size_ - 1) / buffer_size_;
+    output_.assign(block_count * buffer_size_, 0.f);
+
+    std::vector<float> input(buffer_size_);
+    for (size_t block = 0; block < block_count; ++block)
+    {
+        const size_t start = block * buffer_size_;
+        for (size_t i = 0; i < buffer_size_; ++i)
+        {
+            const size_t frame = start + i;
+            input[i] = frame < input_.size() ? input_[frame] : 0.f;
+            if (loopback_gain_ != 0.f && frame >= loopback_delay_)
+            {
+                input[i] += loopback_gain_ * output_[frame - loopback_delay_];
+            }
+        }
+
+        // Same calls and order as the audio callback
+        float* output = &output_[start];
+        processor.Process(input.data(), output, buffer_size_);
+        if (probe != nullptr)
+        {
+            probe->Process(input.data(), output, buffer_size_);
+        }
+    }
+
+    if (output_file_name.empty())
+    {
+        return true;
+    }
+
+    const std::string name(output_file_name);
+    SF_INFO out_sf_info{0};
+    out_sf_info.channels = 1;
+    out_sf_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    out_sf_info.samplerate = static_cast<int>(sample_rate_);
+    out_sf_info.frames = static_cast<sf_count_t>(output_.size());
+
+    SNDFILE* out_file = sf_open(name.c_str(), SFM_WRITE, &out_sf_info);
+    if (!out_file)
+    {
+        std::cerr << "Failed to open output file " << name << std::endl;
+        return false;
+    }
+
+    sf_writef_float(out_file, output_.data(), static_cast<sf_count_t>(output_.size()));
+    sf_write_sync(out_file);
+    sf_close(out_file);
+    return true;
+}
+
+const std::vector<float>& FileAudioDevice::GetOutput() const
+{
+    return output_;
+}
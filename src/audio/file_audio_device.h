@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class LatencyProbe;
+class LiveInputProcessor;
+
+/**
+ * @brief Stand-in for a duplex audio device, reading its input from a sound file and writing its output to another,
+ * to run the live input path without hardware.
+ *
+ * Run() calls the LiveInputProcessor and the LatencyProbe one device buffer at a time, the way the AudioProcessor
+ * of every backend does, as fast as they render. The output can be fed back into the input after a fixed delay, a
+ * simulated loopback cable whose delay the probe should measure exactly and without jitter.
+ */
+class FileAudioDevice
+{
+  public:
+    FileAudioDevice(uint32_t buffer_size = 512);
+
+    /**
+     * @brief Reads one channel of a sound file, played as the device input at the rate of the file.
+     * @return False if the file cannot be read or has no such channel.
+     */
+    bool OpenInput(std::string_view file_name, uint32_t channel = 0);
+
+    /**
+     * @brief Uses a signal as the device input.
+     */
+    void SetInput(std::vector<float> input, uint32_t sample_rate);
+
+    /**
+     * @brief Adds the output back to the input.
+     * @param delay_frames The round trip, at least one buffer: the output of a callback only comes back in a later
+     * one.
+     */
+    void SetLoopback(uint32_t delay_frames, float gain = 1.f);
+
+    uint32_t GetSampleRate() const;
+    uint32_t GetBufferSize() const;
+
+    /**
+     * @brief Plays the whole input then tail_seconds of silence, and writes the output.
+     * @param probe The latency probe, or nullptr.
+     * @param output_file_name Mono output, not written if empty.
+     * @note The device format of the processor and the rate of the probe are set by the caller, as when a stream
+     * starts.
+     * @return False if the output cannot be written.
+     */
+    bool Run(LiveInputProcessor& processor, LatencyProbe* probe, std::string_view output_file_name,
+             float tail_seconds = 1.f);
+
+    /**
+     * @brief Gets the output of the last Run().
+     */
+    const std::vector<float>& GetOutput() const;
+
+  private:
+    uint32_t buffer_size_;
+    uint32_t sample_rate_ = 0;
+    std::vector<float> input_;
+    std::vector<float> output_;
+
+    uint32_t loopback_delay_ = 0;
+    float loopback_gain_ = 0.f;
+};
@@ -0,0 +1,131 @@
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+LatencyProbe::~LatencyProbe()
+{
+    Stop();
+}
+
+void LatencyProbe::SetSampleRate(uint32_t sample_rate)
+{
+    sample_rate_ = sample_rate;
+}
+
+void LatencyProbe::Start(float period_seconds, float threshold, float amplitude)
+{
+    Stop();
+    if (sample_rate_ == 0)
+    {
+        return;
+    }
+
+    period_frames_ = std::max<uint32_t>(static_cast<uint32_t>(period_seconds * sample_rate_), 1);
+    threshold_ = threshold;
+    amplitude_ = amplitude;
+
+    frames_to_pulse_ = 0;
+    frames_since_pulse_ = 0;
+    is_waiting_ = false;
+    measurement_count_ = 0;
+    delay_sum_ = 0.0;
+    delay_square_sum_ = 0.0;
+    min_delay_ = 0;
+    max_delay_ = 0;
+
+    published_measurement_count_ = 0;
+    missed_count_ = 0;
+    mean_ms_ = 0.f;
+    min_ms_ = 0.f;
+    max_ms_ = 0.f;
+    jitter_ms_ = 0.f;
+
+    running_ = true;
+}
+
+void LatencyProbe::Stop()
+{
+    running_ = false;
+
+    // Paired with Process(): either the callback sees the probe stopped, or it is seen processing here
+    while (processing_)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool LatencyProbe::IsRunning() const
+{
+    return running_;
+}
+
+void LatencyProbe::Process(const float* in_buffer, float* out_buffer, size_t frame_size)
+{
+    processing_ = true;
+    if (!running_)
+    {
+        processing_ = false;
+        return;
+    }
+
+    for (size_t i = 0; i < frame_size; ++i)
+    {
+        if (frames_to_pulse_ == 0)
+        {
+            if (is_waiting_)
+            {
+                missed_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+            out_buffer[i] += amplitude_;
+            is_waiting_ = true;
+            frames_since_pulse_ = 0;
+            frames_to_pulse_ = period_frames_;
+        }
+
+        if (is_waiting_ && in_buffer != nullptr && std::abs(in_buffer[i]) >= threshold_)
+        {
+            AddMeasurement(frames_since_pulse_);
+            is_waiting_ = false;
+        }
+
+        ++frames_since_pulse_;
+        --frames_to_pulse_;
+    }
+
+    processing_ = false;
+}
+
+LatencyStats LatencyProbe::GetStats() const
+{
+    LatencyStats stats;
+    stats.measurement_count = published_measurement_count_;
+    stats.missed_count = missed_count_;
+    stats.mean_ms = mean_ms_;
+    stats.min_ms = min_ms_;
+    stats.max_ms = max_ms_;
+    stats.jitter_ms = jitter_ms_;
+    return stats;
+}
+
+void LatencyProbe::AddMeasurement(uint32_t delay_frames)
+{
+    min_delay_ = measurement_count_ == 0 ? delay_frames : std::min(min_delay_, delay_frames);
+    max_delay_ = measurement_count_ == 0 ? delay_frames : std::max(max_delay_, delay_frames);
+    ++measurement_count_;
+
+    const double delay = delay_frames;
+    delay_sum_ += delay;
+    delay_square_sum_ += delay * delay;
+
+    const double mean = delay_sum_ / measurement_count_;
+    const double variance = std::max(delay_square_sum_ / measurement_count_ - mean * mean, 0.0);
+    const double ms_per_frame = 1000.0 / sample_rate_;
+
+    mean_ms_.store(static_cast<float>(mean * ms_per_frame), std::memory_order_relaxed);
+    min_ms_.store(static_cast<float>(min_delay_ * ms_per_frame), std::memory_order_relaxed);
+    max_ms_.store(static_cast<float>(max_delay_ * ms_per_frame), std::memory_order_relaxed);
+    jitter_ms_.store(static_cast<float>(std::sqrt(variance) * ms_per_frame), std::memory_order_relaxed);
+    published_measurement_count_.store(measurement_count_, std::memory_order_relaxed);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Round trip latency measured by a LatencyProbe.
+ */
+struct LatencyStats
+{
+    uint32_t measurement_count = 0;
+    uint32_t missed_count = 0; ///< Pulses not heard back before the next one
+    float mean_ms = 0.f;
+    float min_ms = 0.f;
+    float max_ms = 0.f;
+    float jitter_ms = 0.f; ///< Standard deviation of the measurements
+};
+
+/**
+ * @brief Measures the delay from the output of the audio device back to its input, through a loopback cable or a
+ * microphone next to the speaker.
+ *
+ * A pulse is added to the output every period and the input is watched for the first sample above a threshold. The
+ * delay between the two, counted in frames on the audio thread, includes the output and input buffers of the device
+ * and its converters. The delay heard when the live input drives a source is this round trip plus the processing
+ * latency of the LiveInputProcessor.
+ *
+ * Start() and Stop() wait for the callback to leave Process(), Process() never waits.
+ */
+class LatencyProbe
+{
+  public:
+    LatencyProbe() = default;
+    ~LatencyProbe();
+
+    LatencyProbe(const LatencyProbe&) = delete;
+    LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+    /**
+     * @brief Sets the rate of the audio device.
+     * @note Must not be called while the audio callback may be running.
+     */
+    void SetSampleRate(uint32_t sample_rate);
+
+    /**
+     * @brief Starts a new measurement, clearing the statistics.
+     * @param period_seconds Time between two pulses, longer than the round trip.
+     * @param threshold Input level detecting a pulse, above the noise floor of the input.
+     * @param amplitude Level of the pulses.
+     */
+    void Start(float period_seconds = 0.5f, float threshold = 0.1f, float amplitude = 0.5f);
+    void Stop();
+    bool IsRunning() const;
+
+    /**
+     * @brief Adds the pulses to the output and detects them in the input, called from the audio callback.
+     * @param in_buffer Mono input of the device, or nullptr if it has none.
+     * @param out_buffer Mono output the pulses are added to.
+     */
+    void Process(const float* in_buffer, float* out_buffer, size_t frame_size);
+
+    LatencyStats GetStats() const;
+
+  private:
+    void AddMeasurement(uint32_t delay_frames);
+
+    uint32_t sample_rate_ = 0;
+    std::atomic_bool running_ = false;
+    std::atomic_bool processing_ = false; ///< Set by the callback while it uses the state below
+
+    uint32_t period_frames_ = 0;
+    float threshold_ = 0.f;
+    float amplitude_ = 0.f;
+
+    // Audio thread
+    uint32_t frames_to_pulse_ = 0;
+    uint32_t frames_since_pulse_ = 0;
+    bool is_waiting_ = false; ///< A pulse was sent and not heard back yet
+    uint32_t measurement_count_ = 0;
+    double delay_sum_ = 0.0;
+    double delay_square_sum_ = 0.0;
+    uint32_t min_delay_ = 0;
+    uint32_t max_delay_ = 0;
+
+    // Published for GetStats(), each value is consistent on its own
+    std::atomic<uint32_t> published_measurement_count_ = 0;
+    std::atomic<uint32_t> missed_count_ = 0;
+    std::atomic<float> mean_ms_ = 0.f;
+    std::atomic<float> min_ms_ = 0.f;
+    std::atomic<float> max_ms_ = 0.f;
+    std::atomic<float> jitter_ms_ = 0.f;
+};
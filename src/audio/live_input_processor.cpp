@@ -0,0 +1,186 @@
+#include "live_input_processor.h"
+
+#include "denormal.h"
+#include "ring_buffer.tpp"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+constexpr size_t kCommandQueueSize = 256;
+} // namespace
+
+LiveInputProcessor::LiveInputProcessor()
+    : command_buffer_(kCommandQueueSize)
+{
+}
+
+LiveInputProcessor::~LiveInputProcessor()
+{
+    Stop();
+}
+
+void LiveInputProcessor::SetDeviceFormat(uint32_t sample_rate, uint32_t buffer_size)
+{
+    if (sample_rate == device_sample_rate_ && buffer_size == device_buffer_size_)
+    {
+        return;
+    }
+
+    const bool was_running = IsRunning();
+    Stop();
+
+    device_sample_rate_ = sample_rate;
+    device_buffer_size_ = buffer_size;
+
+    if (was_running)
+    {
+        Start(std::move(source_));
+    }
+}
+
+bool LiveInputProcessor::Start(std::unique_ptr<StreamSource> source)
+{
+    Stop();
+
+    if (device_sample_rate_ == 0 || device_buffer_size_ == 0)
+    {
+        std::cerr << "LiveInputProcessor::Start: device format not set" << std::endl;
+        return false;
+    }
+
+    if (!source || source->GetSampleRate() == 0)
+    {
+        std::cerr << "LiveInputProcessor::Start: invalid source" << std::endl;
+        return false;
+    }
+
+    source_ = std::move(source);
+    command_buffer_.Reset();
+    dropout_count_ = 0;
+
+    const uint32_t source_sample_rate = source_->GetSampleRate();
+    input_resampler_.Init(device_sample_rate_, source_sample_rate);
+    output_resampler_.Init(source_sample_rate, device_sample_rate_);
+
+    const size_t max_source_frames = output_resampler_.GetMaxInputFramesNeeded(device_buffer_size_);
+    const size_t max_input_frames = input_resampler_.GetMaxInputFramesNeeded(max_source_frames);
+    source_input_.assign(max_source_frames, 0.f);
+    source_output_.assign(max_source_frames, 0.f);
+
+    // The input consumed per callback differs from the device buffer by up to the frames of one source sample and
+    // the rounding of both resamplers
+    queued_ahead_ = source_sample_rate == device_sample_rate_ ? 0 : input_resampler_.GetMaxInputFramesNeeded(1) + 2;
+    input_queue_.assign(max_input_frames + queued_ahead_ + 2 * static_cast<size_t>(device_buffer_size_), 0.f);
+    input_queue_size_ = queued_ahead_;
+
+    running_ = true;
+    return true;
+}
+
+void LiveInputProcessor::Stop()
+{
+    running_ = false;
+
+    // Paired with Process(): either the callback sees the processor stopped, or it is seen processing here
+    while (processing_)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool LiveInputProcessor::IsRunning() const
+{
+    return running_;
+}
+
+bool LiveInputProcessor::PostCommand(const StreamCommand& command)
+{
+    if (!running_)
+    {
+        return false;
+    }
+
+    return command_buffer_.Write(&command, 1) == 1;
+}
+
+void LiveInputProcessor::Process(const float* in_buffer, float* out_buffer, size_t frame_size)
+{
+    processing_ = true;
+    if (!running_ || frame_size > device_buffer_size_)
+    {
+        if (running_)
+        {
+            dropout_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        processing_ = false;
+        std::fill(out_buffer, out_buffer + frame_size, 0.f);
+        return;
+    }
+
+    // The source ticks a mesh whose tail would otherwise fall into the subnormal range
+    ScopedFlushDenormals flush_denormals;
+    ApplyCommands();
+
+    float* queue_end = input_queue_.data() + input_queue_size_;
+    if (in_buffer != nullptr)
+    {
+        std::copy(in_buffer, in_buffer + frame_size, queue_end);
+    }
+    else
+    {
+        std::fill(queue_end, queue_end + frame_size, 0.f);
+    }
+    input_queue_size_ += frame_size;
+
+    const size_t source_frames = output_resampler_.GetInputFramesNeeded(frame_size);
+    const size_t input_frames = input_resampler_.GetInputFramesNeeded(source_frames);
+    if (input_frames > input_queue_size_)
+    {
+        std::fill(input_queue_.data() + input_queue_size_, input_queue_.data() + input_frames, 0.f);
+        input_queue_size_ = input_frames;
+        dropout_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    input_resampler_.Process(input_queue_.data(), input_frames, source_input_.data(), source_frames);
+    std::copy(input_queue_.data() + input_frames, input_queue_.data() + input_queue_size_, input_queue_.data());
+    input_queue_size_ -= input_frames;
+
+    source_->RenderWithInput(source_input_.data(), source_output_.data(), source_frames);
+    output_resampler_.Process(source_output_.data(), source_frames, out_buffer, frame_size);
+
+    processing_ = false;
+}
+
+float LiveInputProcessor::GetProcessingLatency() const
+{
+    if (!running_)
+    {
+        return 0.f;
+    }
+
+    const float source_to_device = static_cast<float>(device_sample_rate_) / source_->GetSampleRate();
+    return static_cast<float>(queued_ahead_) + input_resampler_.GetLatency() +
+           output_resampler_.GetLatency() * source_to_device;
+}
+
+uint32_t LiveInputProcessor::GetDropoutCount() const
+{
+    return dropout_count_;
+}
+
+void LiveInputProcessor::ApplyCommands()
+{
+    auto commands = command_buffer_.PeekRead(command_buffer_.GetSize());
+    for (const auto& command : commands.first)
+    {
+        source_->HandleCommand(command);
+    }
+    for (const auto& command : commands.second)
+    {
+        source_->HandleCommand(command);
+    }
+    command_buffer_.Consume(commands.size());
+}
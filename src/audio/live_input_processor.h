@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "polyphase_resampler.h"
+#include "ring_buffer.h"
+#include "stream_renderer.h"
+
+/**
+ * @brief Plays a StreamSource driven by the input of the audio device, for instance a mesh struck through a contact
+ * mic or a trigger pad.
+ *
+ * Unlike a StreamRenderer, the source is rendered in the audio callback itself: every input sample reaches the source
+ * at a fixed delay and its output is returned in the same callback, rendering ahead would only add latency. The input
+ * is resampled to the rate of the source and the output back to the rate of the device. The input resampler does not
+ * consume exactly one device buffer per callback, a few frames are kept queued ahead of it so it never runs dry; they
+ * are part of GetProcessingLatency().
+ *
+ * Start() and Stop() wait for the callback to leave Process(), Process() never waits.
+ */
+class LiveInputProcessor
+{
+  public:
+    LiveInputProcessor();
+    ~LiveInputProcessor();
+
+    LiveInputProcessor(const LiveInputProcessor&) = delete;
+    LiveInputProcessor& operator=(const LiveInputProcessor&) = delete;
+
+    /**
+     * @brief Sets the format of the audio device.
+     * @note Must not be called while the audio callback may be running. Restarts the current source, if any.
+     */
+    void SetDeviceFormat(uint32_t sample_rate, uint32_t buffer_size);
+
+    /**
+     * @brief Starts playing a source, replacing the current one.
+     * @return False if the device format is not set.
+     */
+    bool Start(std::unique_ptr<StreamSource> source);
+    void Stop();
+    bool IsRunning() const;
+
+    /**
+     * @brief Queues a command for the source, applied at the start of the next callback.
+     * @return False if the queue is full or no source is playing.
+     * @note Not meant to be called from several threads at once.
+     */
+    bool PostCommand(const StreamCommand& command);
+
+    /**
+     * @brief Renders the next block, called from the audio callback.
+     * @param in_buffer Mono input of the device, or nullptr for silence.
+     * @param out_buffer Mono output, filled with silence when nothing is playing.
+     * @note Never blocks nor allocates.
+     */
+    void Process(const float* in_buffer, float* out_buffer, size_t frame_size);
+
+    /**
+     * @brief Gets the delay added between the input and the output of the device, in device frames, on top of the
+     * response of the source itself.
+     */
+    float GetProcessingLatency() const;
+
+    /**
+     * @brief Gets the number of callbacks whose input could not be queued or was missing since the source was
+     * started, which only happens when the device changes its buffer size.
+     */
+    uint32_t GetDropoutCount() const;
+
+  private:
+    void ApplyCommands();
+
+    uint32_t device_sample_rate_ = 0;
+    uint32_t device_buffer_size_ = 0;
+
+    std::unique_ptr<StreamSource> source_;
+    std::atomic_bool running_ = false;
+    std::atomic_bool processing_ = false; ///< Set by the callback while it uses the source
+
+    RingBuffer<StreamCommand> command_buffer_;
+
+    PolyphaseResampler input_resampler_;  ///< Device rate to source rate
+    PolyphaseResampler output_resampler_; ///< Source rate to device rate
+
+    // Device input not consumed by the input resampler yet, always starts with the frames queued ahead
+    std::vector<float> input_queue_;
+    size_t input_queue_size_ = 0;
+    size_t queued_ahead_ = 0;
+
+    std::vector<float> source_input_;  ///< Room for the source frames of one device buffer
+    std::vector<float> source_output_;
+
+    std::atomic<uint32_t> dropout_count_ = 0;
+};
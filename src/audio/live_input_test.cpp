@@ -0,0 +1,129 @@
+#include "file_audio_device.h"
+#include "latency_probe.h"
+#include "live_input_processor.h"
+#include "stream_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// Runs the live input path on a FileAudioDevice: the latency probe must measure the simulated loopback exactly, and
+// an impulse on the input must come out after the processing latency the processor reports.
+
+constexpr uint32_t kDeviceSampleRate = 48000;
+constexpr uint32_t kBufferSize = 256;
+
+/**
+ * @brief A source returning its input, at a rate of its own.
+ */
+class PassthroughSource : public StreamSource
+{
+  public:
+    explicit PassthroughSource(uint32_t sample_rate)
+        : sample_rate_(sample_rate)
+    {
+    }
+
+    uint32_t GetSampleRate() const override
+    {
+        return sample_rate_;
+    }
+
+    void HandleCommand(const StreamCommand& command) override
+    {
+    }
+
+    void Render(float* out_buffer, size_t frame_size) override
+    {
+        std::fill(out_buffer, out_buffer + frame_size, 0.f);
+    }
+
+    void RenderWithInput(const float* in_buffer, float* out_buffer, size_t frame_size) override
+    {
+        std::copy(in_buffer, in_buffer + frame_size, out_buffer);
+    }
+
+  private:
+    uint32_t sample_rate_;
+};
+
+bool test_loopback(uint32_t delay_frames)
+{
+    FileAudioDevice device(kBufferSize);
+    device.SetInput(std::vector<float>(kDeviceSampleRate * 2, 0.f), kDeviceSampleRate);
+    device.SetLoopback(delay_frames);
+
+    LiveInputProcessor processor;
+    processor.SetDeviceFormat(device.GetSampleRate(), device.GetBufferSize());
+
+    LatencyProbe probe;
+    probe.SetSampleRate(device.GetSampleRate());
+    probe.Start(0.1f);
+    device.Run(processor, &probe, "", 0.f);
+
+    const LatencyStats stats = probe.GetStats();
+    const float expected_ms = 1000.f * delay_frames / kDeviceSampleRate;
+    std::cout << "Loopback of " << delay_frames << " frames: " << stats.mean_ms << " ms, jitter " << stats.jitter_ms
+              << " ms, " << stats.measurement_count << " measurements, " << stats.missed_count << " missed"
+              << std::endl;
+
+    return stats.measurement_count >= 19 && stats.missed_count == 0 && std::abs(stats.mean_ms - expected_ms) < 1e-3f &&
+           stats.jitter_ms < 1e-3f;
+}
+
+bool test_live_input(uint32_t source_sample_rate)
+{
+    // Impulses a fraction of a device buffer apart from each other's phase
+    const std::vector<size_t> positions = {1000, 12345, 40000};
+    std::vector<float> input(kDeviceSampleRate, 0.f);
+    for (size_t position : positions)
+    {
+        input[position] = 1.f;
+    }
+
+    FileAudioDevice device(kBufferSize);
+    device.SetInput(input, kDeviceSampleRate);
+
+    LiveInputProcessor processor;
+    processor.SetDeviceFormat(device.GetSampleRate(), device.GetBufferSize());
+    processor.Start(std::make_unique<PassthroughSource>(source_sample_rate));
+    const float latency = processor.GetProcessingLatency();
+    device.Run(processor, nullptr, "live_input_test.wav", 0.1f);
+
+    const auto& output = device.GetOutput();
+    bool success = processor.GetDropoutCount() == 0;
+    for (size_t position : positions)
+    {
+        // The band limited impulse peaks at the delay, to the nearest frame
+        const auto begin = output.begin() + static_cast<std::ptrdiff_t>(position);
+        const auto peak = std::max_element(begin, begin + 2000);
+        const auto delay = static_cast<float>(peak - begin);
+        success &= std::abs(delay - latency) <= 1.f;
+    }
+
+    std::cout << "Live input at " << source_sample_rate << " Hz: latency " << latency << " frames, "
+              << processor.GetDropoutCount() << " dropouts, " << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success &= test_loopback(kBufferSize);
+    success &= test_loopback(777);
+    success &= test_live_input(kDeviceSampleRate);
+    success &= test_live_input(11025);
+    success &= test_live_input(44100);
+    success &= test_live_input(96000);
+
+    if (!success)
+    {
+        std::cerr << "Live input test failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
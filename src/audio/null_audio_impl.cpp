@@ -0,0 +1,246 @@
+#include "null_audio_impl.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+constexpr const char* kDeviceName = "Null";
+} // namespace
+
+NullAudioManagerImpl::NullAudioManagerImpl(uint32_t sample_rate, uint32_t buffer_size, uint32_t output_channel_count)
+    : sample_rate_(sample_rate)
+    , buffer_size_(buffer_size)
+    , output_channel_count_(output_channel_count)
+    , input_buffer_(buffer_size, 0.f)
+    , output_buffer_(static_cast<size_t>(buffer_size) * output_channel_count, 0.f)
+{
+    processor_.SetFormat(sample_rate_, buffer_size_, output_channel_count_);
+}
+
+NullAudioManagerImpl::~NullAudioManagerImpl()
+{
+    StopAudioStream();
+    CloseOutputFile();
+}
+
+bool NullAudioManagerImpl::StartAudioStream()
+{
+    if (running_)
+    {
+        return true;
+    }
+    if (!OpenOutputFile())
+    {
+        return false;
+    }
+
+    running_ = true;
+    callback_thread_ = std::thread(&NullAudioManagerImpl::CallbackThread, this);
+    return true;
+}
+
+void NullAudioManagerImpl::StopAudioStream()
+{
+    running_ = false;
+    if (callback_thread_.joinable())
+    {
+        callback_thread_.join();
+    }
+    CloseOutputFile();
+}
+
+bool NullAudioManagerImpl::IsAudioStreamRunning() const
+{
+    return running_;
+}
+
+AudioStreamInfo NullAudioManagerImpl::GetAudioStreamInfo() const
+{
+    AudioStreamInfo info = {0};
+    info.sample_rate = sample_rate_;
+    info.buffer_size = buffer_size_;
+    info.num_input_channels = 1;
+    info.num_output_channels = output_channel_count_;
+    return info;
+}
+
+void NullAudioManagerImpl::SetOutputDevice(std::string_view device_name)
+{
+    if (device_name == "None")
+    {
+        StopAudioStream();
+    }
+    else if (device_name == kDeviceName)
+    {
+        StartAudioStream();
+    }
+}
+
+void NullAudioManagerImpl::SetInputDevice(std::string_view device_name)
+{
+    // The input is always silent
+}
+
+void NullAudioManagerImpl::SetAudioDriver(std::string_view driver_name)
+{
+}
+
+void NullAudioManagerImpl::SelectInputChannels(uint8_t channels)
+{
+}
+
+std::vector<std::string> NullAudioManagerImpl::GetOutputDevicesName() const
+{
+    return {"None", kDeviceName};
+}
+
+std::vector<std::string> NullAudioManagerImpl::GetInputDevicesName() const
+{
+    return {"None", kDeviceName};
+}
+
+std::vector<std::string> NullAudioManagerImpl::GetSupportedAudioDrivers() const
+{
+    return {kDeviceName};
+}
+
+std::string NullAudioManagerImpl::GetCurrentAudioDriver() const
+{
+    return kDeviceName;
+}
+
+void NullAudioManagerImpl::PlayTestTone(bool play)
+{
+    processor_.PlayTestTone(play);
+}
+
+AudioFileManager* NullAudioManagerImpl::GetAudioFileManager()
+{
+    return processor_.GetAudioFileManager();
+}
+
+StreamRenderer* NullAudioManagerImpl::GetStreamRenderer()
+{
+    return processor_.GetStreamRenderer();
+}
+
+LiveInputProcessor* NullAudioManagerImpl::GetLiveInputProcessor()
+{
+    return processor_.GetLiveInputProcessor();
+}
+
+LatencyProbe* NullAudioManagerImpl::GetLatencyProbe()
+{
+    return processor_.GetLatencyProbe();
+}
+
+DeadlineStats NullAudioManagerImpl::GetCallbackStats() const
+{
+    return processor_.GetCallbackStats();
+}
+
+void NullAudioManagerImpl::ResetDeadlineStats()
+{
+    processor_.ResetDeadlineStats();
+}
+
+void NullAudioManagerImpl::WriteStats(std::ostream& stream) const
+{
+    processor_.WriteStats(stream);
+}
+
+void NullAudioManagerImpl::Hit()
+{
+    processor_.Hit();
+}
+
+void NullAudioManagerImpl::SetRealTime(bool is_real_time)
+{
+    is_real_time_ = is_real_time;
+}
+
+void NullAudioManagerImpl::SetOutputFile(std::string_view file_name)
+{
+    CloseOutputFile();
+    output_file_name_ = file_name;
+}
+
+bool NullAudioManagerImpl::RunCallbacks(size_t callback_count)
+{
+    if (running_ || !OpenOutputFile())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < callback_count; ++i)
+    {
+        RunCallback();
+    }
+    return true;
+}
+
+bool NullAudioManagerImpl::OpenOutputFile()
+{
+    if (output_file_ != nullptr || output_file_name_.empty())
+    {
+        return true;
+    }
+
+    SF_INFO out_sf_info{0};
+    out_sf_info.channels = static_cast<int>(output_channel_count_);
+    out_sf_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    out_sf_info.samplerate = static_cast<int>(sample_rate_);
+
+    output_file_ = sf_open(output_file_name_.c_str(), SFM_WRITE, &out_sf_info);
+    if (!output_file_)
+    {
+        std::cerr << "Failed to open output file " << output_file_name_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void NullAudioManagerImpl::CloseOutputFile()
+{
+    if (output_file_ != nullptr)
+    {
+        sf_write_sync(output_file_);
+        sf_close(output_file_);
+        output_file_ = nullptr;
+    }
+}
+
+void NullAudioManagerImpl::CallbackThread()
+{
+    const auto period = std::chrono::nanoseconds(static_cast<int64_t>(buffer_size_) * 1000000000 / sample_rate_);
+    auto next_callback = std::chrono::steady_clock::now();
+
+    while (running_)
+    {
+        RunCallback();
+
+        if (is_real_time_)
+        {
+            next_callback += period;
+
+            // A late device skips ahead instead of rendering the missed buffers back to back
+            const auto now = std::chrono::steady_clock::now();
+            if (now > next_callback + period)
+            {
+                next_callback = now;
+            }
+            std::this_thread::sleep_until(next_callback);
+        }
+    }
+}
+
+void NullAudioManagerImpl::RunCallback()
+{
+    processor_.Process(input_buffer_.data(), output_buffer_.data(), buffer_size_);
+
+    if (output_file_ != nullptr)
+    {
+        sf_writef_float(output_file_, output_buffer_.data(), buffer_size_);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sndfile.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "audio.h"
+#include "audio_processor.h"
+
+/**
+ * @brief An AudioManager without a sound card, for headless machines, benchmarks and tests.
+ *
+ * A thread calls the AudioProcessor the way an audio device calls its callback: one buffer at a time, either at the
+ * pace of a device of the same format or back to back as fast as the buffers render. The input is silent. The output
+ * can be written to a sound file, outside of the timed part of the callback. RunCallbacks() drives a fixed number of
+ * callbacks on the calling thread instead, for reproducible measurements.
+ */
+class NullAudioManagerImpl : public AudioManager
+{
+  public:
+    NullAudioManagerImpl(uint32_t sample_rate = 48000, uint32_t buffer_size = 512, uint32_t output_channel_count = 2);
+    ~NullAudioManagerImpl() override;
+
+    bool StartAudioStream() override;
+    void StopAudioStream() override;
+    bool IsAudioStreamRunning() const override;
+    AudioStreamInfo GetAudioStreamInfo() const override;
+
+    void SetOutputDevice(std::string_view device_name) override;
+    void SetInputDevice(std::string_view device_name) override;
+    void SetAudioDriver(std::string_view driver_name) override;
+    void SelectInputChannels(uint8_t channels) override;
+
+    std::vector<std::string> GetOutputDevicesName() const override;
+    std::vector<std::string> GetInputDevicesName() const override;
+    std::vector<std::string> GetSupportedAudioDrivers() const override;
+    std::string GetCurrentAudioDriver() const override;
+
+    void PlayTestTone(bool play) override;
+
+    AudioFileManager* GetAudioFileManager() override;
+    StreamRenderer* GetStreamRenderer() override;
+    LiveInputProcessor* GetLiveInputProcessor() override;
+    LatencyProbe* GetLatencyProbe() override;
+    DeadlineStats GetCallbackStats() const override;
+    void ResetDeadlineStats() override;
+    void WriteStats(std::ostream& stream) const override;
+
+    void Hit() override;
+
+    /**
+     * @brief Paces the callbacks like a device, or runs them back to back.
+     * @note Applies to the next stream.
+     */
+    void SetRealTime(bool is_real_time);
+
+    /**
+     * @brief Writes the output of the next streams to a sound file, nothing if the name is empty.
+     */
+    void SetOutputFile(std::string_view file_name);
+
+    /**
+     * @brief Runs callbacks on the calling thread, back to back.
+     * @return False if the stream is running.
+     */
+    bool RunCallbacks(size_t callback_count);
+
+  private:
+    bool OpenOutputFile();
+    void CloseOutputFile();
+
+    void CallbackThread();
+    void RunCallback();
+
+    uint32_t sample_rate_;
+    uint32_t buffer_size_;
+    uint32_t output_channel_count_;
+    bool is_real_time_ = true;
+
+    std::string output_file_name_;
+    SNDFILE* output_file_ = nullptr;
+
+    AudioProcessor processor_;
+    std::vector<float> input_buffer_; ///< Silence, one device buffer
+    std::vector<float> output_buffer_;
+
+    std::thread callback_thread_;
+    std::atomic_bool running_ = false;
+};
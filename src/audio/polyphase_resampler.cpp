@@ -0,0 +1,189 @@
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+namespace
+{
+constexpr double k_kaiser_beta = 8.6;     // About 90 dB of stopband attenuation
+constexpr double k_passband_ratio = 0.9; // Cutoff relative to the lowest Nyquist frequency
+
+// Modified Bessel function of the first kind, order 0, for the Kaiser window
+double BesselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+} // namespace
+
+bool PolyphaseResampler::Init(uint32_t input_rate, uint32_t output_rate, size_t taps_per_phase)
+{
+    if (input_rate == 0 || output_rate == 0)
+    {
+        return false;
+    }
+
+    const uint64_t divisor = std::gcd(input_rate, output_rate);
+    interpolation_ = output_rate / divisor;
+    decimation_ = input_rate / divisor;
+    is_bypassed_ = interpolation_ == decimation_;
+
+    if (is_bypassed_)
+    {
+        tap_count_ = 0;
+        phase_count_ = 0;
+        phases_.clear();
+        history_.clear();
+        Reset();
+        return true;
+    }
+
+    // Downsampling narrows the passband, the filter grows to keep the same transition band
+    const size_t length_scale = (decimation_ + interpolation_ - 1) / interpolation_;
+    tap_count_ = std::max<size_t>(taps_per_phase, 1) * length_scale;
+    tap_count_ = (tap_count_ + kLaneCount - 1) / kLaneCount * kLaneCount;
+    phase_count_ = std::min<size_t>(interpolation_, kMaxPhaseCount);
+
+    // Prototype low-pass at the upsampled rate, sampled at phase_count_ points per input sample
+    const double cutoff = 0.5 * k_passband_ratio * std::min(1.0, static_cast<double>(interpolation_) / decimation_);
+    const double center = 0.5 * static_cast<double>(tap_count_ - 1);
+    const double window_scale = 1.0 / BesselI0(k_kaiser_beta);
+
+    phases_.assign(phase_count_ * tap_count_, 0.f);
+    for (size_t phase = 0; phase < phase_count_; ++phase)
+    {
+        const double offset = static_cast<double>(phase) / static_cast<double>(phase_count_);
+        float* taps = &phases_[phase * tap_count_];
+        double sum = 0.0;
+
+        // Tap i multiplies the input i - tap_count_ + 1 samples away from the newest one
+        for (size_t i = 0; i < tap_count_; ++i)
+        {
+            const double t = static_cast<double>(tap_count_ - 1 - i) + offset - center;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+
+            const double r = t / (center + 1.0);
+            const double window = r * r < 1.0 ? BesselI0(k_kaiser_beta * std::sqrt(1.0 - r * r)) * window_scale : 0.0;
+
+            const double tap = sinc * window;
+            taps[i] = static_cast<float>(tap);
+            sum += tap;
+        }
+
+        // Unity gain at DC on every phase, otherwise the phases modulate a constant signal
+        for (size_t i = 0; i < tap_count_; ++i)
+        {
+            taps[i] = static_cast<float>(taps[i] / sum);
+        }
+    }
+
+    history_.assign(2 * tap_count_, 0.f);
+    Reset();
+    return true;
+}
+
+void PolyphaseResampler::Reset()
+{
+    std::fill(history_.begin(), history_.end(), 0.f);
+    history_position_ = 0;
+    phase_ = interpolation_;
+}
+
+size_t PolyphaseResampler::GetInputFramesNeeded(size_t output_frame_count) const
+{
+    if (is_bypassed_)
+    {
+        return output_frame_count;
+    }
+    if (output_frame_count == 0)
+    {
+        return 0;
+    }
+
+    // A sample is consumed every time the position passes a multiple of L, before each output
+    return static_cast<size_t>((phase_ + (output_frame_count - 1) * decimation_) / interpolation_);
+}
+
+size_t PolyphaseResampler::GetMaxInputFramesNeeded(size_t output_frame_count) const
+{
+    if (is_bypassed_ || output_frame_count == 0)
+    {
+        return output_frame_count;
+    }
+    // The position is below L + M at the start of a block
+    const uint64_t max_phase = interpolation_ + decimation_ - 1;
+    return static_cast<size_t>((max_phase + (output_frame_count - 1) * decimation_) / interpolation_);
+}
+
+void PolyphaseResampler::Process(const float* input, size_t input_frame_count, float* output,
+                                 size_t output_frame_count)
+{
+    assert(input_frame_count == GetInputFramesNeeded(output_frame_count));
+
+    if (is_bypassed_)
+    {
+        std::copy(input, input + output_frame_count, output);
+        return;
+    }
+
+    size_t input_position = 0;
+    for (size_t i = 0; i < output_frame_count; ++i)
+    {
+        while (phase_ >= interpolation_)
+        {
+            PushSample(input[input_position++]);
+            phase_ -= interpolation_;
+        }
+
+        const float* window = &history_[history_position_];
+        const float* taps = GetPhase(phase_);
+
+        std::array<float, kLaneCount> sums{};
+        for (size_t tap = 0; tap < tap_count_; tap += kLaneCount)
+        {
+            for (size_t lane = 0; lane < kLaneCount; ++lane)
+            {
+                sums[lane] += window[tap + lane] * taps[tap + lane];
+            }
+        }
+        output[i] = std::accumulate(sums.begin(), sums.end(), 0.f);
+
+        phase_ += decimation_;
+    }
+    assert(input_position == input_frame_count);
+}
+
+float PolyphaseResampler::GetLatency() const
+{
+    return is_bypassed_ ? 0.f : 0.5f * static_cast<float>(tap_count_ - 1);
+}
+
+void PolyphaseResampler::PushSample(float sample)
+{
+    history_[history_position_] = sample;
+    history_[history_position_ + tap_count_] = sample;
+    history_position_ = history_position_ + 1 == tap_count_ ? 0 : history_position_ + 1;
+}
+
+const float* PolyphaseResampler::GetPhase(uint64_t phase) const
+{
+    // The phase at or just before the position when the table holds fewer phases than L, rounding up could need
+    // an input sample that was not pushed yet
+    const auto idx = static_cast<size_t>(phase * phase_count_ / interpolation_);
+    return &phases_[idx * tap_count_];
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Streaming resampler between two sample rates, for a mesh playing at the rate of the audio device.
+ *
+ * The ratio is reduced to output_rate / input_rate = L / M. Conceptually the input is upsampled by L, low-pass
+ * filtered and decimated by M; only the taps that meet a non-zero input are computed. The windowed sinc filter is
+ * split in L phases, each one a short FIR stored contiguously and padded to a multiple of kLaneCount taps, so the
+ * product with the input history runs in kLaneCount independent accumulators the compiler turns into SIMD.
+ *
+ * Ratios with more than kMaxPhaseCount phases use the closest earlier of kMaxPhaseCount phases, the position itself
+ * stays exact. Equal rates are passed through.
+ *
+ * Init() allocates the phase table and the history, Process() neither allocates nor locks.
+ */
+class PolyphaseResampler
+{
+  public:
+    static constexpr size_t kLaneCount = 8;
+    static constexpr size_t kMaxPhaseCount = 1024;
+
+    PolyphaseResampler() = default;
+
+    /**
+     * @brief Builds the filter for a pair of rates and resets the state.
+     * @param taps_per_phase Length of each phase when upsampling, multiplied by M / L when downsampling to keep the
+     * same transition band. Rounded up to a multiple of kLaneCount.
+     * @return False if a rate is 0.
+     */
+    bool Init(uint32_t input_rate, uint32_t output_rate, size_t taps_per_phase = 32);
+
+    /**
+     * @brief Clears the history, the next output starts on a new input sample.
+     */
+    void Reset();
+
+    /**
+     * @brief Gets the number of input frames Process() consumes to produce a number of output frames.
+     */
+    size_t GetInputFramesNeeded(size_t output_frame_count) const;
+
+    /**
+     * @brief Gets the largest GetInputFramesNeeded() for a number of output frames, whatever the state.
+     */
+    size_t GetMaxInputFramesNeeded(size_t output_frame_count) const;
+
+    /**
+     * @brief Resamples a block.
+     * @param input_frame_count Must be GetInputFramesNeeded(output_frame_count).
+     */
+    void Process(const float* input, size_t input_frame_count, float* output, size_t output_frame_count);
+
+    /**
+     * @brief Gets the delay added by the filter, in input frames.
+     */
+    float GetLatency() const;
+
+  private:
+    void PushSample(float sample);
+    const float* GetPhase(uint64_t phase) const;
+
+    uint64_t interpolation_ = 1; ///< L
+    uint64_t decimation_ = 1;    ///< M
+    bool is_bypassed_ = true;
+
+    size_t tap_count_ = 0;   ///< Taps of every phase, a multiple of kLaneCount
+    size_t phase_count_ = 0; ///< Phases in the table, L or kMaxPhaseCount
+    std::vector<float> phases_;
+
+    // Input history written twice, so the last tap_count_ samples are always contiguous
+    std::vector<float> history_;
+    size_t history_position_ = 0; ///< Oldest sample of the window
+    uint64_t phase_ = 0;          ///< Position of the next output after the newest input, in 1 / L input frames
+};
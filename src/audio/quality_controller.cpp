@@ -0,0 +1,118 @@
+#include "quality_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr double k_smoothing_ns = 50e6;
+constexpr uint64_t k_upgrade_hold_ns = 2000000000ull;
+constexpr uint64_t k_max_upgrade_hold_ns = 32000000000ull;
+constexpr float k_default_settle_seconds = 0.2f;
+constexpr uint64_t k_no_upgrade = std::numeric_limits<uint64_t>::max(); ///< No upgrade waiting to prove it fits
+} // namespace
+
+QualityController::QualityController(float degrade_load, float upgrade_load)
+    : degrade_load_(degrade_load)
+    , upgrade_load_(upgrade_load)
+    , settle_ns_(static_cast<uint64_t>(k_default_settle_seconds * 1e9))
+    , upgrade_hold_ns_(k_upgrade_hold_ns)
+    , since_upgrade_ns_(k_no_upgrade)
+{
+}
+
+void QualityController::SetTierCount(size_t tier_count)
+{
+    tier_count_ = std::max<size_t>(tier_count, 1);
+    tier_ = 0;
+    switch_count_ = 0;
+    has_load_ = false;
+    settle_remaining_ns_ = 0;
+    below_ns_ = 0;
+    upgrade_hold_ns_ = k_upgrade_hold_ns;
+    since_upgrade_ns_ = k_no_upgrade;
+}
+
+size_t QualityController::GetTierCount() const
+{
+    return tier_count_;
+}
+
+void QualityController::SetSettleTime(float seconds)
+{
+    settle_ns_ = static_cast<uint64_t>(std::max(seconds, 0.f) * 1e9);
+}
+
+size_t QualityController::Update(uint64_t duration_ns, uint64_t budget_ns)
+{
+    if (tier_count_ <= 1 || budget_ns == 0)
+    {
+        return tier_;
+    }
+    if (settle_remaining_ns_ > 0)
+    {
+        settle_remaining_ns_ -= std::min(settle_remaining_ns_, budget_ns);
+        return tier_;
+    }
+
+    if (since_upgrade_ns_ != k_no_upgrade)
+    {
+        since_upgrade_ns_ += budget_ns;
+        if (since_upgrade_ns_ >= upgrade_hold_ns_)
+        {
+            // The last upgrade held, the next one is not delayed any more
+            upgrade_hold_ns_ = k_upgrade_hold_ns;
+            since_upgrade_ns_ = k_no_upgrade;
+        }
+    }
+
+    const auto load = static_cast<float>(static_cast<double>(duration_ns) / static_cast<double>(budget_ns));
+    const auto alpha = static_cast<float>(1.0 - std::exp(-static_cast<double>(budget_ns) / k_smoothing_ns));
+    load_ = has_load_ ? load_ + (load - load_) * alpha : load;
+    has_load_ = true;
+
+    if (load_ > degrade_load_ && tier_ + 1 < tier_count_)
+    {
+        if (since_upgrade_ns_ != k_no_upgrade)
+        {
+            // The last upgrade did not fit, the next one waits longer
+            upgrade_hold_ns_ = std::min(upgrade_hold_ns_ * 2, k_max_upgrade_hold_ns);
+            since_upgrade_ns_ = k_no_upgrade;
+        }
+        Switch(tier_ + 1);
+        return tier_;
+    }
+
+    below_ns_ = load_ < upgrade_load_ ? below_ns_ + budget_ns : 0;
+    if (tier_ > 0 && below_ns_ >= upgrade_hold_ns_)
+    {
+        Switch(tier_ - 1);
+        since_upgrade_ns_ = 0;
+    }
+    return tier_;
+}
+
+size_t QualityController::GetTier() const
+{
+    return tier_;
+}
+
+float QualityController::GetLoad() const
+{
+    return load_;
+}
+
+size_t QualityController::GetSwitchCount() const
+{
+    return switch_count_;
+}
+
+void QualityController::Switch(size_t tier)
+{
+    tier_ = tier;
+    ++switch_count_;
+    has_load_ = false;
+    settle_remaining_ns_ = settle_ns_;
+    below_ns_ = 0;
+}
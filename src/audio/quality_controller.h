@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Picks the quality tier of a real-time source from the time it takes to render its blocks.
+ *
+ * Tier 0 is the full quality, each following tier is cheaper. The load of a block, its render time over the duration
+ * of the audio it renders, is smoothed over a few tens of milliseconds. Above the degrade load the controller steps one
+ * tier down, and steps back up once the load has stayed below the upgrade load for the upgrade hold time. The gap
+ * between the two loads is the hysteresis: a cheaper tier must leave room for the dearer one before it is tried again.
+ *
+ * An upgrade followed by a degrade within the hold time did not fit, the hold time then doubles, so a tier too dear
+ * for the machine is not retried every few seconds. After each switch the blocks are ignored for the settle time,
+ * which covers the crossfade of the source, when both tiers are rendered at once.
+ *
+ * The times are counted in audio, the sum of the budgets, so the controller behaves the same whatever the block size.
+ * Update() never blocks nor allocates.
+ */
+class QualityController
+{
+  public:
+    /**
+     * @param degrade_load Smoothed load above which the next cheaper tier is used.
+     * @param upgrade_load Smoothed load below which the next dearer tier is tried again.
+     */
+    QualityController(float degrade_load = 0.75f, float upgrade_load = 0.35f);
+
+    /**
+     * @brief Sets the number of tiers and goes back to the full quality.
+     */
+    void SetTierCount(size_t tier_count);
+    size_t GetTierCount() const;
+
+    /**
+     * @brief Sets the time during which the blocks are ignored after a switch.
+     */
+    void SetSettleTime(float seconds);
+
+    /**
+     * @brief Records the render time of a block.
+     * @return The tier of the next blocks.
+     */
+    size_t Update(uint64_t duration_ns, uint64_t budget_ns);
+
+    size_t GetTier() const;
+
+    /**
+     * @brief Gets the smoothed load of the current tier, 1 uses the whole budget.
+     */
+    float GetLoad() const;
+
+    size_t GetSwitchCount() const;
+
+  private:
+    void Switch(size_t tier);
+
+    float degrade_load_;
+    float upgrade_load_;
+    size_t tier_count_ = 1;
+    size_t tier_ = 0;
+    size_t switch_count_ = 0;
+
+    float load_ = 0.f;
+    bool has_load_ = false; ///< The smoothing starts over after a switch
+
+    uint64_t settle_ns_;
+    uint64_t settle_remaining_ns_ = 0;
+    uint64_t below_ns_ = 0;     ///< Time the load has stayed below the upgrade load
+    uint64_t upgrade_hold_ns_;  ///< Time below the upgrade load before an upgrade
+    uint64_t since_upgrade_ns_; ///< Time since the last upgrade, while it may still not fit
+};
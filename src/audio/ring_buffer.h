@@ -1,33 +1,115 @@
 #pragma once
 
 #include <atomic>
-#include <memory>
+#include <cstddef>
+#include <span>
+#include <type_traits>
 
+/**
+ * @brief A contiguous region of a RingBuffer, split in two where it wraps around.
+ */
+template <typename T>
+struct RingBufferSpans
+{
+    std::span<T> first;
+    std::span<T> second;
+
+    size_t size() const
+    {
+        return first.size() + second.size();
+    }
+};
+
+/**
+ * @brief Wait-free single producer, single consumer ring buffer.
+ *
+ * The capacity is a power of two and the indices grow without wrapping, so an index is turned into a position with a
+ * mask and a full buffer is told apart from an empty one without any extra flag. The write and read indices live on
+ * separate cache lines, next to the copy of the opposite index each side last loaded, so the producer and the consumer
+ * only touch the other side's cache line when their copy says the buffer is full or empty.
+ *
+ * PrepareWrite()/CommitWrite() and PeekRead()/Consume() give direct access to the storage, so a producer can render in
+ * place and a consumer can read without an intermediate copy.
+ *
+ * @note Write(), PrepareWrite() and CommitWrite() must only be called by the producer thread, Read(), Peek(),
+ * PeekRead() and Consume() by the consumer thread. Resize() and Reset() must not run concurrently with either.
+ */
 template <typename T>
 class RingBuffer
 {
+    static_assert(std::is_trivially_copyable_v<T>, "RingBuffer only holds trivially copyable types");
+
   public:
     RingBuffer(size_t size = 32768);
     ~RingBuffer();
 
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /**
+     * @brief Reallocates the buffer, rounding the capacity up to a power of two. Clears the buffer.
+     */
     void Resize(size_t size);
 
     size_t GetSize() const;
     size_t GetReadAvailable() const;
     size_t GetWriteAvailable() const;
 
-    void Write(const T* data, size_t size);
+    /**
+     * @brief Copies data into the buffer.
+     * @return The number of elements written, less than size if the buffer is full.
+     */
+    size_t Write(const T* data, size_t size);
+
+    /**
+     * @brief Copies data out of the buffer.
+     * @param size [in, out] The number of elements requested, set to the number of elements read.
+     */
     void Read(T* data, size_t& size);
+
+    /**
+     * @brief Same as Read() but leaves the data in the buffer.
+     */
     void Peek(T* data, size_t& size);
 
+    /**
+     * @brief Gets the free space to write up to size elements in place.
+     * @return The writable region, possibly smaller than size. Only visible to the consumer after CommitWrite().
+     */
+    RingBufferSpans<T> PrepareWrite(size_t size);
+
+    /**
+     * @brief Publishes elements written in the region returned by PrepareWrite().
+     */
+    void CommitWrite(size_t size);
+
+    /**
+     * @brief Gets up to size readable elements in place.
+     * @return The readable region, possibly smaller than size. Stays valid until Consume().
+     */
+    RingBufferSpans<const T> PeekRead(size_t size);
+
+    /**
+     * @brief Releases elements read from the region returned by PeekRead().
+     */
+    void Consume(size_t size);
+
     void Reset();
 
   private:
-    size_t max_size_ = 0;
-    std::atomic<size_t> read_index_ = 0;
-    std::atomic<size_t> write_index_ = 0;
-    std::atomic_bool overflow_flag_ = false;
+    static constexpr size_t kCacheLineSize = 64;
+
     T* buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+
+    // Producer side
+    alignas(kCacheLineSize) std::atomic<size_t> write_index_ = 0;
+    size_t cached_read_index_ = 0;
+
+    // Consumer side
+    alignas(kCacheLineSize) std::atomic<size_t> read_index_ = 0;
+    size_t cached_write_index_ = 0;
 };
 
 #include "ring_buffer.tpp"
\ No newline at end of file
@@ -1,10 +1,9 @@
 #pragma once
 #include "ring_buffer.h"
 
-#include <cassert>
+#include <algorithm>
+#include <bit>
 #include <cstdlib>
-#include <iostream>
-#include <type_traits>
 
 namespace
 {
@@ -13,18 +12,11 @@ void FreeBuffer(T* buffer)
 {
     if (buffer != nullptr)
     {
-        if (std::is_arithmetic<T>::value)
-        {
 #ifdef _WIN32
-            _aligned_free(buffer);
+        _aligned_free(buffer);
 #else
-            free(buffer);
+        free(buffer);
 #endif
-        }
-        else
-        {
-            free(buffer);
-        }
     }
 }
 } // namespace
@@ -44,172 +36,118 @@ RingBuffer<T>::~RingBuffer()
 template <typename T>
 void RingBuffer<T>::Resize(size_t size)
 {
-    max_size_ = size;
-
     FreeBuffer(buffer_);
 
-    if (std::is_arithmetic<T>::value)
-    {
-        const auto byte_size = max_size_ * sizeof(T);
-        const auto alignment = 64;
-        const auto padded_size = ((byte_size + alignment - 1) / alignment) * alignment;
+    capacity_ = std::bit_ceil(std::max<size_t>(size, 1));
+    mask_ = capacity_ - 1;
+
+    const auto byte_size = capacity_ * sizeof(T);
+    const auto alignment = kCacheLineSize;
+    const auto padded_size = ((byte_size + alignment - 1) / alignment) * alignment;
 #ifdef _WIN32
-        buffer_ = static_cast<T*>(_aligned_malloc(padded_size, alignment));
+    buffer_ = static_cast<T*>(_aligned_malloc(padded_size, alignment));
 #else
-        buffer_ = static_cast<T*>(aligned_alloc(alignment, padded_size));
+    buffer_ = static_cast<T*>(aligned_alloc(alignment, padded_size));
 #endif
-        max_size_ = padded_size / sizeof(T);
-    }
-    else
-    {
-        buffer_ = static_cast<T*>(malloc(max_size_ * sizeof(T)));
-    }
 
-    read_index_ = 0;
-    write_index_ = 0;
+    Reset();
 }
 
 template <typename T>
 size_t RingBuffer<T>::GetSize() const
 {
-    return max_size_;
+    return capacity_;
 }
 
 template <typename T>
 size_t RingBuffer<T>::GetReadAvailable() const
 {
-    if (overflow_flag_)
-    {
-        return max_size_;
-    }
-    return (max_size_ + write_index_ - read_index_) % max_size_;
+    const size_t read_index = read_index_.load(std::memory_order_acquire);
+    const size_t write_index = write_index_.load(std::memory_order_acquire);
+    return write_index - read_index;
 }
 
 template <typename T>
 size_t RingBuffer<T>::GetWriteAvailable() const
 {
-    if (overflow_flag_)
-    {
-        return 0;
-    }
-
-    return max_size_ - GetReadAvailable();
+    return capacity_ - GetReadAvailable();
 }
 
 template <typename T>
-void RingBuffer<T>::Write(const T* data, size_t size)
+size_t RingBuffer<T>::Write(const T* data, size_t size)
 {
-    if (size == 0)
-    {
-        return;
-    }
-
-    size_t write_available = GetWriteAvailable();
-
-    if (write_available == 0)
-    {
-        std::cerr << "RingBuffer::Write: No space to write, dropping samples" << std::endl;
-        return;
-    }
-
-    if (size > write_available)
-    {
-        std::cerr << "RingBuffer::Write: No enough space to write, dropping samples" << std::endl;
-        size = write_available;
-    }
-
-    // Check if we need to wrap around and write in two step
-    size_t write_index = write_index_ % max_size_;
-    if (write_index + size > max_size_)
-    {
-        size_t first_chunk_size = max_size_ - write_index;
-        std::copy(data, data + first_chunk_size, buffer_ + write_index);
-        std::copy(data + first_chunk_size, data + size, buffer_);
-    }
-    else
-    {
-        std::copy(data, data + size, buffer_ + write_index);
-    }
-
-    size_t new_write_index = (write_index_ + size) % max_size_;
-    if (new_write_index == read_index_)
-    {
-        overflow_flag_ = true;
-    }
-
-    write_index_.store(new_write_index);
+    auto spans = PrepareWrite(size);
+    std::copy(data, data + spans.first.size(), spans.first.begin());
+    std::copy(data + spans.first.size(), data + spans.size(), spans.second.begin());
+    CommitWrite(spans.size());
+    return spans.size();
 }
 
 template <typename T>
 void RingBuffer<T>::Read(T* data, size_t& size)
 {
-    size_t read_available = GetReadAvailable();
+    Peek(data, size);
+    Consume(size);
+}
 
-    if (read_available == 0)
-    {
-        // std::cerr << "RingBuffer::Read: No data to read" << std::endl;
-        size = 0;
-        return;
-    }
+template <typename T>
+void RingBuffer<T>::Peek(T* data, size_t& size)
+{
+    auto spans = PeekRead(size);
+    std::copy(spans.first.begin(), spans.first.end(), data);
+    std::copy(spans.second.begin(), spans.second.end(), data + spans.first.size());
+    size = spans.size();
+}
 
-    if (size > read_available)
+template <typename T>
+RingBufferSpans<T> RingBuffer<T>::PrepareWrite(size_t size)
+{
+    const size_t write_index = write_index_.load(std::memory_order_relaxed);
+    if (capacity_ - (write_index - cached_read_index_) < size)
     {
-        std::cerr << "RingBuffer::Read: No enough data to read, reading only available data" << std::endl;
-        size = read_available;
+        cached_read_index_ = read_index_.load(std::memory_order_acquire);
     }
 
-    // Check if we need to wrap around and read in two step
-    size_t read_index = read_index_ % max_size_;
-    if (read_index + size > max_size_)
-    {
-        size_t first_chunk_size = max_size_ - read_index;
-        std::copy(buffer_ + read_index, buffer_ + read_index + first_chunk_size, data);
-        std::copy(buffer_, buffer_ + size - first_chunk_size, data + first_chunk_size);
-    }
-    else
-    {
-        std::copy(buffer_ + read_index, buffer_ + read_index + size, data);
-    }
+    size = std::min(size, capacity_ - (write_index - cached_read_index_));
 
-    read_index_.store((read_index_ + size) % max_size_);
-    overflow_flag_ = false;
+    const size_t position = write_index & mask_;
+    const size_t first_size = std::min(size, capacity_ - position);
+    return {std::span<T>(buffer_ + position, first_size), std::span<T>(buffer_, size - first_size)};
 }
 
 template <typename T>
-void RingBuffer<T>::Peek(T* data, size_t& size)
+void RingBuffer<T>::CommitWrite(size_t size)
 {
-    size_t read_available = GetReadAvailable();
+    write_index_.store(write_index_.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
 
-    if (read_available == 0)
+template <typename T>
+RingBufferSpans<const T> RingBuffer<T>::PeekRead(size_t size)
+{
+    const size_t read_index = read_index_.load(std::memory_order_relaxed);
+    if (cached_write_index_ - read_index < size)
     {
-        // std::cerr << "RingBuffer::Read: No data to read" << std::endl;
-        size = 0;
-        return;
+        cached_write_index_ = write_index_.load(std::memory_order_acquire);
     }
 
-    if (size > read_available)
-    {
-        std::cerr << "RingBuffer::Read: No enough data to read, reading only available data" << std::endl;
-        size = read_available;
-    }
+    size = std::min(size, cached_write_index_ - read_index);
 
-    // Check if we need to wrap around and read in two step
-    size_t read_index = read_index_ % max_size_;
-    if (read_index + size > max_size_)
-    {
-        size_t first_chunk_size = max_size_ - read_index;
-        std::copy(buffer_ + read_index, buffer_ + read_index + first_chunk_size, data);
-        std::copy(buffer_, buffer_ + size - first_chunk_size, data + first_chunk_size);
-    }
-    else
-    {
-        std::copy(buffer_ + read_index, buffer_ + read_index + size, data);
-    }
+    const size_t position = read_index & mask_;
+    const size_t first_size = std::min(size, capacity_ - position);
+    return {std::span<const T>(buffer_ + position, first_size), std::span<const T>(buffer_, size - first_size)};
+}
+
+template <typename T>
+void RingBuffer<T>::Consume(size_t size)
+{
+    read_index_.store(read_index_.load(std::memory_order_relaxed) + size, std::memory_order_release);
 }
 
 template <typename T>
 void RingBuffer<T>::Reset()
 {
-    read_index_ = 0;
-    write_index_ = 0;
+    write_index_.store(0, std::memory_order_relaxed);
+    read_index_.store(0, std::memory_order_relaxed);
+    cached_read_index_ = 0;
+    cached_write_index_ = 0;
 }
\ No newline at end of file
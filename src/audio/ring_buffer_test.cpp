@@ -0,0 +1,177 @@
+#include "ring_buffer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// A producer thread writes a running counter in chunks of random size, a consumer thread reads it back in chunks of
+// random size and checks that no value is lost, repeated or out of order, through the copy and the in place APIs.
+
+constexpr size_t kStressCapacity = 1000; // Rounded up to 1024
+constexpr uint32_t kStressCount = 1 << 22;
+constexpr size_t kMaxChunkSize = 300;
+
+bool test_capacity()
+{
+    bool success = true;
+    RingBuffer<float> buffer(1000);
+    success &= buffer.GetSize() == 1024;
+
+    for (size_t size : {0, 1, 2, 3, 64, 65, 4096})
+    {
+        buffer.Resize(size);
+        const size_t expected = size <= 1 ? 1 : std::bit_ceil(size);
+        success &= buffer.GetSize() == expected;
+        success &= buffer.GetReadAvailable() == 0 && buffer.GetWriteAvailable() == expected;
+    }
+
+    std::cout << "Capacity: " << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+bool test_wrap_around()
+{
+    bool success = true;
+    RingBuffer<uint32_t> buffer(8);
+    const std::vector<uint32_t> data = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+    // Moves the indices past the middle of the storage
+    success &= buffer.Write(data.data(), 5) == 5;
+    std::vector<uint32_t> out(8);
+    size_t size = 3;
+    buffer.Read(out.data(), size);
+    success &= size == 3 && out[0] == 0 && out[2] == 2;
+
+    // The free space wraps around the end of the storage
+    auto write_spans = buffer.PrepareWrite(6);
+    success &= write_spans.first.size() == 3 && write_spans.second.size() == 3;
+    success &= buffer.Write(data.data() + 5, 7) == 6;
+    success &= buffer.GetWriteAvailable() == 0 && buffer.Write(data.data(), 1) == 0;
+
+    // Peek leaves the data in place, the readable region wraps as well
+    size = 8;
+    buffer.Peek(out.data(), size);
+    success &= size == 8 && buffer.GetReadAvailable() == 8;
+    auto read_spans = buffer.PeekRead(8);
+    success &= read_spans.first.size() == 5 && read_spans.second.size() == 3;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        success &= out[i] == data[i + 3];
+    }
+
+    buffer.Consume(8);
+    success &= buffer.GetReadAvailable() == 0 && buffer.PeekRead(1).size() == 0;
+
+    std::cout << "Wrap around: " << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+bool test_two_threads(bool write_in_place, bool read_in_place)
+{
+    RingBuffer<uint32_t> buffer(kStressCapacity);
+
+    std::thread producer([&] {
+        std::minstd_rand random(1);
+        std::uniform_int_distribution<size_t> chunk_size(1, kMaxChunkSize);
+        std::vector<uint32_t> chunk(kMaxChunkSize);
+        uint32_t next = 0;
+        while (next < kStressCount)
+        {
+            const size_t size = std::min<size_t>(chunk_size(random), kStressCount - next);
+            if (write_in_place)
+            {
+                auto spans = buffer.PrepareWrite(size);
+                for (auto& value : spans.first)
+                {
+                    value = next++;
+                }
+                for (auto& value : spans.second)
+                {
+                    value = next++;
+                }
+                buffer.CommitWrite(spans.size());
+            }
+            else
+            {
+                for (size_t i = 0; i < size; ++i)
+                {
+                    chunk[i] = next + static_cast<uint32_t>(i);
+                }
+                next += static_cast<uint32_t>(buffer.Write(chunk.data(), size));
+            }
+
+            // Lets the consumer run when both threads share a core
+            if (buffer.GetWriteAvailable() == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    size_t error_count = 0;
+    std::minstd_rand random(2);
+    std::uniform_int_distribution<size_t> chunk_size(1, kMaxChunkSize);
+    std::vector<uint32_t> chunk(kMaxChunkSize);
+    uint32_t expected = 0;
+    while (expected < kStressCount)
+    {
+        size_t size = chunk_size(random);
+        if (read_in_place)
+        {
+            auto spans = buffer.PeekRead(size);
+            for (uint32_t value : spans.first)
+            {
+                error_count += value != expected++;
+            }
+            for (uint32_t value : spans.second)
+            {
+                error_count += value != expected++;
+            }
+            buffer.Consume(spans.size());
+        }
+        else
+        {
+            buffer.Read(chunk.data(), size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                error_count += chunk[i] != expected++;
+            }
+        }
+
+        if (buffer.GetReadAvailable() == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    const bool success = error_count == 0 && buffer.GetReadAvailable() == 0;
+    std::cout << "Two threads, " << (write_in_place ? "in place" : "copy") << " write, "
+              << (read_in_place ? "in place" : "copy") << " read: " << error_count << " errors, "
+              << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success &= test_capacity();
+    success &= test_wrap_around();
+    success &= test_two_threads(false, false);
+    success &= test_two_threads(true, true);
+    success &= test_two_threads(false, true);
+    success &= test_two_threads(true, false);
+
+    if (!success)
+    {
+        std::cerr << "Ring buffer test failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,11 +1,8 @@
 #include "rtaudio_impl.h"
 
-#include "audio_file_manager.h"
-#include "ring_buffer.tpp"
-#include "sndfile_manager_impl.h"
+#include "rt_log.h"
 
 #include <RtAudio.h>
-#include <_string.h>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -35,7 +32,8 @@ RtAudioManagerImpl::RtAudioManagerImpl()
     current_output_device_id_ = rtaudio_->getDefaultOutputDevice();
     current_input_device_id_ = -1;
 
-    audio_file_manager_ = std::make_unique<SndFileManagerImpl>();
+    // Started here, the callback only queues its messages
+    get_rt_log();
 }
 
 RtAudioManagerImpl::~RtAudioManagerImpl()
@@ -73,6 +71,9 @@ bool RtAudioManagerImpl::StartAudioStream()
         return false;
     }
 
+    // The device may not use the requested buffer size, set the format before the callback starts
+    processor_.SetFormat(sample_rate_, buffer_frames, out_parameters.nChannels);
+
     error = rtaudio_->startStream();
     if (error != RTAUDIO_NO_ERROR)
     {
@@ -85,8 +86,6 @@ bool RtAudioManagerImpl::StartAudioStream()
     input_stream_parameters_ = in_parameters;
     buffer_size_ = buffer_frames;
 
-    test_tone_.SetSampleRate(sample_rate_);
-
     std::cout << "Audio stream started" << std::endl;
 
     return true;
@@ -266,17 +265,47 @@ std::string RtAudioManagerImpl::GetCurrentAudioDriver() const
 
 void RtAudioManagerImpl::PlayTestTone(bool play)
 {
-    play_test_tone_ = play;
+    processor_.PlayTestTone(play);
 }
 
 AudioFileManager* RtAudioManagerImpl::GetAudioFileManager()
 {
-    return audio_file_manager_.get();
+    return processor_.GetAudioFileManager();
+}
+
+StreamRenderer* RtAudioManagerImpl::GetStreamRenderer()
+{
+    return processor_.GetStreamRenderer();
+}
+
+LiveInputProcessor* RtAudioManagerImpl::GetLiveInputProcessor()
+{
+    return processor_.GetLiveInputProcessor();
+}
+
+LatencyProbe* RtAudioManagerImpl::GetLatencyProbe()
+{
+    return processor_.GetLatencyProbe();
+}
+
+DeadlineStats RtAudioManagerImpl::GetCallbackStats() const
+{
+    return processor_.GetCallbackStats();
+}
+
+void RtAudioManagerImpl::ResetDeadlineStats()
+{
+    processor_.ResetDeadlineStats();
+}
+
+void RtAudioManagerImpl::WriteStats(std::ostream& stream) const
+{
+    processor_.WriteStats(stream);
 }
 
 void RtAudioManagerImpl::Hit()
 {
-    queue_hit_ = true;
+    processor_.Hit();
 }
 
 int RtAudioManagerImpl::RtAudioCbStatic(void* outputBuffer, void* inputBuffer, unsigned int nBufferFrames,
@@ -291,35 +320,17 @@ int RtAudioManagerImpl::RtAudioCbImpl(void* outputBuffer, void* inputBuffer, uns
 {
     if (status & RTAUDIO_INPUT_OVERFLOW)
     {
-        std::cerr << "Stream overflow detected!" << std::endl;
+        get_rt_log().log(RtLogLevel::WARNING, "Stream overflow detected at {:.3f}s", streamTime);
     }
     if (status & RTAUDIO_OUTPUT_UNDERFLOW)
     {
-        std::cerr << "Stream underflow detected!" << std::endl;
+        get_rt_log().log(RtLogLevel::WARNING, "Stream underflow detected at {:.3f}s", streamTime);
     }
 
-    float* output = static_cast<float*>(outputBuffer);
-    float test_tone = 0.f;
-    float* input = static_cast<float*>(inputBuffer);
-
-    if (output)
+    // The input is mono, see StartAudioStream(), and is missing without an input device
+    if (outputBuffer)
     {
-        memset(output, 0, nBufferFrames * output_stream_parameters_.nChannels * sizeof(float));
-        audio_file_manager_->ProcessBlock(output, nBufferFrames, output_stream_parameters_.nChannels);
-        // Just write silence for now
-        for (auto i = 0; i < nBufferFrames; i++)
-        {
-            float tick = 0.f;
-            if (play_test_tone_)
-            {
-                test_tone = test_tone_.Tick();
-            }
-
-            for (auto j = 0; j < output_stream_parameters_.nChannels; j++)
-            {
-                output[(i * output_stream_parameters_.nChannels) + j] += test_tone + tick;
-            }
-        }
+        processor_.Process(static_cast<const float*>(inputBuffer), static_cast<float*>(outputBuffer), nBufferFrames);
     }
 
     return 0;
@@ -9,12 +9,10 @@
 #include <sndfile.h>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "audio.h"
-#include "audio_file_manager.h"
-#include "test_tone.h"
-
-class AudioFileManager;
+#include "audio_processor.h"
 
 #ifdef TWO_PI
 #undef TWO_PI
@@ -45,7 +43,16 @@ class RtAudioManagerImpl : public AudioManager
     void PlayTestTone(bool play) override;
 
     AudioFileManager* GetAudioFileManager() override;
-
+    StreamRenderer* GetStreamRenderer() override;
+    LiveInputProcessor* GetLiveInputProcessor() override;
+    LatencyProbe* GetLatencyProbe() override;
+    DeadlineStats GetCallbackStats() const override;
+    void ResetDeadlineStats() override;
+    void WriteStats(std::ostream& stream) const override;
+
+    /**
+     * @brief Strikes the sources played by the stream renderer and the live input, if any.
+     */
     void Hit() override;
 
   private:
@@ -67,12 +74,5 @@ class RtAudioManagerImpl : public AudioManager
     uint32_t sample_rate_ = 48000;
     RtAudio::Api current_audio_api_ = RtAudio::Api::UNSPECIFIED;
 
-    bool play_test_tone_ = false;
-
-    TestToneGenerator test_tone_;
-
-    std::unique_ptr<AudioFileManager> audio_file_manager_;
-
-    // STK
-    std::atomic_bool queue_hit_ = false;
+    AudioProcessor processor_;
 };
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "stream_renderer.h"
+
+#include "denormal.h"
+#include "ring_buffer.tpp"
+#include "rt_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace
+{
+constexpr size_t kCommandQueueSize = 256;
+} // namespace
+
+StreamRenderer::StreamRenderer()
+    : command_buffer_(kCommandQueueSize)
+{
+}
+
+StreamRenderer::~StreamRenderer()
+{
+    Stop();
+}
+
+void StreamRenderer::SetDeviceFormat(uint32_t sample_rate, uint32_t buffer_size)
+{
+    if (sample_rate == device_sample_rate_ && buffer_size == device_buffer_size_)
+    {
+        return;
+    }
+
+    const bool was_running = IsRunning();
+    Stop();
+
+    device_sample_rate_ = sample_rate;
+    device_buffer_size_ = buffer_size;
+
+    // The ring buffer is only resized here, while the audio callback is not running. Room for the largest render
+    // ahead and the block being written.
+    audio_buffer_.Resize(static_cast<size_t>(buffer_size) * 8);
+
+    if (was_running)
+    {
+        Start(std::move(source_), render_ahead_);
+    }
+}
+
+bool StreamRenderer::Start(std::unique_ptr<StreamSource> source, uint32_t render_ahead)
+{
+    Stop();
+
+    if (device_sample_rate_ == 0 || device_buffer_size_ == 0)
+    {
+        std::cerr << "StreamRenderer::Start: device format not set" << std::endl;
+        return false;
+    }
+
+    if (!source || source->GetSampleRate() == 0)
+    {
+        std::cerr << "StreamRenderer::Start: invalid source" << std::endl;
+        return false;
+    }
+
+    source_ = std::move(source);
+    render_ahead_ = std::clamp<uint32_t>(render_ahead, 1, 7);
+
+    audio_buffer_.Reset();
+    command_buffer_.Reset();
+    underrun_count_ = 0;
+    render_monitor_.Reset();
+
+    resampler_.Init(source_->GetSampleRate(), device_sample_rate_);
+    source_block_.assign(resampler_.GetMaxInputFramesNeeded(device_buffer_size_), 0.f);
+
+    // Prime the buffer so the first callbacks do not underrun while the render thread starts
+    {
+        ScopedFlushDenormals flush_denormals;
+        for (uint32_t i = 0; i < render_ahead_; ++i)
+        {
+            RenderBlock();
+        }
+    }
+
+    running_ = true;
+    render_thread_ = std::thread(&StreamRenderer::RenderThread, this);
+
+    return true;
+}
+
+void StreamRenderer::Stop()
+{
+    running_ = false;
+    if (render_thread_.joinable())
+    {
+        render_thread_.join();
+    }
+
+    // Paired with Process(): either the callback sees the renderer stopped, or it is seen processing here. Start()
+    // resets the audio buffer, which must not happen under a read.
+    while (processing_)
+    {
+        std::this_thread::yield();
+    }
+}
+
+bool StreamRenderer::IsRunning() const
+{
+    return running_;
+}
+
+bool StreamRenderer::PostCommand(const StreamCommand& command)
+{
+    if (!running_)
+    {
+        return false;
+    }
+
+    return command_buffer_.Write(&command, 1) == 1;
+}
+
+void StreamRenderer::Process(float* out_buffer, size_t frame_size)
+{
+    processing_ = true;
+    if (!running_)
+    {
+        processing_ = false;
+        std::fill(out_buffer, out_buffer + frame_size, 0.f);
+        return;
+    }
+
+    size_t read_size = std::min(frame_size, audio_buffer_.GetReadAvailable());
+    audio_buffer_.Read(out_buffer, read_size);
+
+    if (read_size < frame_size)
+    {
+        std::fill(out_buffer + read_size, out_buffer + frame_size, 0.f);
+        underrun_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    processing_ = false;
+}
+
+uint32_t StreamRenderer::GetUnderrunCount() const
+{
+    return underrun_count_;
+}
+
+size_t StreamRenderer::GetBufferedFrames() const
+{
+    if (!running_)
+    {
+        return 0;
+    }
+    return audio_buffer_.GetReadAvailable();
+}
+
+uint32_t StreamRenderer::GetQualityTier() const
+{
+    return source_ ? source_->GetQualityTier() : 0;
+}
+
+DeadlineStats StreamRenderer::GetRenderStats() const
+{
+    return render_monitor_.GetStats();
+}
+
+void StreamRenderer::ResetRenderStats()
+{
+    render_monitor_.Reset();
+}
+
+void StreamRenderer::RenderThread()
+{
+    // The sources tick meshes whose tails would otherwise fall into the subnormal range
+    enable_flush_denormals();
+
+    const size_t target_frames = static_cast<size_t>(render_ahead_) * device_buffer_size_;
+
+    // Poll a few times per device buffer, often enough to refill the buffer before the next callback
+    const auto poll_period =
+        std::chrono::microseconds(static_cast<int64_t>(250000.0 * device_buffer_size_ / device_sample_rate_));
+
+    // Rendering a block must take less than playing it, whatever is buffered ahead
+    const uint64_t budget_ns = static_cast<uint64_t>(device_buffer_size_) * 1000000000ull / device_sample_rate_;
+
+    while (running_)
+    {
+        while (running_ && audio_buffer_.GetReadAvailable() < target_frames)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            ApplyCommands();
+            RenderBlock();
+            const auto end = std::chrono::steady_clock::now();
+
+            const auto duration_ns = static_cast<uint64_t>(std::chrono::nanoseconds(end - start).count());
+            if (render_monitor_.Record(duration_ns, budget_ns))
+            {
+                get_rt_log().log(RtLogLevel::WARNING, "Xrun predicted: the stream renderer nears {:.0f} us per block",
+                                 budget_ns / 1000.0);
+            }
+        }
+
+        std::this_thread::sleep_for(poll_period);
+    }
+}
+
+void StreamRenderer::RenderBlock()
+{
+    // Render in place, the block may wrap around the end of the ring buffer
+    auto spans = audio_buffer_.PrepareWrite(device_buffer_size_);
+    RenderResampled(spans.first.data(), spans.first.size());
+    RenderResampled(spans.second.data(), spans.second.size());
+    audio_buffer_.CommitWrite(spans.size());
+}
+
+void StreamRenderer::RenderResampled(float* out_buffer, size_t frame_size)
+{
+    // The source renders exactly what the resampler consumes, no source frame waits between two blocks
+    const size_t source_frame_count = resampler_.GetInputFramesNeeded(frame_size);
+    if (source_frame_count > 0)
+    {
+        source_->Render(source_block_.data(), source_frame_count);
+    }
+    resampler_.Process(source_block_.data(), source_frame_count, out_buffer, frame_size);
+}
+
+void StreamRenderer::ApplyCommands()
+{
+    auto commands = command_buffer_.PeekRead(command_buffer_.GetSize());
+    for (const auto& command : commands.first)
+    {
+        source_->HandleCommand(command);
+    }
+    for (const auto& command : commands.second)
+    {
+        source_->HandleCommand(command);
+    }
+    command_buffer_.Consume(commands.size());
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "deadline_monitor.h"
+#include "polyphase_resampler.h"
+#include "ring_buffer.h"
+
+enum class StreamCommandType : uint8_t
+{
+    kHit,          ///< Strike, value is the velocity
+    kSetParameter, ///< Sets a parameter of the source, see StreamCommand::parameter
+};
+
+/**
+ * @brief A message sent from the UI to the source played by a StreamRenderer.
+ */
+struct StreamCommand
+{
+    StreamCommandType type = StreamCommandType::kHit;
+    uint32_t parameter = 0; ///< Meaning defined by the source, for kSetParameter
+    float value = 0.f;
+};
+
+/**
+ * @brief A mono signal rendered on demand, for instance a mesh and its listener.
+ * @note Every method but GetQualityTier() is called from the render thread of the StreamRenderer.
+ */
+class StreamSource
+{
+  public:
+    StreamSource() = default;
+    virtual ~StreamSource() = default;
+
+    virtual uint32_t GetSampleRate() const = 0;
+    virtual void HandleCommand(const StreamCommand& command) = 0;
+    virtual void Render(float* out_buffer, size_t frame_size) = 0;
+
+    /**
+     * @brief Renders while driven by a live input, one input sample per output sample at the same position.
+     * @param in_buffer The input at the rate of the source. Ignored by default.
+     */
+    virtual void RenderWithInput(const float* in_buffer, float* out_buffer, size_t frame_size)
+    {
+        Render(out_buffer, frame_size);
+    }
+
+    /**
+     * @brief Gets the quality the source renders with, 0 for its full quality, its meaning is defined by the source.
+     * @note Called from any thread while the source plays.
+     */
+    virtual uint32_t GetQualityTier() const
+    {
+        return 0;
+    }
+};
+
+/**
+ * @brief Plays a StreamSource in real time.
+ *
+ * A render thread keeps a bounded amount of audio rendered ahead of the device, render_ahead device buffers, in a
+ * lock-free ring buffer read by the audio callback. The source runs at its own sample rate, usually the cheapest one
+ * that sounds right, and a PolyphaseResampler brings it to the device rate. Commands are passed to the render thread
+ * through a second lock-free ring buffer and applied at the start of the next rendered block, so the latency of a hit
+ * is at most render_ahead + 1 device buffers.
+ */
+class StreamRenderer
+{
+  public:
+    StreamRenderer();
+    ~StreamRenderer();
+
+    StreamRenderer(const StreamRenderer&) = delete;
+    StreamRenderer& operator=(const StreamRenderer&) = delete;
+
+    /**
+     * @brief Sets the format of the audio device.
+     * @note Must not be called while the audio callback may be running. Restarts the current source, if any.
+     */
+    void SetDeviceFormat(uint32_t sample_rate, uint32_t buffer_size);
+
+    /**
+     * @brief Starts playing a source, replacing the current one.
+     * @param render_ahead Number of device buffers rendered ahead of the device. 1 or 2 keeps the latency low, more
+     * leaves room for a source whose render time varies.
+     * @return False if the device format is not set.
+     */
+    bool Start(std::unique_ptr<StreamSource> source, uint32_t render_ahead = 2);
+
+    /**
+     * @brief Stops the render thread and waits for the audio callback to leave Process().
+     */
+    void Stop();
+    bool IsRunning() const;
+
+    /**
+     * @brief Queues a command for the source.
+     * @return False if the queue is full or no source is playing.
+     * @note Not meant to be called from several threads at once.
+     */
+    bool PostCommand(const StreamCommand& command);
+
+    /**
+     * @brief Reads the next block of audio, called from the audio callback.
+     * @param out_buffer Mono output, filled with silence when nothing is playing.
+     * @note Never blocks. Missing samples are replaced with silence and counted as an underrun.
+     */
+    void Process(float* out_buffer, size_t frame_size);
+
+    /**
+     * @brief Gets the number of device buffers that could not be filled since the source was started.
+     */
+    uint32_t GetUnderrunCount() const;
+
+    /**
+     * @brief Gets the number of frames rendered ahead of the device.
+     */
+    size_t GetBufferedFrames() const;
+
+    /**
+     * @brief Gets the quality tier of the current source, see StreamSource::GetQualityTier().
+     * @note Called from the thread starting the sources.
+     */
+    uint32_t GetQualityTier() const;
+
+    /**
+     * @brief Gets the time spent rendering each device buffer against its duration, since the source was started.
+     */
+    DeadlineStats GetRenderStats() const;
+    void ResetRenderStats();
+
+  private:
+    void RenderThread();
+
+    /**
+     * @brief Renders one device buffer directly into the ring buffer.
+     */
+    void RenderBlock();
+
+    /**
+     * @brief Renders frames at the device rate, resampling the output of the source.
+     */
+    void RenderResampled(float* out_buffer, size_t frame_size);
+
+    void ApplyCommands();
+
+    uint32_t device_sample_rate_ = 0;
+    uint32_t device_buffer_size_ = 0;
+    uint32_t render_ahead_ = 2;
+
+    std::unique_ptr<StreamSource> source_;
+    std::thread render_thread_;
+    std::atomic_bool running_ = false;
+    std::atomic_bool processing_ = false; ///< Set by the callback while it reads the audio buffer
+
+    RingBuffer<float> audio_buffer_;
+    RingBuffer<StreamCommand> command_buffer_;
+
+    PolyphaseResampler resampler_;
+    std::vector<float> source_block_; ///< Room for the source frames resampled into one device buffer
+
+    std::atomic<uint32_t> underrun_count_ = 0;
+    DeadlineMonitor render_monitor_;
+};
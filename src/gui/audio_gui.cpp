@@ -1,7 +1,10 @@
 #include "audio_gui.h"
 
 #include "audio.h"
+#include "audio_processor.h"
+#include "deadline_monitor.h"
 #include "imgui.h"
+#include "latency_probe.h"
 
 #include <cassert>
 #include <cmath>
@@ -84,9 +87,59 @@ void draw_audio_device_gui(AudioManager* audio_manager)
     ImGui::Text("Buffer Size: %d", audio_stream_info.buffer_size);
     ImGui::Text("Num Output Channels: %d", audio_stream_info.num_output_channels);
 
+    // Time spent in the callback against the duration of its buffer
+    ImGui::SeparatorText("Audio callback");
+    draw_deadline_stats(audio_manager->GetCallbackStats());
+    if (ImGui::Button("Reset##deadline_stats"))
+    {
+        audio_manager->ResetDeadlineStats();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump Stats"))
+    {
+        audio_manager->WriteStats(std::cout);
+    }
+
     static bool play_test_tone = false;
     if (ImGui::Checkbox("Play Test Tone", &play_test_tone))
     {
         audio_manager->PlayTestTone(play_test_tone);
     }
+
+    // Pulses sent to the output and heard back on the input, through a loopback cable
+    ImGui::SeparatorText("Round trip latency");
+    LatencyProbe* latency_probe = audio_manager->GetLatencyProbe();
+    if (ImGui::Button(latency_probe->IsRunning() ? "Stop Measuring" : "Measure"))
+    {
+        if (latency_probe->IsRunning())
+        {
+            latency_probe->Stop();
+        }
+        else
+        {
+            latency_probe->Start();
+        }
+    }
+
+    const LatencyStats stats = latency_probe->GetStats();
+    ImGui::Text("Round trip: %0.2f ms (min %0.2f, max %0.2f)", stats.mean_ms, stats.min_ms, stats.max_ms);
+    ImGui::Text("Jitter: %0.3f ms", stats.jitter_ms);
+    ImGui::Text("Measurements: %u, missed: %u", stats.measurement_count, stats.missed_count);
+}
+
+void draw_deadline_stats(const DeadlineStats& stats)
+{
+    ImGui::Text("Load: %0.1f%% of %0.0f us", 100.f * stats.load, stats.budget_us);
+    ImGui::Text("p50 %0.0f us, p99 %0.0f us, p99.9 %0.0f us, max %0.0f us", stats.p50_us, stats.p99_us, stats.p999_us,
+                stats.max_us);
+    ImGui::Text("Late: %llu, Near Misses: %llu", static_cast<unsigned long long>(stats.late_count),
+                static_cast<unsigned long long>(stats.near_miss_count));
+    if (stats.is_xrun_predicted)
+    {
+        ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Xrun predicted, recent p99 %0.0f us", stats.recent_p99_us);
+    }
+    else
+    {
+        ImGui::Text("Recent p99: %0.0f us", stats.recent_p99_us);
+    }
 }
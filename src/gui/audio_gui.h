@@ -3,5 +3,11 @@
 #include "audio.h"
 
 class AudioManager;
+struct DeadlineStats;
 
 void draw_audio_device_gui(AudioManager* audio_manager);
+
+/**
+ * @brief Draws how close the blocks of a real-time path come to their deadline, see DeadlineMonitor.
+ */
+void draw_deadline_stats(const DeadlineStats& stats);
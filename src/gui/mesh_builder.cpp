@@ -0,0 +1,120 @@
+#include "mesh_builder.h"
+
+#include "denormal.h"
+
+#include <utility>
+
+MeshBuilder::MeshBuilder(std::chrono::milliseconds debounce)
+    : debounce_(debounce)
+{
+    thread_ = std::thread(&MeshBuilder::worker_loop, this);
+}
+
+MeshBuilder::~MeshBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        // Cancels the running build
+        generation_++;
+    }
+    condition_.notify_one();
+    thread_.join();
+
+    delete result_.exchange(nullptr);
+}
+
+void MeshBuilder::request(MeshBuildFunction build)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = std::move(build);
+        start_time_ = std::chrono::steady_clock::now() + debounce_;
+        generation_++;
+    }
+    condition_.notify_one();
+}
+
+std::unique_ptr<MeshBuild> MeshBuilder::build_now(const MeshBuildFunction& build)
+{
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = nullptr;
+        generation = ++generation_;
+    }
+
+    std::unique_ptr<MeshBuild> result = build(MeshBuildToken(generation_, generation));
+
+    // Drops a result published by the worker before this build, destroyed once the lock is released
+    std::unique_ptr<MeshBuild> stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed_generation_ = generation;
+        stale.reset(result_.exchange(nullptr));
+    }
+    return result;
+}
+
+std::unique_ptr<MeshBuild> MeshBuilder::take_result()
+{
+    return std::unique_ptr<MeshBuild>(result_.exchange(nullptr, std::memory_order_acquire));
+}
+
+bool MeshBuilder::is_busy() const
+{
+    return completed_generation_.load() != generation_.load();
+}
+
+void MeshBuilder::worker_loop()
+{
+    enable_flush_denormals();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        condition_.wait(lock, [this] { return stop_ || pending_ != nullptr; });
+
+        // Every new request pushes the start time back
+        while (!stop_ && std::chrono::steady_clock::now() < start_time_)
+        {
+            condition_.wait_until(lock, start_time_);
+        }
+
+        if (stop_)
+        {
+            return;
+        }
+        if (pending_ == nullptr)
+        {
+            // Taken over by build_now() while waiting
+            continue;
+        }
+
+        MeshBuildFunction build = std::move(pending_);
+        pending_ = nullptr;
+        const uint64_t generation = generation_.load();
+        lock.unlock();
+
+        MeshBuildToken token(generation_, generation);
+        std::unique_ptr<MeshBuild> result = build(token);
+
+        // Published under the lock so a build_now() in between can not be overwritten by an older build
+        lock.lock();
+        if (!token.is_cancelled())
+        {
+            if (result != nullptr)
+            {
+                // A result the GUI did not take yet is stale
+                result.reset(result_.exchange(result.release(), std::memory_order_acq_rel));
+            }
+            completed_generation_ = generation;
+        }
+
+        // The stale or cancelled result is freed unlocked, a mesh takes a while to free and the GUI may wait
+        lock.unlock();
+        result.reset();
+        build = nullptr;
+        lock.lock();
+    }
+}
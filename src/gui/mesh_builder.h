@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mat2d.h"
+#include "mesh_2d.h"
+
+/**
+ * @brief A mesh built in the background, with everything the GUI needs to display it.
+ */
+struct MeshBuild
+{
+    std::unique_ptr<Mesh2D> mesh;
+    Mat2D<uint8_t> mask;                ///< Mask the mesh was built with
+    std::vector<glm::vec3> line_starts; ///< Segments of the mesh, uploaded to the GPU by the GUI thread
+    std::vector<glm::vec3> line_ends;
+};
+
+/**
+ * @brief Tells a build whether a newer request made it useless.
+ */
+class MeshBuildToken
+{
+  public:
+    MeshBuildToken(const std::atomic<uint64_t>& current_generation, uint64_t generation)
+        : current_generation_(current_generation)
+        , generation_(generation)
+    {
+    }
+
+    bool is_cancelled() const
+    {
+        return current_generation_.load(std::memory_order_relaxed) != generation_;
+    }
+
+  private:
+    const std::atomic<uint64_t>& current_generation_;
+    uint64_t generation_;
+};
+
+/**
+ * @brief Builds a mesh from a snapshot of the parameters, returns nullptr if cancelled or if the build failed.
+ * @note Runs on the builder thread, must not touch the state of the GUI.
+ */
+using MeshBuildFunction = std::function<std::unique_ptr<MeshBuild>(const MeshBuildToken& token)>;
+
+/**
+ * @class MeshBuilder
+ * @brief Builds meshes on a background thread so the GUI never waits for a rebuild.
+ *
+ * A request only starts once no other request came in for the debounce time, so dragging a slider builds the mesh
+ * once it settles instead of on every frame. A new request cancels the build in progress, which gives up at its next
+ * check of the token. The finished build is published with an atomic pointer swap and picked up by the GUI thread
+ * with take_result(), which never blocks.
+ */
+class MeshBuilder
+{
+  public:
+    explicit MeshBuilder(std::chrono::milliseconds debounce = std::chrono::milliseconds(50));
+    ~MeshBuilder();
+
+    MeshBuilder(const MeshBuilder&) = delete;
+    MeshBuilder& operator=(const MeshBuilder&) = delete;
+
+    /**
+     * @brief Schedules a build, replacing the pending request and cancelling the running build.
+     */
+    void request(MeshBuildFunction build);
+
+    /**
+     * @brief Builds on the calling thread, replacing the pending request and cancelling the running build.
+     */
+    std::unique_ptr<MeshBuild> build_now(const MeshBuildFunction& build);
+
+    /**
+     * @brief Takes the last finished build.
+     * @return The build, or nullptr if no build finished since the last call.
+     */
+    std::unique_ptr<MeshBuild> take_result();
+
+    /**
+     * @brief Checks whether the last request is still pending or building.
+     */
+    bool is_busy() const;
+
+  private:
+    void worker_loop();
+
+    std::chrono::milliseconds debounce_;
+
+    std::mutex mutex_; ///< Protects the pending request, never held while building
+    std::condition_variable condition_;
+    MeshBuildFunction pending_;
+    std::chrono::steady_clock::time_point start_time_;
+    bool stop_ = false;
+
+    std::atomic<uint64_t> generation_ = 0;           ///< Generation of the last request
+    std::atomic<uint64_t> completed_generation_ = 0; ///< Generation of the last request handled by the worker
+    std::atomic<MeshBuild*> result_ = nullptr;       ///< Last finished build, owned by the builder until taken
+
+    std::thread thread_;
+};
@@ -2,24 +2,28 @@
 
 #include "Stk.h"
 #include "audio.h"
+#include "audio_gui.h"
 #include "audio_file_manager.h"
 #include "circular_mesh_manager.h"
+#include "deadline_monitor.h"
 #include "fft_utils.h"
 #include "glm/detail/qualifier.hpp"
 #include "imgui.h"
 #include "implot.h"
+#include "latency_probe.h"
+#include "live_input_processor.h"
+#include "mesh_stream_source.h"
 #include "rectangular_mesh_manager.h"
+#include "render_preview.h"
+#include "stream_renderer.h"
 
 #include <algorithm>
 #include <atomic>
-#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <format>
-#include <iostream>
 #include <memory>
-#include <sndfile.h>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -70,51 +74,44 @@ const std::vector<const char*> kCircularModes = {"(0,1)", "(1,1)", "(2,1)", "(0,
 const std::vector<float> kCircularRatios = {1.f,    1.594f, 2.136f, 2.296f, 2.653f, 2.918f,
                                             3.156f, 3.501f, 3.600f, 3.652f, 4.060f, 4.154f};
 
-void update_waveform()
+// Updates the waveform with the samples rendered so far, the plot covers the whole render
+void update_waveform(const std::vector<float>& samples, const RenderPreview& preview, bool is_new_render)
 {
-    SF_INFO sf_info{0};
-    SNDFILE* file = sf_open(kOutputFile, SFM_READ, &sf_info);
-
-    assert(sf_info.channels == 1);
-
     // Backup old waveform
-    g_waveform_2 = std::move(g_waveform);
-
-    sf_count_t n_frames = sf_info.frames;
-    g_waveform.resize(n_frames);
-    sf_readf_float(file, g_waveform.data(), n_frames);
-
-    g_waveform_duration_second = static_cast<float>(n_frames) / sf_info.samplerate;
+    if (is_new_render)
+    {
+        g_waveform_2 = std::move(g_waveform);
+    }
 
-    sf_close(file);
+    g_waveform = samples;
+    g_waveform_duration_second = static_cast<float>(preview.get_frame_count()) / preview.get_sample_rate();
     g_waveform_updated = true;
 }
 
-void update_spectrogram(float time)
+void update_spectrogram(const std::vector<float>& samples, uint32_t samplerate, bool is_new_render)
 {
-    SF_INFO sf_info{0};
-    SNDFILE* file = sf_open(kOutputFile, SFM_READ, &sf_info);
-
     g_spectrogram_info.fft_size = kN_FFT;
-    g_spectrogram_info.samplerate = sf_info.samplerate;
+    g_spectrogram_info.samplerate = samplerate;
     g_spectrogram_info.overlap = kOverlap;
     g_spectrogram_info.fft_hop_size = g_spectrogram_info.fft_size - g_spectrogram_info.overlap;
     g_spectrogram_info.num_freqs = g_spectrogram_info.fft_size / 2;
     g_spectrogram_info.num_bins = g_spectrogram_info.samplerate * 1.f / g_spectrogram_info.fft_hop_size - 1;
 
-    assert(sf_info.channels == 1);
-
-    sf_count_t n_frames = sf_info.frames;
+    const size_t n_frames = samples.size();
 
     size_t audio_buffer_size = n_frames + g_spectrogram_info.fft_size;
     std::vector<float> m_samples(audio_buffer_size);
-    sf_readf_float(file, m_samples.data(), n_frames);
+    std::copy(samples.begin(), samples.end(), m_samples.begin());
 
     // backup old spectrogram
-    g_spectrogram_2 = std::move(g_spectrogram);
+    if (is_new_render)
+    {
+        g_spectrogram_2 = std::move(g_spectrogram);
+    }
 
+    // The bins past the samples rendered so far stay silent
     const size_t spectrogram_size = g_spectrogram_info.num_freqs * g_spectrogram_info.num_bins;
-    g_spectrogram.resize(spectrogram_size);
+    g_spectrogram.assign(spectrogram_size, g_min_dB);
 
     std::vector<float> window(g_spectrogram_info.fft_size, 0);
     GetWindow(FFTWindowType::Hann, window.data(), g_spectrogram_info.fft_size);
@@ -126,7 +123,6 @@ void update_spectrogram(float time)
     {
         if (idx + g_spectrogram_info.fft_size > audio_buffer_size)
         {
-            std::cout << "End of buffer, idx: " << idx << std::endl;
             break;
         }
 
@@ -150,8 +146,6 @@ void update_spectrogram(float time)
     {
         g_fft_frq[f] = f * (float)g_spectrogram_info.samplerate / (float)g_spectrogram_info.fft_size;
     }
-
-    sf_close(file);
 }
 
 void InitWindow()
@@ -212,22 +206,34 @@ void draw_audio_player(AudioManager* audio_manager)
     static bool autoplay = false;
     ImGui::Checkbox("Autoplay", &autoplay);
 
-    if (g_render_complete)
+    // The views and the autoplay follow the render as it progresses, the file is only written at the end
+    static std::shared_ptr<const RenderPreview> preview;
+    static uint64_t preview_version = 0;
+    std::shared_ptr<const RenderPreview> current_preview = g_mesh_manager->get_render_preview();
+    if (current_preview != preview)
+    {
+        preview = current_preview;
+        preview_version = 0;
+    }
+
+    if (preview && preview->get_version() != preview_version)
     {
-        // update spectrogram data
-        update_waveform();
-        update_spectrogram(0.f);
+        const bool is_new_render = preview_version == 0;
+        std::vector<float> samples;
+        preview_version = preview->get_samples(samples);
+        update_waveform(samples, *preview, is_new_render);
+        update_spectrogram(samples, preview->get_sample_rate(), is_new_render);
         g_update_spectrum = true;
-        if (autoplay)
+
+        if (autoplay && is_new_render)
         {
-            if (audio_manager->GetAudioFileManager()->GetState() != AudioFileManager::AudioPlayerState::kPlaying)
-            {
-                if (audio_manager->GetAudioFileManager()->OpenAudioFile(kOutputFile))
-                {
-                    audio_manager->GetAudioFileManager()->Play();
-                }
-            }
+            audio_manager->GetAudioFileManager()->Stop();
+            audio_manager->GetStreamRenderer()->Start(std::make_unique<RenderPreviewSource>(preview));
         }
+    }
+
+    if (g_render_complete)
+    {
         g_render_time = g_mesh_manager->get_render_runtime();
         g_render_complete = false;
     }
@@ -262,13 +268,17 @@ void draw_audio_player(AudioManager* audio_manager)
     }
 
     ImGui::SeparatorText("Render");
-    ImGui::BeginDisabled(g_mesh_manager->is_rendering());
-
-    if (ImGui::Button("Render"))
+    if (g_mesh_manager->is_rendering())
     {
-        g_mesh_manager->render_async(render_time_sec, []() { g_render_complete = true; });
+        if (ImGui::Button("Cancel"))
+        {
+            g_mesh_manager->cancel_render();
+        }
+    }
+    else if (ImGui::Button("Render"))
+    {
+        g_mesh_manager->render_async(render_time_sec, kOutputFile, []() { g_render_complete = true; });
     }
-    ImGui::EndDisabled();
     ImGui::SameLine();
     ImGui::ProgressBar(g_mesh_manager->get_progress());
 
@@ -279,11 +289,156 @@ void draw_audio_player(AudioManager* audio_manager)
     ImGui::SliderFloat("##rendertime", &render_time_sec, 1.f, 10.f);
     ImGui::PopItemWidth();
 
+    // The render ends early once the membrane has decayed, the file keeps the requested length
+    static bool stop_on_silence = true;
+    static float silence_floor_db = -90.f;
+    ImGui::Checkbox("Stop on silence", &stop_on_silence);
+    ImGui::BeginDisabled(!stop_on_silence);
+    ImGui::SameLine();
+    ImGui::PushItemWidth(100);
+    ImGui::SliderFloat("Floor (dB)", &silence_floor_db, -120.f, -40.f);
+    ImGui::PopItemWidth();
+    ImGui::EndDisabled();
+    g_mesh_manager->set_stop_on_silence(stop_on_silence, silence_floor_db);
+
+    // Large meshes are mostly silent right after a strike
+    static bool skip_silent_tiles = false;
+    ImGui::Checkbox("Skip silent tiles", &skip_silent_tiles);
+    g_mesh_manager->set_skip_silent_tiles(skip_silent_tiles);
+
     ImGui::Text("Render Time: %0.2f ms", g_render_time);
 
     // get simulation time for one second
     float normalized_time = g_render_time / render_time_sec;
     ImGui::Text("Took %0.2f ms to render 1 seconds", normalized_time);
+
+    ImGui::SeparatorText("Real-time");
+
+    // Applies to the next sources, a mesh too large for the machine then degrades instead of underrunning
+    static bool adaptive_quality = false;
+    ImGui::Checkbox("Adaptive quality", &adaptive_quality);
+    g_mesh_manager->set_adaptive_quality(adaptive_quality);
+
+    StreamRenderer* stream_renderer = audio_manager->GetStreamRenderer();
+    const bool is_streaming = stream_renderer->IsRunning();
+    bool stream_started = false;
+    if (ImGui::Button(is_streaming ? "Stop Stream" : "Stream"))
+    {
+        if (is_streaming)
+        {
+            stream_renderer->Stop();
+        }
+        else
+        {
+            stream_started = g_mesh_manager->start_stream(stream_renderer);
+        }
+    }
+
+    ImGui::BeginDisabled(!is_streaming);
+    ImGui::SameLine();
+    // Rebuilds the streamed mesh with the current parameters
+    if (ImGui::Button("Reload"))
+    {
+        stream_started = g_mesh_manager->start_stream(stream_renderer);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Hit"))
+    {
+        audio_manager->Hit();
+    }
+    ImGui::EndDisabled();
+
+    // Ramp length of the parameters changed while streaming, sent again to every new source
+    static int smoothing_length = 256;
+    ImGui::PushItemWidth(100);
+    const bool smoothing_changed = ImGui::SliderInt("Smoothing (samples)", &smoothing_length, 0, 4096);
+    ImGui::PopItemWidth();
+    if (smoothing_changed || stream_started)
+    {
+        StreamCommand command;
+        command.type = StreamCommandType::kSetParameter;
+        command.parameter = static_cast<uint32_t>(MeshStreamParameter::SMOOTHING_LENGTH);
+        command.value = static_cast<float>(smoothing_length);
+        stream_renderer->PostCommand(command);
+    }
+
+    // Pins a quality tier to compare them by ear, sent again to every new source. Shifted by one from MeshQualityTier.
+    static int pinned_tier = 0;
+    const std::vector<const char*> tier_names = {"Automatic", "Full", "No diffusion", "Point listener",
+                                                 "Low resolution"};
+    ImGui::BeginDisabled(!adaptive_quality);
+    ImGui::PushItemWidth(150);
+    const bool pinned_tier_changed =
+        ImGui::Combo("Quality tier", &pinned_tier, tier_names.data(), static_cast<int>(tier_names.size()));
+    ImGui::PopItemWidth();
+    ImGui::EndDisabled();
+    if (pinned_tier_changed || stream_started)
+    {
+        stream_renderer->PostCommand({StreamCommandType::kSetParameter,
+                                      static_cast<uint32_t>(MeshStreamParameter::QUALITY_TIER),
+                                      static_cast<float>(pinned_tier - 1)});
+    }
+
+    ImGui::Text("Underruns: %u", stream_renderer->GetUnderrunCount());
+    ImGui::SameLine();
+    ImGui::Text("Buffered: %zu frames", stream_renderer->GetBufferedFrames());
+    if (stream_renderer->IsRunning())
+    {
+        const size_t tier = std::min<size_t>(stream_renderer->GetQualityTier() + 1, tier_names.size() - 1);
+        ImGui::Text("Quality: %s", tier_names[tier]);
+
+        // A mesh too large for live use shows here before it underruns
+        draw_deadline_stats(stream_renderer->GetRenderStats());
+    }
+
+    // The selected input channel drives the mesh, rendered in the audio callback
+    ImGui::SeparatorText("Live input");
+    LiveInputProcessor* live_input = audio_manager->GetLiveInputProcessor();
+    const bool is_live = live_input->IsRunning();
+    bool live_started = false;
+    if (ImGui::Button(is_live ? "Stop Live Input" : "Live Input"))
+    {
+        if (is_live)
+        {
+            live_input->Stop();
+        }
+        else
+        {
+            live_started = g_mesh_manager->start_live_input(live_input);
+        }
+    }
+
+    static float input_gain = 1.f;
+    ImGui::PushItemWidth(100);
+    const bool input_gain_changed = ImGui::SliderFloat("Input Gain", &input_gain, 0.f, 10.f);
+    ImGui::PopItemWidth();
+    if (input_gain_changed || live_started)
+    {
+        live_input->PostCommand({StreamCommandType::kSetParameter,
+                                 static_cast<uint32_t>(MeshStreamParameter::INPUT_GAIN), input_gain});
+    }
+    if (live_started)
+    {
+        live_input->PostCommand({StreamCommandType::kSetParameter,
+                                 static_cast<uint32_t>(MeshStreamParameter::SMOOTHING_LENGTH),
+                                 static_cast<float>(smoothing_length)});
+    }
+
+    // The round trip comes from the latency probe of the audio settings
+    const float processing_latency = live_input->GetProcessingLatency();
+    const LatencyStats latency_stats = audio_manager->GetLatencyProbe()->GetStats();
+    const uint32_t sample_rate = audio_manager->GetAudioStreamInfo().sample_rate;
+    ImGui::Text("Processing latency: %0.1f frames", processing_latency);
+    if (is_live && latency_stats.measurement_count > 0 && sample_rate > 0)
+    {
+        ImGui::Text("Input to output: %0.2f ms", latency_stats.mean_ms + processing_latency * 1000.f / sample_rate);
+    }
+    ImGui::Text("Dropouts: %u", live_input->GetDropoutCount());
+    if (is_live)
+    {
+        // The mesh is rendered in the callback, its time is the time of the callback
+        draw_deadline_stats(audio_manager->GetCallbackStats());
+    }
 }
 
 void draw_mesh_config(bool& reset_camera)
@@ -1,21 +1,53 @@
 #include "mesh_manager.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
 
 #include <sndfile.h>
 
 #include "gaussian.h"
 #include "listener.h"
+#include "live_input_processor.h"
 #include "mesh_2d.h"
+#include "mesh_stream_source.h"
+#include "stream_renderer.h"
+
+namespace
+{
+constexpr float kPreviewSeconds = 0.15f; ///< Rendered and published first, heard a fraction of a second after a change
+constexpr float kChunkSeconds = 0.25f;   ///< Published together after the preview
+constexpr float kSilenceHoldSeconds = 0.1f;
+constexpr float kTileFloorDb = -120.f; ///< Level of the tiles skipped, relative to the excitation amplitude
+
+// Time between two checks of the watchdog of the renders
+constexpr float kInteractiveWatchdogSeconds = 0.5f; ///< Rarely checked, an unstable preview is heard anyway
+constexpr float kBatchWatchdogSeconds = 0.05f;      ///< Nobody listens to a batch render while it runs
+} // namespace
+
+MeshManager::~MeshManager()
+{
+    // The completion callback of the render uses this manager, it has to be done before the manager is destroyed
+    render_handle_.cancel();
+    if (render_handle_.is_valid())
+    {
+        render_handle_.get_future().wait();
+    }
+}
 
 float MeshManager::get_progress() const
 {
-    return progress_;
+    return render_handle_.get_progress();
 }
 
 bool MeshManager::is_rendering() const
 {
-    return is_rendering_;
+    return render_handle_.is_running();
 }
 
 float MeshManager::get_render_runtime() const
@@ -23,14 +55,151 @@ float MeshManager::get_render_runtime() const
     return render_runtime_;
 }
 
-void MeshManager::render_async_worker(std::unique_ptr<Mesh2D>&& mesh, RenderCompleteCallback cb)
+bool MeshManager::start_stream(StreamRenderer* renderer)
+{
+    auto source = create_stream_source();
+    if (!source || !renderer->Start(std::move(source)))
+    {
+        return false;
+    }
+    stream_renderer_ = renderer;
+    return true;
+}
+
+bool MeshManager::start_live_input(LiveInputProcessor* processor)
 {
-    const size_t out_size = render_time_seconds_ * sample_rate_;
-    std::vector<float> out_buffer(out_size);
+    auto source = create_stream_source();
+    if (!source || !processor->Start(std::move(source)))
+    {
+        return false;
+    }
+    live_input_ = processor;
+    return true;
+}
 
-    stk::PoleZero dc_blocker;
-    dc_blocker.setBlockZero(dc_blocker_alpha_);
+void MeshManager::post_stream_parameter(MeshStreamParameter parameter, float value)
+{
+    StreamCommand command;
+    command.type = StreamCommandType::kSetParameter;
+    command.parameter = static_cast<uint32_t>(parameter);
+    command.value = value;
 
+    if (stream_renderer_ != nullptr && stream_renderer_->IsRunning() && !stream_renderer_->PostCommand(command))
+    {
+        std::cerr << "Stream command queue is full" << std::endl;
+    }
+    if (live_input_ != nullptr && live_input_->IsRunning() && !live_input_->PostCommand(command))
+    {
+        std::cerr << "Live input command queue is full" << std::endl;
+    }
+}
+
+void MeshManager::post_stream_friction()
+{
+    const RimguideInfo info = get_rimguide_info();
+    post_stream_parameter(MeshStreamParameter::FRICTION_COEFF, info.friction_coeff);
+    post_stream_parameter(MeshStreamParameter::FRICTION_DELAY, info.friction_delay);
+
+    // The coefficients depend on the sample rate, the twin at half the rate has its own
+    const RimguideInfo twin_info = get_low_resolution_rimguide_info();
+    post_stream_parameter(MeshStreamParameter::TWIN_FRICTION_COEFF, twin_info.friction_coeff);
+    post_stream_parameter(MeshStreamParameter::TWIN_FRICTION_DELAY, twin_info.friction_delay);
+}
+
+std::unique_ptr<MeshStreamSource> MeshManager::create_stream_source()
+{
+    auto mesh = get_render_mesh();
+    if (!mesh)
+    {
+        std::cerr << "Failed to create the mesh" << std::endl;
+        return nullptr;
+    }
+
+    const ListenerInfo listener_info = get_listener_info(*mesh);
+    auto source = std::make_unique<MeshStreamSource>(std::move(mesh), listener_info, get_listener_gain(),
+                                                     create_excitation());
+    source->set_excitation_amplitude(excitation_amplitude_);
+    source->set_dc_blocker(use_dc_blocker_, dc_blocker_alpha_);
+    source->set_rimguide_info(get_rimguide_info());
+    if (adaptive_quality_)
+    {
+        source->enable_adaptive_quality(create_low_resolution_mesh(), get_low_resolution_rimguide_info());
+    }
+    return source;
+}
+
+std::vector<float> MeshManager::get_render_mesh_key() const
+{
+    const RimguideInfo info = get_rimguide_info();
+    std::vector<float> key = {static_cast<float>(sample_rate_),
+                              info.friction_coeff,
+                              info.friction_delay,
+                              info.wave_speed,
+                              info.sample_rate,
+                              static_cast<float>(info.is_solid_boundary),
+                              info.fundamental_frequency,
+                              static_cast<float>(info.use_automatic_pitch_bend),
+                              info.pitch_bend_amount,
+                              static_cast<float>(info.use_square_law_nonlinearity),
+                              info.nonlinear_factor,
+                              static_cast<float>(info.use_nonlinear_allpass),
+                              info.nonlinear_allpass_coeffs[0],
+                              info.nonlinear_allpass_coeffs[1],
+                              static_cast<float>(info.use_extra_diffusion_filters),
+                              static_cast<float>(info.diffusion_coeffs.size())};
+    key.insert(key.end(), info.diffusion_coeffs.begin(), info.diffusion_coeffs.end());
+    return key;
+}
+
+std::unique_ptr<Mesh2D> MeshManager::get_render_mesh()
+{
+    std::vector<float> key = get_render_mesh_key();
+    if (!render_prototype_ || key != render_prototype_key_)
+    {
+        render_prototype_ = create_render_mesh();
+        render_prototype_key_ = std::move(key);
+        if (!render_prototype_)
+        {
+            return nullptr;
+        }
+    }
+
+    auto mesh = render_prototype_->clone();
+    if (!mesh)
+    {
+        // Not worth building twice, the prototype itself is given away and built again by the next call
+        return std::move(render_prototype_);
+    }
+    return mesh;
+}
+
+std::unique_ptr<Mesh2D> MeshManager::create_low_resolution_mesh()
+{
+    // Every parameter of the mesh derives from the sample rate, they are computed again for the twin
+    const int32_t sample_rate = sample_rate_;
+    sample_rate_ = sample_rate / 2;
+    compute_parameters();
+    auto mesh = create_render_mesh();
+
+    sample_rate_ = sample_rate;
+    compute_parameters();
+    return mesh;
+}
+
+RimguideInfo MeshManager::get_low_resolution_rimguide_info()
+{
+    const int32_t sample_rate = sample_rate_;
+    sample_rate_ = sample_rate / 2;
+    compute_parameters();
+    const RimguideInfo info = get_rimguide_info();
+
+    sample_rate_ = sample_rate;
+    compute_parameters();
+    return info;
+}
+
+std::vector<float> MeshManager::create_excitation() const
+{
     std::vector<float> impulse;
     if (excitation_type_ == ExcitationType::DIRAC)
     {
@@ -55,83 +224,171 @@ void MeshManager::render_async_worker(std::unique_ptr<Mesh2D>&& mesh, RenderComp
             sf_close(file);
         }
     }
+    return impulse;
+}
 
+ListenerInfo MeshManager::get_listener_info(const Mesh2D& mesh) const
+{
     ListenerInfo listener_info{};
     listener_info.position = {-0.4f, 0.f, 0.8f};
-    listener_info.samplerate = mesh->get_samplerate();
+    listener_info.samplerate = mesh.get_samplerate();
     listener_info.type = listener_type_;
 
     if (listener_type_ == ListenerType::POINT)
     {
-        listener_info.position = {mesh->get_output_pos().x, mesh->get_output_pos().y, 0.0f};
+        listener_info.position = {mesh.get_output_pos().x, mesh.get_output_pos().y, 0.0f};
     }
+    return listener_info;
+}
 
-    Listener listener;
-    listener.init(*mesh, listener_info);
+float MeshManager::get_listener_gain() const
+{
     if (listener_type_ == ListenerType::ALL)
     {
-        listener.set_gain(0.2f);
+        return 0.2f;
     }
     else if (listener_type_ == ListenerType::BOUNDARY)
     {
         // TODO: figure out how to scale this properly
-        listener.set_gain(5.f);
+        return 5.f;
     }
     else if (listener_type_ == ListenerType::POINT)
     {
-        listener.set_gain(10.f);
+        return 10.f;
     }
+    return 1.f;
+}
 
-    progress_ = 0.f;
-
-    auto start = std::chrono::high_resolution_clock::now();
+void MeshManager::render_async(float render_time_seconds, const std::string& output_file, RenderCompleteCallback cb)
+{
+    // A new render replaces the previous one instead of waiting for it
+    cancel_render();
 
-    for (size_t i = 0; i < out_size - 1; i++)
+    RenderJob job = create_render_job(render_time_seconds, RenderPriority::INTERACTIVE);
+    if (!job.mesh)
     {
-        float input = 0.f;
-        if (i < impulse.size())
+        return;
+    }
+
+    auto preview = std::make_shared<RenderPreview>(job.frame_count, sample_rate_);
+    job.preview_frame_count = static_cast<size_t>(kPreviewSeconds * sample_rate_);
+    job.chunk_frame_count = static_cast<size_t>(kChunkSeconds * sample_rate_);
+    job.on_chunk = [preview](std::span<const float> chunk, size_t) { preview->append(chunk); };
+
+    job.on_complete = [this, output_file, cb, sample_rate = sample_rate_](const RenderResult& result) {
+        if (result.cancelled)
         {
-            input = -impulse[i] * excitation_amplitude_;
+            return;
         }
-        mesh->tick(input);
-        out_buffer[i] = listener.tick();
 
-        if (use_dc_blocker_)
+        render_runtime_ = result.runtime_ms;
+        if (result.unstable)
         {
-            out_buffer[i] = dc_blocker.tick(out_buffer[i]);
+            // The diagnostic is already printed, the output is not worth saving
+            return;
         }
 
-        float new_progress = static_cast<float>(i) / static_cast<float>(out_size);
-        if (new_progress - progress_ > 0.01f)
+        SF_INFO out_sf_info{0};
+        out_sf_info.channels = 1;
+        out_sf_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        out_sf_info.samplerate = sample_rate;
+        out_sf_info.frames = static_cast<sf_count_t>(result.output.size());
+
+        SNDFILE* out_file = sf_open(output_file.c_str(), SFM_WRITE, &out_sf_info);
+        if (!out_file)
         {
-            progress_ = new_progress;
+            std::cerr << "Failed to open output file" << std::endl;
+            return;
         }
-    }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    render_runtime_ = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        sf_writef_float(out_file, result.output.data(), static_cast<sf_count_t>(result.output.size()));
+        sf_write_sync(out_file);
+        sf_close(out_file);
 
-    SF_INFO out_sf_info{0};
-    out_sf_info.channels = 1;
-    out_sf_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
-    out_sf_info.samplerate = static_cast<int>(sample_rate_);
-    out_sf_info.frames = static_cast<sf_count_t>(out_size);
+        if (cb)
+        {
+            cb();
+        }
+    };
+    render_handle_ = get_render_service().submit(std::move(job));
+    render_preview_ = std::move(preview);
+}
+
+std::shared_ptr<const RenderPreview> MeshManager::get_render_preview() const
+{
+    return render_preview_;
+}
 
-    SNDFILE* out_file = sf_open("mesh.wav", SFM_WRITE, &out_sf_info);
-    if (!out_file)
+RenderHandle MeshManager::submit_render(float render_time_seconds, RenderPriority priority)
+{
+    RenderJob job = create_render_job(render_time_seconds, priority);
+    if (!job.mesh)
     {
-        std::cerr << "Failed to open output file" << std::endl;
-        return;
+        return {};
     }
+    return get_render_service().submit(std::move(job));
+}
 
-    sf_writef_float(out_file, out_buffer.data(), out_size);
-    sf_write_sync(out_file);
-    sf_close(out_file);
+RenderService& MeshManager::get_render_service()
+{
+    // One core is left to the audio and GUI threads
+    static RenderService service(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+    return service;
+}
 
-    is_rendering_ = false;
+void MeshManager::cancel_render()
+{
+    render_handle_.cancel();
+}
+
+void MeshManager::set_stop_on_silence(bool enabled, float floor_db)
+{
+    stop_on_silence_ = enabled;
+    silence_floor_db_ = floor_db;
+}
+
+void MeshManager::set_skip_silent_tiles(bool enabled)
+{
+    skip_silent_tiles_ = enabled;
+}
 
-    if (cb)
+void MeshManager::set_adaptive_quality(bool enabled)
+{
+    adaptive_quality_ = enabled;
+}
+
+RenderJob MeshManager::create_render_job(float render_time_seconds, RenderPriority priority)
+{
+    RenderJob job;
+    job.mesh = get_render_mesh();
+    if (!job.mesh)
+    {
+        std::cerr << "Unsupported mesh type" << std::endl;
+        return job;
+    }
+
+    if (skip_silent_tiles_)
+    {
+        job.mesh->set_activity_threshold(excitation_amplitude_ * std::pow(10.f, kTileFloorDb / 20.f));
+    }
+
+    job.listener_info = get_listener_info(*job.mesh);
+    job.listener_gain = get_listener_gain();
+    job.excitation = create_excitation();
+    for (auto& sample : job.excitation)
     {
-        cb();
+        sample *= -excitation_amplitude_;
     }
-}
\ No newline at end of file
+    job.frame_count = static_cast<size_t>(render_time_seconds * sample_rate_);
+    job.use_dc_blocker = use_dc_blocker_;
+    job.dc_blocker_alpha = dc_blocker_alpha_;
+    job.stop_on_silence = stop_on_silence_;
+    job.silence_floor_db = silence_floor_db_;
+    job.silence_hold_frame_count = static_cast<size_t>(kSilenceHoldSeconds * sample_rate_);
+    job.priority = priority;
+
+    const float watchdog_seconds =
+        priority == RenderPriority::INTERACTIVE ? kInteractiveWatchdogSeconds : kBatchWatchdogSeconds;
+    job.watchdog_interval = static_cast<size_t>(watchdog_seconds * sample_rate_);
+    return job;
+}
@@ -5,6 +5,12 @@
 
 #include "listener.h"
 #include "mesh_2d.h"
+#include "mesh_stream_source.h"
+#include "render_preview.h"
+#include "render_service.h"
+#include "rimguide.h"
+
+class LiveInputProcessor;
 
 using RenderCompleteCallback = std::function<void()>;
 
@@ -14,7 +20,9 @@ using RenderCompleteCallback = std::function<void()>;
 enum class MeshType
 {
     TRIANGULAR_MESH,
-    RECTILINEAR_MESH
+    RECTILINEAR_MESH,
+    POLAR_MESH,            ///< Concentric rings, only for circular membranes
+    MULTI_RESOLUTION_MESH, ///< Rectilinear, refined around the input position
 };
 
 /**
@@ -27,15 +35,91 @@ enum class ExcitationType
     FILE,
 };
 
+/**
+ * @brief Parts of a mesh affected by a change of parameters.
+ */
+struct MeshUpdate
+{
+    bool topology = false; ///< Junctions and their connections, the whole mesh is rebuilt
+    bool boundary = false; ///< Delays and filters of the rimguides
+    bool input = false;    ///< Input zone
+
+    bool any() const
+    {
+        return topology || boundary || input;
+    }
+};
+
 class MeshManager
 {
   public:
     MeshManager() = default;
-    virtual ~MeshManager() = default;
+
+    /**
+     * @brief Destroys the MeshManager object, once the render started by render_async() is cancelled.
+     */
+    virtual ~MeshManager();
 
     virtual void draw_config_menu(bool& reset_camera) = 0;
     virtual void draw_experimental_config_menu() = 0;
-    virtual void render_async(float render_time_seconds, RenderCompleteCallback cb) = 0;
+
+    /**
+     * @brief Renders the current mesh in the background and writes it to a file.
+     * @param output_file The WAV file written when the render is finished.
+     * @param cb Called from the render thread once the file is written, not called if the render is cancelled.
+     * @note Cancels the previous render started by this function, if it is still running. The samples are published
+     * to get_render_preview() as they are rendered, starting with a short preview.
+     */
+    void render_async(float render_time_seconds, const std::string& output_file, RenderCompleteCallback cb);
+
+    /**
+     * @brief Gets the output of the last render started by render_async(), filled while it is being rendered.
+     * @return The preview, or nullptr if nothing was rendered yet.
+     */
+    std::shared_ptr<const RenderPreview> get_render_preview() const;
+
+    /**
+     * @brief Queues a render of the current mesh.
+     * @param priority Batch renders only run when no interactive render is waiting.
+     * @return The handle of the job, its future holds the rendered samples.
+     */
+    RenderHandle submit_render(float render_time_seconds, RenderPriority priority);
+
+    /**
+     * @brief Stops the render started by render_async(), if any.
+     */
+    void cancel_render();
+
+    /**
+     * @brief Lets the next renders stop once the mesh is silent, the rest of the output is left silent.
+     * @param floor_db Output level in dBFS, and mesh energy relative to its peak, below which the mesh is silent.
+     */
+    void set_stop_on_silence(bool enabled, float floor_db);
+
+    /**
+     * @brief Lets the next renders skip the silent regions of the mesh, see Mesh2D::set_activity_threshold().
+     */
+    void set_skip_silent_tiles(bool enabled);
+
+    /**
+     * @brief Lets the next streamed meshes lower their quality instead of underrunning, see MeshQualityTier.
+     */
+    void set_adaptive_quality(bool enabled);
+
+    /**
+     * @brief Plays the current mesh in real time, replacing the source of the renderer.
+     * @param renderer The stream renderer of the audio manager.
+     * @return False if the stream could not be started.
+     */
+    bool start_stream(StreamRenderer* renderer);
+
+    /**
+     * @brief Plays the current mesh driven by the live input of the audio device, replacing the source of the
+     * processor.
+     * @param processor The live input processor of the audio manager.
+     * @return False if the live input could not be started.
+     */
+    bool start_live_input(LiveInputProcessor* processor);
 
     virtual float get_progress() const;
     virtual bool is_rendering() const;
@@ -46,7 +130,90 @@ class MeshManager
     virtual void render_gl_mesh(glm::mat4 mvp) const = 0;
 
   protected:
-    virtual void render_async_worker(std::unique_ptr<Mesh2D>&& mesh, RenderCompleteCallback cb);
+    /**
+     * @brief Builds a mesh from the current parameters, ready to be rendered.
+     * @return The mesh, or nullptr if the mesh type is not supported.
+     */
+    virtual std::unique_ptr<Mesh2D> create_render_mesh() = 0;
+
+    /**
+     * @brief Gets the parameters the render mesh is built from, see get_render_mesh().
+     * @note The managers append the parameters of their geometry to the ones returned by this base.
+     */
+    virtual std::vector<float> get_render_mesh_key() const;
+
+    /**
+     * @brief Copies a silent render mesh, built again only when get_render_mesh_key() changes.
+     * @return The mesh, or nullptr if the mesh type is not supported.
+     * @note Copying is several times cheaper than create_render_mesh(). A mesh that can not be copied, like one with
+     * time-varying allpass filters, is built for every call.
+     */
+    std::unique_ptr<Mesh2D> get_render_mesh();
+
+    /**
+     * @brief Builds the twin of the render mesh at half the sample rate, for MeshQualityTier::LOW_RESOLUTION.
+     * @return The mesh, or nullptr if the mesh type is not supported.
+     */
+    std::unique_ptr<Mesh2D> create_low_resolution_mesh();
+
+    /**
+     * @brief Gets the rimguide configuration of the twin built by create_low_resolution_mesh().
+     */
+    RimguideInfo get_low_resolution_rimguide_info();
+
+    /**
+     * @brief Computes the parameters of the mesh derived from the current settings and sample rate.
+     */
+    virtual void compute_parameters() = 0;
+
+    /**
+     * @brief Builds a render job for the current mesh and excitation.
+     * @return The job, without a mesh if the mesh type is not supported.
+     */
+    RenderJob create_render_job(float render_time_seconds, RenderPriority priority);
+
+    /**
+     * @brief Gets the rimguide configuration from the current parameters.
+     */
+    virtual RimguideInfo get_rimguide_info() const = 0;
+
+    /**
+     * @brief Sends a parameter to the streamed and the live mesh, which ramp to it without being rebuilt.
+     * @note Does nothing if this manager is neither streaming nor playing the live input.
+     */
+    void post_stream_parameter(MeshStreamParameter parameter, float value);
+
+    /**
+     * @brief Sends the friction of the rimguides to the streamed and the live mesh, and to their twin.
+     */
+    void post_stream_friction();
+
+    /**
+     * @brief Builds the excitation signal from the current parameters, without the excitation amplitude.
+     */
+    std::vector<float> create_excitation() const;
+
+    /**
+     * @brief Builds a real-time source playing the current mesh.
+     * @return The source, or nullptr if the mesh type is not supported.
+     */
+    std::unique_ptr<MeshStreamSource> create_stream_source();
+
+    /**
+     * @brief Gets the listener configuration for a mesh from the current parameters.
+     */
+    ListenerInfo get_listener_info(const Mesh2D& mesh) const;
+
+    /**
+     * @brief Gets the gain compensating the level of the current listener type.
+     */
+    float get_listener_gain() const;
+
+    /**
+     * @brief Gets the service rendering the meshes of every manager.
+     * @note The renders of all the managers share its workers instead of each starting its own threads.
+     */
+    static RenderService& get_render_service();
 
     int32_t sample_rate_ = 11025; ///< Sample rate for the simulation.
 
@@ -56,12 +223,22 @@ class MeshManager
     std::string excitation_filename_{""};
     ListenerType listener_type_ = ListenerType::ALL; ///< Type of listener.
 
-    float render_time_seconds_ = 1.f; ///< Time in seconds for rendering.
-
     bool use_dc_blocker_ = false;     ///< Flag to use DC blocker.
     float dc_blocker_alpha_ = 0.995f; ///< Alpha value for DC blocker.
 
-    std::atomic_bool is_rendering_{false};   ///< Flag indicating if rendering is in progress.
-    std::atomic<float> progress_{0.f};       ///< Progress of the rendering.
-    std::atomic<float> render_runtime_{0.f}; ///< Runtime of the render in milliseconds.
+    bool stop_on_silence_ = false;   ///< Flag to stop the renders once the mesh is silent.
+    float silence_floor_db_ = -90.f; ///< Level below which the mesh is silent.
+    bool skip_silent_tiles_ = false; ///< Flag to skip the silent tiles of the mesh in the renders.
+    bool adaptive_quality_ = false;  ///< Flag to let the streamed meshes lower their quality.
+
+    std::atomic<float> render_runtime_{0.f}; ///< Runtime of the last render in milliseconds.
+
+    StreamRenderer* stream_renderer_ = nullptr; ///< Renderer playing the mesh of this manager, if any.
+    LiveInputProcessor* live_input_ = nullptr;  ///< Processor playing the mesh of this manager, if any.
+
+    RenderHandle render_handle_;                   ///< Render started by render_async().
+    std::shared_ptr<RenderPreview> render_preview_; ///< Output of the render started by render_async().
+
+    std::unique_ptr<Mesh2D> render_prototype_; ///< Silent render mesh copied by get_render_mesh().
+    std::vector<float> render_prototype_key_;  ///< Parameters the prototype was built from.
 };
\ No newline at end of file
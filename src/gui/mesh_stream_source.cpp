@@ -0,0 +1,393 @@
+#include "mesh_stream_source.h"
+
+#include "denormal.h"
+#include "rt_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+MeshStreamSource::MeshStreamSource(std::unique_ptr<Mesh2D> mesh, const ListenerInfo& listener_info,
+                                   float listener_gain, std::vector<float> excitation)
+    : mesh_(std::move(mesh))
+    , excitation_(std::move(excitation))
+    , excitation_position_(excitation_.size())
+{
+    listener_.init(*mesh_, listener_info);
+    listener_.set_gain(listener_gain);
+
+    // Started on the thread building the source, the render thread or the audio callback must not
+    mesh_->start_threads();
+}
+
+void MeshStreamSource::set_excitation_amplitude(float amplitude)
+{
+    excitation_amplitude_ = amplitude;
+}
+
+void MeshStreamSource::set_dc_blocker(bool enabled, float alpha)
+{
+    use_dc_blocker_ = enabled;
+    dc_blocker_.setBlockZero(alpha);
+}
+
+void MeshStreamSource::set_rimguide_info(const RimguideInfo& info)
+{
+    friction_coeff_.reset(info.friction_coeff);
+    friction_delay_.reset(info.friction_delay);
+    pitch_bend_amount_.reset(info.pitch_bend_amount);
+    nonlinear_factor_.reset(info.nonlinear_factor);
+}
+
+void MeshStreamSource::enable_adaptive_quality(std::unique_ptr<Mesh2D> twin, const RimguideInfo& twin_info)
+{
+    const size_t sample_rate = mesh_->get_samplerate();
+    if (twin && (twin->get_samplerate() * 2 + 1 < sample_rate || twin->get_samplerate() * 2 > sample_rate + 1))
+    {
+        std::cerr << "MeshStreamSource: the twin must run at half the sample rate of the mesh" << std::endl;
+        twin.reset();
+    }
+
+    ListenerInfo point_info{};
+    point_info.type = ListenerType::POINT;
+    point_info.position = {mesh_->get_output_pos().x, mesh_->get_output_pos().y, 0.f};
+    point_info.samplerate = sample_rate;
+    point_listener_.init(*mesh_, point_info);
+
+    twin_ = std::move(twin);
+    if (twin_)
+    {
+        point_info.position = {twin_->get_output_pos().x, twin_->get_output_pos().y, 0.f};
+        point_info.samplerate = twin_->get_samplerate();
+        twin_listener_.init(*twin_, point_info);
+        twin_->start_threads();
+        twin_friction_coeff_.reset(twin_info.friction_coeff);
+        twin_friction_delay_.reset(twin_info.friction_delay);
+    }
+
+    // Each tier saves something over the previous one, or it is skipped
+    tiers_.clear();
+    tiers_.push_back(MeshQualityTier::FULL);
+    if (mesh_->has_diffusion_filters())
+    {
+        tiers_.push_back(MeshQualityTier::NO_DIFFUSION);
+    }
+    if (listener_.get_type() != ListenerType::POINT)
+    {
+        tiers_.push_back(MeshQualityTier::POINT_LISTENER);
+    }
+    if (twin_)
+    {
+        tiers_.push_back(MeshQualityTier::LOW_RESOLUTION);
+    }
+
+    crossfade_length_ = static_cast<uint32_t>(kCrossfadeSeconds * sample_rate);
+    quality_controller_.SetTierCount(tiers_.size());
+    quality_controller_.SetSettleTime(2.f * kCrossfadeSeconds);
+
+    // A hit rendered through every tier at once gives the gains matching their levels to the listener. Rendered on the
+    // thread building the source, the tail would otherwise fall into the subnormal range.
+    ScopedFlushDenormals flush_denormals;
+    const auto frame_count = static_cast<size_t>(kCalibrationSeconds * sample_rate);
+    double listener_energy = 0.0;
+    double point_energy = 0.0;
+    double twin_energy = 0.0;
+    for (size_t i = 0; i < frame_count; ++i)
+    {
+        float input = 0.f;
+        if (excitation_.empty())
+        {
+            input = i == 0 ? -1.f : 0.f;
+        }
+        else if (i < excitation_.size())
+        {
+            input = -excitation_[i];
+        }
+
+        mesh_->tick(input);
+        const float out = listener_.tick();
+        const float point_out = point_listener_.tick();
+        listener_energy += out * out;
+        point_energy += point_out * point_out;
+        if (twin_)
+        {
+            const float twin_out = tick_twin(input);
+            twin_energy += twin_out * twin_out;
+        }
+    }
+    point_gain_ = point_energy > 0.0 ? static_cast<float>(std::sqrt(listener_energy / point_energy)) : 1.f;
+    twin_gain_ = twin_energy > 0.0 ? static_cast<float>(std::sqrt(listener_energy / twin_energy)) : 1.f;
+
+    mesh_->clear();
+    listener_.clear();
+    clear_twin();
+}
+
+uint32_t MeshStreamSource::GetSampleRate() const
+{
+    return static_cast<uint32_t>(mesh_->get_samplerate());
+}
+
+uint32_t MeshStreamSource::GetQualityTier() const
+{
+    return static_cast<uint32_t>(quality_tier_.load(std::memory_order_relaxed));
+}
+
+void MeshStreamSource::HandleCommand(const StreamCommand& command)
+{
+    switch (command.type)
+    {
+    case StreamCommandType::kHit:
+        // Hits add up, the mesh is not cleared
+        excitation_position_ = 0;
+        velocity_ = command.value;
+        break;
+    case StreamCommandType::kSetParameter:
+        switch (static_cast<MeshStreamParameter>(command.parameter))
+        {
+        case MeshStreamParameter::OUTPUT_GAIN:
+            output_gain_ = command.value;
+            break;
+        case MeshStreamParameter::EXCITATION_AMPLITUDE:
+            excitation_amplitude_ = command.value;
+            break;
+        case MeshStreamParameter::INPUT_GAIN:
+            input_gain_ = command.value;
+            break;
+        case MeshStreamParameter::FRICTION_COEFF:
+            friction_coeff_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::FRICTION_DELAY:
+            friction_delay_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::PITCH_BEND_AMOUNT:
+            pitch_bend_amount_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::NONLINEAR_FACTOR:
+            nonlinear_factor_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::SMOOTHING_LENGTH:
+            smoothing_length_ = static_cast<uint32_t>(std::max(command.value, 0.f));
+            break;
+        case MeshStreamParameter::TWIN_FRICTION_COEFF:
+            twin_friction_coeff_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::TWIN_FRICTION_DELAY:
+            twin_friction_delay_.set_target(command.value, smoothing_length_);
+            break;
+        case MeshStreamParameter::QUALITY_TIER:
+            pin_quality_tier(command.value);
+            break;
+        }
+        break;
+    }
+}
+
+void MeshStreamSource::Render(float* out_buffer, size_t frame_size)
+{
+    render(nullptr, out_buffer, frame_size);
+}
+
+void MeshStreamSource::RenderWithInput(const float* in_buffer, float* out_buffer, size_t frame_size)
+{
+    render(in_buffer, out_buffer, frame_size);
+}
+
+void MeshStreamSource::render(const float* in_buffer, float* out_buffer, size_t frame_size)
+{
+    const bool is_adaptive = tiers_.size() > 1;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < frame_size; ++i)
+    {
+        update_rimguides();
+
+        float input = 0.f;
+        if (excitation_position_ < excitation_.size())
+        {
+            input = -excitation_[excitation_position_++] * excitation_amplitude_ * velocity_;
+        }
+        if (in_buffer != nullptr)
+        {
+            // The hits still play, added to the live input
+            input -= in_buffer[i] * input_gain_;
+        }
+        float out;
+        if (is_adaptive)
+        {
+            out = tick_tiers(input);
+        }
+        else
+        {
+            mesh_->tick(input);
+            out = listener_.tick();
+        }
+
+        out *= output_gain_;
+        if (use_dc_blocker_)
+        {
+            out = dc_blocker_.tick(out);
+        }
+        out_buffer[i] = out;
+    }
+
+    if (is_adaptive && !is_tier_pinned_)
+    {
+        const auto end = std::chrono::steady_clock::now();
+        const auto duration_ns = static_cast<uint64_t>(std::chrono::nanoseconds(end - start).count());
+        const uint64_t budget_ns = frame_size * 1000000000ull / mesh_->get_samplerate();
+        const MeshQualityTier tier = tiers_[quality_controller_.Update(duration_ns, budget_ns)];
+        if (tier != quality_tier_)
+        {
+            set_quality_tier(tier);
+        }
+    }
+}
+
+float MeshStreamSource::tick_tiers(float input)
+{
+    if (diffusion_mix_.is_ramping())
+    {
+        mesh_->set_diffusion_mix(diffusion_mix_.tick());
+    }
+    const float listener_mix = listener_mix_.tick();
+    const float twin_mix = twin_mix_.tick();
+
+    float out = 0.f;
+    if (twin_mix < 1.f)
+    {
+        mesh_->tick(input);
+
+        float mesh_out = 0.f;
+        if (listener_mix > 0.f)
+        {
+            mesh_out += listener_.tick() * listener_mix;
+        }
+        if (listener_mix < 1.f)
+        {
+            mesh_out += point_listener_.tick() * point_gain_ * (1.f - listener_mix);
+        }
+        out += mesh_out * (1.f - twin_mix);
+    }
+    if (twin_mix > 0.f)
+    {
+        out += tick_twin(input) * twin_gain_ * twin_mix;
+    }
+    return out;
+}
+
+float MeshStreamSource::tick_twin(float input)
+{
+    if (!is_second_sample_)
+    {
+        is_second_sample_ = true;
+        twin_input_ = input;
+        return twin_last_;
+    }
+
+    is_second_sample_ = false;
+    twin_->tick(0.5f * (twin_input_ + input));
+    twin_previous_ = twin_last_;
+    twin_last_ = twin_listener_.tick();
+    return 0.5f * (twin_previous_ + twin_last_);
+}
+
+void MeshStreamSource::set_quality_tier(MeshQualityTier tier)
+{
+    const float diffusion_mix = tier < MeshQualityTier::NO_DIFFUSION ? 1.f : 0.f;
+    const float listener_mix = tier < MeshQualityTier::POINT_LISTENER ? 1.f : 0.f;
+    const float twin_mix = tier == MeshQualityTier::LOW_RESOLUTION ? 1.f : 0.f;
+
+    // The parts left idle by the previous tier are stale, they fade in from silence
+    if (twin_mix < 1.f && twin_mix_.get_value() == 1.f)
+    {
+        mesh_->clear();
+        listener_.clear();
+    }
+    else if (listener_mix > 0.f && listener_mix_.get_value() == 0.f)
+    {
+        listener_.clear();
+    }
+    if (twin_mix > 0.f && twin_mix_.get_value() == 0.f)
+    {
+        clear_twin();
+    }
+
+    diffusion_mix_.set_target(diffusion_mix, crossfade_length_);
+    listener_mix_.set_target(listener_mix, crossfade_length_);
+    twin_mix_.set_target(twin_mix, crossfade_length_);
+    quality_tier_ = tier;
+
+    const auto index = std::find(tiers_.begin(), tiers_.end(), tier) - tiers_.begin();
+    get_rt_log().log(RtLogLevel::INFO, "Mesh quality tier {} of {}, load {:.2f}", index + 1, tiers_.size(),
+                     quality_controller_.GetLoad());
+}
+
+void MeshStreamSource::pin_quality_tier(float tier)
+{
+    if (tiers_.size() <= 1)
+    {
+        return;
+    }
+
+    // Unpinned, the controller picks the tier again after the next block
+    is_tier_pinned_ = tier >= 0.f;
+    if (!is_tier_pinned_)
+    {
+        return;
+    }
+
+    auto it = std::find_if(tiers_.begin(), tiers_.end(),
+                           [tier](MeshQualityTier t) { return static_cast<float>(t) >= tier; });
+    const MeshQualityTier pinned = it != tiers_.end() ? *it : tiers_.back();
+    if (pinned != quality_tier_)
+    {
+        set_quality_tier(pinned);
+    }
+}
+
+void MeshStreamSource::clear_twin()
+{
+    if (twin_)
+    {
+        twin_->clear();
+    }
+    is_second_sample_ = false;
+    twin_input_ = 0.f;
+    twin_previous_ = 0.f;
+    twin_last_ = 0.f;
+}
+
+void MeshStreamSource::update_rimguides()
+{
+    if (friction_coeff_.is_ramping() || friction_delay_.is_ramping())
+    {
+        const float friction_coeff = friction_coeff_.tick();
+        mesh_->set_rimguide_friction(friction_coeff, friction_delay_.tick());
+    }
+    if (twin_ && (twin_friction_coeff_.is_ramping() || twin_friction_delay_.is_ramping()))
+    {
+        const float friction_coeff = twin_friction_coeff_.tick();
+        twin_->set_rimguide_friction(friction_coeff, twin_friction_delay_.tick());
+    }
+    if (pitch_bend_amount_.is_ramping())
+    {
+        const float pitch_bend_amount = pitch_bend_amount_.tick();
+        mesh_->set_pitch_bend_amount(pitch_bend_amount);
+        if (twin_)
+        {
+            twin_->set_pitch_bend_amount(pitch_bend_amount);
+        }
+    }
+    if (nonlinear_factor_.is_ramping())
+    {
+        const float nonlinear_factor = nonlinear_factor_.tick();
+        mesh_->set_nonlinear_factor(nonlinear_factor);
+        if (twin_)
+        {
+            twin_->set_nonlinear_factor(nonlinear_factor);
+        }
+    }
+}
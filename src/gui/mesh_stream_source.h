@@ -0,0 +1,178 @@
+#pragma once
+
+#include "listener.h"
+#include "mesh_2d.h"
+#include "quality_controller.h"
+#include "rimguide.h"
+#include "smoothed_value.h"
+#include "stream_renderer.h"
+
+#include <PoleZero.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Parameters of a MeshStreamSource, set with StreamCommandType::kSetParameter.
+ *
+ * The rimguide parameters ramp to their new value over SMOOTHING_LENGTH samples and are written into the running mesh
+ * every sample of the ramp.
+ */
+enum class MeshStreamParameter : uint32_t
+{
+    OUTPUT_GAIN,          ///< Gain applied after the listener
+    EXCITATION_AMPLITUDE, ///< Amplitude of the excitation, multiplied by the velocity of each hit
+    INPUT_GAIN,           ///< Gain of the live input injected into the mesh, see RenderWithInput()
+    FRICTION_COEFF,       ///< Friction coefficient of the rimguides, as in RimguideInfo
+    FRICTION_DELAY,       ///< Friction delay of the rimguides, as in RimguideInfo
+    PITCH_BEND_AMOUNT,    ///< Automatic pitch bend amount of the rimguides
+    NONLINEAR_FACTOR,     ///< Square law nonlinear factor of the rimguides
+    SMOOTHING_LENGTH,     ///< Length in samples of the ramps of the rimguide parameters, for the next changes
+    TWIN_FRICTION_COEFF,  ///< Friction coefficient of the rimguides of the twin, at its sample rate
+    TWIN_FRICTION_DELAY,  ///< Friction delay of the rimguides of the twin, at its sample rate
+    QUALITY_TIER,         ///< MeshQualityTier the source is pinned to, -1 to let the QualityController pick it
+};
+
+/**
+ * @brief Quality tiers of a MeshStreamSource, each one cheaper than the previous and keeping its savings.
+ * @note The value of a tier is the one returned by MeshStreamSource::GetQualityTier().
+ */
+enum class MeshQualityTier : uint8_t
+{
+    FULL,           ///< The mesh and listener as built
+    NO_DIFFUSION,   ///< Without the extra diffusion filters of the rimguides
+    POINT_LISTENER, ///< The listener reduced to the output position of the mesh
+    LOW_RESOLUTION, ///< A twin of the mesh at half the sample rate, heard at its output position
+};
+
+/**
+ * @class MeshStreamSource
+ * @brief Plays a mesh and its listener in real time, struck by StreamCommandType::kHit commands.
+ *
+ * Played by a LiveInputProcessor, the live input is also injected into the mesh, at the position of the excitation,
+ * on the tick of the sample it belongs to.
+ *
+ * With adaptive quality, a QualityController times every rendered block against its duration and picks a
+ * MeshQualityTier, so a mesh too large for the machine degrades instead of underrunning. The tiers are built with the
+ * source and their levels matched, a change of tier crossfades between the two over kCrossfadeSeconds. A part of the
+ * source left idle by a tier, the listener or one of the two meshes, is cleared before it fades in again: the mesh
+ * starts silent, the hits still ringing in the tier it replaces fade out with the crossfade.
+ *
+ * MeshStreamParameter::QUALITY_TIER pins a tier, to compare them by ear. A tier that was skipped is replaced with the
+ * next cheaper one.
+ */
+class MeshStreamSource : public StreamSource
+{
+  public:
+    /**
+     * @brief Constructs a MeshStreamSource object.
+     * @param mesh The mesh, with its boundary, input and output already set.
+     * @param listener_info The listener configuration.
+     * @param listener_gain The gain of the listener.
+     * @param excitation The excitation played on every hit.
+     */
+    MeshStreamSource(std::unique_ptr<Mesh2D> mesh, const ListenerInfo& listener_info, float listener_gain,
+                     std::vector<float> excitation);
+    ~MeshStreamSource() override = default;
+
+    void set_excitation_amplitude(float amplitude);
+    void set_dc_blocker(bool enabled, float alpha);
+
+    /**
+     * @brief Sets the rimguide parameters the mesh was built with, the starting point of the smoothed parameters.
+     */
+    void set_rimguide_info(const RimguideInfo& info);
+
+    /**
+     * @brief Lets the source lower its quality when rendering takes too long, see MeshQualityTier.
+     * @param twin The same mesh built at half the sample rate, with its boundary, input and output set, for
+     * MeshQualityTier::LOW_RESOLUTION. Without it that tier is skipped.
+     * @param twin_info The rimguide parameters the twin was built with. Its friction depends on the sample rate, it
+     * follows MeshStreamParameter::TWIN_FRICTION_COEFF and TWIN_FRICTION_DELAY instead of the friction of the mesh.
+     * @note Renders the excitation through every tier to match their levels, must be called before the source plays.
+     */
+    void enable_adaptive_quality(std::unique_ptr<Mesh2D> twin, const RimguideInfo& twin_info);
+
+    uint32_t GetSampleRate() const override;
+    uint32_t GetQualityTier() const override;
+    void HandleCommand(const StreamCommand& command) override;
+    void Render(float* out_buffer, size_t frame_size) override;
+    void RenderWithInput(const float* in_buffer, float* out_buffer, size_t frame_size) override;
+
+  private:
+    static constexpr float kCrossfadeSeconds = 0.1f;
+    static constexpr float kCalibrationSeconds = 0.15f;
+
+    /**
+     * @param in_buffer The live input, or nullptr.
+     */
+    void render(const float* in_buffer, float* out_buffer, size_t frame_size);
+
+    /**
+     * @brief Ticks the parts of the source used by the current tier and the one it fades from.
+     * @return The output, before the output gain.
+     */
+    float tick_tiers(float input);
+
+    /**
+     * @brief Ticks the twin once every two samples, on their mean, and interpolates between its last two outputs.
+     */
+    float tick_twin(float input);
+
+    void set_quality_tier(MeshQualityTier tier);
+
+    /**
+     * @param tier A MeshQualityTier, or a negative value to unpin the tier.
+     */
+    void pin_quality_tier(float tier);
+    void clear_twin();
+
+    /**
+     * @brief Advances the ramps of the rimguide parameters and writes them into the mesh.
+     */
+    void update_rimguides();
+
+    std::unique_ptr<Mesh2D> mesh_;
+    Listener listener_;
+
+    std::vector<float> excitation_;
+    size_t excitation_position_; ///< Position in the excitation, past the end when idle
+    float excitation_amplitude_ = 1.f;
+    float velocity_ = 0.f;
+    float input_gain_ = 1.f;
+    float output_gain_ = 1.f;
+
+    bool use_dc_blocker_ = false;
+    stk::PoleZero dc_blocker_;
+
+    uint32_t smoothing_length_ = 256;
+    SmoothedValue friction_coeff_;
+    SmoothedValue friction_delay_;
+    SmoothedValue twin_friction_coeff_;
+    SmoothedValue twin_friction_delay_;
+    SmoothedValue pitch_bend_amount_;
+    SmoothedValue nonlinear_factor_;
+
+    QualityController quality_controller_;
+    std::vector<MeshQualityTier> tiers_; ///< Tiers picked by the controller, empty without adaptive quality
+    std::atomic<MeshQualityTier> quality_tier_ = MeshQualityTier::FULL;
+    bool is_tier_pinned_ = false;
+    uint32_t crossfade_length_ = 0;
+    SmoothedValue diffusion_mix_{1.f};
+    SmoothedValue listener_mix_{1.f}; ///< 1 for the listener, 0 for the point listener
+    SmoothedValue twin_mix_{0.f};     ///< 0 for the mesh, 1 for its twin
+
+    Listener point_listener_;
+    float point_gain_ = 1.f; ///< Matches the level of the point listener to the listener
+
+    std::unique_ptr<Mesh2D> twin_;
+    Listener twin_listener_;
+    float twin_gain_ = 1.f;         ///< Matches the level of the twin to the listener
+    bool is_second_sample_ = false; ///< The twin ticks on the second sample of each pair
+    float twin_input_ = 0.f;        ///< First input of the pair
+    float twin_previous_ = 0.f;
+    float twin_last_ = 0.f;
+};
@@ -0,0 +1,193 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+#include "listener.h"
+#include "mesh_stream_source.h"
+#include "rimguide.h"
+#include "rimguide_utils.h"
+#include "trimesh.h"
+#include "wave_math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+// The tiers are pinned with MeshStreamParameter::QUALITY_TIER, the QualityController never switches them on the
+// render times of the machine running the test.
+
+namespace
+{
+constexpr float kSampleRate = 22050;
+constexpr float kRadius = 0.1f;
+constexpr float kDensity = 0.262;
+constexpr float kTension = 3325.f;
+constexpr float kDecay = 25.f;
+
+constexpr size_t kCalibrationFrames = static_cast<size_t>(0.15f * kSampleRate);
+constexpr size_t kFadeFrames = 8192; ///< Longer than the crossfade, even so the twin keeps its pairs of samples
+constexpr size_t kRingFrames = 4096;
+
+RimguideInfo get_rimguide_info(float sample_rate, float decay)
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float f0 = get_fundamental_frequency(kRadius, c, sample_rate);
+    float friction_coeff = get_friction_coeff(kRadius, c, decay, f0);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = get_friction_delay(friction_coeff, f0);
+    info.wave_speed = c;
+    info.sample_rate = sample_rate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+    return info;
+}
+
+std::unique_ptr<Mesh2D> create_drum(float sample_rate)
+{
+    const RimguideInfo info = get_rimguide_info(sample_rate, kDecay);
+    float sample_distance = get_sample_distance(info.wave_speed, sample_rate);
+    float max_radius = get_max_radius(kRadius, info.friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+    mesh->init(mesh->get_mask_for_radius(max_radius));
+    mesh->init_boundary(info);
+    mesh->set_input(0.01f, {0.03f, 0.02f});
+    mesh->set_output(0.7f, 0.6f);
+    return mesh;
+}
+
+/**
+ * @brief A drum heard by a listener of every junction, with a point listener and a twin as cheaper tiers.
+ */
+std::unique_ptr<MeshStreamSource> create_source()
+{
+    auto mesh = create_drum(kSampleRate);
+
+    ListenerInfo listener_info{};
+    listener_info.type = ListenerType::ALL;
+    listener_info.samplerate = kSampleRate;
+    listener_info.position = {-0.4f, 0.f, 0.8f};
+
+    auto source = std::make_unique<MeshStreamSource>(std::move(mesh), listener_info, 1.f, std::vector<float>{1.f});
+    source->set_rimguide_info(get_rimguide_info(kSampleRate, kDecay));
+    source->enable_adaptive_quality(create_drum(kSampleRate / 2), get_rimguide_info(kSampleRate / 2, kDecay));
+    return source;
+}
+
+void set_parameter(MeshStreamSource& source, MeshStreamParameter parameter, float value)
+{
+    source.HandleCommand({StreamCommandType::kSetParameter, static_cast<uint32_t>(parameter), value});
+}
+
+void pin_tier(MeshStreamSource& source, MeshQualityTier tier)
+{
+    set_parameter(source, MeshStreamParameter::QUALITY_TIER, static_cast<float>(tier));
+    REQUIRE(source.GetQualityTier() == static_cast<uint32_t>(tier));
+}
+
+void hit(MeshStreamSource& source)
+{
+    source.HandleCommand({StreamCommandType::kHit, 0, 1.f});
+}
+
+std::vector<float> render(MeshStreamSource& source, size_t frame_count)
+{
+    std::vector<float> out(frame_count);
+    source.Render(out.data(), frame_count);
+    return out;
+}
+
+double get_energy(const std::vector<float>& signal, size_t begin = 0)
+{
+    double energy = 0.0;
+    for (size_t i = begin; i < signal.size(); ++i)
+    {
+        energy += static_cast<double>(signal[i]) * signal[i];
+    }
+    return energy;
+}
+
+float get_peak(const std::vector<float>& signal, size_t begin = 0)
+{
+    float peak = 0.f;
+    for (size_t i = begin; i < signal.size(); ++i)
+    {
+        peak = std::max(peak, std::abs(signal[i]));
+    }
+    return peak;
+}
+
+} // namespace
+
+TEST_CASE("Quality tiers - Levels")
+{
+    auto reference = create_source();
+    pin_tier(*reference, MeshQualityTier::FULL);
+    hit(*reference);
+    const double full_energy = get_energy(render(*reference, kCalibrationFrames));
+    REQUIRE(full_energy > 0.0);
+
+    // Each tier is matched to the listener on the hit it was calibrated with
+    for (MeshQualityTier tier : {MeshQualityTier::POINT_LISTENER, MeshQualityTier::LOW_RESOLUTION})
+    {
+        auto source = create_source();
+        pin_tier(*source, tier);
+        render(*source, kFadeFrames);
+        hit(*source);
+        CHECK(get_energy(render(*source, kCalibrationFrames)) == doctest::Approx(full_energy).epsilon(0.01));
+    }
+}
+
+TEST_CASE("Quality tiers - Crossfade")
+{
+    auto source = create_source();
+    pin_tier(*source, MeshQualityTier::FULL);
+    hit(*source);
+    render(*source, kRingFrames);
+
+    // The hit ringing in the mesh fades out with the crossfade, the twin fades in from silence
+    pin_tier(*source, MeshQualityTier::LOW_RESOLUTION);
+    auto out = render(*source, kFadeFrames);
+    CHECK(get_peak(out) > 0.f);
+    CHECK(get_peak(out, kFadeFrames / 2) == 0.f);
+
+    // The mesh left idle by the twin still holds the first hit, it is cleared before fading in
+    hit(*source);
+    REQUIRE(get_peak(render(*source, kRingFrames)) > 0.f);
+    pin_tier(*source, MeshQualityTier::FULL);
+    out = render(*source, kFadeFrames);
+    CHECK(get_peak(out) > 0.f);
+    CHECK(get_peak(out, kFadeFrames / 2) == 0.f);
+
+    // Same for the twin, which still holds the second hit
+    pin_tier(*source, MeshQualityTier::LOW_RESOLUTION);
+    out = render(*source, kFadeFrames);
+    CHECK(get_peak(out, kFadeFrames / 2) == 0.f);
+}
+
+TEST_CASE("Quality tiers - Twin friction")
+{
+    // The twin follows its own friction, computed for its sample rate
+    auto get_tail_energy = [](float decay) {
+        auto source = create_source();
+        pin_tier(*source, MeshQualityTier::LOW_RESOLUTION);
+        render(*source, kFadeFrames);
+
+        const RimguideInfo info = get_rimguide_info(kSampleRate / 2, decay);
+        set_parameter(*source, MeshStreamParameter::SMOOTHING_LENGTH, 0.f);
+        set_parameter(*source, MeshStreamParameter::TWIN_FRICTION_COEFF, info.friction_coeff);
+        set_parameter(*source, MeshStreamParameter::TWIN_FRICTION_DELAY, info.friction_delay);
+
+        hit(*source);
+        return get_energy(render(*source, kRingFrames), kRingFrames / 2);
+    };
+
+    CHECK(get_tail_energy(8.f * kDecay) < 0.1 * get_tail_energy(kDecay));
+}
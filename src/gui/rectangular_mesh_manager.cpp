@@ -1,5 +1,6 @@
 #include "rectangular_mesh_manager.h"
 
+#include "denormal.h"
 #include "gaussian.h"
 #include "junction.h"
 #include "line.h"
@@ -31,7 +32,6 @@
 #include <functional>
 #include <iostream>
 #include <numbers>
-#include <thread>
 #include <utility>
 #include <vector>
 
@@ -44,11 +44,77 @@ float rand_float()
     return rn;
 }
 
+// Segments between connected junctions and from the boundary junctions to their rimguide
+void get_mesh_lines(const Mesh2D& mesh, MeshType mesh_type, float vertical_scaler, std::vector<glm::vec3>& start_points,
+                    std::vector<glm::vec3>& end_points)
+{
+    for (const auto& j : mesh.junctions_.container())
+    {
+        if (j.get_type() == 0)
+        {
+            continue;
+        }
+
+        auto pos = j.get_pos();
+
+        if (mesh_type == MeshType::TRIANGULAR_MESH)
+        {
+            if (j.get_neighbor(EAST) != nullptr)
+            {
+                auto neighbor_pos = j.get_neighbor(EAST)->get_pos();
+                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
+                                        j.get_neighbor(EAST)->get_output() * vertical_scaler);
+            }
+            if (j.get_neighbor(SOUTH_EAST) != nullptr)
+            {
+                auto neighbor_pos = j.get_neighbor(SOUTH_EAST)->get_pos();
+                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
+                                        j.get_neighbor(SOUTH_EAST)->get_output() * vertical_scaler);
+            }
+            if (j.get_neighbor(NORTH_EAST) != nullptr)
+            {
+                auto neighbor_pos = j.get_neighbor(NORTH_EAST)->get_pos();
+                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
+                                        j.get_neighbor(NORTH_EAST)->get_output() * vertical_scaler);
+            }
+        }
+        else if (mesh_type == MeshType::RECTILINEAR_MESH)
+        {
+            if (j.get_neighbor(EAST) != nullptr)
+            {
+                auto neighbor_pos = j.get_neighbor(EAST)->get_pos();
+                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
+                                        j.get_neighbor(EAST)->get_output() * vertical_scaler);
+            }
+            if (j.get_neighbor(SOUTH) != nullptr)
+            {
+                auto neighbor_pos = j.get_neighbor(SOUTH)->get_pos();
+                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
+                                        j.get_neighbor(SOUTH)->get_output() * vertical_scaler);
+            }
+        }
+
+        if (j.has_rimguide())
+        {
+            auto rimguide_pos = j.get_rimguide()->get_pos();
+            start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler);
+            end_points.emplace_back(rimguide_pos.x, rimguide_pos.y, 0.f);
+        }
+    }
+}
+
 } // namespace
 
 RectangularMeshManager::RectangularMeshManager()
 {
-    update_mesh_object();
+    compute_parameters();
+    // The first mesh is built right away so there is always one to show
+    publish_mesh_build(mesh_builder_.build_now(get_mesh_build_function()));
 }
 
 RectangularMeshManager::~RectangularMeshManager() = default;
@@ -93,62 +159,137 @@ void RectangularMeshManager::compute_parameters()
     fundamental_frequency_ = fundamental_frequency_ * sample_rate_ / (2 * M_PI);
 }
 
-void RectangularMeshManager::update_mesh_object()
+void RectangularMeshManager::update_mesh_object(const MeshUpdate& update)
 {
+    const Vec2Di previous_grid_size = grid_size_;
+    const float previous_sample_distance = sample_distance_;
+    const float previous_max_length = max_length_;
+    const float previous_max_width = max_width_;
+
     compute_parameters();
     is_simulation_running_ = false;
 
-    switch (mesh_type_)
+    // A build in progress started from older parameters, it has to be replaced
+    bool rebuild = update.topology || mesh_builder_.is_busy() || !(grid_size_ == previous_grid_size) ||
+                   sample_distance_ != previous_sample_distance;
+    if (!rebuild && (max_length_ != previous_max_length || max_width_ != previous_max_width))
     {
-    case MeshType::TRIANGULAR_MESH:
-        mesh_ = std::make_unique<TriMesh>(grid_size_.x, grid_size_.y, sample_distance_);
-        break;
-    case MeshType::RECTILINEAR_MESH:
-        mesh_ = std::make_unique<RectilinearMesh>(grid_size_.x, grid_size_.y, sample_distance_);
-        break;
-    default:
-        break;
+        // The grid is kept as long as the mask is the same
+        rebuild = mesh_->get_mask_for_rect(max_length_, max_width_).container() != mask_.container();
     }
 
-    RimguideInfo info = get_rimguide_info();
+    if (rebuild)
+    {
+        // The current mesh stays on screen until the new one is published
+        mesh_builder_.request(get_mesh_build_function());
+        return;
+    }
 
-    auto mask = mesh_->get_mask_for_rect(max_length_, max_width_);
-    mesh_->init(mask);
-    mesh_->init_boundary(info);
+    mesh_->clear();
+    if (update.boundary)
+    {
+        mesh_->update_boundary(get_rimguide_info());
+    }
+    if (update.input)
+    {
+        mesh_->set_input(input_radius_ / 100.f, Vec2Df{input_pos_.x / 100.f, input_pos_.y / 100.f});
+    }
+    is_gl_mesh_dirty_ = true;
+}
 
-    Vec2Df input_center = {input_pos_.x / 100.f, input_pos_.y / 100.f};
-    mesh_->set_input(input_radius_ / 100.f, input_center);
-    mesh_->set_output(output_pos_.x, output_pos_.y);
+MeshBuildFunction RectangularMeshManager::get_mesh_build_function() const
+{
+    // The parameters are copied, they keep changing while the mesh is built
+    return [mesh_type = mesh_type_, grid_size = grid_size_, sample_distance = sample_distance_,
+            max_length = max_length_, max_width = max_width_, info = get_rimguide_info(),
+            input_center = Vec2Df{input_pos_.x / 100.f, input_pos_.y / 100.f}, input_radius = input_radius_ / 100.f,
+            output_pos = output_pos_, clamp_center = clamp_center_,
+            vertical_scaler = vertical_scaler_](const MeshBuildToken& token) -> std::unique_ptr<MeshBuild> {
+        auto build = std::make_unique<MeshBuild>();
+        switch (mesh_type)
+        {
+        case MeshType::TRIANGULAR_MESH:
+            build->mesh = std::make_unique<TriMesh>(grid_size.x, grid_size.y, sample_distance);
+            break;
+        case MeshType::RECTILINEAR_MESH:
+            build->mesh = std::make_unique<RectilinearMesh>(grid_size.x, grid_size.y, sample_distance);
+            break;
+        default:
+            std::cerr << "Unsupported mesh type" << std::endl;
+            return nullptr;
+        }
 
-    if (clamp_center_)
+        if (token.is_cancelled())
+        {
+            return nullptr;
+        }
+
+        build->mask = build->mesh->get_mask_for_rect(max_length, max_width);
+        build->mesh->init(build->mask);
+
+        if (token.is_cancelled())
+        {
+            return nullptr;
+        }
+
+        build->mesh->init_boundary(info);
+        build->mesh->set_input(input_radius, input_center);
+        build->mesh->set_output(output_pos.x, output_pos.y);
+
+        if (clamp_center)
+        {
+            build->mesh->clamp_center_with_rimguide();
+        }
+
+        if (token.is_cancelled())
+        {
+            return nullptr;
+        }
+
+        get_mesh_lines(*build->mesh, mesh_type, vertical_scaler, build->line_starts, build->line_ends);
+        return build;
+    };
+}
+
+void RectangularMeshManager::publish_mesh_build(std::unique_ptr<MeshBuild> build)
+{
+    if (build == nullptr)
     {
-        mesh_->clamp_center_with_rimguide();
+        return;
     }
 
-    update_gl_mesh();
+    mesh_ = std::move(build->mesh);
+    mask_ = build->mask;
+    is_simulation_running_ = false;
+
+    update_gl_lines(std::move(build->line_starts), std::move(build->line_ends));
     line_->set_color({1.f, 1.f, 1.f});
     boundary_line_->set_color({1.f, 0.2f, 0.2f});
+    is_gl_mesh_dirty_ = false;
 }
 
 void RectangularMeshManager::draw_config_menu(bool& reset_camera)
 {
-    ImGui::BeginDisabled(is_rendering_);
-    bool config_changed = false;
+    publish_mesh_build(mesh_builder_.take_result());
+
+    MeshUpdate update;
+    // Parameters only used by the renders, which do not affect the mesh shown
+    bool render_changed = false;
     ImGui::SeparatorText("Mesh Config");
 
     constexpr float kColOffset = 130;
 
     ImGui::Text("Mesh Type:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::RadioButton("Triangular", reinterpret_cast<int*>(&mesh_type_),
-                                         static_cast<int>(MeshType::TRIANGULAR_MESH));
+    update.topology |= ImGui::RadioButton("Triangular", reinterpret_cast<int*>(&mesh_type_),
+                                          static_cast<int>(MeshType::TRIANGULAR_MESH));
     ImGui::SameLine();
-    config_changed |= ImGui::RadioButton("Rectilinear", reinterpret_cast<int*>(&mesh_type_),
-                                         static_cast<int>(MeshType::RECTILINEAR_MESH));
+    update.topology |= ImGui::RadioButton("Rectilinear", reinterpret_cast<int*>(&mesh_type_),
+                                          static_cast<int>(MeshType::RECTILINEAR_MESH));
 
     ImGui::Text("Sample Rate:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::InputInt("##sample_rate", &sample_rate_);
+    update.topology |= ImGui::InputInt("##sample_rate", &sample_rate_);
     if (sample_rate_ > 48000)
     {
         sample_rate_ = 48000;
@@ -166,14 +307,14 @@ void RectangularMeshManager::draw_config_menu(bool& reset_camera)
     static int width_cm = static_cast<int>(width_ * 100);
     ImGui::SameLine();
     ImGui::PushItemWidth(100);
-    config_changed |= ImGui::SliderInt("##length", &length_cm, 1, 100);
+    update.boundary |= ImGui::SliderInt("##length", &length_cm, 1, 100);
     if (locked)
     {
         width_cm = length_cm;
     }
     ImGui::BeginDisabled(locked);
     ImGui::SameLine();
-    config_changed |= ImGui::SliderInt("##width", &width_cm, 1, 100);
+    update.boundary |= ImGui::SliderInt("##width", &width_cm, 1, 100);
     ImGui::EndDisabled();
     ImGui::PopItemWidth();
 
@@ -182,36 +323,42 @@ void RectangularMeshManager::draw_config_menu(bool& reset_camera)
 
     ImGui::Text("Filter Pole:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##pole", &filter_pole_, 0.f, 1.f, nullptr, ImGuiSliderFlags_Logarithmic);
+    update.boundary |= ImGui::SliderFloat("##pole", &filter_pole_, 0.f, 1.f, nullptr, ImGuiSliderFlags_Logarithmic);
 
     ImGui::Text("Density:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##density", &density_, 0.1f, 1.f);
+    update.topology |= ImGui::SliderFloat("##density", &density_, 0.1f, 1.f);
 
     ImGui::Text("Tension:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderInt("##tension", &tension_, 1000, 10000);
+    update.topology |= ImGui::SliderInt("##tension", &tension_, 1000, 10000);
 
     ImGui::Text("Min. Rim Delay:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##min_rimguide_delay", &minimum_rimguide_delay_, 1.5f, 20.f);
+    update.boundary |= ImGui::SliderFloat("##min_rimguide_delay", &minimum_rimguide_delay_, 1.5f, 20.f);
 
     ImGui::Text("Input Pos:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat2("##input_pos", &input_pos_.x, -std::min(length_cm, width_cm) / 2.f,
-                                          std::min(length_cm, width_cm) / 2.f);
+    update.input |= ImGui::SliderFloat2("##input_pos", &input_pos_.x, -std::min(length_cm, width_cm) / 2.f,
+                                        std::min(length_cm, width_cm) / 2.f);
 
     ImGui::Text("Input Radius:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##input_radius", &input_radius_, 0.f, 0.25f * std::min(length_cm, width_cm));
+    update.input |= ImGui::SliderFloat("##input_radius", &input_radius_, 0.f, 0.25f * std::min(length_cm, width_cm));
 
     ImGui::Text("Clamped bound.:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::Checkbox("##solid_boundary", &is_solid_boundary_);
+    update.boundary |= ImGui::Checkbox("##solid_boundary", &is_solid_boundary_);
+
+    if (update.any())
+    {
+        update_mesh_object(update);
+    }
 
-    if (config_changed)
+    if (update.boundary)
     {
-        update_mesh_object();
+        // The streamed mesh keeps its geometry, only the friction of its rim follows the new parameters
+        post_stream_friction();
     }
 
     assert(mesh_ != nullptr);
@@ -222,14 +369,15 @@ void RectangularMeshManager::draw_config_menu(bool& reset_camera)
     ImGui::SameLine(kColOffset);
     static int excitation_type = 0;
     std::vector<const char*> excitation_names = {"Raised Cosine", "Dirac", "File"};
-    ImGui::Combo("##excitation_type", &excitation_type, excitation_names.data(), excitation_names.size());
+    render_changed |= ImGui::Combo("##excitation_type", &excitation_type, excitation_names.data(),
+                                   excitation_names.size());
     excitation_type_ = static_cast<ExcitationType>(excitation_type);
 
     if (excitation_type_ == ExcitationType::RAISE_COSINE)
     {
         ImGui::Text("Frequency (Hz):");
         ImGui::SameLine(kColOffset);
-        ImGui::SliderFloat("##excitation_freq", &excitation_frequency_, 10.f, 1000.f);
+        render_changed |= ImGui::SliderFloat("##excitation_freq", &excitation_frequency_, 10.f, 1000.f);
     }
     else if (excitation_type_ == ExcitationType::FILE)
     {
@@ -250,34 +398,44 @@ void RectangularMeshManager::draw_config_menu(bool& reset_camera)
         {
             excitation_filename_ = file_dialog.GetSelected().string();
             file_dialog.ClearSelected();
+            render_changed = true;
         }
     }
 
     ImGui::Text("Amplitude:");
     ImGui::SameLine(kColOffset);
-    ImGui::SliderFloat("##excitation_amp", &excitation_amplitude_, 0.f, 20.f);
+    render_changed |= ImGui::SliderFloat("##excitation_amp", &excitation_amplitude_, 0.f, 20.f);
 
     ImGui::SeparatorText("Listener config");
     std::vector<const char*> listener_types = {"All", "Boundary", "Point"};
     ImGui::Text("Listener Type:");
     ImGui::SameLine(kColOffset);
-    ImGui::Combo("##listener_type", reinterpret_cast<int*>(&listener_type_), listener_types.data(),
-                 listener_types.size());
+    render_changed |= ImGui::Combo("##listener_type", reinterpret_cast<int*>(&listener_type_),
+                                   listener_types.data(), listener_types.size());
 
     if (listener_type_ == ListenerType::POINT)
     {
         ImGui::Text("Listener Pos:");
         ImGui::SameLine(kColOffset);
-        config_changed |= ImGui::SliderFloat2("##output_pos", &output_pos_.x, 0.f, 1.f);
+        // Only moves the output, the mesh is left as is
+        if (ImGui::SliderFloat2("##output_pos", &output_pos_.x, 0.f, 1.f))
+        {
+            mesh_->set_output(output_pos_.x, output_pos_.y);
+            render_changed = true;
+        }
     }
 
-    ImGui::Checkbox("Use DC Blocker", &use_dc_blocker_);
+    render_changed |= ImGui::Checkbox("Use DC Blocker", &use_dc_blocker_);
     if (use_dc_blocker_)
     {
-        ImGui::SliderFloat("Alpha", &dc_blocker_alpha_, 0.85f, 0.999f);
+        render_changed |= ImGui::SliderFloat("Alpha", &dc_blocker_alpha_, 0.85f, 0.999f);
     }
 
-    ImGui::EndDisabled();
+    // The render in progress was started from the previous parameters, it is not worth finishing
+    if (update.any() || render_changed)
+    {
+        cancel_render();
+    }
 
     ImGui::SeparatorText("Derived Parameters");
     constexpr float kColOffset2 = 200;
@@ -339,8 +497,8 @@ void RectangularMeshManager::draw_config_menu(bool& reset_camera)
 
 void RectangularMeshManager::draw_experimental_config_menu()
 {
-    ImGui::BeginDisabled(is_rendering_);
-    bool config_changed = false;
+    ImGui::BeginDisabled(is_rendering());
+    MeshUpdate update;
     ImGui::SeparatorText("Experimental Mesh Config");
 
     constexpr float kIndent = 15;
@@ -352,61 +510,70 @@ void RectangularMeshManager::draw_experimental_config_menu()
     ImGui::Indent(kIndent);
     ImGui::Text("Mod Frequency:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##mod_freq", &allpass_mod_freq_, 0.f, 50.f);
+    ImGui::SliderFloat("##mod_freq", &allpass_mod_freq_, 0.f, 50.f);
 
     ImGui::Text("Amplitude:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::SliderFloat("##excitation_amp", &excitation_amplitude_, 0.f, 10.f);
+    ImGui::SliderFloat("##excitation_amp", &excitation_amplitude_, 0.f, 10.f);
 
     std::vector<const char*> types = {"Sync", "Phase offset", "Random", "Random Freq and Amp"};
     ImGui::Text("Modulation Type:");
     ImGui::SameLine(kColOffset);
-    config_changed |= ImGui::Combo("##mod_type", reinterpret_cast<int*>(&allpass_type_), types.data(), types.size());
+    ImGui::Combo("##mod_type", reinterpret_cast<int*>(&allpass_type_), types.data(), types.size());
 
     if (allpass_type_ == TimeVaryingAllpassType::RANDOM || allpass_type_ == TimeVaryingAllpassType::RANDOM_FREQ_AND_AMP)
     {
         ImGui::Text("Random Freq:");
         ImGui::SameLine(kColOffset);
-        config_changed |= ImGui::SliderFloat("##rand_freq", &allpass_random_freq_, 0.f, 1.f);
+        ImGui::SliderFloat("##rand_freq", &allpass_random_freq_, 0.f, 1.f);
     }
     if (allpass_type_ == TimeVaryingAllpassType::RANDOM_FREQ_AND_AMP)
     {
         ImGui::Text("Random Amp:");
         ImGui::SameLine(kColOffset);
-        config_changed |= ImGui::SliderFloat("##rand_amp", &allpass_random_mod_amp_, 0.f, 1.f);
+        ImGui::SliderFloat("##rand_amp", &allpass_random_mod_amp_, 0.f, 1.f);
     }
     if (allpass_type_ == TimeVaryingAllpassType::PHASE_OFFSET)
     {
         ImGui::Text("Phase Offset:");
         ImGui::SameLine(kColOffset);
-        config_changed |= ImGui::SliderFloat("##phase_offset", &allpass_phase_offset_, 0.f, 1.f);
+        ImGui::SliderFloat("##phase_offset", &allpass_phase_offset_, 0.f, 1.f);
     }
 
     ImGui::Unindent(kIndent);
     ImGui::EndDisabled();
 
-    config_changed |= ImGui::Checkbox("Clamp center", &clamp_center_);
+    update.topology |= ImGui::Checkbox("Clamp center", &clamp_center_);
 
-    config_changed |= ImGui::Checkbox("Automatic pitch bend", &use_automatic_pitch_bend_);
+    update.boundary |= ImGui::Checkbox("Automatic pitch bend", &use_automatic_pitch_bend_);
 
     if (use_automatic_pitch_bend_)
     {
-        config_changed |= ImGui::SliderFloat("Pitch bend amount", &pitch_bend_amount_, -1.f, 1.f);
+        // Applied in place, the mesh does not need to be rebuilt
+        if (ImGui::SliderFloat("Pitch bend amount", &pitch_bend_amount_, -1.f, 1.f))
+        {
+            mesh_->set_pitch_bend_amount(pitch_bend_amount_);
+            post_stream_parameter(MeshStreamParameter::PITCH_BEND_AMOUNT, pitch_bend_amount_);
+        }
     }
 
-    config_changed |= ImGui::Checkbox("Square law nonlinearity", &use_square_law_nonlinearity_);
+    update.boundary |= ImGui::Checkbox("Square law nonlinearity", &use_square_law_nonlinearity_);
     if (use_square_law_nonlinearity_)
     {
-        config_changed |= ImGui::SliderFloat("Non linear factor", &nonlinear_factor_, 0.f, 1.f);
+        if (ImGui::SliderFloat("Non linear factor", &nonlinear_factor_, 0.f, 1.f))
+        {
+            mesh_->set_nonlinear_factor(nonlinear_factor_);
+            post_stream_parameter(MeshStreamParameter::NONLINEAR_FACTOR, nonlinear_factor_);
+        }
     }
 
-    config_changed |= ImGui::Checkbox("Nonlinear allpass", &use_nonlinear_allpass_);
+    update.boundary |= ImGui::Checkbox("Nonlinear allpass", &use_nonlinear_allpass_);
     if (use_nonlinear_allpass_)
     {
-        config_changed |= ImGui::SliderFloat2("Coeff 1", nonlinear_allpass_coeffs_, -1.f, 1.f);
+        update.boundary |= ImGui::SliderFloat2("Coeff 1", nonlinear_allpass_coeffs_, -1.f, 1.f);
     }
 
-    config_changed |= ImGui::Checkbox("Extra diffusion filters", &use_extra_diffusion_filters_);
+    update.boundary |= ImGui::Checkbox("Extra diffusion filters", &use_extra_diffusion_filters_);
 
     if (use_extra_diffusion_filters_)
     {
@@ -441,9 +608,9 @@ void RectangularMeshManager::draw_experimental_config_menu()
 
     ImGui::EndDisabled();
 
-    if (config_changed)
+    if (update.any())
     {
-        update_mesh_object();
+        update_mesh_object(update);
     }
 }
 
@@ -477,10 +644,13 @@ void RectangularMeshManager::draw_simulation_menu(bool& reset_camera)
         }
 
         mesh_->clear();
+        is_gl_mesh_dirty_ = true;
     }
 
     if (ImGui::Button("Tick"))
     {
+        // Ticked on the GUI thread, whose tail would otherwise fall into the subnormal range
+        ScopedFlushDenormals flush_denormals;
         if (impulse_idx < impulse.size())
         {
             mesh_->tick(impulse[impulse_idx]);
@@ -490,6 +660,7 @@ void RectangularMeshManager::draw_simulation_menu(bool& reset_camera)
         {
             mesh_->tick(0);
         }
+        is_gl_mesh_dirty_ = true;
     }
 
     static float elapsed_time = 0.f;
@@ -499,6 +670,7 @@ void RectangularMeshManager::draw_simulation_menu(bool& reset_camera)
         elapsed_time += ImGui::GetIO().DeltaTime;
         if (elapsed_time > 1.f / simul_speed)
         {
+            ScopedFlushDenormals flush_denormals;
             if (impulse_idx < impulse.size())
             {
                 mesh_->tick(impulse[impulse_idx]);
@@ -509,6 +681,7 @@ void RectangularMeshManager::draw_simulation_menu(bool& reset_camera)
                 mesh_->tick(0);
             }
             elapsed_time = 0.f;
+            is_gl_mesh_dirty_ = true;
         }
     }
 
@@ -527,20 +700,27 @@ void RectangularMeshManager::draw_simulation_menu(bool& reset_camera)
         reset_camera = true;
     }
 
-    ImGui::SliderFloat("Vertical Scaler", &vertical_scaler_, 0.1f, 10.f);
+    is_gl_mesh_dirty_ |= ImGui::SliderFloat("Vertical Scaler", &vertical_scaler_, 0.1f, 10.f);
 
-    update_gl_mesh();
+    // The geometry only changes when the mesh is ticked or updated
+    if (is_gl_mesh_dirty_)
+    {
+        update_gl_mesh();
+    }
 }
 
-void RectangularMeshManager::render_async(float render_time_seconds, RenderCompleteCallback cb)
+std::vector<float> RectangularMeshManager::get_render_mesh_key() const
+{
+    std::vector<float> key = MeshManager::get_render_mesh_key();
+    key.insert(key.end(), {static_cast<float>(mesh_type_), static_cast<float>(grid_size_.x),
+                           static_cast<float>(grid_size_.y), sample_distance_, max_length_, max_width_, length_,
+                           width_, input_pos_.x, input_pos_.y, input_radius_, output_pos_.x, output_pos_.y,
+                           static_cast<float>(clamp_center_), static_cast<float>(use_time_varying_allpass_)});
+    return key;
+}
+
+std::unique_ptr<Mesh2D> RectangularMeshManager::create_render_mesh()
 {
-    if (is_rendering_)
-    {
-        std::cerr << "Already rendering" << std::endl;
-        return;
-    }
-    render_time_seconds_ = render_time_seconds;
-    is_rendering_ = true;
     std::unique_ptr<Mesh2D> mesh;
 
     switch (mesh_type_)
@@ -552,7 +732,7 @@ void RectangularMeshManager::render_async(float render_time_seconds, RenderCompl
         mesh = std::make_unique<RectilinearMesh>(grid_size_.x, grid_size_.y, sample_distance_);
         break;
     default:
-        break;
+        return nullptr;
     }
 
     RimguideInfo info = get_rimguide_info();
@@ -614,7 +794,7 @@ void RectangularMeshManager::render_async(float render_time_seconds, RenderCompl
         }
     }
 
-    std::thread(&RectangularMeshManager::render_async_worker, this, std::move(mesh), cb).detach();
+    return mesh;
 }
 
 void RectangularMeshManager::plot_mesh() const
@@ -791,65 +971,13 @@ void RectangularMeshManager::update_gl_mesh()
 {
     std::vector<glm::vec3> start_points;
     std::vector<glm::vec3> end_points;
-    for (const auto& j : mesh_->junctions_.container())
-    {
-        if (j.get_type() == 0)
-        {
-            continue;
-        }
-
-        auto pos = j.get_pos();
-
-        if (mesh_type_ == MeshType::TRIANGULAR_MESH)
-        {
-            if (j.get_neighbor(EAST) != nullptr)
-            {
-                auto neighbor_pos = j.get_neighbor(EAST)->get_pos();
-                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
-                                        j.get_neighbor(EAST)->get_output() * vertical_scaler_);
-            }
-            if (j.get_neighbor(SOUTH_EAST) != nullptr)
-            {
-                auto neighbor_pos = j.get_neighbor(SOUTH_EAST)->get_pos();
-                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
-                                        j.get_neighbor(SOUTH_EAST)->get_output() * vertical_scaler_);
-            }
-            if (j.get_neighbor(NORTH_EAST) != nullptr)
-            {
-                auto neighbor_pos = j.get_neighbor(NORTH_EAST)->get_pos();
-                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
-                                        j.get_neighbor(NORTH_EAST)->get_output() * vertical_scaler_);
-            }
-        }
-        else if (mesh_type_ == MeshType::RECTILINEAR_MESH)
-        {
-            if (j.get_neighbor(EAST) != nullptr)
-            {
-                auto neighbor_pos = j.get_neighbor(EAST)->get_pos();
-                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
-                                        j.get_neighbor(EAST)->get_output() * vertical_scaler_);
-            }
-            if (j.get_neighbor(SOUTH) != nullptr)
-            {
-                auto neighbor_pos = j.get_neighbor(SOUTH)->get_pos();
-                start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-                end_points.emplace_back(neighbor_pos.x, neighbor_pos.y,
-                                        j.get_neighbor(SOUTH)->get_output() * vertical_scaler_);
-            }
-        }
-
-        if (j.has_rimguide())
-        {
-            auto rimguide_pos = j.get_rimguide()->get_pos();
-            start_points.emplace_back(pos.x, pos.y, j.get_output() * vertical_scaler_);
-            end_points.emplace_back(rimguide_pos.x, rimguide_pos.y, 0.f);
-        }
-    }
+    get_mesh_lines(*mesh_, mesh_type_, vertical_scaler_, start_points, end_points);
+    update_gl_lines(std::move(start_points), std::move(end_points));
+    is_gl_mesh_dirty_ = false;
+}
 
+void RectangularMeshManager::update_gl_lines(std::vector<glm::vec3> start_points, std::vector<glm::vec3> end_points)
+{
     if (!line_)
     {
         line_ = std::make_unique<Line>(start_points, end_points);
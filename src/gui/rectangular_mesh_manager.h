@@ -3,6 +3,8 @@
 #include "glm/ext/matrix_float4x4.hpp"
 #include "line.h"
 #include "listener.h"
+#include "mat2d.h"
+#include "mesh_builder.h"
 #include "mesh_2d.h"
 #include "mesh_manager.h"
 #include "trimesh.h"
@@ -45,13 +47,6 @@ class RectangularMeshManager : public MeshManager
      */
     void draw_simulation_menu(bool& reset_camera);
 
-    /**
-     * @brief Renders the mesh asynchronously.
-     * @param render_time_seconds Time in seconds for rendering.
-     * @param cb Callback function to be called upon render completion.
-     */
-    void render_async(float render_time_seconds, RenderCompleteCallback cb) override;
-
     /**
      * @brief Plots the mesh.
      */
@@ -65,26 +60,48 @@ class RectangularMeshManager : public MeshManager
 
     float current_fundamental_frequency() const;
 
-  private:
+  protected:
+    std::unique_ptr<Mesh2D> create_render_mesh() override;
+    std::vector<float> get_render_mesh_key() const override;
+    RimguideInfo get_rimguide_info() const override;
+
     /**
      * @brief Computes the parameters for the mesh.
      */
-    void compute_parameters();
+    void compute_parameters() override;
 
+  private:
     /**
-     * @brief Updates the mesh object.
+     * @brief Updates the mesh object after a change of parameters.
+     * @param update The parts of the mesh affected by the change.
+     * @note The mesh is only rebuilt if its grid or mask changes, otherwise the affected parts are updated in place.
      */
-    void update_mesh_object();
+    void update_mesh_object(const MeshUpdate& update);
+
+    /**
+     * @brief Snapshots the current parameters into a function building the mesh on the builder thread.
+     */
+    MeshBuildFunction get_mesh_build_function() const;
+
+    /**
+     * @brief Replaces the mesh object with a finished build.
+     * @param build The build, ignored if nullptr.
+     */
+    void publish_mesh_build(std::unique_ptr<MeshBuild> build);
 
     /**
      * @brief Updates the OpenGL mesh.
      */
     void update_gl_mesh();
 
-    RimguideInfo get_rimguide_info() const;
+    /**
+     * @brief Uploads the segments of the mesh and redraws the boundary.
+     */
+    void update_gl_lines(std::vector<glm::vec3> start_points, std::vector<glm::vec3> end_points);
 
     MeshType mesh_type_ = MeshType::RECTILINEAR_MESH; ///< Type of the mesh.
     std::unique_ptr<Mesh2D> mesh_{nullptr};           ///< Pointer to the mesh object.
+    Mat2D<uint8_t> mask_;                             ///< Mask the mesh object was built with.
 
     // Model parameters
     float length_ = 0.64;                 ///< Length of the rectangular mesh.
@@ -100,6 +117,7 @@ class RectangularMeshManager : public MeshManager
 
     bool is_simulation_running_ = false; ///< Flag indicating if the simulation is running.
     float vertical_scaler_ = 1.f;        ///< Vertical scaler for rendering.
+    bool is_gl_mesh_dirty_ = false;      ///< Flag indicating if the OpenGL mesh is out of date.
 
     // Derived parameters
     float wave_speed_ = 0;            ///< Speed of the wave propagation.
@@ -145,4 +163,6 @@ class RectangularMeshManager : public MeshManager
 
     std::unique_ptr<Line> line_ = nullptr;          ///< Pointer to the line object.
     std::unique_ptr<Line> boundary_line_ = nullptr; ///< Pointer to the rectangular line object.
+
+    MeshBuilder mesh_builder_; ///< Rebuilds the mesh in the background, destroyed first.
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "render_preview.h"
+
+#include <algorithm>
+#include <utility>
+
+RenderPreview::RenderPreview(size_t frame_count, uint32_t sample_rate)
+    : frame_count_(frame_count)
+    , sample_rate_(sample_rate)
+{
+    // Reserved up front, the render thread never waits for a reallocation
+    samples_.reserve(frame_count_);
+}
+
+void RenderPreview::append(std::span<const float> samples)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t count = std::min(samples.size(), frame_count_ - samples_.size());
+    samples_.insert(samples_.end(), samples.begin(), samples.begin() + count);
+    version_++;
+}
+
+uint64_t RenderPreview::get_samples(std::vector<float>& samples) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples = samples_;
+    return version_;
+}
+
+size_t RenderPreview::read(size_t position, float* out_buffer, size_t count) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (position >= samples_.size())
+    {
+        return 0;
+    }
+
+    count = std::min(count, samples_.size() - position);
+    std::copy_n(samples_.begin() + position, count, out_buffer);
+    return count;
+}
+
+uint64_t RenderPreview::get_version() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return version_;
+}
+
+size_t RenderPreview::get_frame_count() const
+{
+    return frame_count_;
+}
+
+size_t RenderPreview::get_rendered_frame_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samples_.size();
+}
+
+uint32_t RenderPreview::get_sample_rate() const
+{
+    return sample_rate_;
+}
+
+RenderPreviewSource::RenderPreviewSource(std::shared_ptr<const RenderPreview> preview)
+    : preview_(std::move(preview))
+{
+}
+
+uint32_t RenderPreviewSource::GetSampleRate() const
+{
+    return preview_->get_sample_rate();
+}
+
+void RenderPreviewSource::HandleCommand(const StreamCommand& command)
+{
+    if (command.type == StreamCommandType::kHit)
+    {
+        position_ = 0;
+    }
+}
+
+void RenderPreviewSource::Render(float* out_buffer, size_t frame_size)
+{
+    const size_t count = preview_->read(position_, out_buffer, frame_size);
+    std::fill(out_buffer + count, out_buffer + frame_size, 0.f);
+
+    // Waits for the samples not rendered yet instead of skipping them
+    position_ += count;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "stream_renderer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+/**
+ * @class RenderPreview
+ * @brief The output of a render as it is being rendered, shared between the render thread, the GUI and the player.
+ */
+class RenderPreview
+{
+  public:
+    /**
+     * @brief Constructs a RenderPreview object.
+     * @param frame_count The length of the render once finished.
+     * @param sample_rate The sample rate of the render.
+     */
+    RenderPreview(size_t frame_count, uint32_t sample_rate);
+
+    /**
+     * @brief Adds the samples following the ones already rendered.
+     */
+    void append(std::span<const float> samples);
+
+    /**
+     * @brief Copies the rendered samples.
+     * @return The version of the copied samples.
+     */
+    uint64_t get_samples(std::vector<float>& samples) const;
+
+    /**
+     * @brief Copies rendered samples from a position.
+     * @return The number of samples copied, less than count if they are not rendered yet.
+     */
+    size_t read(size_t position, float* out_buffer, size_t count) const;
+
+    /**
+     * @brief Gets a number incremented by every append, to tell whether the samples changed.
+     */
+    uint64_t get_version() const;
+
+    size_t get_frame_count() const;
+    size_t get_rendered_frame_count() const;
+    uint32_t get_sample_rate() const;
+
+  private:
+    const size_t frame_count_;
+    const uint32_t sample_rate_;
+
+    mutable std::mutex mutex_;
+    std::vector<float> samples_;
+    uint64_t version_ = 0;
+};
+
+/**
+ * @class RenderPreviewSource
+ * @brief Plays a RenderPreview while it is being rendered, pausing when the playback catches up with the render.
+ *
+ * A StreamCommandType::kHit command restarts the playback from the beginning.
+ */
+class RenderPreviewSource : public StreamSource
+{
+  public:
+    explicit RenderPreviewSource(std::shared_ptr<const RenderPreview> preview);
+    ~RenderPreviewSource() override = default;
+
+    uint32_t GetSampleRate() const override;
+    void HandleCommand(const StreamCommand& command) override;
+    void Render(float* out_buffer, size_t frame_size) override;
+
+  private:
+    std::shared_ptr<const RenderPreview> preview_;
+    size_t position_ = 0;
+};
@@ -0,0 +1,430 @@
+#include "compiled_mesh.h"
+
+#include "junction.h"
+#include "mesh_2d.h"
+#include "rimguide.h"
+#include "vec2d.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr int32_t kNoWave = -1;
+
+// The self-loop port is stored after the regular ports
+constexpr size_t kLoadPort = kMaxPortCount;
+
+// Number of instances accumulated together by the product, one AVX register
+constexpr size_t kInstanceBlock = 8;
+
+// Shortest delay the allpass interpolation of stk::DelayA handles
+constexpr float kMinRimguideDelay = 0.5f;
+
+using Row = std::vector<std::pair<uint32_t, float>>;
+
+// Same setup as Rimguide::init()
+void init_rimguide(stk::DelayA& delay_line, stk::OnePole& filter, float delay, float friction_coeff)
+{
+    delay_line.setMaximumDelay(static_cast<unsigned long>(std::exp2(std::ceil(std::log2(delay + 1)))));
+    delay_line.setDelay(delay);
+    delay_line.clear();
+    filter.setPole(friction_coeff);
+    filter.clear();
+}
+
+// Sums the coefficients of the same column and drops the ones that cancel out
+void merge_row(Row& row)
+{
+    std::sort(row.begin(), row.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    Row merged;
+    for (const auto& [column, value] : row)
+    {
+        if (!merged.empty() && merged.back().first == column)
+        {
+            merged.back().second += value;
+        }
+        else
+        {
+            merged.emplace_back(column, value);
+        }
+    }
+
+    std::erase_if(merged, [](const auto& coeff) { return coeff.second == 0.f; });
+    row = std::move(merged);
+}
+} // namespace
+
+bool CompiledMesh::compile(const Mesh2D& mesh, size_t instance_count)
+{
+    if (instance_count == 0)
+    {
+        std::cerr << "Invalid instance count" << std::endl;
+        return false;
+    }
+
+    if (mesh.get_symmetry() != SymmetryMode::NONE)
+    {
+        std::cerr << "Symmetry modes are not supported by the compiled mesh" << std::endl;
+        return false;
+    }
+
+    const auto& junctions = mesh.junctions_.container();
+    const size_t junction_count = junctions.size();
+
+    // Index of the wave arriving on each port, and of the rimguide of each junction
+    std::vector<std::array<int32_t, kMaxPortCount + 1>> wave_index(junction_count);
+    std::vector<int32_t> rimguide_index(junction_count, kNoWave);
+    size_t wave_count = 0;
+    size_t rimguide_count = 0;
+
+    for (size_t idx = 0; idx < junction_count; ++idx)
+    {
+        const Junction& j = junctions[idx];
+        wave_index[idx].fill(kNoWave);
+        if (j.get_type() == 0)
+        {
+            continue;
+        }
+
+        if (j.has_symmetry_ports() || j.has_external_ports())
+        {
+            std::cerr << "Junctions with symmetry or external ports can not be compiled" << std::endl;
+            return false;
+        }
+
+        for (size_t port = 0; port < j.get_port_count(); ++port)
+        {
+            if (j.get_neighbor(static_cast<NEIGHBORS>(port)) != nullptr)
+            {
+                wave_index[idx][port] = static_cast<int32_t>(wave_count++);
+            }
+        }
+        if (j.get_load_admittance() > 0.f)
+        {
+            wave_index[idx][kLoadPort] = static_cast<int32_t>(wave_count++);
+        }
+
+        if (j.has_rimguide())
+        {
+            if (!j.get_rimguide()->is_linear())
+            {
+                std::cerr << "Rimguides with nonlinearities, modulation or diffusion filters can not be compiled"
+                          << std::endl;
+                return false;
+            }
+            rimguide_index[idx] = static_cast<int32_t>(rimguide_count++);
+        }
+    }
+
+    std::vector<bool> is_input(junction_count, false);
+    for (const Junction* j : mesh.get_inputs())
+    {
+        is_input[j - junctions.data()] = true;
+    }
+
+    const size_t output_idx = &mesh.junctions_(mesh.output_x, mesh.output_y) - junctions.data();
+
+    const size_t state_size = wave_count + rimguide_count + 1;
+    const auto input_column = static_cast<uint32_t>(wave_count + rimguide_count);
+
+    // The pressures are stored after the state, one per active junction
+    std::vector<Row> scatter_rows;
+    std::vector<Row> propagation_rows(state_size);
+
+    for (size_t idx = 0; idx < junction_count; ++idx)
+    {
+        const Junction& j = junctions[idx];
+        if (j.get_type() == 0)
+        {
+            continue;
+        }
+
+        // Same equations as Junction::process_scatter_n_port(), the 4 and 6 port junctions are the special case
+        // where every admittance is 1
+        const float scaler = 2.f / j.get_total_admittance();
+        const float input_scaled = is_input[idx] ? scaler : 0.f;
+
+        Row& pressure = scatter_rows.emplace_back();
+        // The input drives every port but the rimguide
+        float driven_admittance = j.get_load_admittance();
+        for (size_t port = 0; port < j.get_port_count(); ++port)
+        {
+            if (wave_index[idx][port] != kNoWave)
+            {
+                pressure.emplace_back(wave_index[idx][port], scaler * j.get_port_admittance(port));
+                driven_admittance += j.get_port_admittance(port);
+            }
+        }
+        if (wave_index[idx][kLoadPort] != kNoWave)
+        {
+            pressure.emplace_back(wave_index[idx][kLoadPort], scaler * j.get_load_admittance());
+        }
+        if (rimguide_index[idx] != kNoWave)
+        {
+            pressure.emplace_back(wave_count + rimguide_index[idx], scaler * j.get_rim_admittance());
+        }
+        if (is_input[idx])
+        {
+            pressure.emplace_back(input_column, scaler * driven_admittance * input_scaled);
+        }
+
+        const auto pressure_column = static_cast<uint32_t>(state_size + scatter_rows.size() - 1);
+
+        // The outgoing wave of each port is the incoming wave of the remote port on the next tick
+        for (size_t port = 0; port < j.get_port_count(); ++port)
+        {
+            const Junction* neighbor = j.get_neighbor(static_cast<NEIGHBORS>(port));
+            if (neighbor == nullptr)
+            {
+                continue;
+            }
+
+            const size_t remote = j.get_remote_port(port);
+            Row& row = propagation_rows[wave_index[neighbor - junctions.data()][remote]];
+            row.emplace_back(pressure_column, 1.f);
+            row.emplace_back(wave_index[idx][port], -1.f);
+            if (is_input[idx])
+            {
+                row.emplace_back(input_column, -input_scaled);
+            }
+        }
+
+        if (wave_index[idx][kLoadPort] != kNoWave)
+        {
+            Row& row = propagation_rows[wave_index[idx][kLoadPort]];
+            row.emplace_back(pressure_column, 1.f);
+            row.emplace_back(wave_index[idx][kLoadPort], -1.f);
+            if (is_input[idx])
+            {
+                row.emplace_back(input_column, -input_scaled);
+            }
+        }
+
+        if (rimguide_index[idx] != kNoWave)
+        {
+            Row& row = propagation_rows[wave_count + rimguide_index[idx]];
+            row.emplace_back(pressure_column, 1.f);
+            row.emplace_back(wave_count + rimguide_index[idx], -1.f);
+        }
+
+        if (idx == output_idx)
+        {
+            propagation_rows[input_column].emplace_back(pressure_column, 1.f);
+        }
+    }
+
+    instance_count_ = instance_count;
+    wave_count_ = wave_count;
+    rimguide_count_ = rimguide_count;
+    state_size_ = state_size;
+
+    auto to_csr = [](std::vector<Row>& rows, SparseMatrix& matrix) {
+        matrix.row_offsets.assign(1, 0);
+        matrix.columns.clear();
+        matrix.values.clear();
+        for (auto& row : rows)
+        {
+            merge_row(row);
+            for (const auto& [column, value] : row)
+            {
+                matrix.columns.push_back(column);
+                matrix.values.push_back(value);
+            }
+            matrix.row_offsets.push_back(static_cast<uint32_t>(matrix.columns.size()));
+        }
+    };
+    to_csr(scatter_rows, scatter_);
+    to_csr(propagation_rows, propagation_);
+
+    state_.assign((state_size_ + scatter_rows.size()) * instance_count_, 0.f);
+    next_state_.assign(state_.size(), 0.f);
+
+    delay_lines_.clear();
+    filters_.clear();
+    phase_reversal_.clear();
+    rimguide_distance_.clear();
+    for (size_t idx = 0; idx < junction_count; ++idx)
+    {
+        if (rimguide_index[idx] == kNoWave)
+        {
+            continue;
+        }
+
+        const Rimguide* rimguide = junctions[idx].get_rimguide();
+        stk::DelayA delay_line;
+        stk::OnePole filter;
+        init_rimguide(delay_line, filter, rimguide->get_delay(), rimguide->get_friction_coeff());
+
+        delay_lines_.insert(delay_lines_.end(), instance_count_, delay_line);
+        filters_.insert(filters_.end(), instance_count_, filter);
+        phase_reversal_.insert(phase_reversal_.end(), instance_count_, rimguide->get_phase_reversal());
+        rimguide_distance_.push_back(get_distance(rimguide->get_pos(), junctions[idx].get_pos()));
+    }
+
+    return true;
+}
+
+bool CompiledMesh::set_rimguide_info(size_t instance, const RimguideInfo& info)
+{
+    assert(instance < instance_count_);
+
+    if (info.use_automatic_pitch_bend || info.use_square_law_nonlinearity || info.use_nonlinear_allpass ||
+        info.use_extra_diffusion_filters)
+    {
+        std::cerr << "Rimguides with nonlinearities or diffusion filters can not be compiled" << std::endl;
+        return false;
+    }
+
+    // Same delay as Rimguide::init()
+    const float samples_per_meter = info.sample_rate / info.wave_speed;
+    for (size_t r = 0; r < rimguide_count_; ++r)
+    {
+        if (rimguide_distance_[r] * samples_per_meter * 2.f - 1.f - info.friction_delay < kMinRimguideDelay)
+        {
+            std::cerr << "Rimguide delay too short for the friction delay" << std::endl;
+            return false;
+        }
+    }
+
+    for (size_t r = 0; r < rimguide_count_; ++r)
+    {
+        const size_t idx = r * instance_count_ + instance;
+        const float delay = rimguide_distance_[r] * samples_per_meter * 2.f - 1.f - info.friction_delay;
+        init_rimguide(delay_lines_[idx], filters_[idx], delay, info.friction_coeff);
+        phase_reversal_[idx] = info.is_solid_boundary ? -1.f : 1.f;
+    }
+
+    return true;
+}
+
+void CompiledMesh::clear()
+{
+    std::fill(state_.begin(), state_.end(), 0.f);
+    std::fill(next_state_.begin(), next_state_.end(), 0.f);
+    for (auto& delay_line : delay_lines_)
+    {
+        delay_line.clear();
+    }
+    for (auto& filter : filters_)
+    {
+        filter.clear();
+    }
+}
+
+float CompiledMesh::tick(float input)
+{
+    assert(instance_count_ == 1);
+    float output = 0.f;
+    tick(&input, &output);
+    return output;
+}
+
+void CompiledMesh::tick(const float* input, float* output)
+{
+    const size_t input_row = (wave_count_ + rimguide_count_) * instance_count_;
+    std::copy(input, input + instance_count_, state_.begin() + input_row);
+
+    // The pressures only depend on the state, they can be written next to it
+    multiply(scatter_, state_.data(), state_.data() + state_size_ * instance_count_);
+    multiply(propagation_, state_.data(), next_state_.data());
+
+    std::copy(next_state_.begin() + input_row, next_state_.begin() + input_row + instance_count_, output);
+    std::swap(state_, next_state_);
+
+    // The rimguide rows now hold the wave sent to each rimguide, replace it with what comes back
+    for (size_t r = 0; r < rimguide_count_; ++r)
+    {
+        float* wave = state_.data() + (wave_count_ + r) * instance_count_;
+        for (size_t i = 0; i < instance_count_; ++i)
+        {
+            const size_t idx = r * instance_count_ + i;
+            wave[i] = delay_lines_[idx].tick(filters_[idx].tick(wave[i] * phase_reversal_[idx]));
+        }
+    }
+}
+
+void CompiledMesh::process(const float* input, float* output, size_t frame_count)
+{
+    for (size_t frame = 0; frame < frame_count; ++frame)
+    {
+        tick(input + frame * instance_count_, output + frame * instance_count_);
+    }
+}
+
+void CompiledMesh::multiply(const SparseMatrix& matrix, const float* src, float* dst) const
+{
+    const size_t row_count = matrix.row_offsets.size() - 1;
+    const uint32_t* columns = matrix.columns.data();
+    const float* values = matrix.values.data();
+
+    if (instance_count_ == 1)
+    {
+        for (size_t row = 0; row < row_count; ++row)
+        {
+            float acc = 0.f;
+            for (uint32_t e = matrix.row_offsets[row]; e < matrix.row_offsets[row + 1]; ++e)
+            {
+                acc += values[e] * src[columns[e]];
+            }
+            dst[row] = acc;
+        }
+        return;
+    }
+
+    // Accumulate blocks of instances in registers, the inner loops have a fixed length the compiler can vectorize
+    const size_t block_end = instance_count_ - instance_count_ % kInstanceBlock;
+    for (size_t row = 0; row < row_count; ++row)
+    {
+        float* dst_row = dst + row * instance_count_;
+        const uint32_t begin = matrix.row_offsets[row];
+        const uint32_t end = matrix.row_offsets[row + 1];
+
+        for (size_t block = 0; block < block_end; block += kInstanceBlock)
+        {
+            std::array<float, kInstanceBlock> acc{};
+            for (uint32_t e = begin; e < end; ++e)
+            {
+                const float value = values[e];
+                const float* src_row = src + columns[e] * instance_count_ + block;
+                for (size_t i = 0; i < kInstanceBlock; ++i)
+                {
+                    acc[i] += value * src_row[i];
+                }
+            }
+            std::copy(acc.begin(), acc.end(), dst_row + block);
+        }
+
+        for (size_t i = block_end; i < instance_count_; ++i)
+        {
+            float acc = 0.f;
+            for (uint32_t e = begin; e < end; ++e)
+            {
+                acc += values[e] * src[columns[e] * instance_count_ + i];
+            }
+            dst_row[i] = acc;
+        }
+    }
+}
+
+size_t CompiledMesh::get_instance_count() const
+{
+    return instance_count_;
+}
+
+size_t CompiledMesh::get_wave_count() const
+{
+    return wave_count_;
+}
+
+size_t CompiledMesh::get_nonzero_count() const
+{
+    return scatter_.values.size() + propagation_.values.size();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <DelayA.h>
+#include <OnePole.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Mesh2D;
+struct RimguideInfo;
+
+/**
+ * @class CompiledMesh
+ * @brief A mesh compiled into a sparse matrix, to run several instances of the same drum at once.
+ *
+ * Without the rimguides, a tick of the mesh is a fixed linear map from the incoming waves of every port to the
+ * incoming waves of the next tick. It is compiled into two CSR matrices acting on a state vector made of the incoming
+ * wave of every port (self-loop ports included), the output of every rimguide and the input sample:
+ * - the scatter matrix gives the pressure of every junction
+ * - the propagation matrix gives the next incoming waves, the wave sent to each rimguide and the pressure at the
+ *   output junction, from the state and the pressures
+ *
+ * Keeping the two steps apart needs about half the coefficients of the product of the two matrices. The rimguides are
+ * run after the propagation as plain filtered delay lines.
+ *
+ * Several instances sharing the topology (different excitations of the same drum) are processed together as a
+ * sparse matrix times dense matrix product. The instance index is the innermost dimension of the state, so the inner
+ * loop of the product is a contiguous multiply-add over the instances that the compiler can vectorize.
+ */
+class CompiledMesh
+{
+  public:
+    CompiledMesh() = default;
+    ~CompiledMesh() = default;
+
+    CompiledMesh(const CompiledMesh& mesh) = delete;
+    CompiledMesh& operator=(const CompiledMesh& mesh) = delete;
+    CompiledMesh(CompiledMesh&& mesh) = default;
+    CompiledMesh& operator=(CompiledMesh&& mesh) = default;
+
+    /**
+     * @brief Compiles an initialized mesh.
+     * @param mesh The mesh, with its boundary, input and output already set.
+     * @param instance_count The number of instances processed on every tick.
+     * @return False if the mesh can not be compiled. Symmetry ports, meshes running at several rates and rimguides
+     * with nonlinearities, modulation or diffusion filters are not supported.
+     * @note Only the topology is compiled, every instance starts from a cleared state.
+     */
+    bool compile(const Mesh2D& mesh, size_t instance_count = 1);
+
+    /**
+     * @brief Sets the rimguide parameters of one instance.
+     * @param instance The instance.
+     * @param info The rimguide parameters. Only the parameters of a linear rimguide are used: the friction, the wave
+     * speed, the sample rate and the boundary type. The rimguides stay where they were in the compiled mesh.
+     * @return False if the parameters need a nonlinear rimguide or the delay of a rimguide would be too short.
+     * @note Clears the rimguides of the instance.
+     */
+    bool set_rimguide_info(size_t instance, const RimguideInfo& info);
+
+    /**
+     * @brief Clears the state of every instance.
+     */
+    void clear();
+
+    /**
+     * @brief Processes a tick of a single instance mesh.
+     * @param input The input value.
+     * @return The pressure at the output junction.
+     */
+    float tick(float input);
+
+    /**
+     * @brief Processes a tick of every instance.
+     * @param input The input value of each instance.
+     * @param output The pressure at the output junction of each instance.
+     */
+    void tick(const float* input, float* output);
+
+    /**
+     * @brief Processes several ticks of every instance.
+     * @param input The input values, instance_count values per frame.
+     * @param output The output values, instance_count values per frame.
+     * @param frame_count The number of ticks to process.
+     */
+    void process(const float* input, float* output, size_t frame_count);
+
+    size_t get_instance_count() const;
+
+    /**
+     * @brief Gets the number of ports carrying a wave, the size of the linear part of the state.
+     * @return The number of waves.
+     */
+    size_t get_wave_count() const;
+
+    /**
+     * @brief Gets the number of nonzero coefficients of the two matrices.
+     * @return The number of nonzero coefficients.
+     */
+    size_t get_nonzero_count() const;
+
+  private:
+    struct SparseMatrix
+    {
+        std::vector<uint32_t> row_offsets;
+        std::vector<uint32_t> columns;
+        std::vector<float> values;
+    };
+
+    /**
+     * @brief Computes dst = matrix * src for every instance.
+     * @param matrix The matrix.
+     * @param src The state the matrix acts on, instance innermost.
+     * @param dst One row per matrix row, instance innermost. Must not overlap the columns read from src.
+     */
+    void multiply(const SparseMatrix& matrix, const float* src, float* dst) const;
+
+    size_t instance_count_ = 0;
+    size_t wave_count_ = 0;
+    size_t rimguide_count_ = 0;
+    size_t state_size_ = 0; ///< Waves, rimguide outputs and the input
+
+    SparseMatrix scatter_;     ///< Pressure of every junction
+    SparseMatrix propagation_; ///< Next state from the state and the pressures
+
+    std::vector<float> state_;      ///< The state followed by the pressures, instance innermost
+    std::vector<float> next_state_; ///< Same layout, the input row holds the output pressure after a tick
+
+    // One delay line and friction filter per rimguide and instance, instance innermost
+    std::vector<stk::DelayA> delay_lines_;
+    std::vector<stk::OnePole> filters_;
+    std::vector<float> phase_reversal_;    ///< Per rimguide and instance
+    std::vector<float> rimguide_distance_; ///< Distance between each rimguide and its junction
+};
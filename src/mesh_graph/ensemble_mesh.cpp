@@ -0,0 +1,92 @@
+#include "ensemble_mesh.h"
+
+#include "mesh_2d.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+// 8 floats fill an AVX register, 16 an AVX-512 one
+constexpr size_t kLaneWidth = 8;
+} // namespace
+
+bool EnsembleMesh::init(const Mesh2D& mesh, const std::vector<EnsembleVariant>& variants)
+{
+    if (variants.empty())
+    {
+        std::cerr << "An ensemble needs at least one variant" << std::endl;
+        return false;
+    }
+
+    const size_t lane_count = (variants.size() + kLaneWidth - 1) / kLaneWidth * kLaneWidth;
+    if (!compiled_mesh_.compile(mesh, lane_count))
+    {
+        return false;
+    }
+
+    for (size_t lane = 0; lane < variants.size(); ++lane)
+    {
+        if (!compiled_mesh_.set_rimguide_info(lane, variants[lane].rimguide_info))
+        {
+            std::cerr << "Invalid rimguide parameters for variant " << lane << std::endl;
+            return false;
+        }
+    }
+
+    variant_count_ = variants.size();
+    input_gain_.assign(lane_count, 0.f);
+    for (size_t lane = 0; lane < variants.size(); ++lane)
+    {
+        input_gain_[lane] = variants[lane].input_gain;
+    }
+    lane_input_.assign(lane_count, 0.f);
+    lane_output_.assign(lane_count, 0.f);
+
+    return true;
+}
+
+void EnsembleMesh::clear()
+{
+    compiled_mesh_.clear();
+}
+
+void EnsembleMesh::tick(float input, float* output)
+{
+    for (size_t lane = 0; lane < lane_input_.size(); ++lane)
+    {
+        lane_input_[lane] = input * input_gain_[lane];
+    }
+
+    compiled_mesh_.tick(lane_input_.data(), lane_output_.data());
+
+    std::copy(lane_output_.begin(), lane_output_.begin() + variant_count_, output);
+}
+
+std::vector<std::vector<float>> EnsembleMesh::render(const std::vector<float>& input, size_t frame_count)
+{
+    std::vector<std::vector<float>> outputs(variant_count_, std::vector<float>(frame_count, 0.f));
+    std::vector<float> frame(variant_count_);
+
+    for (size_t i = 0; i < frame_count; ++i)
+    {
+        tick(i < input.size() ? input[i] : 0.f, frame.data());
+        for (size_t variant = 0; variant < variant_count_; ++variant)
+        {
+            outputs[variant][i] = frame[variant];
+        }
+    }
+
+    return outputs;
+}
+
+size_t EnsembleMesh::get_variant_count() const
+{
+    return variant_count_;
+}
+
+size_t EnsembleMesh::get_lane_count() const
+{
+    return lane_input_.size();
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "compiled_mesh.h"
+#include "rimguide.h"
+
+#include <cstddef>
+#include <vector>
+
+class Mesh2D;
+
+/**
+ * @brief Parameters of one variant of an ensemble.
+ */
+struct EnsembleVariant
+{
+    float input_gain = 1.f;     ///< Gain applied to the input shared by every variant
+    RimguideInfo rimguide_info; ///< Friction, decay and boundary type of the rimguides
+};
+
+/**
+ * @class EnsembleMesh
+ * @brief Runs several variants of the same mesh side by side, for parameter sweeps.
+ *
+ * The variants share the topology of the mesh and differ by their excitation amplitude and rimguide parameters. The
+ * state of every junction holds one value per variant, interleaved, so a single traversal of the topology advances
+ * all of them and the inner loops run across the variants in SIMD lanes. The number of lanes is the number of
+ * variants rounded up to a multiple of 8, the extra lanes are silent.
+ */
+class EnsembleMesh
+{
+  public:
+    EnsembleMesh() = default;
+    ~EnsembleMesh() = default;
+
+    EnsembleMesh(const EnsembleMesh& mesh) = delete;
+    EnsembleMesh& operator=(const EnsembleMesh& mesh) = delete;
+
+    /**
+     * @brief Builds the ensemble from an initialized mesh.
+     * @param mesh The mesh, with its boundary, input and output already set. Its rimguides give the position of the
+     * rimguides of every variant.
+     * @param variants The parameters of each variant.
+     * @return False if the mesh or one of the variants can not be compiled, see CompiledMesh::compile().
+     */
+    bool init(const Mesh2D& mesh, const std::vector<EnsembleVariant>& variants);
+
+    /**
+     * @brief Clears the state of every variant.
+     */
+    void clear();
+
+    /**
+     * @brief Processes a tick of every variant.
+     * @param input The input value, scaled by the gain of each variant.
+     * @param output The output of each variant, get_variant_count() values.
+     */
+    void tick(float input, float* output);
+
+    /**
+     * @brief Renders every variant.
+     * @param input The input signal, followed by silence if shorter than frame_count.
+     * @param frame_count The number of samples to render.
+     * @return The output of each variant.
+     */
+    std::vector<std::vector<float>> render(const std::vector<float>& input, size_t frame_count);
+
+    size_t get_variant_count() const;
+
+    /**
+     * @brief Gets the number of lanes processed on every tick.
+     * @return The number of variants rounded up to a multiple of the SIMD width.
+     */
+    size_t get_lane_count() const;
+
+  private:
+    CompiledMesh compiled_mesh_;
+    size_t variant_count_ = 0;
+
+    std::vector<float> input_gain_;  ///< Per lane, 0 for the padding lanes
+    std::vector<float> lane_input_;  ///< Per lane input of the current tick
+    std::vector<float> lane_output_; ///< Per lane output of the current tick
+};
@@ -1,7 +1,10 @@
 #include "junction.h"
 
+#include "denormal.h"
 #include "rimguide.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
@@ -9,6 +12,8 @@
 #include <string>
 #include <utility>
 
+std::atomic<uint32_t> Junction::energy_error_count_ = 0;
+
 void Junction::init(JUNCTION_TYPE jtype, float x, float y)
 {
     pos_.x = x;
@@ -27,12 +32,57 @@ void Junction::init(JUNCTION_TYPE jtype, float x, float y)
         in_.resize(6, 0.f);
         out_.resize(6, 0.f);
         break;
+    case JUNCTION_TYPE::N_PORT:
+        // Ports are added by add_link()
+        neighbors_.clear();
+        in_.clear();
+        out_.clear();
+        break;
     default:
         std::cerr << "Invalid junction type" << std::endl;
         break;
     }
 }
 
+Junction::Junction(const Junction& junction, const Junction* junctions, Junction* clone_junctions)
+    : junction_type_(junction.junction_type_)
+    , type_(junction.type_)
+    , in_(junction.in_)
+    , out_(junction.out_)
+    , pos_(junction.pos_)
+    , input_(junction.input_)
+    , pressure_(junction.pressure_)
+    , abs_coeff_(junction.abs_coeff_)
+    , neighbors_(junction.neighbors_.size(), nullptr)
+    , num_connection_(junction.num_connection_)
+    , symmetry_source_(junction.symmetry_source_)
+    , has_symmetry_ports_(junction.has_symmetry_ports_)
+    , remote_port_(junction.remote_port_)
+    , admittance_(junction.admittance_)
+    , rim_admittance_(junction.rim_admittance_)
+    , load_admittance_(junction.load_admittance_)
+    , load_wave_(junction.load_wave_)
+    , total_admittance_(junction.total_admittance_)
+    , use_alternate_(junction.use_alternate_)
+{
+    // The buffers of the external ports belong to the mesh, they can not be relocated
+    assert(junction.external_ports_.empty());
+
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (junction.neighbors_[i] != nullptr)
+        {
+            neighbors_[i] = clone_junctions + (junction.neighbors_[i] - junctions);
+        }
+    }
+
+    if (junction.rimguide_ != nullptr)
+    {
+        rimguide_ = junction.rimguide_->clone(this);
+        assert(rimguide_ != nullptr);
+    }
+}
+
 Junction::Junction(Junction&& trijunction) noexcept
     : type_(trijunction.type_)
     , pos_(trijunction.pos_)
@@ -48,6 +98,15 @@ Junction::Junction(Junction&& trijunction) noexcept
     num_connection_ = trijunction.num_connection_;
     in_ = trijunction.in_;
     out_ = trijunction.out_;
+    symmetry_source_ = trijunction.symmetry_source_;
+    has_symmetry_ports_ = trijunction.has_symmetry_ports_;
+    remote_port_ = std::move(trijunction.remote_port_);
+    admittance_ = std::move(trijunction.admittance_);
+    rim_admittance_ = trijunction.rim_admittance_;
+    load_admittance_ = trijunction.load_admittance_;
+    load_wave_ = trijunction.load_wave_;
+    total_admittance_ = trijunction.total_admittance_;
+    external_ports_ = std::move(trijunction.external_ports_);
 }
 
 Junction& Junction::operator=(Junction&& trijunction) noexcept
@@ -67,6 +126,15 @@ Junction& Junction::operator=(Junction&& trijunction) noexcept
         num_connection_ = trijunction.num_connection_;
         in_ = trijunction.in_;
         out_ = trijunction.out_;
+        symmetry_source_ = trijunction.symmetry_source_;
+        has_symmetry_ports_ = trijunction.has_symmetry_ports_;
+        remote_port_ = std::move(trijunction.remote_port_);
+        admittance_ = std::move(trijunction.admittance_);
+        rim_admittance_ = trijunction.rim_admittance_;
+        load_admittance_ = trijunction.load_admittance_;
+        load_wave_ = trijunction.load_wave_;
+        total_admittance_ = trijunction.total_admittance_;
+        external_ports_ = std::move(trijunction.external_ports_);
     }
     return *this;
 }
@@ -85,6 +153,8 @@ void Junction::reset()
     {
         j = nullptr;
     }
+    symmetry_source_.fill(-1);
+    has_symmetry_ports_ = false;
     clear();
 }
 
@@ -97,6 +167,7 @@ void Junction::clear()
     }
     input_ = 0.f;
     pressure_ = 0.f;
+    load_wave_ = 0.f;
 
     if (rimguide_ != nullptr)
     {
@@ -115,18 +186,106 @@ void Junction::add_neighbor(Junction* neighbor, NEIGHBORS dir)
     neighbors_[dir] = neighbor;
 }
 
+void Junction::add_symmetry_port(NEIGHBORS dir, NEIGHBORS source)
+{
+    assert(static_cast<size_t>(dir) < neighbors_.size());
+    assert(static_cast<size_t>(source) < neighbors_.size());
+    assert(source == dir || neighbors_[source] != nullptr || symmetry_source_[source] >= 0);
+    neighbors_[dir] = nullptr;
+    symmetry_source_[dir] = static_cast<int8_t>(source);
+    has_symmetry_ports_ = true;
+}
+
+bool Junction::has_symmetry_ports() const
+{
+    return has_symmetry_ports_;
+}
+
+void Junction::add_link(Junction* neighbor, float admittance)
+{
+    assert(junction_type_ == JUNCTION_TYPE::N_PORT && neighbor->junction_type_ == JUNCTION_TYPE::N_PORT);
+    assert(neighbors_.size() < kMaxPortCount && neighbor->neighbors_.size() < kMaxPortCount);
+
+    remote_port_.push_back(static_cast<uint8_t>(neighbor->neighbors_.size()));
+    neighbor->remote_port_.push_back(static_cast<uint8_t>(neighbors_.size()));
+
+    neighbors_.push_back(neighbor);
+    in_.push_back(0.f);
+    out_.push_back(0.f);
+    admittance_.push_back(admittance);
+
+    neighbor->neighbors_.push_back(this);
+    neighbor->in_.push_back(0.f);
+    neighbor->out_.push_back(0.f);
+    neighbor->admittance_.push_back(admittance);
+}
+
+void Junction::add_external_port(const float* incoming, float* outgoing, float admittance)
+{
+    assert(junction_type_ == JUNCTION_TYPE::N_PORT);
+    assert(neighbors_.size() + external_ports_.size() < kMaxPortCount);
+    external_ports_.push_back({incoming, outgoing, admittance});
+}
+
+void Junction::set_rim_admittance(float admittance)
+{
+    assert(junction_type_ == JUNCTION_TYPE::N_PORT);
+    rim_admittance_ = admittance;
+}
+
+void Junction::set_load_admittance(float admittance)
+{
+    assert(junction_type_ == JUNCTION_TYPE::N_PORT);
+    load_admittance_ = admittance;
+}
+
 void Junction::init_junction_type()
 {
     type_ = 0;
+    num_connection_ = 0;
+
+    // A mirrored port can point to another mirrored port when its image also lies outside the domain,
+    // resolve those chains once here so the scatter only ever looks one level deep.
+    for (size_t i = 0; i < symmetry_source_.size(); ++i)
+    {
+        int8_t source = symmetry_source_[i];
+        for (size_t depth = 0; depth < symmetry_source_.size() && source >= 0 && source != static_cast<int8_t>(i) &&
+                               neighbors_[source] == nullptr && symmetry_source_[source] != source;
+             ++depth)
+        {
+            source = symmetry_source_[source];
+        }
+        symmetry_source_[i] = source;
+    }
 
     for (size_t i = 0; i < neighbors_.size(); ++i)
     {
-        if (neighbors_[i] != nullptr)
+        if (neighbors_[i] != nullptr || symmetry_source_[i] >= 0)
         {
             type_ |= (1 << i);
             num_connection_++;
         }
     }
+
+    if (junction_type_ == JUNCTION_TYPE::N_PORT)
+    {
+        total_admittance_ = rim_admittance_ + load_admittance_;
+        for (size_t i = 0; i < neighbors_.size(); ++i)
+        {
+            if (neighbors_[i] != nullptr)
+            {
+                total_admittance_ += admittance_[i];
+            }
+        }
+
+        // External ports are numbered after the regular ones
+        for (size_t i = 0; i < external_ports_.size(); ++i)
+        {
+            type_ |= (1 << (neighbors_.size() + i));
+            num_connection_++;
+            total_admittance_ += external_ports_[i].admittance;
+        }
+    }
 }
 
 void Junction::init_boundary(const RimguideInfo& info)
@@ -136,6 +295,16 @@ void Junction::init_boundary(const RimguideInfo& info)
     rimguide_->init(info, this);
 }
 
+void Junction::update_boundary(const RimguideInfo& info)
+{
+    assert(rimguide_ != nullptr);
+    // The rimguides clamping the center do not depend on the boundary
+    if (!rimguide_->is_center())
+    {
+        rimguide_->init(info, this);
+    }
+}
+
 void Junction::init_inner_boundary()
 {
     assert(rimguide_ == nullptr);
@@ -147,7 +316,15 @@ void Junction::process_scatter()
 {
 #ifndef SLOW_JUNCTION
 
-    if (use_alternate_)
+    if (junction_type_ == JUNCTION_TYPE::N_PORT)
+    {
+        process_scatter_n_port();
+    }
+    else if (has_symmetry_ports_)
+    {
+        process_scatter_symmetric();
+    }
+    else if (use_alternate_)
     {
         if (junction_type_ == JUNCTION_TYPE::SIX_PORT)
         {
@@ -176,6 +353,13 @@ void Junction::process_scatter()
     use_alternate_ = !use_alternate_;
 #else
 
+    if (junction_type_ == JUNCTION_TYPE::N_PORT)
+    {
+        // use_alternate_ is never set with SLOW_JUNCTION, process_delay() takes care of the propagation
+        process_scatter_n_port();
+        return;
+    }
+
     float pj = 0.f;
     for (size_t i = 0; i < in_.size(); ++i)
     {
@@ -197,7 +381,7 @@ void Junction::process_scatter()
         scaler = 1.f / 3.f;
         break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -226,7 +410,7 @@ void Junction::process_scatter()
         // Don't bother checking for energy conservation if there was an external input
         if (std::abs(pj_out - pj) > 1e-5)
         {
-            std::cerr << "Energy not conserved" << std::endl;
+            energy_error_count_.fetch_add(1, std::memory_order_relaxed);
         }
     }
     input_ = 0.f;
@@ -272,7 +456,7 @@ void Junction::process_scatter_4port_1()
         scaler = 1.f / 3.f;
         break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -316,7 +500,7 @@ void Junction::process_scatter_4port_1()
         // Don't bother checking for energy conservation if there was an external input
         if (std::abs(pj_out - pj) > 1e-5)
         {
-            std::cerr << "Energy not conserved" << std::endl;
+            energy_error_count_.fetch_add(1, std::memory_order_relaxed);
         }
     }
     input_ = 0.f;
@@ -361,7 +545,7 @@ void Junction::process_scatter_4port_2()
         scaler = 1.f / 3.f;
         break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -410,7 +594,7 @@ void Junction::process_scatter_4port_2()
         // Don't bother checking for energy conservation if there was an external input
         if (std::abs(pj_out - pj) > 1e-5)
         {
-            std::cerr << "Energy not conserved" << std::endl;
+            energy_error_count_.fetch_add(1, std::memory_order_relaxed);
         }
     }
     input_ = 0.f;
@@ -460,7 +644,7 @@ void Junction::process_scatter_6port_1()
         scaler = 1.f / 3.f;
         break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -511,7 +695,7 @@ void Junction::process_scatter_6port_1()
         // Don't bother checking for energy conservation if there was an external input
         if (std::abs(pj_out - pj) > 1e-5)
         {
-            std::cerr << "Energy not conserved" << std::endl;
+            energy_error_count_.fetch_add(1, std::memory_order_relaxed);
         }
     }
     input_ = 0.f;
@@ -561,7 +745,7 @@ void Junction::process_scatter_6port_2()
         scaler = 1.f / 3.f;
         break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -620,9 +804,164 @@ void Junction::process_scatter_6port_2()
         // Don't bother checking for energy conservation if there was an external input
         if (std::abs(pj_out - pj) > 1e-5)
         {
-            std::cerr << "Energy not conserved" << std::endl;
+            energy_error_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    input_ = 0.f;
+}
+
+size_t Junction::opposite_port(size_t port) const
+{
+    // NORTH_WEST <-> SOUTH_EAST, NORTH_EAST <-> SOUTH_WEST, EAST <-> WEST for the 6 port junction
+    // NORTH <-> SOUTH, EAST <-> WEST for the 4 port junction
+    return junction_type_ == JUNCTION_TYPE::SIX_PORT ? 5 - port : port ^ 1;
+}
+
+void Junction::process_scatter_symmetric()
+{
+    // Same two-phase scheme as the other scatter functions, but ports crossing a symmetry plane read the
+    // incoming wave of their mirror image instead of a neighbor. Only a handful of junctions along the
+    // symmetry planes take this path.
+    const size_t port_count = neighbors_.size();
+    const float scaler = junction_type_ == JUNCTION_TYPE::SIX_PORT ? 1.f / 3.f : 1.f / 2.f;
+    const float input_scaled = input_ * scaler;
+
+    std::array<float, 6> incoming{};
+    for (size_t i = 0; i < port_count; ++i)
+    {
+        if (neighbors_[i] != nullptr)
+        {
+            incoming[i] = use_alternate_ ? neighbors_[i]->out_[opposite_port(i)] : in_[i];
+        }
+        else if (symmetry_source_[i] == static_cast<int8_t>(i))
+        {
+            // The neighbor is our own mirror image: what it sends us is what we sent it.
+            incoming[i] = use_alternate_ ? out_[i] : in_[i];
+        }
+    }
+
+    float pj = 0.f;
+    for (size_t i = 0; i < port_count; ++i)
+    {
+        if (neighbors_[i] == nullptr && symmetry_source_[i] >= 0 && symmetry_source_[i] != static_cast<int8_t>(i))
+        {
+            incoming[i] = incoming[symmetry_source_[i]];
+        }
+
+        if (neighbors_[i] != nullptr || symmetry_source_[i] >= 0)
+        {
+            pj += incoming[i] + input_scaled;
+        }
+    }
+
+    if (rimguide_ != nullptr)
+    {
+        pj += rimguide_->last_out() * (neighbors_.size() - num_connection_);
+    }
+
+    pressure_ = pj * scaler;
+
+    for (size_t i = 0; i < port_count; ++i)
+    {
+        const float outgoing = pressure_ - incoming[i] - input_scaled;
+        if (neighbors_[i] != nullptr)
+        {
+            if (use_alternate_)
+            {
+                neighbors_[i]->in_[opposite_port(i)] = outgoing;
+            }
+            else
+            {
+                out_[i] = outgoing;
+            }
+        }
+        else if (symmetry_source_[i] == static_cast<int8_t>(i))
+        {
+            if (use_alternate_)
+            {
+                in_[i] = outgoing;
+            }
+            else
+            {
+                out_[i] = outgoing;
+            }
+        }
+        // Mirrored ports don't store anything, their image is handled by the source port.
+    }
+
+    if (rimguide_ != nullptr)
+    {
+        rimguide_->process_scatter(pressure_ - rimguide_->last_out());
+    }
+
+    input_ = 0.f;
+}
+
+void Junction::process_scatter_n_port()
+{
+    // Weighted version of the other scatter functions, with admittances of 1 this is the same as the 4 and 6 port
+    // junctions. The self-loop port sends its outgoing wave back to the junction on the next sample.
+    assert(neighbors_.size() <= kMaxPortCount);
+    const float scaler = 2.f / total_admittance_;
+    const float input_scaled = input_ * scaler;
+
+    std::array<float, kMaxPortCount> incoming{};
+    float pj = 0.f;
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (neighbors_[i] != nullptr)
+        {
+            incoming[i] = use_alternate_ ? neighbors_[i]->out_[remote_port_[i]] : in_[i];
+            pj += (incoming[i] + input_scaled) * admittance_[i];
         }
     }
+
+    for (const auto& port : external_ports_)
+    {
+        pj += (*port.incoming + input_scaled) * port.admittance;
+    }
+
+    if (rimguide_ != nullptr)
+    {
+        pj += rimguide_->last_out() * rim_admittance_;
+    }
+
+    // The input drives the self-loop like the other lossless ports, otherwise it excites waves that bounce between
+    // the ports and the self-loop without ever raising the pressure, and that no rimguide can damp
+    pj += (load_wave_ + input_scaled) * load_admittance_;
+
+    pressure_ = pj * scaler;
+
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (neighbors_[i] == nullptr)
+        {
+            continue;
+        }
+
+        const float outgoing = pressure_ - incoming[i] - input_scaled;
+        if (use_alternate_)
+        {
+            neighbors_[i]->in_[remote_port_[i]] = outgoing;
+        }
+        else
+        {
+            out_[i] = outgoing;
+        }
+    }
+
+    for (auto& port : external_ports_)
+    {
+        *port.outgoing = pressure_ - *port.incoming - input_scaled;
+    }
+
+    load_wave_ = pressure_ - load_wave_ - input_scaled;
+
+    if (rimguide_ != nullptr)
+    {
+        rimguide_->process_scatter(pressure_ - rimguide_->last_out());
+    }
+
     input_ = 0.f;
 }
 
@@ -636,8 +975,11 @@ void Junction::process_delay()
     case JUNCTION_TYPE::SIX_PORT:
         process_delay_six_port();
         break;
+    case JUNCTION_TYPE::N_PORT:
+        process_delay_n_port();
+        break;
     default:
-        std::cerr << "Invalid junction type" << std::endl;
+        assert(false && "Invalid junction type");
         break;
     }
 
@@ -676,6 +1018,17 @@ void Junction::process_delay_six_port()
     }
 }
 
+void Junction::process_delay_n_port()
+{
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (neighbors_[i] != nullptr)
+        {
+            in_[i] = neighbors_[i]->out_[remote_port_[i]];
+        }
+    }
+}
+
 void Junction::process_delay_four_port()
 {
     assert(neighbors_.size() == 4);
@@ -746,18 +1099,112 @@ float Junction::get_energy() const
     return e;
 }
 
+void Junction::count_subnormals(DenormalCounter& counter) const
+{
+    counter.add(in_);
+    counter.add(out_);
+    counter.add(pressure_);
+    counter.add(load_wave_);
+
+    if (rimguide_ != nullptr)
+    {
+        rimguide_->count_subnormals(counter);
+    }
+}
+
+bool Junction::is_quiet(float threshold) const
+{
+    if (std::abs(input_) > threshold || std::abs(pressure_) > threshold || std::abs(load_wave_) > threshold)
+    {
+        return false;
+    }
+
+    for (float wave : in_)
+    {
+        if (std::abs(wave) > threshold)
+        {
+            return false;
+        }
+    }
+
+    if (rimguide_ != nullptr)
+    {
+        return std::abs(rimguide_->last_in()) <= threshold && std::abs(rimguide_->last_out()) <= threshold;
+    }
+    return true;
+}
+
+float Junction::get_peak_incoming(bool second_phase) const
+{
+    float peak = 0.f;
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (neighbors_[i] != nullptr)
+        {
+            const float wave = second_phase ? neighbors_[i]->out_[get_remote_port(i)] : in_[i];
+            peak = std::max(peak, std::abs(wave));
+        }
+    }
+    return peak;
+}
+
+void Junction::sleep()
+{
+    clear();
+
+    // Our last outgoing waves are still waiting in the neighbors, they would be read again on every tick
+    for (size_t i = 0; i < neighbors_.size(); ++i)
+    {
+        if (neighbors_[i] != nullptr)
+        {
+            neighbors_[i]->in_[get_remote_port(i)] = 0.f;
+        }
+    }
+}
+
+bool Junction::is_second_phase() const
+{
+    return use_alternate_;
+}
+
+void Junction::set_second_phase(bool second_phase)
+{
+    use_alternate_ = second_phase;
+}
+
+uint32_t Junction::get_energy_error_count()
+{
+    return energy_error_count_.load(std::memory_order_relaxed);
+}
+
 Junction* Junction::get_neighbor(NEIGHBORS dir) const
 {
     assert(static_cast<size_t>(dir) < neighbors_.size());
     return neighbors_[dir];
 }
 
+size_t Junction::get_port_count() const
+{
+    return neighbors_.size();
+}
+
 void Junction::remove_neighbor(NEIGHBORS dir)
 {
     assert(static_cast<size_t>(dir) < neighbors_.size());
+    const bool was_connected = neighbors_[dir] != nullptr || symmetry_source_[dir] >= 0;
     neighbors_[dir] = nullptr;
+    symmetry_source_[dir] = -1;
     type_[static_cast<size_t>(dir)] = false;
-    num_connection_--;
+    if (was_connected)
+    {
+        num_connection_--;
+    }
+
+    if (junction_type_ == JUNCTION_TYPE::N_PORT && was_connected)
+    {
+        // The removed port now leads to a rimguide
+        rim_admittance_ += admittance_[dir];
+    }
 }
 
 bool Junction::is_boundary() const
@@ -770,10 +1217,53 @@ bool Junction::is_boundary() const
     {
         return num_connection_ < 6 && num_connection_ > 0;
     }
+    if (junction_type_ == JUNCTION_TYPE::N_PORT)
+    {
+        return rim_admittance_ > 0.f && num_connection_ > 0;
+    }
 
     return false;
 }
 
+float Junction::get_port_admittance(size_t port) const
+{
+    assert(port < neighbors_.size());
+    return junction_type_ == JUNCTION_TYPE::N_PORT ? admittance_[port] : 1.f;
+}
+
+size_t Junction::get_remote_port(size_t port) const
+{
+    assert(port < neighbors_.size());
+    return junction_type_ == JUNCTION_TYPE::N_PORT ? remote_port_[port] : opposite_port(port);
+}
+
+float Junction::get_rim_admittance() const
+{
+    if (rimguide_ == nullptr)
+    {
+        return 0.f;
+    }
+
+    // Every missing port of the 4 and 6 port junctions leads to the rimguide
+    return junction_type_ == JUNCTION_TYPE::N_PORT ? rim_admittance_
+                                                   : static_cast<float>(neighbors_.size() - num_connection_);
+}
+
+float Junction::get_load_admittance() const
+{
+    return junction_type_ == JUNCTION_TYPE::N_PORT ? load_admittance_ : 0.f;
+}
+
+float Junction::get_total_admittance() const
+{
+    return junction_type_ == JUNCTION_TYPE::N_PORT ? total_admittance_ : static_cast<float>(neighbors_.size());
+}
+
+bool Junction::has_external_ports() const
+{
+    return !external_ports_.empty();
+}
+
 void Junction::print_info() const
 {
     std::cout << "Pos: " << pos_.x << ", " << pos_.y << std::endl;
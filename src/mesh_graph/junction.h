@@ -2,12 +2,18 @@
 
 #include "vec2d.h"
 
+#include <array>
+#include <atomic>
 #include <bitset>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "rimguide.h"
+#include "static_vector.h"
+
+class DenormalCounter;
 
 enum NEIGHBORS
 {
@@ -25,12 +31,16 @@ enum JUNCTION_TYPE
 {
     FOUR_PORT = 0,
     SIX_PORT = 1,
+    N_PORT = 2, // Arbitrary number of ports with per-port admittances, used by unstructured meshes
     UNDEFINED,
 };
 
 constexpr uint8_t kInsideJunction =
     (1 << NORTH_EAST) | (1 << EAST) | (1 << SOUTH_EAST) | (1 << SOUTH_WEST) | (1 << WEST) | (1 << NORTH_WEST);
 
+// Maximum number of ports of a N_PORT junction
+constexpr size_t kMaxPortCount = 8;
+
 /**
  * @brief A junction node in a triangular digital waveguide mesh
  *
@@ -49,6 +59,13 @@ class Junction
      *  @param y Y-coordinate of the junction  */
     void init(JUNCTION_TYPE type, float x, float y);
 
+    /** @brief Copies a junction of another mesh, state and rimguide included
+     *  @param junction Junction to copy
+     *  @param junctions First junction of the mesh holding @p junction
+     *  @param clone_junctions First junction of the copied mesh. The neighbors are relocated to the same index.
+     *  @note External ports and modulated rimguides can not be copied, see Mesh2D::clone(). */
+    Junction(const Junction& junction, const Junction* junctions, Junction* clone_junctions);
+
     Junction(const Junction& trijunction) = delete;
     Junction& operator=(const Junction& trijunction) = delete;
     Junction(Junction&& trijunction) noexcept;
@@ -65,12 +82,44 @@ class Junction
 
     void add_neighbor(Junction* neighbor, NEIGHBORS dir);
 
+    /** @brief Replaces the port in direction @p dir with a virtual link through a symmetry plane
+     *  @param dir Port whose neighbor lies outside the simulated domain
+     *  @param source Port whose incoming wave is the mirror image of the wave arriving on @p dir.
+     *  Passing @p dir itself makes the port reflect its own outgoing wave, which is what happens when the
+     *  symmetry plane cuts the link at its midpoint. */
+    void add_symmetry_port(NEIGHBORS dir, NEIGHBORS source);
+
+    bool has_symmetry_ports() const;
+
+    /** @brief Connects two N_PORT junctions with a waveguide of the given admittance
+     *  @param neighbor Junction at the other end of the waveguide
+     *  @param admittance Admittance of the waveguide, the same on both ends */
+    void add_link(Junction* neighbor, float admittance);
+
+    /** @brief Adds a port whose waves are exchanged through buffers owned by the mesh (N_PORT only)
+     *  @param incoming Incoming wave, read on every scatter
+     *  @param outgoing Outgoing wave, written on every scatter
+     *  @param admittance Admittance of the port
+     *  @note Used to couple meshes running at different rates. The buffers must outlive the junction. */
+    void add_external_port(const float* incoming, float* outgoing, float admittance);
+
+    /** @brief Sets the admittance of the waveguide going to the rimguide (N_PORT only) */
+    void set_rim_admittance(float admittance);
+
+    /** @brief Sets the admittance of the self-loop port (N_PORT only)
+     *  @note The self-loop returns the outgoing wave on the next sample. It is used to match the admittance of
+     *  junctions whose cell is bigger than what their links account for. */
+    void set_load_admittance(float admittance);
+
     /** @brief Initialize the junction type based on neighbor connections */
     void init_junction_type();
 
     void init_boundary(const RimguideInfo& info);
     void init_inner_boundary();
 
+    /** @brief Reinitialize the rimguide of a boundary junction in place, a rimguide clamping the center is kept */
+    void update_boundary(const RimguideInfo& info);
+
     /** @brief Process wave scattering at this junction */
     void process_scatter();
 
@@ -90,13 +139,57 @@ class Junction
 
     float get_energy() const;
 
+    /** @brief Adds the waves, the pressure and the rimguide state to a subnormal counter */
+    void count_subnormals(DenormalCounter& counter) const;
+
     void print_info() const;
 
     Junction* get_neighbor(NEIGHBORS dir) const;
+    size_t get_port_count() const;
     void remove_neighbor(NEIGHBORS dir);
 
     bool is_boundary() const;
 
+    /** @brief Gets the admittance of a port, 1 for the 4 and 6 port junctions */
+    float get_port_admittance(size_t port) const;
+
+    /** @brief Gets the port of the neighbor on @p port that leads back to this junction */
+    size_t get_remote_port(size_t port) const;
+
+    /** @brief Gets the admittance of the waveguide going to the rimguide, 0 without a rimguide */
+    float get_rim_admittance() const;
+
+    /** @brief Gets the admittance of the self-loop port, 0 for the 4 and 6 port junctions */
+    float get_load_admittance() const;
+
+    /** @brief Gets the sum of the admittances of all the ports, connected or not */
+    float get_total_admittance() const;
+
+    bool has_external_ports() const;
+
+    /** @brief Checks whether the incoming waves, the pressure, the input and the rimguide are all below a level
+     *  @note Only meaningful before the first half of the scatter, when every incoming wave is stored in in_. */
+    bool is_quiet(float threshold) const;
+
+    /** @brief Gets the largest wave the neighbors are sending to this junction
+     *  @param second_phase True if the next scatter is the second half, where the waves are read from the neighbors */
+    float get_peak_incoming(bool second_phase) const;
+
+    /** @brief Clears the junction and the waves it sent to its neighbors, before it stops being processed
+     *  @note The neighbors then receive silence from this junction until it is processed again. */
+    void sleep();
+
+    /** @brief Gets the half of the scatter processed next */
+    bool is_second_phase() const;
+
+    /** @brief Sets the half of the scatter processed next, to resume a junction that was not processed */
+    void set_second_phase(bool second_phase);
+
+    /** @brief Gets the number of scatters, from every junction, whose outgoing waves did not add up to the incoming
+     *  ones since the program started
+     *  @note Counted rather than printed, the scatter runs on the audio thread. */
+    static uint32_t get_energy_error_count();
+
   private:
     void process_delay_four_port();
     void process_delay_six_port();
@@ -107,19 +200,50 @@ class Junction
     void process_scatter_6port_1();
     void process_scatter_6port_2();
 
+    /** @brief Generic scatter for junctions sitting on a symmetry plane */
+    void process_scatter_symmetric();
+
+    /** @brief Scatter for N_PORT junctions, each port weighted by its admittance */
+    void process_scatter_n_port();
+    void process_delay_n_port();
+
+    size_t opposite_port(size_t port) const;
+
     JUNCTION_TYPE junction_type_ = JUNCTION_TYPE::UNDEFINED;
-    std::bitset<6> type_ = 0;        // Type of junction (determined by number of connections)
-    std::vector<float> in_ = {0.f};  // Incoming wave components
-    std::vector<float> out_ = {0.f}; // Outgoing wave components
+    std::bitset<kMaxPortCount> type_ = 0;            // Type of junction (determined by number of connections)
+    StaticVector<float, kMaxPortCount> in_ = {0.f};  // Incoming wave components
+    StaticVector<float, kMaxPortCount> out_ = {0.f}; // Outgoing wave components
 
     Vec2Df pos_ = {0.f, 0.f}; // Junction position (x,y)
 
-    float input_ = 0.f;                            // External input signal
-    float pressure_ = 0.f;                         // Pressure value at the junction
-    float abs_coeff_ = 0.f;                        // absorption coefficient at the junction
-    std::vector<Junction*> neighbors_ = {nullptr}; // Connected neighbors
-    size_t num_connection_ = 0;                    // Number of connected neighbors
-    std::unique_ptr<Rimguide> rimguide_;           // Boundary condition (if this is a boundary node)
+    float input_ = 0.f;                                            // External input signal
+    float pressure_ = 0.f;                                         // Pressure value at the junction
+    float abs_coeff_ = 0.f;                                        // absorption coefficient at the junction
+    StaticVector<Junction*, kMaxPortCount> neighbors_ = {nullptr}; // Connected neighbors
+    size_t num_connection_ = 0;                                    // Number of connected neighbors
+    std::unique_ptr<Rimguide> rimguide_;                           // Boundary condition (if this is a boundary node)
+
+    // For each port, the port mirrored into it through a symmetry plane (-1 if none)
+    std::array<int8_t, kMaxPortCount> symmetry_source_ = {-1, -1, -1, -1, -1, -1, -1, -1};
+    bool has_symmetry_ports_ = false;
+
+    // N_PORT only
+    StaticVector<uint8_t, kMaxPortCount> remote_port_; // Port index of this junction in each neighbor
+    StaticVector<float, kMaxPortCount> admittance_;    // Admittance of each port
+    float rim_admittance_ = 0.f;                       // Admittance of the waveguide going to the rimguide
+    float load_admittance_ = 0.f;                      // Admittance of the self-loop port
+    float load_wave_ = 0.f;                            // Wave travelling in the self-loop
+    float total_admittance_ = 0.f;                     // Sum of all the admittances above
+
+    struct ExternalPort
+    {
+        const float* incoming;
+        float* outgoing;
+        float admittance;
+    };
+    std::vector<ExternalPort> external_ports_; // Ports fed by the mesh, see add_external_port()
 
     bool use_alternate_ = false;
+
+    static std::atomic<uint32_t> energy_error_count_;
 };
\ No newline at end of file
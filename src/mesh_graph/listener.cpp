@@ -1,6 +1,7 @@
 #include "listener.h"
 
 #include "DelayA.h"
+#include "denormal.h"
 #include "junction.h"
 #include "mat2d.h"
 #include "mesh_2d.h"
@@ -9,6 +10,7 @@
 
 #include <cassert>
 #include <iostream>
+#include <limits>
 
 namespace
 {
@@ -24,49 +26,89 @@ void Listener::init(const Mesh2D& mesh, const ListenerInfo& info)
 {
     mesh_ = &mesh;
     pos_ = info.position;
+    delays_.clear();
+    loss_factors_.clear();
+    sources_.clear();
     delays_.reserve(mesh.get_junction_count());
     loss_factors_.reserve(mesh.get_junction_count());
+    sources_.reserve(mesh.get_junction_count());
     type_ = info.type;
+    point_source_ = nullptr;
 
-    const float sample_distance = kSpeedOfSoundInAir / info.samplerate;
-
-    for (const auto& j : mesh_->junctions_.container())
+    if (type_ == ListenerType::POINT)
     {
-        if (j.get_type() == 0)
+        // With a symmetry mode, the listener may be above a junction that is not simulated. Its mirror image is.
+        Vec2Df point = {pos_.x, pos_.y};
+        if (mesh.get_symmetry() != SymmetryMode::NONE)
         {
-            continue;
+            point = mesh.fold_to_symmetry_domain(point);
         }
 
-        if (type_ == ListenerType::BOUNDARY && !j.is_boundary())
+        float min_distance = std::numeric_limits<float>::max();
+        for (const auto& j : mesh_->junctions_.container())
         {
-            continue;
-        }
+            if (j.get_type() == 0)
+            {
+                continue;
+            }
 
-        if (type_ == ListenerType::POINT)
-        {
-            if (j.get_pos() == Vec2Df{pos_.x, pos_.y})
+            if (j.get_pos() == point)
             {
                 point_source_ = &j;
                 break;
             }
 
+            const float distance = get_distance(j.get_pos(), point);
+            if (mesh.get_symmetry() != SymmetryMode::NONE && distance < min_distance)
+            {
+                min_distance = distance;
+                point_source_ = &j;
+            }
+        }
+
+        if (point_source_ == nullptr)
+        {
+            std::cerr << "No junctions found for listener" << std::endl;
+        }
+        return;
+    }
+
+    const float sample_distance = kSpeedOfSoundInAir / info.samplerate;
+
+    for (size_t idx = 0; idx < mesh_->junctions_.size(); ++idx)
+    {
+        const Junction& j = mesh_->junctions_[idx];
+        if (j.get_type() == 0)
+        {
+            continue;
+        }
+
+        if (type_ == ListenerType::BOUNDARY && !j.is_boundary())
+        {
             continue;
         }
 
-        if (type_ == ListenerType::ZONE)
+        // In a symmetry reduced mesh each junction stands for all of its mirror images
+        const auto images = mesh.get_symmetry_images(j.get_pos());
+        for (const auto& image : images)
         {
-            const float distance = get_distance(j.get_pos(), {pos_.x, pos_.y});
-            if (distance > info.radius)
+            if (type_ == ListenerType::ZONE)
             {
-                continue;
+                const float distance = get_distance(image, {pos_.x, pos_.y});
+                if (distance > info.radius)
+                {
+                    continue;
+                }
             }
+            Vec3Df junction_pos = {image.x, image.y, 0.0f};
+            float distance = get_distance(junction_pos, pos_);
+
+            float delay = distance / sample_distance;
+            delays_.emplace_back(delay, static_cast<unsigned long>(delay + 8));
+            // Junctions of a coarser resolution radiate from a larger area
+            loss_factors_.push_back(sample_distance / (distance) * mesh.get_junction_area(idx));
+            sources_.push_back(&j);
         }
-        Vec3Df junction_pos = {j.get_pos().x, j.get_pos().y, 0.0f};
-        float distance = get_distance(junction_pos, pos_);
-
-        float delay = distance / sample_distance;
-        delays_.emplace_back(delay, static_cast<unsigned long>(delay + 8));
-        loss_factors_.push_back(sample_distance / (distance));
     }
 
     if (delays_.empty())
@@ -80,6 +122,19 @@ void Listener::set_gain(float gain)
     gain_ = gain;
 }
 
+ListenerType Listener::get_type() const
+{
+    return type_;
+}
+
+void Listener::clear()
+{
+    for (auto& delay : delays_)
+    {
+        delay.clear();
+    }
+}
+
 float Listener::tick()
 {
     if (type_ == ListenerType::POINT)
@@ -88,36 +143,19 @@ float Listener::tick()
         return point_source_->get_output();
     }
 
-    size_t i = 0;
     float out = 0.f;
-    for (const auto& j : mesh_->junctions_.container())
+    for (size_t i = 0; i < sources_.size(); ++i)
     {
-        float junction_output = 0.f;
-        if (j.get_type() == 0)
-        {
-            continue;
-        }
-        if (type_ == ListenerType::BOUNDARY)
-        {
-            if (!j.is_boundary())
-            {
-                continue;
-            }
-            assert(j.has_rimguide());
-            junction_output = j.get_output(); //.get_rimguide()->last_out();
-        }
-        else if (type_ == ListenerType::POINT && j.get_pos() != Vec2Df{pos_.x, pos_.y})
-        {
-            continue;
-        }
-        else
-        {
-            junction_output = j.get_output();
-        }
-
-        out += delays_[i].tick(junction_output) * loss_factors_[i];
-        i++;
+        out += delays_[i].tick(sources_[i]->get_output()) * loss_factors_[i];
     }
 
     return out * gain_;
-}
\ No newline at end of file
+}
+
+void Listener::count_subnormals(DenormalCounter& counter) const
+{
+    for (const auto& delay : delays_)
+    {
+        counter.add(static_cast<float>(delay.lastOut()));
+    }
+}
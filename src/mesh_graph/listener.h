@@ -12,6 +12,7 @@
 
 #include "junction.h"
 
+class DenormalCounter;
 class Mesh2D;
 
 /**
@@ -60,19 +61,37 @@ class Listener
      */
     void set_gain(float gain);
 
+    /**
+     * @brief Gets the type the listener was initialized with
+     */
+    ListenerType get_type() const;
+
+    /**
+     * @brief Clears the delay lines, for a listener that was not ticked while the mesh was
+     */
+    void clear();
+
     /**
      * @brief Processes one time step and returns the accumulated sound
      * @return The calculated sound value for current time step
+     * @note Neither allocates, locks nor prints once initialized.
      */
     float tick();
 
+    /**
+     * @brief Adds the last output of every delay line to a subnormal counter
+     * @param counter Counter of the sampled state
+     */
+    void count_subnormals(DenormalCounter& counter) const;
+
   private:
-    const Mesh2D* mesh_;              ///< Pointer to the associated mesh
-    std::vector<stk::DelayA> delays_; ///< Delay lines for acoustic simulation
-    std::vector<float> loss_factors_; ///< Attenuation factors
-    Vec3Df pos_{};                    ///< Listener position
-    float gain_ = 1.f;                ///< Gain factor
-    ListenerType type_;               ///< Type of the listener
+    const Mesh2D* mesh_;                   ///< Pointer to the associated mesh
+    std::vector<stk::DelayA> delays_;      ///< Delay lines for acoustic simulation
+    std::vector<float> loss_factors_;      ///< Attenuation factors
+    std::vector<const Junction*> sources_; ///< Junction feeding each delay line
+    Vec3Df pos_{};                         ///< Listener position
+    float gain_ = 1.f;                     ///< Gain factor
+    ListenerType type_;                    ///< Type of the listener
 
     const Junction* point_source_{nullptr};
 };
\ No newline at end of file
@@ -1,11 +1,16 @@
 #include "mesh_2d.h"
 
+#include "denormal.h"
 #include "rimguide.h"
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <numbers>
+#include <utility>
 
 #define IDX(x, y) ((x) + (y) * lx_)
 
@@ -15,6 +20,23 @@ bool is_within_rect(float x, float y, float length, float width)
 {
     return x >= -length / 2.f && x <= length / 2.f && y >= -width / 2.f && y <= width / 2.f;
 }
+
+// Positions are compared with a tolerance relative to the sample distance
+constexpr float kSymmetryTolerance = 1e-3f;
+
+// Upper bound on the number of reflections needed to fold a point into the fundamental domain
+constexpr size_t kMaxReflections = 24;
+
+float dot(Vec2Df a, Vec2Df b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+
+Vec2Df reflect(Vec2Df pos, Vec2Df normal)
+{
+    const float d = 2.f * dot(pos, normal);
+    return {pos.x - d * normal.x, pos.y - d * normal.y};
+}
 } // namespace
 
 Mesh2D::Mesh2D()
@@ -25,6 +47,235 @@ Mesh2D::Mesh2D()
     , threadpool_(4)
     , sample_rate_(11025)
 {
+    // Built once so a tick never allocates, the ranges are only computed when the tasks run
+    const size_t n_threads = threadpool_.get_num_threads();
+    for (size_t i = 0; i < n_threads; ++i)
+    {
+        scatter_tasks_.emplace_back([this, i, n_threads]() {
+            if (activity_threshold_ > 0.f)
+            {
+                process_tiles_mt(i * awake_tiles_.size() / n_threads, (i + 1) * awake_tiles_.size() / n_threads);
+            }
+            else
+            {
+                process_scatter_mt(i * junctions_.size() / n_threads, (i + 1) * junctions_.size() / n_threads);
+            }
+        });
+        delay_tasks_.emplace_back([this, i, n_threads]() {
+            process_delay_mt(i * junctions_.size() / n_threads, (i + 1) * junctions_.size() / n_threads);
+        });
+    }
+}
+
+void Mesh2D::set_symmetry(SymmetryMode mode)
+{
+    symmetry_ = mode;
+}
+
+SymmetryMode Mesh2D::get_symmetry() const
+{
+    return symmetry_;
+}
+
+float Mesh2D::get_sector_angle() const
+{
+    return std::numbers::pi_v<float> / 4.f;
+}
+
+std::vector<Vec2Df> Mesh2D::get_symmetry_planes() const
+{
+    switch (symmetry_)
+    {
+    case SymmetryMode::HALF:
+        return {{0.f, 1.f}};
+    case SymmetryMode::QUADRANT:
+        return {{0.f, 1.f}, {1.f, 0.f}};
+    case SymmetryMode::SECTOR:
+    {
+        const float angle = get_sector_angle();
+        return {{0.f, 1.f}, {std::sin(angle), -std::cos(angle)}};
+    }
+    case SymmetryMode::NONE:
+    default:
+        return {};
+    }
+}
+
+bool Mesh2D::is_in_symmetry_domain(Vec2Df pos) const
+{
+    const float eps = kSymmetryTolerance * sample_distance_;
+    for (const auto& plane : get_symmetry_planes())
+    {
+        if (dot(pos, plane) < -eps)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<Vec2Df> Mesh2D::get_symmetry_images(Vec2Df pos) const
+{
+    const float eps = kSymmetryTolerance * sample_distance_;
+    const auto planes = get_symmetry_planes();
+
+    // The images are the orbit of the position under the group generated by the plane reflections
+    std::vector<Vec2Df> images{pos};
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        for (const auto& plane : planes)
+        {
+            const Vec2Df image = reflect(images[i], plane);
+            const bool is_new = std::none_of(images.begin(), images.end(),
+                                             [&](const Vec2Df& other) { return get_distance(image, other) < eps; });
+            if (is_new)
+            {
+                images.push_back(image);
+            }
+        }
+    }
+    return images;
+}
+
+Vec2Df Mesh2D::fold_to_symmetry_domain(Vec2Df pos) const
+{
+    const float eps = kSymmetryTolerance * sample_distance_;
+    const auto planes = get_symmetry_planes();
+    for (size_t i = 0; i < kMaxReflections && !is_in_symmetry_domain(pos); ++i)
+    {
+        for (const auto& plane : planes)
+        {
+            if (dot(pos, plane) < -eps)
+            {
+                pos = reflect(pos, plane);
+            }
+        }
+    }
+    return pos;
+}
+
+void Mesh2D::init_symmetry()
+{
+    if (symmetry_ == SymmetryMode::NONE)
+    {
+        return;
+    }
+
+    const float eps = kSymmetryTolerance * sample_distance_;
+    const auto planes = get_symmetry_planes();
+
+    struct SymmetryPort
+    {
+        Junction* junction;
+        NEIGHBORS dir;
+        NEIGHBORS source;
+    };
+    std::vector<SymmetryPort> symmetry_ports;
+    std::vector<SymmetryPort> disconnected_ports;
+
+    // First pass: find the mirror of every link leaving the domain while all the neighbors are still connected.
+    for (auto& j : junctions_.container())
+    {
+        if (!is_in_symmetry_domain(j.get_pos()))
+        {
+            continue;
+        }
+
+        for (size_t port = 0; port < j.get_port_count(); ++port)
+        {
+            const Junction* neighbor = j.get_neighbor(static_cast<NEIGHBORS>(port));
+            if (neighbor == nullptr || is_in_symmetry_domain(neighbor->get_pos()))
+            {
+                continue;
+            }
+
+            const Vec2Df pos = j.get_pos();
+            const Vec2Df neighbor_pos = neighbor->get_pos();
+
+            // A plane cutting the link at its midpoint maps the neighbor onto this junction: the port reflects.
+            const bool is_reflecting = std::any_of(planes.begin(), planes.end(), [&](const Vec2Df& plane) {
+                return get_distance(reflect(neighbor_pos, plane), pos) < eps;
+            });
+            if (is_reflecting)
+            {
+                symmetry_ports.push_back({&j, static_cast<NEIGHBORS>(port), static_cast<NEIGHBORS>(port)});
+                continue;
+            }
+
+            // Otherwise the junction sits on one or more planes. Reflect the neighbor through those planes
+            // until it lands in the domain; the incoming wave on this port is then the one coming from there.
+            Vec2Df image = neighbor_pos;
+            for (size_t i = 0; i < kMaxReflections && !is_in_symmetry_domain(image); ++i)
+            {
+                for (const auto& plane : planes)
+                {
+                    if (std::abs(dot(pos, plane)) < eps && dot(image, plane) < -eps)
+                    {
+                        image = reflect(image, plane);
+                    }
+                }
+            }
+
+            bool found = false;
+            for (size_t source = 0; source < j.get_port_count(); ++source)
+            {
+                const Junction* other = j.get_neighbor(static_cast<NEIGHBORS>(source));
+                if (other != nullptr && get_distance(other->get_pos(), image) < eps)
+                {
+                    symmetry_ports.push_back({&j, static_cast<NEIGHBORS>(port), static_cast<NEIGHBORS>(source)});
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                // Should not happen with a symmetric mask, fall back to a rimguide on that port.
+                std::cerr << "No mirror image found for junction at (" << pos.x << ", " << pos.y << ")" << std::endl;
+                disconnected_ports.push_back({&j, static_cast<NEIGHBORS>(port), static_cast<NEIGHBORS>(port)});
+            }
+        }
+    }
+
+    // Second pass: disconnect everything outside the domain and install the symmetry ports.
+    for (auto& j : junctions_.container())
+    {
+        if (!is_in_symmetry_domain(j.get_pos()))
+        {
+            j.reset();
+        }
+    }
+
+    for (const auto& port : symmetry_ports)
+    {
+        port.junction->add_symmetry_port(port.dir, port.source);
+    }
+
+    for (const auto& port : disconnected_ports)
+    {
+        port.junction->add_neighbor(nullptr, port.dir);
+    }
+}
+
+size_t Mesh2D::find_nearest_junction(Vec2Df pos) const
+{
+    size_t nearest = 0;
+    float min_distance = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < junctions_.size(); ++i)
+    {
+        if (junctions_[i].get_type() == 0)
+        {
+            continue;
+        }
+
+        const float distance = get_distance(junctions_[i].get_pos(), pos);
+        if (distance < min_distance)
+        {
+            min_distance = distance;
+            nearest = i;
+        }
+    }
+    return nearest;
 }
 
 void Mesh2D::clear()
@@ -33,6 +284,84 @@ void Mesh2D::clear()
     {
         j.clear();
     }
+
+    // The tiles are kept, a voice cleared on the audio thread must not rebuild them
+    for (size_t i = 0; i < tiles_.size(); ++i)
+    {
+        wake_tile(i);
+    }
+}
+
+std::unique_ptr<Mesh2D> Mesh2D::clone() const
+{
+    return nullptr;
+}
+
+bool Mesh2D::copy_from(const Mesh2D& mesh)
+{
+    const auto& source = mesh.junctions_.container();
+    const bool can_copy = std::none_of(source.begin(), source.end(), [](const Junction& j) {
+        return j.has_external_ports() || (j.has_rimguide() && j.get_rimguide()->has_modulator());
+    });
+    if (!can_copy)
+    {
+        return false;
+    }
+
+    // Reserved first, the neighbors are relocated to junctions that are not built yet
+    auto& junctions = junctions_.container();
+    junctions.clear();
+    junctions.reserve(source.size());
+    for (const auto& j : source)
+    {
+        junctions.emplace_back(j, source.data(), junctions.data());
+    }
+    junctions_.allocate(mesh.junctions_.get_row_size(), mesh.junctions_.get_col_size());
+
+    auto relocate = [&](const Junction* j) { return &junctions[j - source.data()]; };
+    inputs_.clear();
+    for (const Junction* j : mesh.inputs_)
+    {
+        inputs_.push_back(relocate(j));
+    }
+
+    // The rimguides keep their order, the center rimguides do not know their junction
+    std::vector<std::pair<const Rimguide*, Rimguide*>> copies;
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        if (source[i].has_rimguide())
+        {
+            copies.emplace_back(source[i].get_rimguide(), junctions[i].get_rimguide());
+        }
+    }
+    auto is_before = [](const auto& copy, const Rimguide* rimguide) { return std::less<>()(copy.first, rimguide); };
+    std::sort(copies.begin(), copies.end(), [&](const auto& a, const auto& b) { return is_before(a, b.first); });
+    rimguides_.clear();
+    for (const Rimguide* rimguide : mesh.rimguides_)
+    {
+        auto copy = std::lower_bound(copies.begin(), copies.end(), rimguide, is_before);
+        assert(copy != copies.end() && copy->first == rimguide);
+        rimguides_.push_back(copy->second);
+    }
+
+    lx_ = mesh.lx_;
+    ly_ = mesh.ly_;
+    input_x = mesh.input_x;
+    input_y = mesh.input_y;
+    output_x = mesh.output_x;
+    output_y = mesh.output_y;
+    sample_rate_ = mesh.sample_rate_;
+    symmetry_ = mesh.symmetry_;
+    sample_distance_ = mesh.sample_distance_;
+
+    activity_threshold_ = mesh.activity_threshold_;
+    tiles_ = mesh.tiles_;
+    tile_indices_ = mesh.tile_indices_;
+    awake_tiles_ = mesh.awake_tiles_;
+    is_awake_tiles_dirty_ = mesh.is_awake_tiles_dirty_;
+    tile_phase_ = mesh.tile_phase_;
+    tile_tick_count_ = mesh.tile_tick_count_;
+    return true;
 }
 
 Mat2D<uint8_t> Mesh2D::get_mask_for_radius(float radius) const
@@ -96,6 +425,18 @@ void Mesh2D::init_boundary(const RimguideInfo& info)
     });
 }
 
+void Mesh2D::update_boundary(const RimguideInfo& info)
+{
+    sample_rate_ = info.sample_rate;
+    for (auto& j : junctions_.container())
+    {
+        if (j.is_boundary())
+        {
+            j.update_boundary(info);
+        }
+    }
+}
+
 size_t Mesh2D::get_samplerate() const
 {
     return sample_rate_;
@@ -112,8 +453,22 @@ float Mesh2D::get_energy() const
     return e;
 }
 
+void Mesh2D::count_subnormals(DenormalCounter& counter) const
+{
+    for (const auto& j : junctions_.container())
+    {
+        j.count_subnormals(counter);
+    }
+}
+
 void Mesh2D::set_input(float radius, Vec2Df center)
 {
+    if (symmetry_ != SymmetryMode::NONE && get_symmetry_images(center).size() != 1)
+    {
+        std::cerr << "Input zone is not centered on the symmetry planes, the simulation will not be accurate"
+                  << std::endl;
+    }
+
     inputs_.clear();
     for (size_t y = 0; y < ly_; ++y)
     {
@@ -136,6 +491,15 @@ void Mesh2D::set_output(float x, float y)
 
     output_x = static_cast<size_t>(x * lx_);
     output_y = static_cast<size_t>(y * ly_);
+
+    if (symmetry_ != SymmetryMode::NONE)
+    {
+        // Pick up the signal from the mirror image of the output position
+        const Vec2Df pos = junctions_(std::min(output_x, lx_ - 1), std::min(output_y, ly_ - 1)).get_pos();
+        const size_t idx = find_nearest_junction(fold_to_symmetry_domain(pos));
+        output_x = idx / ly_;
+        output_y = idx % ly_;
+    }
 }
 
 void Mesh2D::set_absorption_coeff(float coeff)
@@ -146,11 +510,16 @@ void Mesh2D::set_absorption_coeff(float coeff)
     }
 }
 
-float Mesh2D::tick(float input)
+void Mesh2D::start_threads()
 {
-    // Found experimentally, this is the cutoff point where the multi-threaded version becomes faster
-    constexpr size_t kGridSizeCutOff = 2000;
+    if (junctions_.size() >= kGridSizeCutOff)
+    {
+        threadpool_.start_threads();
+    }
+}
 
+float Mesh2D::tick(float input)
+{
     for (auto& j : inputs_)
     {
         j->add_input(input);
@@ -166,6 +535,19 @@ float Mesh2D::tick(float input)
 
 float Mesh2D::tick_st(float input)
 {
+    if (activity_threshold_ > 0.f)
+    {
+        update_tiles(input);
+        for (uint32_t tile_idx : awake_tiles_)
+        {
+            for (uint32_t idx : tiles_[tile_idx].junctions)
+            {
+                junctions_[idx].process_scatter();
+            }
+        }
+        return junctions_(output_x, output_y).get_output();
+    }
+
     for (auto& j : junctions_.container())
     {
         if (j.get_type() != 0)
@@ -192,7 +574,21 @@ void Mesh2D::process_scatter_mt(size_t start, size_t end)
     // }
     for (size_t i = start; i < end; ++i)
     {
-        junctions_[i].process_scatter();
+        if (junctions_[i].get_type() != 0)
+        {
+            junctions_[i].process_scatter();
+        }
+    }
+}
+
+void Mesh2D::process_tiles_mt(size_t start, size_t end)
+{
+    for (size_t i = start; i < end; ++i)
+    {
+        for (uint32_t idx : tiles_[awake_tiles_[i]].junctions)
+        {
+            junctions_[idx].process_scatter();
+        }
     }
 }
 
@@ -211,32 +607,229 @@ void Mesh2D::process_delay_mt(size_t start, size_t end)
 
 float Mesh2D::tick_mt(float input)
 {
-    const uint32_t n_threads = threadpool_.get_num_threads();
-    std::vector<std::function<void()>> scatter_tasks;
-    for (uint32_t i = 0; i < n_threads; ++i)
+    if (activity_threshold_ > 0.f)
     {
-        scatter_tasks.emplace_back([this, i, n_threads]() {
-            process_scatter_mt(i * junctions_.size() / n_threads, (i + 1) * junctions_.size() / n_threads);
-        });
+        update_tiles(input);
+        threadpool_.enqueue_batch_and_wait(scatter_tasks_);
+        return junctions_(output_x, output_y).get_output();
     }
-    threadpool_.enqueue_batch_and_wait(scatter_tasks);
+
+    threadpool_.enqueue_batch_and_wait(scatter_tasks_);
     // std::cout << "Scatter pass done" << std::endl;
 
 #ifdef SLOW_JUNCTION
-    std::vector<std::function<void()>> delay_tasks;
-    for (uint32_t i = 0; i < n_threads; ++i)
-    {
-        delay_tasks.emplace_back([this, i, n_threads]() {
-            process_delay_mt(i * junctions_.size() / n_threads, (i + 1) * junctions_.size() / n_threads);
-        });
-    }
-    threadpool_.enqueue_batch_and_wait(delay_tasks);
+    threadpool_.enqueue_batch_and_wait(delay_tasks_);
 // std::cout << "Delay pass done" << std::endl;
 #endif
 
     return junctions_(output_x, output_y).get_output();
 }
 
+void Mesh2D::set_activity_threshold(float threshold)
+{
+#ifdef SLOW_JUNCTION
+    std::cerr << "Tiles can not be skipped with SLOW_JUNCTION" << std::endl;
+#else
+    // Every junction is processed again until the tiles are rebuilt
+    for (size_t i = 0; i < tiles_.size(); ++i)
+    {
+        wake_tile(i);
+    }
+    tiles_.clear();
+    activity_threshold_ = std::max(threshold, 0.f);
+
+    // Built right away on an initialized mesh, the first tick would allocate them otherwise
+    if (activity_threshold_ > 0.f && get_junction_count() > 0)
+    {
+        init_tiles();
+    }
+#endif
+}
+
+float Mesh2D::get_activity_threshold() const
+{
+    return activity_threshold_;
+}
+
+size_t Mesh2D::get_active_tile_count() const
+{
+    return activity_threshold_ > 0.f ? awake_tiles_.size() : 0;
+}
+
+void Mesh2D::init_tiles()
+{
+    const size_t row_count = junctions_.get_row_size();
+    const size_t col_count = junctions_.get_col_size();
+    const size_t tile_col_count = (col_count + kTileSize - 1) / kTileSize;
+    const size_t tile_count = ((row_count + kTileSize - 1) / kTileSize) * tile_col_count;
+
+    tiles_.assign(tile_count, Tile{});
+    tile_indices_.assign(junctions_.size(), 0);
+    for (size_t row = 0; row < row_count; ++row)
+    {
+        for (size_t col = 0; col < col_count; ++col)
+        {
+            const size_t idx = row * col_count + col;
+            tile_indices_[idx] = static_cast<uint32_t>((row / kTileSize) * tile_col_count + col / kTileSize);
+        }
+    }
+
+    const Junction* first = &junctions_[0];
+    for (size_t idx = 0; idx < junctions_.size(); ++idx)
+    {
+        const Junction& j = junctions_[idx];
+        if (j.get_type() == 0)
+        {
+            continue;
+        }
+
+        Tile& tile = tiles_[tile_indices_[idx]];
+        tile.junctions.push_back(static_cast<uint32_t>(idx));
+        tile.can_sleep = tile.can_sleep && !j.has_external_ports();
+        tile_phase_ = j.is_second_phase();
+
+        bool is_border = false;
+        for (size_t port = 0; port < j.get_port_count(); ++port)
+        {
+            const Junction* neighbor = j.get_neighbor(static_cast<NEIGHBORS>(port));
+            if (neighbor == nullptr)
+            {
+                continue;
+            }
+
+            if (neighbor < first || neighbor >= first + junctions_.size())
+            {
+                // Linked to another mesh, the waves it sends can not wake the tile
+                tile.can_sleep = false;
+            }
+            else if (tile_indices_[neighbor - first] != tile_indices_[idx])
+            {
+                is_border = true;
+            }
+        }
+
+        if (is_border)
+        {
+            tile.border.push_back(static_cast<uint32_t>(idx));
+        }
+    }
+
+    awake_tiles_.clear();
+    for (size_t i = 0; i < tiles_.size(); ++i)
+    {
+        if (!tiles_[i].junctions.empty())
+        {
+            awake_tiles_.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    is_awake_tiles_dirty_ = false;
+    tile_tick_count_ = 0;
+}
+
+void Mesh2D::update_tiles(float input)
+{
+    if (tiles_.empty())
+    {
+        init_tiles();
+    }
+
+    if (input != 0.f)
+    {
+        const Junction* first = &junctions_[0];
+        for (const Junction* j : inputs_)
+        {
+            wake_tile(tile_indices_[j - first]);
+        }
+    }
+
+    // The waves reaching a sleeping tile are only seen at its border, they never travel further than a junction
+    // in a tick
+    for (size_t i = 0; i < tiles_.size(); ++i)
+    {
+        if (tiles_[i].is_awake)
+        {
+            continue;
+        }
+
+        for (uint32_t idx : tiles_[i].border)
+        {
+            if (junctions_[idx].get_peak_incoming(tile_phase_) > activity_threshold_)
+            {
+                wake_tile(i);
+                break;
+            }
+        }
+    }
+
+    // Before the first half of the scatter every incoming wave is stored in its junction, nothing is lost by
+    // clearing a silent tile
+    if (!tile_phase_ && tile_tick_count_ >= kTileCheckInterval)
+    {
+        check_tile_activity();
+        tile_tick_count_ = 0;
+    }
+
+    if (is_awake_tiles_dirty_)
+    {
+        is_awake_tiles_dirty_ = false;
+        awake_tiles_.clear();
+        for (size_t i = 0; i < tiles_.size(); ++i)
+        {
+            if (tiles_[i].is_awake && !tiles_[i].junctions.empty())
+            {
+                awake_tiles_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    tile_phase_ = !tile_phase_;
+    ++tile_tick_count_;
+}
+
+void Mesh2D::check_tile_activity()
+{
+    for (auto& tile : tiles_)
+    {
+        if (!tile.is_awake || !tile.can_sleep)
+        {
+            continue;
+        }
+
+        const bool is_quiet = std::all_of(tile.junctions.begin(), tile.junctions.end(), [this](uint32_t idx) {
+            return junctions_[idx].is_quiet(activity_threshold_);
+        });
+        tile.quiet_count = is_quiet ? tile.quiet_count + 1 : 0;
+
+        // Waiting for a second check leaves time for the rimguides to empty their delay lines
+        if (tile.quiet_count >= kTileQuietCheckCount)
+        {
+            for (uint32_t idx : tile.junctions)
+            {
+                junctions_[idx].sleep();
+            }
+            tile.is_awake = false;
+            is_awake_tiles_dirty_ = true;
+        }
+    }
+}
+
+void Mesh2D::wake_tile(size_t tile_idx)
+{
+    Tile& tile = tiles_[tile_idx];
+    if (tile.is_awake)
+    {
+        return;
+    }
+
+    for (uint32_t idx : tile.junctions)
+    {
+        junctions_[idx].set_second_phase(tile_phase_);
+    }
+    tile.is_awake = true;
+    tile.quiet_count = 0;
+    is_awake_tiles_dirty_ = true;
+}
+
 std::vector<Junction*> Mesh2D::get_inputs() const
 {
     return inputs_;
@@ -279,6 +872,11 @@ size_t Mesh2D::get_junction_count() const
     return count;
 }
 
+float Mesh2D::get_junction_area(size_t /*idx*/) const
+{
+    return 1.f;
+}
+
 size_t Mesh2D::get_rimguide_count() const
 {
     size_t count = 0;
@@ -301,3 +899,41 @@ Rimguide* Mesh2D::get_rimguide(size_t idx)
     }
     return nullptr;
 }
+
+void Mesh2D::set_rimguide_friction(float friction_coeff, float friction_delay)
+{
+    for (auto* rimguide : rimguides_)
+    {
+        rimguide->set_friction(friction_coeff, friction_delay);
+    }
+}
+
+void Mesh2D::set_pitch_bend_amount(float amount)
+{
+    for (auto* rimguide : rimguides_)
+    {
+        rimguide->set_pitch_bend_amount(amount);
+    }
+}
+
+void Mesh2D::set_nonlinear_factor(float factor)
+{
+    for (auto* rimguide : rimguides_)
+    {
+        rimguide->set_nonlinear_factor(factor);
+    }
+}
+
+bool Mesh2D::has_diffusion_filters() const
+{
+    return std::any_of(rimguides_.begin(), rimguides_.end(),
+                       [](const Rimguide* rimguide) { return rimguide->has_diffusion_filters(); });
+}
+
+void Mesh2D::set_diffusion_mix(float mix)
+{
+    for (auto* rimguide : rimguides_)
+    {
+        rimguide->set_diffusion_mix(mix);
+    }
+}
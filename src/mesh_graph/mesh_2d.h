@@ -7,11 +7,27 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 
+class DenormalCounter;
 class Rimguide;
 struct RimguideInfo;
 
+/**
+ * @brief Mirror symmetry used to reduce the simulated domain.
+ * @note Only valid when the excitation is centered and the shape is symmetric, as is the case for a circular
+ * membrane struck in the middle.
+ */
+enum class SymmetryMode
+{
+    NONE,     ///< Simulate the whole membrane
+    HALF,     ///< Simulate y >= 0
+    QUADRANT, ///< Simulate x >= 0 and y >= 0
+    SECTOR,   ///< Simulate the smallest sector allowed by the lattice (1/12 for the hex mesh, 1/8 for the grid)
+};
+
 /**
  * @class Mesh2D
  * @brief Represents a 2D waveguide mesh
@@ -39,6 +55,15 @@ class Mesh2D
      */
     virtual void clear();
 
+    /**
+     * @brief Copies the mesh, state included, without building it again.
+     * @return The copy, or nullptr if the mesh can not be copied: junctions with external ports, rimguides with a
+     * modulator and mesh types that do not implement it.
+     * @note Much cheaper than init() and init_boundary(), a voice is spawned by copying a silent mesh, or by clearing
+     * one that played. The copy has its own threads, see start_threads().
+     */
+    virtual std::unique_ptr<Mesh2D> clone() const;
+
     /**
      * @brief Gets a mask for a given radius.
      * @param radius The radius for which to get the mask.
@@ -48,6 +73,34 @@ class Mesh2D
 
     virtual Mat2D<uint8_t> get_mask_for_rect(float length, float width) const;
 
+    /**
+     * @brief Sets the symmetry used to reduce the simulated domain.
+     * @param mode The symmetry mode.
+     * @note Must be called before init(). Junctions outside the fundamental domain are left unconnected and
+     * links crossing a symmetry plane are replaced by reflecting ports.
+     */
+    void set_symmetry(SymmetryMode mode);
+
+    /**
+     * @brief Gets the symmetry mode.
+     * @return The symmetry mode.
+     */
+    SymmetryMode get_symmetry() const;
+
+    /**
+     * @brief Gets every mirror image of a position, including the position itself.
+     * @param pos The position.
+     * @return The distinct images of the position under the symmetry group.
+     */
+    std::vector<Vec2Df> get_symmetry_images(Vec2Df pos) const;
+
+    /**
+     * @brief Folds a position into the simulated domain.
+     * @param pos The position.
+     * @return The image of the position that lies inside the simulated domain.
+     */
+    Vec2Df fold_to_symmetry_domain(Vec2Df pos) const;
+
     /**
      * @brief Initializes the mesh with a given mask.
      * @param mask The mask to initialize the mesh with.
@@ -61,6 +114,14 @@ class Mesh2D
      */
     virtual void init_boundary(const RimguideInfo& info);
 
+    /**
+     * @brief Reconfigures the rimguides created by init_boundary() with new information.
+     * @param info The information to reconfigure the boundary with.
+     * @note Much cheaper than rebuilding the mesh when only the rimguides change. The rim must have the same shape,
+     * the delays follow the new rimguide positions. The rimguides added by clamp_center_with_rimguide() are kept.
+     */
+    virtual void update_boundary(const RimguideInfo& info);
+
     /**
      * @brief Clamps the center with a rimguide.
      * @note The center junction is removed from the mesh and a rimguide is added to all of its neighbors.
@@ -80,6 +141,13 @@ class Mesh2D
      */
     virtual float get_energy() const;
 
+    /**
+     * @brief Adds the state of every junction and rimguide to a subnormal counter.
+     * @param counter The counter.
+     * @note A full scan of the mesh, meant to be sampled every few ticks.
+     */
+    void count_subnormals(DenormalCounter& counter) const;
+
     /**
      * @brief Set the input zone
      *
@@ -105,11 +173,19 @@ class Mesh2D
     /**
      * @brief Processes a tick of the simulation with the given input.
      * @param input The input value.
-     * @note This method will automatically use the appropriate number of threads.
+     * @note This method will automatically use the appropriate number of threads. Once the mesh is initialized and
+     * its threads started, a tick neither allocates, locks nor prints, so it can run on the audio thread.
      * @return The processed output value.
      */
     virtual float tick(float input);
 
+    /**
+     * @brief Starts the threads of a mesh large enough to be ticked in parallel.
+     * @note Otherwise started by the first tick, which then allocates. Call it once the mesh is initialized, before
+     * ticking it on the audio thread.
+     */
+    void start_threads();
+
     /**
      * @brief Processes a tick of the simulation with the given input using a single thread
      * @param input The input value.
@@ -124,6 +200,23 @@ class Mesh2D
      */
     virtual float tick_mt(float input);
 
+    /**
+     * @brief Lets the ticks skip the tiles of the mesh where nothing moves.
+     * @param threshold Level below which the waves of a tile are silent, 0 to process every junction.
+     * @note The mesh is split in square tiles. A tile goes to sleep once its waves, rimguides and inputs stayed
+     * below the threshold for a few checks, dropping what is left of them, and wakes up as soon as a wave above the
+     * threshold reaches its border or an input is played. Only the tick_st() and tick_mt() of Mesh2D skip tiles.
+     * Called after init(), the tiles are built right away instead of on the next tick.
+     */
+    void set_activity_threshold(float threshold);
+
+    float get_activity_threshold() const;
+
+    /**
+     * @brief Gets the number of tiles processed on the last tick, 0 if the ticks do not skip tiles.
+     */
+    size_t get_active_tile_count() const;
+
     /**
      * @brief Gets the input junctions.
      * @return A vector of pointers to the input junctions.
@@ -142,6 +235,13 @@ class Mesh2D
      */
     virtual size_t get_junction_count() const;
 
+    /**
+     * @brief Gets the area covered by a junction, relative to the area of a cell at the sample distance.
+     * @param idx The index of the junction in junctions_.
+     * @return The relative area. 1 for meshes with a uniform resolution.
+     */
+    virtual float get_junction_area(size_t idx) const;
+
     /**
      * @brief Gets the count of rimguides.
      * @return The count of rimguides.
@@ -155,6 +255,34 @@ class Mesh2D
      */
     virtual Rimguide* get_rimguide(size_t idx);
 
+    /**
+     * @brief Updates the friction filter of every rimguide in place.
+     * @param friction_coeff The friction coefficient, as in RimguideInfo.
+     * @param friction_delay The friction delay, as in RimguideInfo.
+     * @note Keeps the state of the mesh, cheap enough to be called between two ticks.
+     */
+    virtual void set_rimguide_friction(float friction_coeff, float friction_delay);
+
+    /**
+     * @brief Sets the pitch bend amount of every rimguide.
+     */
+    void set_pitch_bend_amount(float amount);
+
+    /**
+     * @brief Sets the nonlinear factor of every rimguide.
+     */
+    void set_nonlinear_factor(float factor);
+
+    /**
+     * @brief Checks whether any rimguide has extra diffusion filters.
+     */
+    bool has_diffusion_filters() const;
+
+    /**
+     * @brief Blends the extra diffusion filters of every rimguide in or out, see Rimguide::set_diffusion_mix().
+     */
+    void set_diffusion_mix(float mix);
+
     /**
      * @brief Prints the types of junctions.
      */
@@ -193,7 +321,45 @@ class Mesh2D
     ThreadPool threadpool_;
     size_t sample_rate_;
 
+  protected:
+    /**
+     * @brief Copies the junctions, rimguides, input, output and tiles of a mesh of the same type, for clone().
+     * @param mesh The mesh to copy.
+     * @return False if a junction of the mesh can not be copied, the mesh is then left empty.
+     */
+    bool copy_from(const Mesh2D& mesh);
+
+    /**
+     * @brief Replaces links crossing the symmetry planes with symmetry ports.
+     * @note Called by init() once the neighbors are connected and before the junction types are computed.
+     */
+    void init_symmetry();
+
+    /**
+     * @brief Angle of the sector simulated in SymmetryMode::SECTOR.
+     * @return The angle in radians.
+     */
+    virtual float get_sector_angle() const;
+
+    /**
+     * @brief Finds the active junction closest to a position.
+     * @param pos The position.
+     * @return The index of the junction in junctions_.
+     */
+    size_t find_nearest_junction(Vec2Df pos) const;
+
+    SymmetryMode symmetry_ = SymmetryMode::NONE;
+    float sample_distance_ = 0.f;
+
   private:
+    /**
+     * @brief Gets the normals of the symmetry planes. The simulated domain is on the positive side of every plane.
+     * @return The plane normals.
+     */
+    std::vector<Vec2Df> get_symmetry_planes() const;
+
+    bool is_in_symmetry_domain(Vec2Df pos) const;
+
     /**
      * @brief Processes scatter in multiple threads.
      * @param start The start index.
@@ -201,10 +367,62 @@ class Mesh2D
      */
     void process_scatter_mt(size_t start, size_t end);
 
+    /**
+     * @brief Processes the scatter of the awake tiles in multiple threads.
+     * @param start The start index in awake_tiles_.
+     * @param end The end index in awake_tiles_.
+     */
+    void process_tiles_mt(size_t start, size_t end);
+
+    /**
+     * @brief Splits the mesh in tiles, all of them awake.
+     */
+    void init_tiles();
+
+    /**
+     * @brief Wakes and puts tiles to sleep before a tick.
+     * @param input The input of the tick.
+     */
+    void update_tiles(float input);
+
+    /**
+     * @brief Checks whether a tile should go to sleep, every kTileCheckInterval ticks.
+     */
+    void check_tile_activity();
+
+    void wake_tile(size_t tile_idx);
+
     /**
      * @brief Processes delay in multiple threads.
      * @param start The start index.
      * @param end The end index.
      */
     void process_delay_mt(size_t start, size_t end);
+
+    // Found experimentally, this is the cutoff point where the multi-threaded version becomes faster
+    static constexpr size_t kGridSizeCutOff = 2000;
+
+    static constexpr size_t kTileSize = 16;             ///< Junctions on each side of a tile
+    static constexpr size_t kTileCheckInterval = 32;    ///< Ticks between two checks of the awake tiles, even
+    static constexpr uint32_t kTileQuietCheckCount = 2; ///< Checks a tile must stay silent before going to sleep
+
+    struct Tile
+    {
+        std::vector<uint32_t> junctions; ///< Active junctions of the tile
+        std::vector<uint32_t> border;    ///< Junctions with a neighbor in another tile
+        bool is_awake = true;
+        bool can_sleep = true;    ///< False if the tile exchanges waves outside of the mesh
+        uint32_t quiet_count = 0; ///< Consecutive checks the tile was silent
+    };
+
+    std::vector<std::function<void()>> scatter_tasks_; ///< One per thread of the pool, see tick_mt()
+    std::vector<std::function<void()>> delay_tasks_;
+
+    float activity_threshold_ = 0.f;
+    std::vector<Tile> tiles_;            ///< Built with the threshold, or on the first tick skipping tiles
+    std::vector<uint32_t> tile_indices_; ///< Tile of every junction
+    std::vector<uint32_t> awake_tiles_;  ///< Tiles processed on the next tick
+    bool is_awake_tiles_dirty_ = false;
+    bool tile_phase_ = false;            ///< Half of the scatter processed next by the awake junctions
+    size_t tile_tick_count_ = 0;         ///< Ticks since the last check of the awake tiles
 };
\ No newline at end of file
@@ -0,0 +1,423 @@
+#include "multires_mesh.h"
+
+#include "junction.h"
+#include "mat2d.h"
+#include "rimguide.h"
+#include "vec2d.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+struct Direction
+{
+    int dx;
+    int dy;
+};
+
+constexpr Direction kDirections[] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+// Keeps the cutoff of the friction filter at the same frequency on the coarse grid
+float get_coarse_friction_coeff(float friction_coeff, size_t ratio)
+{
+    return std::copysign(std::pow(std::abs(friction_coeff), static_cast<float>(ratio)), friction_coeff);
+}
+
+// Only the coarse grid reaches the rim
+RimguideInfo get_coarse_rimguide_info(const RimguideInfo& info, size_t ratio)
+{
+    RimguideInfo coarse_info = info;
+    coarse_info.sample_rate = info.sample_rate / ratio;
+    coarse_info.friction_delay = info.friction_delay / ratio;
+    coarse_info.friction_coeff = get_coarse_friction_coeff(info.friction_coeff, ratio);
+    return coarse_info;
+}
+} // namespace
+
+MultiResMesh::MultiResMesh(float radius, float sample_distance, size_t ratio, Vec2Df patch_center,
+                           float patch_radius)
+    : radius_(radius)
+    , ratio_(ratio)
+{
+    sample_distance_ = sample_distance;
+
+    if (ratio_ == 0)
+    {
+        std::cerr << "Invalid refinement ratio" << std::endl;
+        ratio_ = 1;
+    }
+
+    const float coarse_distance = sample_distance * ratio_;
+    const auto half_size = static_cast<long>(std::ceil(radius / coarse_distance));
+    coarse_size_ = 2 * half_size + 1;
+
+    // The patch and the ring of coarse junctions around it have to fit inside the membrane
+    auto patch_fits = [&](long center_x, long center_y, long half_patch) {
+        const float x = (std::abs(center_x) + half_patch + 1) * coarse_distance;
+        const float y = (std::abs(center_y) + half_patch + 1) * coarse_distance;
+        return std::sqrt(x * x + y * y) <= radius;
+    };
+
+    long center_x = std::lround(patch_center.x / coarse_distance);
+    long center_y = std::lround(patch_center.y / coarse_distance);
+    auto half_patch = static_cast<long>(std::ceil(patch_radius / coarse_distance));
+    while (half_patch > 0 && !patch_fits(center_x, center_y, half_patch))
+    {
+        half_patch--;
+    }
+    if (!patch_fits(center_x, center_y, half_patch))
+    {
+        std::cerr << "Refined patch does not fit at the input position, moving it to the center" << std::endl;
+        center_x = 0;
+        center_y = 0;
+    }
+
+    patch_x_ = static_cast<size_t>(center_x - half_patch + half_size);
+    patch_y_ = static_cast<size_t>(center_y - half_patch + half_size);
+    patch_size_ = 2 * half_patch + 1;
+    fine_size_ = patch_size_ * ratio_;
+    fine_count_ = fine_size_ * fine_size_;
+
+    lx_ = fine_count_ + coarse_size_ * coarse_size_;
+    ly_ = 1;
+    junctions_.allocate(lx_, ly_);
+
+    // Fine junctions are centered in their coarse cell
+    const float fine_offset = (static_cast<float>(patch_x_) - half_size) * coarse_distance -
+                              (ratio_ - 1) * sample_distance / 2.f;
+    const float fine_offset_y = (static_cast<float>(patch_y_) - half_size) * coarse_distance -
+                                (ratio_ - 1) * sample_distance / 2.f;
+    for (size_t x = 0; x < fine_size_; ++x)
+    {
+        for (size_t y = 0; y < fine_size_; ++y)
+        {
+            junctions_(get_fine_index(x, y), 0)
+                .init(JUNCTION_TYPE::N_PORT, fine_offset + x * sample_distance, fine_offset_y + y * sample_distance);
+        }
+    }
+
+    for (size_t x = 0; x < coarse_size_; ++x)
+    {
+        for (size_t y = 0; y < coarse_size_; ++y)
+        {
+            const float x_pos = (static_cast<float>(x) - half_size) * coarse_distance;
+            const float y_pos = (static_cast<float>(y) - half_size) * coarse_distance;
+            junctions_(get_coarse_index(x, y), 0).init(JUNCTION_TYPE::N_PORT, x_pos, y_pos);
+        }
+    }
+}
+
+size_t MultiResMesh::get_fine_index(size_t x, size_t y) const
+{
+    return x * fine_size_ + y;
+}
+
+size_t MultiResMesh::get_coarse_index(size_t x, size_t y) const
+{
+    return fine_count_ + x * coarse_size_ + y;
+}
+
+bool MultiResMesh::is_in_patch(size_t coarse_x, size_t coarse_y) const
+{
+    return coarse_x >= patch_x_ && coarse_x < patch_x_ + patch_size_ && coarse_y >= patch_y_ &&
+           coarse_y < patch_y_ + patch_size_;
+}
+
+void MultiResMesh::clear()
+{
+    Mesh2D::clear();
+
+    for (auto& face : interfaces_)
+    {
+        face.to_coarse = 0.f;
+        face.from_coarse = 0.f;
+        face.to_fine = 0.f;
+        face.fine_sum = 0.f;
+        std::fill(face.fine_out.begin(), face.fine_out.end(), 0.f);
+    }
+    tick_count_ = 0;
+}
+
+void MultiResMesh::init(const Mat2D<uint8_t>& mask)
+{
+    if (mask.size() != lx_ * ly_)
+    {
+        std::cerr << "Mask size does not match mesh size" << std::endl;
+        return;
+    }
+
+    if (symmetry_ != SymmetryMode::NONE)
+    {
+        std::cerr << "Symmetry modes are not supported by the multi-resolution mesh" << std::endl;
+        symmetry_ = SymmetryMode::NONE;
+    }
+
+    // The patch always fits inside the membrane, every fine junction is connected
+    for (size_t x = 0; x < fine_size_; ++x)
+    {
+        for (size_t y = 0; y < fine_size_; ++y)
+        {
+            Junction& j = junctions_(get_fine_index(x, y), 0);
+            if (x + 1 < fine_size_)
+            {
+                j.add_link(&junctions_(get_fine_index(x + 1, y), 0), 1.f);
+            }
+            if (y + 1 < fine_size_)
+            {
+                j.add_link(&junctions_(get_fine_index(x, y + 1), 0), 1.f);
+            }
+        }
+    }
+
+    struct Crossing
+    {
+        size_t coarse_x;
+        size_t coarse_y;
+        Direction dir;
+    };
+    std::vector<Crossing> crossings;
+
+    for (size_t x = 0; x < coarse_size_; ++x)
+    {
+        for (size_t y = 0; y < coarse_size_; ++y)
+        {
+            const size_t idx = get_coarse_index(x, y);
+            if (mask(idx, 0) == 0 || is_in_patch(x, y))
+            {
+                continue;
+            }
+
+            float rim_admittance = 0.f;
+            for (const auto& dir : kDirections)
+            {
+                const long nx = static_cast<long>(x) + dir.dx;
+                const long ny = static_cast<long>(y) + dir.dy;
+                const bool in_grid = nx >= 0 && ny >= 0 && nx < static_cast<long>(coarse_size_) &&
+                                     ny < static_cast<long>(coarse_size_);
+                if (!in_grid || mask(get_coarse_index(nx, ny), 0) == 0)
+                {
+                    rim_admittance += 1.f;
+                }
+                else if (is_in_patch(nx, ny))
+                {
+                    crossings.push_back({x, y, dir});
+                }
+                else if (dir.dx > 0 || dir.dy > 0)
+                {
+                    junctions_(idx, 0).add_link(&junctions_(get_coarse_index(nx, ny), 0), 1.f);
+                }
+            }
+            junctions_(idx, 0).set_rim_admittance(rim_admittance);
+        }
+    }
+
+    // The junctions keep pointers to the interface buffers, allocate them all before connecting anything
+    interfaces_.clear();
+    interfaces_.resize(crossings.size());
+    for (size_t i = 0; i < crossings.size(); ++i)
+    {
+        const auto& crossing = crossings[i];
+        auto& face = interfaces_[i];
+        face.fine_out.resize(ratio_, 0.f);
+
+        junctions_(get_coarse_index(crossing.coarse_x, crossing.coarse_y), 0)
+            .add_external_port(&face.to_coarse, &face.from_coarse, 1.f);
+
+        // Fine junctions along the side of the cell facing the coarse junction
+        const size_t cell_x = (crossing.coarse_x + crossing.dir.dx - patch_x_) * ratio_;
+        const size_t cell_y = (crossing.coarse_y + crossing.dir.dy - patch_y_) * ratio_;
+        for (size_t k = 0; k < ratio_; ++k)
+        {
+            size_t x = cell_x + k;
+            size_t y = cell_y + k;
+            if (crossing.dir.dx != 0)
+            {
+                x = crossing.dir.dx > 0 ? cell_x : cell_x + ratio_ - 1;
+            }
+            else
+            {
+                y = crossing.dir.dy > 0 ? cell_y : cell_y + ratio_ - 1;
+            }
+
+            junctions_(get_fine_index(x, y), 0).add_external_port(&face.to_fine, &face.fine_out[k], 1.f);
+        }
+    }
+
+    for (auto& j : junctions_.container())
+    {
+        j.init_junction_type();
+    }
+}
+
+void MultiResMesh::init_boundary(const RimguideInfo& info)
+{
+    Mesh2D::init_boundary(get_coarse_rimguide_info(info, ratio_));
+    sample_rate_ = info.sample_rate;
+}
+
+void MultiResMesh::update_boundary(const RimguideInfo& info)
+{
+    Mesh2D::update_boundary(get_coarse_rimguide_info(info, ratio_));
+    sample_rate_ = info.sample_rate;
+}
+
+void MultiResMesh::set_rimguide_friction(float friction_coeff, float friction_delay)
+{
+    Mesh2D::set_rimguide_friction(get_coarse_friction_coeff(friction_coeff, ratio_), friction_delay / ratio_);
+}
+
+void MultiResMesh::clamp_center_with_rimguide()
+{
+    std::cerr << "Clamping the center is not supported by the multi-resolution mesh" << std::endl;
+}
+
+void MultiResMesh::set_input(float radius, Vec2Df center)
+{
+    inputs_.clear();
+
+    bool outside_patch = false;
+    for (size_t idx = 0; idx < junctions_.size(); ++idx)
+    {
+        Junction& j = junctions_[idx];
+        if (j.get_type() == 0 || get_distance(center, j.get_pos()) > radius)
+        {
+            continue;
+        }
+
+        if (idx < fine_count_)
+        {
+            inputs_.push_back(&j);
+        }
+        else
+        {
+            outside_patch = true;
+        }
+    }
+
+    if (outside_patch)
+    {
+        std::cerr << "Input zone extends past the refined patch, only the fine junctions are excited" << std::endl;
+    }
+}
+
+void MultiResMesh::set_output(float x, float y)
+{
+    x = std::clamp(x, 0.f, 1.f);
+    y = std::clamp(y, 0.f, 1.f);
+
+    const Vec2Df pos = {(2.f * x - 1.f) * radius_, (2.f * y - 1.f) * radius_};
+    output_x = find_nearest_junction(pos);
+    output_y = 0;
+}
+
+float MultiResMesh::tick_st(float /*input*/)
+{
+    for (size_t i = 0; i < fine_count_; ++i)
+    {
+        if (junctions_[i].get_type() != 0)
+        {
+            junctions_[i].process_scatter();
+        }
+    }
+
+#ifdef SLOW_JUNCTION
+    for (size_t i = 0; i < fine_count_; ++i)
+    {
+        junctions_[i].process_delay();
+    }
+#endif
+
+    tick_count_++;
+    if (tick_count_ % ratio_ == 0)
+    {
+        // The coarse junctions see the average over the last ratio samples, centered half a coarse link away
+        const float scaler = 1.f / static_cast<float>(ratio_ * ratio_);
+        for (auto& face : interfaces_)
+        {
+            face.to_coarse = face.fine_sum * scaler;
+            face.fine_sum = 0.f;
+        }
+
+        for (size_t i = fine_count_; i < junctions_.size(); ++i)
+        {
+            if (junctions_[i].get_type() != 0)
+            {
+                junctions_[i].process_scatter();
+            }
+        }
+
+#ifdef SLOW_JUNCTION
+        for (size_t i = fine_count_; i < junctions_.size(); ++i)
+        {
+            junctions_[i].process_delay();
+        }
+#endif
+
+        for (auto& face : interfaces_)
+        {
+            face.to_fine = face.from_coarse;
+        }
+    }
+
+    for (auto& face : interfaces_)
+    {
+        for (float wave : face.fine_out)
+        {
+            face.fine_sum += wave;
+        }
+    }
+
+    return junctions_(output_x, output_y).get_output();
+}
+
+float MultiResMesh::tick_mt(float input)
+{
+    return tick_st(input);
+}
+
+float MultiResMesh::get_junction_area(size_t idx) const
+{
+    return idx < fine_count_ ? 1.f : static_cast<float>(ratio_ * ratio_);
+}
+
+size_t MultiResMesh::get_fine_junction_count() const
+{
+    return fine_count_;
+}
+
+void MultiResMesh::print_junction_types() const
+{
+    for (size_t y = 0; y < coarse_size_; ++y)
+    {
+        for (size_t x = 0; x < coarse_size_; ++x)
+        {
+            if (is_in_patch(x, y))
+            {
+                std::cout << std::setw(3) << "F" << " ";
+            }
+            else
+            {
+                std::cout << std::setw(3) << std::popcount(junctions_(get_coarse_index(x, y), 0).get_type()) << " ";
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+void MultiResMesh::print_junction_pressure() const
+{
+    for (size_t y = 0; y < coarse_size_; ++y)
+    {
+        for (size_t x = 0; x < coarse_size_; ++x)
+        {
+            std::cout << std::setw(5) << std::fixed << std::setprecision(3)
+                      << junctions_(get_coarse_index(x, y), 0).get_output() << " ";
+        }
+        std::cout << std::endl;
+    }
+}
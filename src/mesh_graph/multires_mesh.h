@@ -0,0 +1,172 @@
+#pragma once
+
+#include "mesh_2d.h"
+#include "vec2d.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class MultiResMesh
+ * @brief A rectilinear 2D mesh with a finely sampled patch around the strike point.
+ *
+ * The membrane is covered by a coarse rectilinear grid with a spacing of ratio * sample_distance. The coarse cells
+ * around the patch center are each replaced by ratio x ratio fine junctions at the sample distance.
+ *
+ * The fine patch runs at the full sample rate and the coarse grid only scatters every ratio samples, so the wave
+ * speed is the same in both. Every coarse link crossing into the patch is coupled to the ratio fine junctions facing
+ * it through external ports:
+ * - the coarse outgoing wave is held for ratio samples and fed to each of the fine junctions
+ * - the fine outgoing waves are averaged over the fine junctions and the last ratio samples before reaching the
+ *   coarse junction
+ *
+ * The two mappings are the adjoint of each other. Waves the coarse grid can represent go through without loss, and
+ * the finer detail is absorbed at the interface instead of aliasing, so the coupling never adds energy.
+ *
+ * The junctions are stored in a single row: the fine patch first, then the coarse grid. The coarse junctions
+ * covered by the patch are left unconnected.
+ */
+class MultiResMesh : public Mesh2D
+{
+  public:
+    /**
+     * @brief Constructs a MultiResMesh object.
+     * @param radius The radius covered by the coarse grid.
+     * @param sample_distance The distance between samples in the fine patch.
+     * @param ratio The ratio between the coarse and the fine sample distance.
+     * @param patch_center The center of the fine patch, snapped to the nearest coarse junction.
+     * @param patch_radius The minimum distance between the patch center and the edge of the patch.
+     */
+    MultiResMesh(float radius, float sample_distance, size_t ratio, Vec2Df patch_center, float patch_radius);
+
+    /**
+     * @brief Destroys the MultiResMesh object.
+     */
+    ~MultiResMesh() override = default;
+
+    MultiResMesh(const MultiResMesh& mesh) = delete;
+    MultiResMesh& operator=(const MultiResMesh& mesh) = delete;
+    MultiResMesh(MultiResMesh&& mesh) = delete;
+    MultiResMesh& operator=(MultiResMesh&& mesh) = delete;
+
+    /**
+     * @brief Clears the mesh and the waves travelling between the two resolutions.
+     */
+    void clear() override;
+
+    /**
+     * @brief Initializes the mesh with a given mask.
+     * @param mask The mask to initialize the mesh with.
+     */
+    void init(const Mat2D<uint8_t>& mask) override;
+
+    /**
+     * @brief Initializes the boundary with given information.
+     * @param info The information to initialize the boundary with, for the fine sample rate.
+     * @note The rimguides are attached to the coarse grid, they run at the coarse sample rate.
+     */
+    void init_boundary(const RimguideInfo& info) override;
+
+    /**
+     * @brief Reconfigures the rimguides with new information.
+     * @param info The information to reconfigure the boundary with, for the fine sample rate.
+     */
+    void update_boundary(const RimguideInfo& info) override;
+
+    /**
+     * @brief Updates the friction filter of every rimguide in place.
+     * @note Takes the parameters for the fine sample rate, like init_boundary().
+     */
+    void set_rimguide_friction(float friction_coeff, float friction_delay) override;
+
+    /**
+     * @brief Clamps the center with a rimguide.
+     * @note Not supported by this mesh.
+     */
+    void clamp_center_with_rimguide() override;
+
+    /**
+     * @brief Set the input zone
+     *
+     * @param radius The radius of the input zone
+     * @param center The center of the input zone
+     * @note Only the fine junctions receive the input.
+     */
+    void set_input(float radius, Vec2Df center) override;
+
+    /**
+     * @brief Sets the output position.
+     * @param x The x-coordinate of the output. A value between 0 and 1.
+     * @param y The y-coordinate of the output. A value between 0 and 1.
+     * @note The output is the junction closest to the position.
+     */
+    void set_output(float x, float y) override;
+
+    /**
+     * @brief Processes a tick of the simulation. The coarse grid is only processed every ratio ticks.
+     * @param input The input value.
+     * @return The processed output value.
+     */
+    float tick_st(float input) override;
+
+    /**
+     * @brief Same as tick_st(), the two resolutions are not processed in parallel yet.
+     * @param input The input value.
+     * @return The processed output value.
+     */
+    float tick_mt(float input) override;
+
+    /**
+     * @brief Gets the area covered by a junction.
+     * @param idx The index of the junction in junctions_.
+     * @return 1 for the fine junctions, ratio^2 for the coarse ones.
+     */
+    float get_junction_area(size_t idx) const override;
+
+    /**
+     * @brief Gets the number of fine junctions.
+     * @return The number of fine junctions, they are stored first in junctions_.
+     */
+    size_t get_fine_junction_count() const;
+
+    /**
+     * @brief Prints the number of ports of the coarse junctions, F for the cells covered by the fine patch.
+     */
+    void print_junction_types() const override;
+
+    /**
+     * @brief Prints the pressure of the coarse junctions.
+     */
+    void print_junction_pressure() const override;
+
+  private:
+    /**
+     * @brief A coarse link crossing into the fine patch.
+     */
+    struct Interface
+    {
+        float to_coarse = 0.f;       ///< Averaged fine waves, incoming wave of the coarse junction
+        float from_coarse = 0.f;     ///< Outgoing wave of the coarse junction
+        float to_fine = 0.f;         ///< Held coarse wave, incoming wave of the fine junctions
+        float fine_sum = 0.f;        ///< Sum of the fine outgoing waves since the last coarse tick
+        std::vector<float> fine_out; ///< Outgoing wave of each fine junction
+    };
+
+    size_t get_fine_index(size_t x, size_t y) const;
+    size_t get_coarse_index(size_t x, size_t y) const;
+    bool is_in_patch(size_t coarse_x, size_t coarse_y) const;
+
+    float radius_;
+    size_t ratio_;
+
+    size_t coarse_size_; ///< Number of coarse junctions per side
+    size_t patch_x_;     ///< X coordinate of the first coarse cell covered by the patch
+    size_t patch_y_;     ///< Y coordinate of the first coarse cell covered by the patch
+    size_t patch_size_;  ///< Number of coarse cells per side covered by the patch
+    size_t fine_size_;   ///< Number of fine junctions per side
+    size_t fine_count_;  ///< Number of fine junctions
+
+    std::vector<Interface> interfaces_;
+    size_t tick_count_ = 0;
+};
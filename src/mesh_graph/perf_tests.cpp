@@ -1,22 +1,39 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
+#include "compiled_mesh.h"
+#include "denormal.h"
+#include "ensemble_mesh.h"
 #include "gaussian.h"
+#include "listener.h"
 #include "mat2d.h"
 #include "nanobench.h"
+#include "multires_mesh.h"
+#include "polar_mesh.h"
 #include "rectilinear_mesh.h"
+#include "render_service.h"
 #include "rimguide.h"
 #include "rimguide_utils.h"
 #include "trimesh.h"
+#include "voice_engine.h"
 #include "wave_math.h"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <complex>
 #include <cstddef>
 #include <format>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <numbers>
+#include <optional>
+#include <span>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 using namespace ankerl;
@@ -112,6 +129,141 @@ TEST_CASE("TriMesh")
     });
 }
 
+TEST_CASE("TriMesh - Tile skipping")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    bench.title("Trimesh - Tile skipping");
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    // A strike near the rim, followed by a second of silence
+    for (float threshold : {0.f, 1e-6f, 1e-4f})
+    {
+        TriMesh mesh(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh.get_mask_for_radius(max_radius);
+        mesh.init(mask);
+        mesh.init_boundary(info);
+        mesh.set_input(0.02f, {kRadius * 0.7f, 0.f});
+        mesh.set_output(0.5, 0.5);
+        mesh.set_activity_threshold(threshold);
+
+        bench.run(std::format("Threshold {}", threshold), [&] {
+            mesh.clear();
+            for (auto i = 0; i < kIterationCount - 1; i++)
+            {
+                float input = 0.f;
+                if (i < impulse.size())
+                {
+                    input = -impulse[i];
+                }
+                float out = mesh.tick(input);
+                ankerl::nanobench::doNotOptimizeAway(out);
+            }
+            for (auto i = 0; i < kIterationCount; i++)
+            {
+                float out = mesh.tick(0.f);
+                ankerl::nanobench::doNotOptimizeAway(out);
+            }
+        });
+        std::cout << "Active tiles at the end: " << mesh.get_active_tile_count() << std::endl;
+    }
+}
+
+TEST_CASE("TriMesh - Long tail")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    TriMesh mesh(grid_size[0], grid_size[1], sample_distance);
+    auto mask = mesh.get_mask_for_radius(max_radius);
+    mesh.init(mask);
+    mesh.init_boundary(info);
+    mesh.set_input(0.1f, {0.f, 0.f});
+    mesh.set_output(0.5, 0.5);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    bench.title("Trimesh - Long tail");
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    // A strike this small starts where the tail of a real strike ends, every second of it is as deep in the
+    // subnormal range as the end of a long render
+    constexpr float kTailAmplitude = 1e-30f;
+    for (bool flush : {false, true})
+    {
+        for (float amplitude : {1.f, kTailAmplitude})
+        {
+            // The mesh is ticked on this thread, only the worker threads flush the subnormals by default
+            std::optional<ScopedFlushDenormals> flush_denormals;
+            if (flush)
+            {
+                flush_denormals.emplace();
+            }
+
+            DenormalCounter counter;
+            const std::string title =
+                std::format("{} - {}", amplitude == 1.f ? "Attack" : "Tail", flush ? "Flush to zero" : "Subnormals");
+            bench.run(title, [&] {
+                mesh.clear();
+                for (auto i = 0; i < kIterationCount - 1; i++)
+                {
+                    float input = 0.f;
+                    if (i < impulse.size())
+                    {
+                        input = -impulse[i] * amplitude;
+                    }
+                    for (auto* j : mesh.get_inputs())
+                    {
+                        j->add_input(input);
+                    }
+                    float out = mesh.tick_st(input);
+                    ankerl::nanobench::doNotOptimizeAway(out);
+
+                    if (i % 64 == 0)
+                    {
+                        mesh.count_subnormals(counter);
+                    }
+                }
+            });
+            std::cout << title << ": " << counter.get_ratio() * 100.f << "% of the sampled state is subnormal"
+                      << std::endl;
+        }
+    }
+}
+
 TEST_CASE("Rectangular mesh")
 {
     float c = get_wave_speed(kTension, kDensity);
@@ -185,6 +337,979 @@ TEST_CASE("Rectangular mesh")
     });
 }
 
+TEST_CASE("Symmetry modes")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    struct Render
+    {
+        std::vector<float> output;
+        std::vector<float> listener;
+    };
+
+    // With a centered input every symmetry mode has to sound like the whole mesh
+    constexpr size_t kSymmetrySampleCount = 4000;
+    auto render = [&](Mesh2D& mesh, SymmetryMode mode) {
+        mesh.set_symmetry(mode);
+        mesh.init(mesh.get_mask_for_radius(max_radius));
+        mesh.init_boundary(info);
+        mesh.set_input(0.02f, {0.f, 0.f});
+        // The middle row is on the x axis, which every mode simulates
+        mesh.set_output(0.75f, 0.5f);
+
+        // Off the axes, so the listener sums junctions and mirror images at different distances
+        ListenerInfo listener_info{};
+        listener_info.position = {0.1f, 0.05f, 0.5f};
+        listener_info.samplerate = static_cast<size_t>(kSampleRate);
+        listener_info.type = ListenerType::ALL;
+        Listener listener;
+        listener.init(mesh, listener_info);
+
+        Render result;
+        for (size_t i = 0; i < kSymmetrySampleCount; ++i)
+        {
+            result.output.push_back(mesh.tick(i == 0 ? 1.f : 0.f));
+            result.listener.push_back(listener.tick());
+        }
+        return result;
+    };
+
+    // Largest difference, relative to the peak of the whole mesh
+    auto get_error = [](const std::vector<float>& full, const std::vector<float>& reduced) {
+        float peak = 0.f;
+        float error = 0.f;
+        for (size_t i = 0; i < full.size(); ++i)
+        {
+            peak = std::max(peak, std::abs(full[i]));
+            error = std::max(error, std::abs(full[i] - reduced[i]));
+        }
+        return error / peak;
+    };
+
+    auto make_mesh = [&](bool is_trimesh) -> std::unique_ptr<Mesh2D> {
+        if (is_trimesh)
+        {
+            return std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        }
+        return std::make_unique<RectilinearMesh>(grid_size[0], grid_size[1], sample_distance);
+    };
+
+    for (bool is_trimesh : {true, false})
+    {
+        auto full_mesh = make_mesh(is_trimesh);
+        const Render full = render(*full_mesh, SymmetryMode::NONE);
+
+        for (SymmetryMode mode : {SymmetryMode::HALF, SymmetryMode::QUADRANT, SymmetryMode::SECTOR})
+        {
+            auto mesh = make_mesh(is_trimesh);
+            const Render reduced = render(*mesh, mode);
+
+            const float output_error = get_error(full.output, reduced.output);
+            const float listener_error = get_error(full.listener, reduced.listener);
+            std::cout << std::format("{} symmetry mode {}: output error {:.3g}, listener error {:.3g}",
+                                     is_trimesh ? "TriMesh" : "RectilinearMesh", static_cast<int>(mode), output_error,
+                                     listener_error)
+                      << std::endl;
+            CHECK(output_error < 1e-4f);
+            CHECK(listener_error < 1e-4f);
+        }
+    }
+}
+
+TEST_CASE("Polar mesh")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    PolarMesh polar_mesh(max_radius, sample_distance);
+    auto mask = polar_mesh.get_mask_for_radius(max_radius);
+    polar_mesh.init(mask);
+    polar_mesh.init_boundary(info);
+    polar_mesh.set_input(0.1f, {0.f, 0.f});
+    polar_mesh.set_output(0.5, 0.5);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    std::string title = std::format("Polar mesh - {} hz", kSampleRate);
+
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    bench.run("PolarMesh - Single thread", [&] {
+        for (auto i = 0; i < kIterationCount - 1; i++)
+        {
+            float input = 0.f;
+            if (i < impulse.size())
+            {
+                input = -impulse[i];
+            }
+            float out = polar_mesh.tick(input);
+            ankerl::nanobench::doNotOptimizeAway(out);
+        }
+    });
+
+    PolarMesh polar_mesh_mt(max_radius, sample_distance);
+    mask = polar_mesh_mt.get_mask_for_radius(max_radius);
+    polar_mesh_mt.init(mask);
+    polar_mesh_mt.init_boundary(info);
+    polar_mesh_mt.set_input(0.1f, {0.f, 0.f});
+    polar_mesh_mt.set_output(0.5, 0.5);
+
+    bench.run("PolarMesh - Multi Thread", [&] {
+        for (auto i = 0; i < kIterationCount - 1; i++)
+        {
+            float input = 0.f;
+            if (i < impulse.size())
+            {
+                input = -impulse[i];
+            }
+            float out = polar_mesh_mt.tick_mt(input);
+            ankerl::nanobench::doNotOptimizeAway(out);
+        }
+    });
+}
+
+TEST_CASE("Polar mesh - Decay and pitch")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    struct Decay
+    {
+        float fundamental;     // radians per sample
+        float fundamental_t60; // seconds
+        float energy_t50;      // seconds for the energy to fall 50 dB below its peak
+    };
+
+    // Magnitude of the output at one frequency over a window
+    auto get_magnitude = [](const std::vector<float>& output, float frequency, size_t start, size_t count) {
+        std::complex<double> sum = 0;
+        for (size_t i = start; i < start + count; ++i)
+        {
+            sum += static_cast<double>(output[i]) * std::polar(1.0, -static_cast<double>(frequency) * i);
+        }
+        return std::abs(sum);
+    };
+
+    // A dirac excites every mode. A mode the rimguides can not damp shows up in the energy, which then takes much
+    // longer to fall than in the triangular mesh.
+    constexpr size_t kDecaySampleCount = 4 * kIterationCount;
+    auto get_decay = [&](Mesh2D& mesh, Vec2Df input_pos) {
+        mesh.init(mesh.get_mask_for_radius(max_radius));
+        mesh.init_boundary(info);
+        mesh.set_input(0.02f, input_pos);
+        mesh.set_output(0.7f, 0.6f);
+
+        std::vector<float> output(kDecaySampleCount);
+        std::vector<float> energy(kDecaySampleCount);
+        for (size_t i = 0; i < kDecaySampleCount; ++i)
+        {
+            output[i] = mesh.tick(i == 0 ? 1.f : 0.f);
+            energy[i] = mesh.get_energy();
+        }
+
+        Decay decay{};
+        const size_t window = kIterationCount / 2;
+        float best = 0.f;
+        for (float frequency = 0.8f * f0; frequency < 1.2f * f0; frequency += 0.001f * f0)
+        {
+            const auto magnitude = static_cast<float>(get_magnitude(output, frequency, window / 2, 2 * window));
+            if (magnitude > best)
+            {
+                best = magnitude;
+                decay.fundamental = frequency;
+            }
+        }
+
+        // The partials above the fundamental are too far to leak into a window of half a second
+        const double early = get_magnitude(output, decay.fundamental, window / 2, window);
+        const double late = get_magnitude(output, decay.fundamental, 5 * window / 2, window);
+        const double seconds = 2.0 * window / kSampleRate;
+        decay.fundamental_t60 = static_cast<float>(60.0 * seconds / (20.0 * std::log10(early / late)));
+
+        const size_t peak = std::max_element(energy.begin(), energy.end()) - energy.begin();
+        size_t end = peak;
+        while (end < kDecaySampleCount && energy[end] > 1e-5f * energy[peak])
+        {
+            ++end;
+        }
+        decay.energy_t50 = static_cast<float>(end - peak) / kSampleRate;
+        return decay;
+    };
+
+    for (Vec2Df input_pos : {Vec2Df{0.1f, 0.05f}, Vec2Df{-0.05f, 0.15f}, Vec2Df{0.2f, -0.1f}})
+    {
+        PolarMesh polar_mesh(max_radius, sample_distance);
+        TriMesh trimesh(grid_size[0], grid_size[1], sample_distance);
+
+        const Decay polar = get_decay(polar_mesh, input_pos);
+        const Decay tri = get_decay(trimesh, input_pos);
+        auto to_hz = [](float frequency) { return frequency * kSampleRate / (2.f * std::numbers::pi_v<float>); };
+        std::cout << std::format("Input at ({}, {}): fundamental polar {:.1f} Hz, trimesh {:.1f} Hz, fundamental T60 "
+                                 "polar {:.2f} s, trimesh {:.2f} s, energy -50 dB polar {:.2f} s, trimesh {:.2f} s",
+                                 input_pos.x, input_pos.y, to_hz(polar.fundamental), to_hz(tri.fundamental),
+                                 polar.fundamental_t60, tri.fundamental_t60, polar.energy_t50, tri.energy_t50)
+                  << std::endl;
+
+        CHECK(std::abs(polar.fundamental - tri.fundamental) < 0.05f * tri.fundamental);
+        CHECK(std::abs(polar.fundamental_t60 - tri.fundamental_t60) < 0.25f * tri.fundamental_t60);
+        CHECK(polar.energy_t50 < kDecaySampleCount / kSampleRate);
+        CHECK(polar.energy_t50 < 2.f * tri.energy_t50);
+        CHECK(tri.energy_t50 < 2.f * polar.energy_t50);
+    }
+}
+
+TEST_CASE("Multi-resolution mesh")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    std::string title = std::format("Multi-resolution mesh - {} hz", kSampleRate);
+
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    for (size_t ratio : {1, 2, 3})
+    {
+        float max_radius = get_max_radius(kRadius, friction_delay / ratio, sample_distance * ratio);
+
+        MultiResMesh mesh(max_radius, sample_distance, ratio, {0.f, 0.f}, 0.05f);
+        auto mask = mesh.get_mask_for_radius(max_radius);
+        mesh.init(mask);
+        mesh.init_boundary(info);
+        mesh.set_input(0.01f, {0.f, 0.f});
+        mesh.set_output(0.5, 0.5);
+
+        bench.run(std::format("MultiResMesh - ratio {}", ratio), [&] {
+            for (auto i = 0; i < kIterationCount - 1; i++)
+            {
+                float input = 0.f;
+                if (i < impulse.size())
+                {
+                    input = -impulse[i];
+                }
+                float out = mesh.tick(input);
+                ankerl::nanobench::doNotOptimizeAway(out);
+            }
+        });
+    }
+}
+
+TEST_CASE("Compiled mesh")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    TriMesh trimesh(grid_size[0], grid_size[1], sample_distance);
+    auto mask = trimesh.get_mask_for_radius(max_radius);
+    trimesh.init(mask);
+    trimesh.init_boundary(info);
+    trimesh.set_input(0.1f, {0.f, 0.f});
+    trimesh.set_output(0.5, 0.5);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    std::string title = std::format("Compiled mesh - {} hz, time per instance", kSampleRate);
+
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    bench.run("TriMesh - Single thread", [&] {
+        for (auto i = 0; i < kIterationCount - 1; i++)
+        {
+            float input = 0.f;
+            if (i < impulse.size())
+            {
+                input = -impulse[i];
+            }
+            float out = trimesh.tick(input);
+            ankerl::nanobench::doNotOptimizeAway(out);
+        }
+    });
+
+    for (size_t instance_count : {1, 8, 32})
+    {
+        CompiledMesh compiled_mesh;
+        REQUIRE(compiled_mesh.compile(trimesh, instance_count));
+
+        std::vector<float> input(instance_count);
+        std::vector<float> output(instance_count);
+
+        bench.batch(instance_count);
+        bench.run(std::format("CompiledMesh - {} instances", instance_count), [&] {
+            for (auto i = 0; i < kIterationCount - 1; i++)
+            {
+                // Give each instance a different strike strength
+                for (size_t instance = 0; instance < instance_count; ++instance)
+                {
+                    input[instance] = i < impulse.size() ? -impulse[i] * (instance + 1) : 0.f;
+                }
+                compiled_mesh.tick(input.data(), output.data());
+                ankerl::nanobench::doNotOptimizeAway(output.data());
+            }
+        });
+    }
+}
+
+TEST_CASE("Ensemble mesh")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    TriMesh trimesh(grid_size[0], grid_size[1], sample_distance);
+    auto mask = trimesh.get_mask_for_radius(max_radius);
+    trimesh.init(mask);
+    trimesh.init_boundary(info);
+    trimesh.set_input(0.1f, {0.f, 0.f});
+    trimesh.set_output(0.5, 0.5);
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    nanobench::Bench bench;
+    std::string title = std::format("Ensemble mesh - {} hz, time per variant", kSampleRate);
+
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    bench.run("TriMesh - Single thread", [&] {
+        for (auto i = 0; i < kIterationCount - 1; i++)
+        {
+            float input = 0.f;
+            if (i < impulse.size())
+            {
+                input = -impulse[i];
+            }
+            float out = trimesh.tick(input);
+            ankerl::nanobench::doNotOptimizeAway(out);
+        }
+    });
+
+    for (size_t variant_count : {8, 16})
+    {
+        // Sweep the decay and the strike strength. The friction delay grows with the decay, staying below kDecay
+        // keeps the rimguide delays long enough for the mesh built above.
+        std::vector<EnsembleVariant> variants(variant_count);
+        for (size_t i = 0; i < variant_count; ++i)
+        {
+            const float decay = kDecay * (0.5f + 0.5f * static_cast<float>(i) / variant_count);
+            const float coeff = get_friction_coeff(kRadius, c, decay, f0);
+            variants[i].input_gain = 0.5f + static_cast<float>(i) / variant_count;
+            variants[i].rimguide_info = info;
+            variants[i].rimguide_info.friction_coeff = -coeff;
+            variants[i].rimguide_info.friction_delay = get_friction_delay(coeff, f0);
+        }
+
+        EnsembleMesh ensemble;
+        REQUIRE(ensemble.init(trimesh, variants));
+
+        std::vector<float> output(variant_count);
+
+        bench.batch(variant_count);
+        bench.run(std::format("EnsembleMesh - {} variants", variant_count), [&] {
+            for (auto i = 0; i < kIterationCount - 1; i++)
+            {
+                float input = 0.f;
+                if (i < impulse.size())
+                {
+                    input = -impulse[i];
+                }
+                ensemble.tick(input, output.data());
+                ankerl::nanobench::doNotOptimizeAway(output.data());
+            }
+        });
+    }
+}
+
+TEST_CASE("Voice engine")
+{
+    constexpr size_t kVoiceCount = 8;
+    constexpr size_t kBlockSize = 64;
+
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+
+    // Drums of increasing size, every voice is kept busy by hitting all of them at the start of each run
+    auto create_drum = [&](float radius) -> std::unique_ptr<Mesh2D> {
+        float f0 = get_fundamental_frequency(radius, c, kSampleRate);
+        float friction_coeff = get_friction_coeff(radius, c, kDecay, f0);
+        float friction_delay = get_friction_delay(friction_coeff, f0);
+        float max_radius = get_max_radius(radius, friction_delay, sample_distance);
+        auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+        RimguideInfo info{};
+        info.friction_coeff = -friction_coeff;
+        info.friction_delay = friction_delay;
+        info.wave_speed = c;
+        info.sample_rate = kSampleRate;
+        info.is_solid_boundary = true;
+        info.get_rimguide_pos = std::bind(get_boundary_position, radius, std::placeholders::_1);
+
+        auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh->get_mask_for_radius(max_radius);
+        mesh->init(mask);
+        mesh->init_boundary(info);
+        mesh->set_input(0.1f * radius, {0.f, 0.f});
+        mesh->set_output(0.5, 0.5);
+        return mesh;
+    };
+
+    nanobench::Bench bench;
+    std::string title = std::format("Voice engine - {} hz, {} voices", kSampleRate, kVoiceCount);
+
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1ms, "ms");
+
+    const size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t worker_count : {size_t{0}, hardware_threads})
+    {
+        VoiceEngine engine(worker_count, kBlockSize);
+        for (size_t i = 0; i < kVoiceCount; ++i)
+        {
+            VoicePreset preset{};
+            const float radius = 0.1f + 0.22f * static_cast<float>(i) / (kVoiceCount - 1);
+            preset.create_mesh = [&, radius] { return create_drum(radius); };
+            preset.excitation = raised_cosine(100, kSampleRate);
+            REQUIRE(engine.add_preset(preset));
+        }
+
+        std::vector<float> output(kBlockSize);
+
+        bench.run(std::format("VoiceEngine - {} workers", worker_count), [&] {
+            for (size_t i = 0; i < kVoiceCount; ++i)
+            {
+                engine.trigger({i, 1.f});
+            }
+            for (size_t i = 0; i < kIterationCount; i += kBlockSize)
+            {
+                engine.process(output.data(), kBlockSize);
+                ankerl::nanobench::doNotOptimizeAway(output.data());
+            }
+        });
+    }
+}
+
+TEST_CASE("Voice engine - Voice stealing")
+{
+    constexpr size_t kBlockSize = 16;
+    constexpr size_t kStealPosition = 50 * kBlockSize;
+    constexpr size_t kFrameCount = kStealPosition + 2 * VoiceEngine::kStealFadeFrameCount;
+
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    VoicePreset preset{};
+    preset.create_mesh = [&]() -> std::unique_ptr<Mesh2D> {
+        auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh->get_mask_for_radius(max_radius);
+        mesh->init(mask);
+        mesh->init_boundary(info);
+        mesh->set_input(0.1f * kRadius, {0.f, 0.f});
+        mesh->set_output(0.5, 0.5);
+        return mesh;
+    };
+    preset.excitation = raised_cosine(100, kSampleRate);
+    preset.voice_count = 1;
+
+    // Plays a hit, and a second one at the steal position if asked, on a drum with a single voice
+    auto play = [&](bool steal) {
+        VoiceEngine engine(0, kBlockSize);
+        REQUIRE(engine.add_preset(preset));
+        engine.trigger({0, 1.f});
+
+        std::vector<float> output(kFrameCount);
+        for (size_t offset = 0; offset < kFrameCount; offset += kBlockSize)
+        {
+            if (steal && offset == kStealPosition)
+            {
+                engine.trigger({0, 0.5f});
+            }
+            engine.process(output.data() + offset, kBlockSize);
+        }
+        CHECK(engine.get_stolen_voice_count() == (steal ? 1 : 0));
+        return output;
+    };
+
+    VoiceEngine fresh_engine(0, kBlockSize);
+    REQUIRE(fresh_engine.add_preset(preset));
+    fresh_engine.trigger({0, 0.5f});
+    std::vector<float> fresh(kFrameCount);
+    fresh_engine.process(fresh.data(), kFrameCount);
+
+    const auto ringing = play(false);
+    const auto stolen = play(true);
+
+    // The first hit fades out instead of stopping, then the second one plays on a cleared mesh
+    float peak = 0.f;
+    for (float sample : ringing)
+    {
+        peak = std::max(peak, std::abs(sample));
+    }
+    for (size_t i = 0; i < kStealPosition; ++i)
+    {
+        REQUIRE(stolen[i] == ringing[i]);
+    }
+    for (size_t i = 0; i < VoiceEngine::kStealFadeFrameCount; ++i)
+    {
+        const float fade = 1.f - static_cast<float>(i) / VoiceEngine::kStealFadeFrameCount;
+        CHECK(std::abs(stolen[kStealPosition + i] - fade * ringing[kStealPosition + i]) < 1e-6f * peak);
+    }
+    const size_t restart = kStealPosition + VoiceEngine::kStealFadeFrameCount;
+    for (size_t i = restart; i < kFrameCount; ++i)
+    {
+        CHECK(stolen[i] == fresh[i - restart]);
+    }
+}
+
+TEST_CASE("Boundary update")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+
+    auto get_rimguide_info = [&](float decay) {
+        float friction_coeff = get_friction_coeff(kRadius, c, decay, f0);
+
+        RimguideInfo info{};
+        info.friction_coeff = -friction_coeff;
+        info.friction_delay = get_friction_delay(friction_coeff, f0);
+        info.wave_speed = c;
+        info.sample_rate = kSampleRate;
+        info.is_solid_boundary = true;
+        info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+        return info;
+    };
+
+    // The rim keeps its shape, only the friction of the rimguides changes
+    const RimguideInfo info = get_rimguide_info(kDecay);
+    const RimguideInfo previous_info = get_rimguide_info(kDecay / 2);
+    float max_radius = get_max_radius(kRadius, info.friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    auto create_mesh = [&](const RimguideInfo& rimguide_info, bool clamp_center) {
+        auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh->get_mask_for_radius(max_radius);
+        mesh->init(mask);
+        mesh->init_boundary(rimguide_info);
+        if (clamp_center)
+        {
+            mesh->clamp_center_with_rimguide();
+        }
+        // Away from the center, which is silent once clamped
+        mesh->set_input(0.05f, {0.1f, 0.f});
+        mesh->set_output(0.7f, 0.6f);
+        return mesh;
+    };
+
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    // A mesh updated in place plays like a mesh built with the new rimguides
+    for (bool clamp_center : {false, true})
+    {
+        auto rebuilt = create_mesh(info, clamp_center);
+        auto updated = create_mesh(previous_info, clamp_center);
+        updated->update_boundary(info);
+
+        for (size_t i = 0; i < kIterationCount; ++i)
+        {
+            const float input = i < impulse.size() ? -impulse[i] : 0.f;
+            REQUIRE(updated->tick(input) == rebuilt->tick(input));
+        }
+    }
+
+    // The delay lines are sized for the whole round trip, the friction delay can go down to 0 without being clamped
+    auto mesh = create_mesh(info, false);
+    for (size_t i = 0; i < mesh->get_rimguide_count(); ++i)
+    {
+        Rimguide* rimguide = mesh->get_rimguide(i);
+        const float round_trip_delay = rimguide->get_delay() + info.friction_delay;
+        rimguide->set_friction(info.friction_coeff, 0.f);
+        CHECK(std::abs(rimguide->get_delay() - std::max(round_trip_delay, 0.5f)) < 1e-4f);
+    }
+}
+
+TEST_CASE("Mesh cloning")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    auto create_mesh = [&] {
+        auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh->get_mask_for_radius(max_radius);
+        mesh->init(mask);
+        mesh->init_boundary(info);
+        mesh->set_input(0.1f, {0.f, 0.f});
+        mesh->set_output(0.5, 0.5);
+        return mesh;
+    };
+
+    auto mesh = create_mesh();
+    auto impulse = raised_cosine(100, kSampleRate);
+
+    // A clone of a mesh that is playing carries on with the same output
+    for (size_t i = 0; i < impulse.size(); ++i)
+    {
+        mesh->tick(-impulse[i]);
+    }
+    auto clone = mesh->clone();
+    REQUIRE(clone != nullptr);
+    for (size_t i = 0; i < kIterationCount; ++i)
+    {
+        REQUIRE(clone->tick(0.f) == mesh->tick(0.f));
+    }
+    mesh->clear();
+
+    std::string title = std::format("Mesh cloning - {} hz", kSampleRate);
+    nanobench::Bench bench;
+    bench.title(title);
+    bench.relative(true);
+    bench.timeUnit(1us, "us");
+
+    bench.run("Build", [&] {
+        auto built = create_mesh();
+        ankerl::nanobench::doNotOptimizeAway(built.get());
+    });
+
+    bench.run("Clone", [&] {
+        auto cloned = mesh->clone();
+        ankerl::nanobench::doNotOptimizeAway(cloned.get());
+    });
+
+    bench.run("Clear", [&] { mesh->clear(); });
+}
+
+TEST_CASE("Render service")
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(kRadius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(kRadius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(kRadius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, kRadius, std::placeholders::_1);
+
+    auto create_mesh = [&] {
+        auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+        auto mask = mesh->get_mask_for_radius(max_radius);
+        mesh->init(mask);
+        mesh->init_boundary(info);
+        mesh->set_input(0.1f, {0.f, 0.f});
+        mesh->set_output(0.5, 0.5);
+        return mesh;
+    };
+
+    ListenerInfo listener_info{};
+    listener_info.position = {0.f, 0.f, 0.5f};
+    listener_info.samplerate = static_cast<size_t>(kSampleRate);
+    listener_info.type = ListenerType::ALL;
+
+    auto impulse = raised_cosine(100, kSampleRate);
+    auto create_job = [&](size_t frame_count, RenderPriority priority) {
+        RenderJob job;
+        job.mesh = create_mesh();
+        job.listener_info = listener_info;
+        job.excitation = impulse;
+        job.frame_count = frame_count;
+        job.priority = priority;
+        return job;
+    };
+
+    constexpr size_t kSliceSize = 256;
+    constexpr size_t kFrameCount = 4 * kSliceSize;
+
+    // Blocks the only worker on its last chunk, until the gate is opened
+    std::promise<void> gate;
+    std::promise<void> gate_reached;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    auto create_gate_job = [&] {
+        RenderJob job = create_job(kSliceSize, RenderPriority::BATCH);
+        job.on_chunk = [&gate_reached, gate_future](std::span<const float>, size_t) {
+            gate_reached.set_value();
+            gate_future.wait();
+        };
+        return job;
+    };
+
+    SUBCASE("Futures")
+    {
+        auto mesh = create_mesh();
+        Listener listener;
+        listener.init(*mesh, listener_info);
+        std::vector<float> expected(kFrameCount);
+        for (size_t i = 0; i < kFrameCount; ++i)
+        {
+            mesh->tick(i < impulse.size() ? impulse[i] : 0.f);
+            expected[i] = listener.tick();
+        }
+
+        RenderService service(2, kSliceSize);
+        std::vector<RenderHandle> handles;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            handles.push_back(service.submit(create_job(kFrameCount, RenderPriority::BATCH)));
+        }
+
+        // Every job takes turns on the workers and renders the same samples as the mesh played alone
+        for (auto& handle : handles)
+        {
+            REQUIRE(handle.is_valid());
+            const RenderResult& result = handle.get_future().get();
+            CHECK_FALSE(result.cancelled);
+            CHECK(result.rendered_frame_count == kFrameCount);
+            CHECK(result.output == expected);
+            CHECK_FALSE(handle.is_running());
+            CHECK(handle.get_progress() == 1.f);
+        }
+        CHECK_FALSE(service.submit(RenderJob{}).is_valid());
+    }
+
+    SUBCASE("Cancellation")
+    {
+        RenderService service(1, kSliceSize);
+        RenderHandle gate_handle = service.submit(create_gate_job());
+        gate_reached.get_future().wait();
+
+        RenderHandle queued = service.submit(create_job(kFrameCount, RenderPriority::INTERACTIVE));
+        RenderHandle batch = service.submit(create_job(kFrameCount, RenderPriority::BATCH));
+        RenderHandle kept = service.submit(create_job(kFrameCount, RenderPriority::INTERACTIVE));
+        queued.cancel();
+        service.cancel_all(RenderPriority::BATCH);
+        gate.set_value();
+
+        // A job cancelled before it started renders nothing, the gate was already running when it was cancelled
+        const RenderResult& queued_result = queued.get_future().get();
+        CHECK(queued.is_cancelled());
+        CHECK(queued_result.cancelled);
+        CHECK(queued_result.output.empty());
+        CHECK(batch.get_future().get().cancelled);
+        CHECK(gate_handle.get_future().get().cancelled);
+
+        const RenderResult& kept_result = kept.get_future().get();
+        CHECK_FALSE(kept_result.cancelled);
+        CHECK(kept_result.output.size() == kFrameCount);
+
+        // A running job stops at its next sample and keeps what it rendered
+        std::promise<void> started;
+        RenderJob job = create_job(1000 * kFrameCount, RenderPriority::INTERACTIVE);
+        job.chunk_frame_count = kSliceSize;
+        job.on_chunk = [&started, is_started = false](std::span<const float>, size_t) mutable {
+            if (!std::exchange(is_started, true))
+            {
+                started.set_value();
+            }
+        };
+        RenderHandle running = service.submit(std::move(job));
+        started.get_future().wait();
+        running.cancel();
+
+        const RenderResult& running_result = running.get_future().get();
+        CHECK(running_result.cancelled);
+        CHECK(running_result.output.size() >= kSliceSize);
+        CHECK(running_result.output.size() < 1000 * kFrameCount);
+        CHECK(running_result.rendered_frame_count == running_result.output.size());
+    }
+
+    SUBCASE("Priority")
+    {
+        RenderService service(1, kSliceSize);
+        std::mutex mutex;
+        std::vector<std::string> completed;
+        auto record = [&](RenderJob& job, std::string name) {
+            job.on_complete = [&mutex, &completed, name](const RenderResult&) {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(name);
+            };
+        };
+
+        RenderJob gate_job = create_gate_job();
+        record(gate_job, "gate");
+        service.submit(std::move(gate_job));
+        gate_reached.get_future().wait();
+
+        // Queued behind the gate: the interactive jobs run first even though the batch jobs were queued before them
+        for (const char* name : {"batch 1", "batch 2"})
+        {
+            RenderJob job = create_job(kFrameCount, RenderPriority::BATCH);
+            record(job, name);
+            service.submit(std::move(job));
+        }
+        RenderHandle last;
+        for (const char* name : {"interactive 1", "interactive 2"})
+        {
+            RenderJob job = create_job(kFrameCount, RenderPriority::INTERACTIVE);
+            record(job, name);
+            last = service.submit(std::move(job));
+        }
+        CHECK(service.get_job_count() == 5);
+
+        gate.set_value();
+        last.get_future().wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const std::vector<std::string> expected = {"gate", "interactive 1", "interactive 2"};
+            CHECK(completed == expected);
+        }
+
+        // The jobs of the same priority share the worker, slice after slice, and finish in the order they were queued
+        while (service.get_job_count() > 0)
+        {
+            std::this_thread::sleep_for(1ms);
+        }
+        const std::vector<std::string> expected = {"gate", "interactive 1", "interactive 2", "batch 1", "batch 2"};
+        CHECK(completed == expected);
+    }
+
+    SUBCASE("Watchdog")
+    {
+        RenderService service(1, kSliceSize);
+        info.use_square_law_nonlinearity = true;
+        info.nonlinear_factor = 0.f;
+
+        // With small waves the square law is a gain of 1 - factor, one rimguide is enough to make the mesh grow
+        RenderJob job = create_job(kFrameCount, RenderPriority::INTERACTIVE);
+        for (auto& sample : job.excitation)
+        {
+            sample *= 0.001f;
+        }
+        job.watchdog_interval = 64;
+        Rimguide* rimguide = job.mesh->get_rimguide(job.mesh->get_rimguide_count() / 3);
+        rimguide->set_nonlinear_factor(-3.f);
+        const Vec2Df pos = rimguide->get_pos();
+
+        const RenderResult& result = service.submit(std::move(job)).get_future().get();
+        CHECK(result.unstable);
+        CHECK(result.output.size() < kFrameCount);
+        CHECK(result.diagnostic.find(std::format("rimguide at ({:.4f}, {:.4f})", pos.x, pos.y)) != std::string::npos);
+
+        // With a factor of 0 the square law leaves the waves untouched
+        RenderJob stable_job = create_job(kFrameCount, RenderPriority::INTERACTIVE);
+        stable_job.watchdog_interval = 64;
+        const RenderResult& stable_result = service.submit(std::move(stable_job)).get_future().get();
+        CHECK_FALSE(stable_result.unstable);
+        CHECK(stable_result.diagnostic.empty());
+        CHECK(stable_result.output.size() == kFrameCount);
+    }
+}
+
 TEST_CASE("TriMesh single thread- BigO")
 {
     std::string title = std::format("Trimesh single thread- BigO", kSampleRate);
@@ -0,0 +1,328 @@
+#include "polar_mesh.h"
+
+#include "junction.h"
+#include "mat2d.h"
+#include "vec2d.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <vector>
+
+namespace
+{
+// Overlaps smaller than this (in radians) between the cells of two rings are not worth a link
+constexpr float kMinOverlap = 1e-4f;
+
+size_t get_ring_size(size_t ring)
+{
+    // Rounding down keeps the spacing on the ring slightly above the sample distance, which is what keeps the
+    // admittance of the self-loop port positive.
+    return ring == 0 ? 1 : static_cast<size_t>(std::floor(2.f * std::numbers::pi_v<float> * ring));
+}
+
+float get_junction_angle(size_t ring, size_t idx)
+{
+    return 2.f * std::numbers::pi_v<float> * idx / get_ring_size(ring);
+}
+
+float wrap_angle(float angle)
+{
+    return std::remainder(angle, 2.f * std::numbers::pi_v<float>);
+}
+} // namespace
+
+PolarMesh::PolarMesh(float radius, float sample_distance)
+    : radius_(radius)
+{
+    sample_distance_ = sample_distance;
+
+    size_t ring_count = static_cast<size_t>(std::floor(radius / sample_distance)) + 1;
+    if (ring_count < 2)
+    {
+        std::cerr << "Invalid mesh size" << std::endl;
+        ring_count = 2;
+    }
+
+    ring_offsets_.push_back(0);
+    for (size_t ring = 0; ring < ring_count; ++ring)
+    {
+        ring_offsets_.push_back(ring_offsets_.back() + get_ring_size(ring));
+    }
+
+    lx_ = ring_offsets_.back();
+    ly_ = 1;
+    junctions_.allocate(lx_, ly_);
+
+    for (size_t ring = 0; ring < ring_count; ++ring)
+    {
+        const float r = ring * sample_distance;
+        for (size_t i = 0; i < get_ring_size(ring); ++i)
+        {
+            const float angle = get_junction_angle(ring, i);
+            junctions_(ring_offsets_[ring] + i, 0).init(JUNCTION_TYPE::N_PORT, r * std::cos(angle),
+                                                        r * std::sin(angle));
+        }
+    }
+}
+
+void PolarMesh::init(const Mat2D<uint8_t>& mask)
+{
+    if (mask.size() != lx_ * ly_)
+    {
+        std::cerr << "Mask size does not match mesh size" << std::endl;
+        return;
+    }
+
+    if (symmetry_ != SymmetryMode::NONE)
+    {
+        std::cerr << "Symmetry modes are not supported by the polar mesh" << std::endl;
+        symmetry_ = SymmetryMode::NONE;
+    }
+
+    const float d = sample_distance_;
+    const size_t ring_count = get_ring_count();
+
+    struct Link
+    {
+        size_t a;
+        size_t b;
+        float admittance;
+        size_t ring; ///< Ring of a link along a ring, 0 for a link between two rings
+    };
+    std::vector<Link> links;
+    std::vector<float> rim_admittance(lx_, 0.f);
+
+    auto connect = [&](size_t a, size_t b, float admittance, size_t ring) {
+        if (mask(a, 0) == 0 && mask(b, 0) == 0)
+        {
+            return;
+        }
+
+        // A link to a masked out junction leads to the rimguide instead
+        if (mask(a, 0) == 0)
+        {
+            rim_admittance[b] += admittance;
+            return;
+        }
+        if (mask(b, 0) == 0)
+        {
+            rim_admittance[a] += admittance;
+            return;
+        }
+
+        links.push_back({a, b, admittance, ring});
+    };
+
+    for (size_t ring = 1; ring < ring_count; ++ring)
+    {
+        const size_t size = get_ring_size(ring);
+        const size_t offset = ring_offsets_[ring];
+        const float r = ring * d;
+
+        // Links along the ring: the shared cell edge is radial and the link follows the arc between the junctions
+        const float ring_admittance = d / (2.f * std::numbers::pi_v<float> * r / size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            connect(offset + i, offset + (i + 1) % size, ring_admittance, ring);
+        }
+
+        // Links to the inner ring: the shared cell edge is the part of the circle between the two rings that both
+        // cells cover, and the link is radial
+        const size_t inner_size = get_ring_size(ring - 1);
+        const auto inner_count = static_cast<long>(inner_size);
+        const size_t inner_offset = ring_offsets_[ring - 1];
+        const float edge_radius = r - d / 2.f;
+        const float half_width = std::numbers::pi_v<float> / size;
+        const float inner_half_width = std::numbers::pi_v<float> / inner_size;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            const float angle = get_junction_angle(ring, i);
+            if (ring == 1)
+            {
+                // Half of the center cell goes to the links, the other half to its self-loop. With all of it in the
+                // links nothing holds the center back when it swings against the first ring, and that mode sits near
+                // half the sample rate where the rim hardly damps anything.
+                connect(inner_offset, offset + i, 0.5f * edge_radius * 2.f * half_width / d, 0);
+                continue;
+            }
+
+            const long nearest = std::lround(angle * inner_size / (2.f * std::numbers::pi_v<float>));
+            for (long j = nearest - 1; j <= nearest + 1; ++j)
+            {
+                const auto inner = static_cast<size_t>((j + inner_count) % inner_count);
+                const float diff = wrap_angle(angle - get_junction_angle(ring - 1, inner));
+                const float overlap =
+                    std::min(inner_half_width, diff + half_width) - std::max(-inner_half_width, diff - half_width);
+                if (overlap > kMinOverlap)
+                {
+                    connect(inner_offset + inner, offset + i, edge_radius * overlap / d, 0);
+                }
+            }
+        }
+    }
+
+    // The outer ring leads to the rim
+    const size_t outer_ring = ring_count - 1;
+    const size_t outer_size = get_ring_size(outer_ring);
+    const float outer_edge = (outer_ring * d + d / 2.f) * 2.f * std::numbers::pi_v<float> / outer_size;
+    for (size_t i = 0; i < outer_size; ++i)
+    {
+        rim_admittance[ring_offsets_[outer_ring] + i] += outer_edge / d;
+    }
+
+    // A link between two rings is not radial when its junctions are not lined up, so it also stiffens the mesh along
+    // the ring. Take that stiffness (half the admittance times the squared offset along the ring, seen from each end)
+    // off the links along the ring. Otherwise the mesh is stiffer around the center than across the rings, and the
+    // high modes circling the center never reach the rim.
+    std::vector<float> tangential_stiffness(lx_, 0.f);
+    for (const Link& link : links)
+    {
+        const Vec2Df a = junctions_(link.a, 0).get_pos();
+        const Vec2Df b = junctions_(link.b, 0).get_pos();
+        const float cross = a.x * b.y - a.y * b.x;
+        const float ra2 = a.x * a.x + a.y * a.y;
+        const float rb2 = b.x * b.x + b.y * b.y;
+        if (link.ring == 0 && ra2 > 0.f && rb2 > 0.f)
+        {
+            tangential_stiffness[link.a] += 0.5f * link.admittance * cross * cross / ra2;
+            tangential_stiffness[link.b] += 0.5f * link.admittance * cross * cross / rb2;
+        }
+    }
+
+    for (Link& link : links)
+    {
+        if (link.ring != 0)
+        {
+            const float spacing = 2.f * std::numbers::pi_v<float> * link.ring * d / get_ring_size(link.ring);
+            const float stiffness = tangential_stiffness[link.a] + tangential_stiffness[link.b];
+            link.admittance = std::max(0.f, link.admittance - stiffness / (2.f * spacing * spacing));
+        }
+    }
+
+    std::vector<float> link_admittance(lx_, 0.f);
+    for (const Link& link : links)
+    {
+        junctions_(link.a, 0).add_link(&junctions_(link.b, 0), link.admittance);
+        link_admittance[link.a] += link.admittance;
+        link_admittance[link.b] += link.admittance;
+    }
+
+    // The admittance of a junction has to be 4 * area / d^2 for the wave to travel at the same speed as in the
+    // rectilinear and triangular meshes. The self-loop port takes whatever the links don't account for.
+    for (size_t ring = 0; ring < ring_count; ++ring)
+    {
+        const size_t size = get_ring_size(ring);
+        const float area = ring == 0 ? std::numbers::pi_v<float> * d * d / 4.f
+                                     : 2.f * std::numbers::pi_v<float> * (ring * d) * d / size;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const size_t idx = ring_offsets_[ring] + i;
+            if (mask(idx, 0) == 0)
+            {
+                continue;
+            }
+
+            const float load = 4.f * area / (d * d) - link_admittance[idx] - rim_admittance[idx];
+            junctions_(idx, 0).set_rim_admittance(rim_admittance[idx]);
+            junctions_(idx, 0).set_load_admittance(std::max(0.f, load));
+        }
+    }
+
+    for (auto& j : junctions_.container())
+    {
+        j.init_junction_type();
+    }
+}
+
+std::unique_ptr<Mesh2D> PolarMesh::clone() const
+{
+    auto mesh = std::unique_ptr<PolarMesh>(new PolarMesh());
+    if (!mesh->copy_from(*this))
+    {
+        return nullptr;
+    }
+    mesh->radius_ = radius_;
+    mesh->ring_offsets_ = ring_offsets_;
+    return mesh;
+}
+
+void PolarMesh::clamp_center_with_rimguide()
+{
+    Junction& center = junctions_(0, 0);
+    assert(center.get_pos() == (Vec2Df{0, 0}));
+
+    for (size_t port = 0; port < center.get_port_count(); ++port)
+    {
+        Junction* neighbor = center.get_neighbor(static_cast<NEIGHBORS>(port));
+        if (neighbor == nullptr)
+        {
+            continue;
+        }
+
+        for (size_t remote = 0; remote < neighbor->get_port_count(); ++remote)
+        {
+            if (neighbor->get_neighbor(static_cast<NEIGHBORS>(remote)) == &center)
+            {
+                neighbor->remove_neighbor(static_cast<NEIGHBORS>(remote));
+                break;
+            }
+        }
+
+        // With a single ring the junction already has a rimguide for the outer rim
+        if (!neighbor->has_rimguide())
+        {
+            neighbor->init_inner_boundary();
+            rimguides_.push_back(neighbor->get_rimguide());
+        }
+
+        center.remove_neighbor(static_cast<NEIGHBORS>(port));
+    }
+
+    assert(center.get_type() == 0);
+}
+
+void PolarMesh::set_output(float x, float y)
+{
+    x = std::clamp(x, 0.f, 1.f);
+    y = std::clamp(y, 0.f, 1.f);
+
+    const Vec2Df pos = {(2.f * x - 1.f) * radius_, (2.f * y - 1.f) * radius_};
+    output_x = find_nearest_junction(pos);
+    output_y = 0;
+}
+
+size_t PolarMesh::get_ring_count() const
+{
+    return ring_offsets_.size() - 1;
+}
+
+void PolarMesh::print_junction_types() const
+{
+    for (size_t ring = 0; ring < get_ring_count(); ++ring)
+    {
+        for (size_t idx = ring_offsets_[ring]; idx < ring_offsets_[ring + 1]; ++idx)
+        {
+            std::cout << std::setw(2) << std::popcount(junctions_(idx, 0).get_type()) << " ";
+        }
+        std::cout << std::endl;
+    }
+}
+
+void PolarMesh::print_junction_pressure() const
+{
+    for (size_t ring = 0; ring < get_ring_count(); ++ring)
+    {
+        for (size_t idx = ring_offsets_[ring]; idx < ring_offsets_[ring + 1]; ++idx)
+        {
+            std::cout << std::setw(5) << std::fixed << std::setprecision(3) << junctions_(idx, 0).get_output() << " ";
+        }
+        std::cout << std::endl;
+    }
+}
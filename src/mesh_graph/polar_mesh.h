@@ -0,0 +1,94 @@
+#pragma once
+
+#include "mesh_2d.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class PolarMesh
+ * @brief A circular 2D mesh built from concentric rings of junctions.
+ *
+ * Ring k sits at radius k * sample_distance and holds floor(2 * pi * k) junctions, so the spacing between junctions
+ * stays close to the sample distance everywhere. Junctions are linked to their two neighbors on the same ring and to
+ * every junction of the adjacent rings whose cell overlaps theirs. The admittance of each link is the length of the
+ * shared cell edge divided by the length of the link, and a self-loop port makes up for the rest of the cell area
+ * so the wave speed is the same as in the other meshes. The links along a ring give up the stiffness that the slanted
+ * links between rings add in that direction, and half of the center cell goes to its self-loop, otherwise high modes
+ * stay trapped away from the rim.
+ *
+ * Every junction of the outer ring is at the same distance from the rim, which gives a smooth boundary.
+ * The junctions are stored in a single row, ring after ring, starting with the center junction.
+ */
+class PolarMesh : public Mesh2D
+{
+  public:
+    /**
+     * @brief Constructs a PolarMesh object.
+     * @param radius The radius of the outer ring. Rounded down to a multiple of the sample distance.
+     * @param sample_distance The distance between samples.
+     */
+    PolarMesh(float radius, float sample_distance);
+
+    /**
+     * @brief Destroys the PolarMesh object.
+     */
+    ~PolarMesh() override = default;
+
+    PolarMesh(const PolarMesh& mesh) = delete;
+    PolarMesh& operator=(const PolarMesh& mesh) = delete;
+    PolarMesh(PolarMesh&& mesh) = delete;
+    PolarMesh& operator=(PolarMesh&& mesh) = delete;
+
+    /**
+     * @brief Initializes the mesh with a given mask.
+     * @param mask The mask to initialize the mesh with.
+     * @note Links to masked out junctions are turned into rimguide ports.
+     */
+    void init(const Mat2D<uint8_t>& mask) override;
+
+    /**
+     * @brief Copies the mesh, state included, see Mesh2D::clone().
+     */
+    std::unique_ptr<Mesh2D> clone() const override;
+
+    /**
+     * @brief Clamps the center with a rimguide.
+     */
+    void clamp_center_with_rimguide() override;
+
+    /**
+     * @brief Sets the output position.
+     * @param x The x-coordinate of the output. A value between 0 and 1.
+     * @param y The y-coordinate of the output. A value between 0 and 1.
+     * @note The output is the junction closest to the position.
+     */
+    void set_output(float x, float y) override;
+
+    /**
+     * @brief Gets the number of rings, including the center junction.
+     * @return The number of rings.
+     */
+    size_t get_ring_count() const;
+
+    /**
+     * @brief Prints the number of ports of each junction, one ring per line.
+     */
+    void print_junction_types() const override;
+
+    /**
+     * @brief Prints the pressure of each junction, one ring per line.
+     */
+    void print_junction_pressure() const override;
+
+  private:
+    /**
+     * @brief Constructs an empty mesh, filled by clone().
+     */
+    PolarMesh() = default;
+
+    float radius_ = 0.f;
+    std::vector<size_t> ring_offsets_; ///< Index of the first junction of each ring, plus the total junction count.
+};
@@ -9,6 +9,8 @@
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 #define IDX(x, y) ((x) + (y) * lx_)
@@ -17,6 +19,7 @@ RectilinearMesh::RectilinearMesh(size_t lx, size_t ly, float sample_distance)
 {
     lx_ = lx;
     ly_ = ly;
+    sample_distance_ = sample_distance;
 
     if (lx_ == 0 || ly_ == 0)
     {
@@ -76,7 +79,7 @@ void RectilinearMesh::init(const Mat2D<uint8_t>& mask)
                 junctions_(x, y).add_neighbor(&junctions_(x + 1, y), EAST);
             }
 
-            if (y > 0 && x > 0 && mask(x, y - 1) == 1)
+            if (y > 0 && mask(x, y - 1) == 1)
             {
                 junctions_(x, y).add_neighbor(&junctions_(x, y - 1), SOUTH);
             }
@@ -87,12 +90,24 @@ void RectilinearMesh::init(const Mat2D<uint8_t>& mask)
         }
     }
 
+    init_symmetry();
+
     for (auto& j : junctions_.container())
     {
         j.init_junction_type();
     }
 }
 
+std::unique_ptr<Mesh2D> RectilinearMesh::clone() const
+{
+    auto mesh = std::unique_ptr<RectilinearMesh>(new RectilinearMesh());
+    if (!mesh->copy_from(*this))
+    {
+        return nullptr;
+    }
+    return mesh;
+}
+
 void RectilinearMesh::clamp_center_with_rimguide()
 {
     Junction* center = nullptr;
@@ -114,20 +129,24 @@ void RectilinearMesh::clamp_center_with_rimguide()
         std::cerr << "Center junction not found" << std::endl;
     }
 
-    center->get_neighbor(NEIGHBORS::EAST)->remove_neighbor(NEIGHBORS::WEST);
-    center->get_neighbor(NEIGHBORS::NORTH)->remove_neighbor(NEIGHBORS::SOUTH);
-    center->get_neighbor(NEIGHBORS::SOUTH)->remove_neighbor(NEIGHBORS::NORTH);
-    center->get_neighbor(NEIGHBORS::WEST)->remove_neighbor(NEIGHBORS::EAST);
+    constexpr NEIGHBORS kDirections[] = {NEIGHBORS::EAST, NEIGHBORS::NORTH, NEIGHBORS::SOUTH, NEIGHBORS::WEST};
+    constexpr NEIGHBORS kOpposites[] = {NEIGHBORS::WEST, NEIGHBORS::SOUTH, NEIGHBORS::NORTH, NEIGHBORS::EAST};
 
-    center->get_neighbor(NEIGHBORS::EAST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::NORTH)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::SOUTH)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::WEST)->init_inner_boundary();
+    // With a symmetry mode, some of the neighbors are mirror images and are not connected
+    for (size_t i = 0; i < std::size(kDirections); ++i)
+    {
+        Junction* neighbor = center->get_neighbor(kDirections[i]);
+        if (neighbor != nullptr)
+        {
+            neighbor->remove_neighbor(kOpposites[i]);
+            neighbor->init_inner_boundary();
+        }
+    }
 
-    center->remove_neighbor(NEIGHBORS::WEST);
-    center->remove_neighbor(NEIGHBORS::EAST);
-    center->remove_neighbor(NEIGHBORS::NORTH);
-    center->remove_neighbor(NEIGHBORS::SOUTH);
+    for (const auto dir : kDirections)
+    {
+        center->remove_neighbor(dir);
+    }
 
     assert(center->get_type() == 0);
     for (auto& j : junctions_.container())
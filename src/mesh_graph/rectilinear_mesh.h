@@ -4,6 +4,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 /**
  * @class RectilinearMesh
@@ -36,6 +37,11 @@ class RectilinearMesh : public Mesh2D
      */
     void init(const Mat2D<uint8_t>& mask) override;
 
+    /**
+     * @brief Copies the mesh, state included, see Mesh2D::clone().
+     */
+    std::unique_ptr<Mesh2D> clone() const override;
+
     /**
      * @brief Clamps the center of the mesh graph using a rim guide.
      */
@@ -52,6 +58,11 @@ class RectilinearMesh : public Mesh2D
     void print_junction_pressure() const override;
 
   private:
+    /**
+     * @brief Constructs an empty mesh, filled by clone().
+     */
+    RectilinearMesh() = default;
+
     /**
      * @brief Performs a scattering pass on the mesh graph.
      * @param start The starting index for the pass.
@@ -0,0 +1,481 @@
+#include "render_service.h"
+
+#include "denormal.h"
+#include "float_check.h"
+#include "rimguide.h"
+
+#include <PoleZero.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <utility>
+
+namespace
+{
+/**
+ * @brief Sums the squared pressures of the junctions, the energy followed by the watchdog.
+ * @note Summed in independent lanes without branches, so the compiler can vectorize the scan without reordering the
+ * additions itself.
+ */
+float get_energy(std::span<const float> pressure)
+{
+    constexpr size_t kLaneCount = 8;
+    std::array<float, kLaneCount> lanes{};
+
+    size_t i = 0;
+    for (; i + kLaneCount <= pressure.size(); i += kLaneCount)
+    {
+        for (size_t lane = 0; lane < kLaneCount; ++lane)
+        {
+            lanes[lane] += pressure[i + lane] * pressure[i + lane];
+        }
+    }
+
+    float energy = 0.f;
+    for (; i < pressure.size(); ++i)
+    {
+        energy += pressure[i] * pressure[i];
+    }
+    for (float lane : lanes)
+    {
+        energy += lane;
+    }
+    return energy;
+}
+} // namespace
+
+struct RenderJobState
+{
+    RenderJob job;
+    Listener listener;
+    stk::PoleZero dc_blocker;
+
+    size_t position = 0;  ///< Next sample to render
+    size_t published = 0; ///< Samples given to on_chunk
+    bool stopped = false;  ///< Stopped on silence
+    bool unstable = false; ///< Aborted by the watchdog
+
+    // Silence detection, see RenderService::check_silence()
+    float floor_amplitude = 0.f;
+    float floor_energy_ratio = 0.f;
+    float peak_energy = 0.f;
+    float output_peak = 0.f;
+    size_t silent_frame_count = 0;
+
+    // Watchdog, see RenderService::check_stability()
+    std::vector<float> pressure;
+    float reference_energy = 0.f;
+    RenderResult result;
+    std::promise<RenderResult> promise;
+
+    std::atomic_bool cancelled = false;
+    std::atomic_bool done = false;
+    std::atomic<float> progress = 0.f;
+};
+
+void RenderHandle::cancel()
+{
+    if (state_)
+    {
+        state_->cancelled = true;
+    }
+}
+
+RenderHandle::RenderHandle(std::shared_ptr<RenderJobState> state)
+    : state_(std::move(state))
+    , future_(state_->promise.get_future().share())
+{
+}
+
+bool RenderHandle::is_valid() const
+{
+    return state_ != nullptr;
+}
+
+bool RenderHandle::is_cancelled() const
+{
+    return state_ && state_->cancelled;
+}
+
+bool RenderHandle::is_running() const
+{
+    return state_ && !state_->done;
+}
+
+float RenderHandle::get_progress() const
+{
+    return state_ ? state_->progress.load() : 0.f;
+}
+
+std::shared_future<RenderResult> RenderHandle::get_future() const
+{
+    return future_;
+}
+
+RenderService::RenderService(size_t worker_count, size_t slice_size)
+    : slice_size_(std::max<size_t>(slice_size, 1))
+{
+    worker_count = std::max<size_t>(worker_count, 1);
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        threads_.emplace_back([this] { worker_thread(); });
+    }
+}
+
+RenderService::~RenderService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        for (auto& job : running_jobs_)
+        {
+            job->cancelled = true;
+        }
+    }
+    condition_.notify_all();
+
+    for (auto& t : threads_)
+    {
+        t.join();
+    }
+
+    // The jobs left in the queues are completed as cancelled so their futures do not wait forever
+    for (auto* queue : {&interactive_queue_, &batch_queue_})
+    {
+        for (auto& job : *queue)
+        {
+            job->cancelled = true;
+            complete(*job);
+        }
+        queue->clear();
+    }
+}
+
+RenderHandle RenderService::submit(RenderJob job)
+{
+    if (!job.mesh)
+    {
+        std::cerr << "Render job has no mesh" << std::endl;
+        return {};
+    }
+
+    auto state = std::make_shared<RenderJobState>();
+    state->job = std::move(job);
+    state->listener.init(*state->job.mesh, state->job.listener_info);
+    state->listener.set_gain(state->job.listener_gain);
+    state->dc_blocker.setBlockZero(state->job.dc_blocker_alpha);
+    state->result.output.resize(state->job.frame_count);
+    state->floor_amplitude = std::pow(10.f, state->job.silence_floor_db / 20.f);
+    state->floor_energy_ratio = std::pow(10.f, state->job.silence_floor_db / 10.f);
+
+    RenderHandle handle(state);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        get_queue(state->job.priority).push_back(std::move(state));
+    }
+    condition_.notify_one();
+    return handle;
+}
+
+void RenderService::cancel_all(RenderPriority priority)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& job : get_queue(priority))
+    {
+        job->cancelled = true;
+    }
+    for (auto& job : running_jobs_)
+    {
+        if (job->job.priority == priority)
+        {
+            job->cancelled = true;
+        }
+    }
+}
+
+size_t RenderService::get_job_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return interactive_queue_.size() + batch_queue_.size() + running_jobs_.size();
+}
+
+void RenderService::worker_thread()
+{
+    enable_flush_denormals();
+
+    while (true)
+    {
+        JobPtr job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return stop_ || !interactive_queue_.empty() || !batch_queue_.empty(); });
+
+            if (stop_)
+            {
+                return;
+            }
+
+            auto& queue = !interactive_queue_.empty() ? interactive_queue_ : batch_queue_;
+            job = std::move(queue.front());
+            queue.pop_front();
+            running_jobs_.push_back(job);
+        }
+
+        const bool finished = render_slice(*job);
+        if (finished)
+        {
+            complete(*job);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_jobs_.erase(std::find(running_jobs_.begin(), running_jobs_.end(), job));
+        if (!finished)
+        {
+            // Back to the end of its queue, letting the other jobs of the same priority render their slice
+            get_queue(job->job.priority).push_back(std::move(job));
+        }
+    }
+}
+
+bool RenderService::render_slice(RenderJobState& state)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    RenderJob& job = state.job;
+    size_t end = std::min(state.position + slice_size_, job.frame_count);
+    if (state.published == 0 && job.preview_frame_count > 0)
+    {
+        // The slice stops at the end of the preview so it is published without delay
+        end = std::min(end, job.preview_frame_count);
+    }
+    for (; state.position < end; ++state.position)
+    {
+        if (state.cancelled.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        float input = 0.f;
+        if (state.position < job.excitation.size())
+        {
+            input = job.excitation[state.position];
+            for (auto* j : job.mesh->inputs_)
+            {
+                j->add_input(input);
+            }
+        }
+        // The jobs are already spread over the workers, each mesh is processed on a single thread
+        job.mesh->tick_st(input);
+        float out = state.listener.tick();
+
+        if (job.use_dc_blocker)
+        {
+            out = state.dc_blocker.tick(out);
+        }
+        state.result.output[state.position] = out;
+
+        if (job.denormal_check_interval > 0 && (state.position + 1) % job.denormal_check_interval == 0)
+        {
+            DenormalCounter counter;
+            job.mesh->count_subnormals(counter);
+            state.listener.count_subnormals(counter);
+            state.result.subnormal_ratios.push_back(counter.get_ratio());
+        }
+
+        if (job.watchdog_interval > 0 && (state.position + 1) % job.watchdog_interval == 0 && !check_stability(state))
+        {
+            state.unstable = true;
+            ++state.position;
+            break;
+        }
+
+        if (job.stop_on_silence)
+        {
+            state.output_peak = std::max(state.output_peak, std::abs(out));
+            if ((state.position + 1) % kSilenceCheckInterval == 0 && check_silence(state))
+            {
+                state.stopped = true;
+                ++state.position;
+                break;
+            }
+        }
+    }
+
+    if (state.unstable)
+    {
+        state.result.unstable = true;
+        state.result.output.resize(state.position);
+        std::cerr << "Render aborted: " << state.result.diagnostic << std::endl;
+    }
+
+    if (state.stopped)
+    {
+        state.result.stopped_on_silence = true;
+        state.result.rendered_frame_count = state.position;
+        if (job.trim_silence)
+        {
+            state.result.output.resize(state.position);
+        }
+        else
+        {
+            // The output is already filled with 0, only the position moves to the end
+            state.position = job.frame_count;
+        }
+    }
+
+    auto slice_end = std::chrono::high_resolution_clock::now();
+    state.result.runtime_ms += std::chrono::duration<float, std::milli>(slice_end - start).count();
+
+    if (job.frame_count > 0)
+    {
+        state.progress = state.stopped || state.unstable
+                             ? 1.f
+                             : static_cast<float>(state.position) / static_cast<float>(job.frame_count);
+    }
+
+    const bool finished = state.position == job.frame_count || state.stopped || state.unstable;
+    if (job.on_chunk && !state.cancelled && !state.unstable)
+    {
+        size_t publish_position = state.published + job.chunk_frame_count;
+        if (state.published == 0 && job.preview_frame_count > 0)
+        {
+            publish_position = job.preview_frame_count;
+        }
+
+        if (state.position > state.published && (state.position >= publish_position || finished))
+        {
+            job.on_chunk(std::span<const float>(state.result.output.data() + state.published,
+                                                state.position - state.published),
+                         state.published);
+            state.published = state.position;
+        }
+    }
+    return state.cancelled || finished;
+}
+
+bool RenderService::check_silence(RenderJobState& state)
+{
+    const float energy = state.job.mesh->get_energy();
+    const float output_peak = std::exchange(state.output_peak, 0.f);
+    state.peak_energy = std::max(state.peak_energy, energy);
+
+    // The excitation may still be silent at its start
+    if (state.position < state.job.excitation.size())
+    {
+        state.silent_frame_count = 0;
+        return false;
+    }
+
+    const bool is_silent =
+        output_peak < state.floor_amplitude && energy <= state.peak_energy * state.floor_energy_ratio;
+    state.silent_frame_count = is_silent ? state.silent_frame_count + kSilenceCheckInterval : 0;
+    return state.silent_frame_count >= state.job.silence_hold_frame_count;
+}
+
+bool RenderService::check_stability(RenderJobState& state)
+{
+    Mesh2D& mesh = *state.job.mesh;
+    state.pressure.resize(mesh.junctions_.size());
+    mesh.get_junction_pressure(state.pressure.data());
+
+    // The rimguides are the only source of instability, one of them is reported first if it is already affected
+    const size_t idx = find_non_finite(state.pressure);
+    if (idx < state.pressure.size())
+    {
+        for (size_t i = 0; i < mesh.get_rimguide_count(); ++i)
+        {
+            const Rimguide* rimguide = mesh.get_rimguide(i);
+            if (is_non_finite(rimguide->last_out()) || is_non_finite(rimguide->last_in()))
+            {
+                const Vec2Df pos = rimguide->get_pos();
+                state.result.diagnostic = std::format("non-finite rimguide at ({:.4f}, {:.4f}) after {} samples",
+                                                      pos.x, pos.y, state.position + 1);
+                return false;
+            }
+        }
+
+        const Vec2Df pos = mesh.junctions_[idx].get_pos();
+        state.result.diagnostic = std::format("non-finite pressure at junction {} ({:.4f}, {:.4f}) after {} samples",
+                                              idx, pos.x, pos.y, state.position + 1);
+        return false;
+    }
+
+    // Measured on the copy, the waves of every junction are not scanned a second time
+    const float energy = get_energy(state.pressure);
+    if (state.position < state.job.excitation.size() || state.reference_energy == 0.f)
+    {
+        // An excitation shorter than the interval is only seen by the first check after it
+        state.reference_energy = std::max(state.reference_energy, energy);
+        return true;
+    }
+
+    if (energy > state.reference_energy * state.job.max_energy_ratio)
+    {
+        // The loudest junction is the closest to where the energy comes from
+        size_t loudest = 0;
+        for (size_t i = 1; i < state.pressure.size(); ++i)
+        {
+            if (std::abs(state.pressure[i]) > std::abs(state.pressure[loudest]))
+            {
+                loudest = i;
+            }
+        }
+
+        // The energy comes from the rimguides, the one reflecting the loudest wave is the first suspect
+        const Rimguide* loudest_rimguide = nullptr;
+        for (size_t i = 0; i < mesh.get_rimguide_count(); ++i)
+        {
+            const Rimguide* rimguide = mesh.get_rimguide(i);
+            if (!loudest_rimguide || std::abs(rimguide->last_in()) > std::abs(loudest_rimguide->last_in()))
+            {
+                loudest_rimguide = rimguide;
+            }
+        }
+
+        const Vec2Df pos = mesh.junctions_[loudest].get_pos();
+        state.result.diagnostic =
+            std::format("energy grew {:.0f} times past the end of the excitation after {} samples, loudest junction {} "
+                        "({:.4f}, {:.4f})",
+                        energy / state.reference_energy, state.position + 1, loudest, pos.x, pos.y);
+        if (loudest_rimguide)
+        {
+            const Vec2Df rimguide_pos = loudest_rimguide->get_pos();
+            state.result.diagnostic +=
+                std::format(", loudest rimguide at ({:.4f}, {:.4f})", rimguide_pos.x, rimguide_pos.y);
+        }
+        return false;
+    }
+    return true;
+}
+
+void RenderService::complete(RenderJobState& state)
+{
+    if (state.cancelled)
+    {
+        state.result.cancelled = true;
+        state.result.output.resize(state.position);
+    }
+    if (!state.stopped)
+    {
+        state.result.rendered_frame_count = state.position;
+    }
+
+    if (state.job.on_complete)
+    {
+        state.job.on_complete(state.result);
+    }
+
+    // The mesh is not needed anymore, no reason to keep it alive as long as a handle
+    state.job.mesh.reset();
+    state.done = true;
+    state.promise.set_value(std::move(state.result));
+}
+
+std::deque<RenderService::JobPtr>& RenderService::get_queue(RenderPriority priority)
+{
+    return priority == RenderPriority::INTERACTIVE ? interactive_queue_ : batch_queue_;
+}
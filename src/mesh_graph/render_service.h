@@ -0,0 +1,215 @@
+#pragma once
+
+#include "listener.h"
+#include "mesh_2d.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Order in which the queued render jobs are given to the workers.
+ */
+enum class RenderPriority
+{
+    INTERACTIVE, ///< Previews the user is waiting for, always taken first
+    BATCH,       ///< Background renders, only run when no interactive job is waiting
+};
+
+/**
+ * @brief Output of a render job.
+ */
+struct RenderResult
+{
+    std::vector<float> output; ///< Rendered samples, truncated if the job was cancelled
+    bool cancelled = false;
+    bool stopped_on_silence = false;
+    bool unstable = false;  ///< Aborted by the watchdog, the output stops where the instability was found
+    std::string diagnostic; ///< What the watchdog found and where
+    size_t rendered_frame_count = 0;     ///< Samples actually rendered, the rest of the output is padding
+    float runtime_ms = 0.f;              ///< Time spent rendering, without the time spent waiting in the queue
+    std::vector<float> subnormal_ratios; ///< Fraction of the state that was subnormal at every count
+};
+
+/**
+ * @brief Everything needed to render a mesh, owned by the job once submitted.
+ */
+struct RenderJob
+{
+    std::unique_ptr<Mesh2D> mesh; ///< Mesh with its boundary, input and output set
+    ListenerInfo listener_info{};
+    float listener_gain = 1.f;
+    std::vector<float> excitation; ///< Input signal, already scaled
+    size_t frame_count = 0;        ///< Number of samples to render
+    bool use_dc_blocker = false;
+    float dc_blocker_alpha = 0.995f;
+    RenderPriority priority = RenderPriority::INTERACTIVE;
+
+    bool stop_on_silence = false;           ///< Stops once the mesh and the output stayed silent for the hold time
+    float silence_floor_db = -90.f;         ///< Output level in dBFS, and mesh energy relative to its peak
+    size_t silence_hold_frame_count = 1024; ///< Samples the mesh and the output must stay below the floor
+    bool trim_silence = false;              ///< Trims the output where the render stopped, instead of padding with 0
+
+    size_t denormal_check_interval = 0; ///< Samples between two counts of the subnormal state, 0 to never count
+
+    size_t watchdog_interval = 0;    ///< Samples between two checks for a non-finite or runaway state, 0 to never check
+    float max_energy_ratio = 1000.f; ///< Energy allowed after the excitation, relative to the peak during it
+
+    size_t preview_frame_count = 0; ///< Samples published first, as soon as they are rendered, 0 for no preview
+    size_t chunk_frame_count = 0;   ///< Samples published together after the preview, 0 to publish every slice
+
+    /**
+     * @brief Called from the worker thread with the samples rendered since the last call, never for a cancelled job.
+     * @note The samples are only valid during the call.
+     */
+    std::function<void(std::span<const float> chunk, size_t offset)> on_chunk;
+
+    /**
+     * @brief Called from the worker thread once the job is finished or cancelled, before the future is ready.
+     */
+    std::function<void(const RenderResult&)> on_complete;
+};
+
+struct RenderJobState;
+
+/**
+ * @brief Follows and cancels a submitted render job.
+ */
+class RenderHandle
+{
+  public:
+    RenderHandle() = default;
+
+    /**
+     * @brief Asks the job to stop, the worker gives up at its next sample.
+     */
+    void cancel();
+
+    bool is_valid() const;
+    bool is_cancelled() const;
+
+    /**
+     * @brief Checks whether the job is queued or being rendered.
+     */
+    bool is_running() const;
+
+    float get_progress() const;
+
+    /**
+     * @brief Gets the result, ready once the job is finished or cancelled.
+     */
+    std::shared_future<RenderResult> get_future() const;
+
+  private:
+    friend class RenderService;
+    explicit RenderHandle(std::shared_ptr<RenderJobState> state);
+
+    std::shared_ptr<RenderJobState> state_;
+    std::shared_future<RenderResult> future_;
+};
+
+/**
+ * @class RenderService
+ * @brief Renders meshes offline on a team of worker threads.
+ *
+ * Jobs are rendered in slices of a fixed number of samples. After each slice the job goes back to the end of the
+ * queue of its priority, so jobs of the same priority share the workers and an interactive job never waits for a
+ * batch job to finish. The cancellation of a job is checked at every sample.
+ *
+ * The workers are the only threads rendering: a mesh is always ticked on a single thread, even when it is large enough
+ * to use its own threads when it is played alone.
+ *
+ * A job can stop on silence. The energy of the mesh is a full scan of its junctions, so it is only sampled every
+ * kSilenceCheckInterval samples, together with the peak of the output since the last check. Once the excitation is
+ * over and both stay below the floor for the hold time, the rest of the output is left silent.
+ *
+ * A watchdog aborts the jobs whose mesh becomes unstable, as some nonlinear rimguides can. Every watchdog_interval
+ * samples the pressure of the junctions is copied and scanned for NaN and infinities, and its energy is compared to
+ * its peak during the excitation: a passive mesh can only lose energy once the excitation is over. The copy is a full
+ * scan of the mesh, so the watchdog is off unless the job sets an interval.
+ *
+ * The workers flush the subnormal values to zero. A job can still count the subnormal values of its mesh and listener
+ * every few samples, to check the state of a long tail.
+ *
+ * A job can publish its output progressively: the preview is published as soon as it is rendered, so the start of a
+ * long render can be heard and plotted right away, then the rest follows in chunks.
+ */
+class RenderService
+{
+  public:
+    static constexpr size_t kSilenceCheckInterval = 64;
+
+    /**
+     * @brief Constructs a RenderService object.
+     * @param worker_count The number of jobs rendered at the same time, at least 1.
+     * @param slice_size The number of samples rendered before a job goes back to the queue.
+     */
+    RenderService(size_t worker_count, size_t slice_size = 1024);
+    ~RenderService();
+
+    RenderService(const RenderService& service) = delete;
+    RenderService& operator=(const RenderService& service) = delete;
+
+    /**
+     * @brief Queues a job.
+     * @return The handle of the job, invalid if the job has no mesh.
+     */
+    RenderHandle submit(RenderJob job);
+
+    /**
+     * @brief Cancels every queued and running job of a priority.
+     */
+    void cancel_all(RenderPriority priority);
+
+    /**
+     * @brief Gets the number of jobs queued or being rendered.
+     */
+    size_t get_job_count() const;
+
+  private:
+    using JobPtr = std::shared_ptr<RenderJobState>;
+
+    void worker_thread();
+
+    /**
+     * @brief Renders the next slice of a job.
+     * @return True if the job is finished or cancelled.
+     */
+    bool render_slice(RenderJobState& state);
+
+    /**
+     * @brief Samples the energy of the mesh and the peak of the output since the last call.
+     * @return True if the job stayed silent for its hold time.
+     */
+    bool check_silence(RenderJobState& state);
+
+    /**
+     * @brief Scans the mesh for non-finite values and runaway energy.
+     * @return False if the mesh is unstable, with the diagnostic of the result set.
+     */
+    bool check_stability(RenderJobState& state);
+
+    void complete(RenderJobState& state);
+
+    std::deque<JobPtr>& get_queue(RenderPriority priority);
+
+    size_t slice_size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<JobPtr> interactive_queue_;
+    std::deque<JobPtr> batch_queue_;
+    std::vector<JobPtr> running_jobs_; ///< Jobs taken by a worker, kept to be cancelled
+    bool stop_ = false;
+
+    std::vector<std::thread> threads_;
+};
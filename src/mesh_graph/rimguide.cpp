@@ -1,12 +1,14 @@
 #include "rimguide.h"
 
 #include "Generator.h"
+#include "denormal.h"
 #include "junction.h"
 
 #include <BiQuad.h>
 #include <DelayA.h>
 #include <OnePole.h>
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -17,12 +19,19 @@ namespace
 
 constexpr float kPitchBendScaler = 100.f;
 
+// Default maximum delay of stk::DelayA, a modulated or bent delay moves within it
+constexpr uint32_t kMaxModulatedDelay = 4095;
+
 } // namespace
 
 Rimguide::Rimguide()
     : junction_(nullptr)
     , delay_(0)
+    , round_trip_delay_(0)
+    , max_delay_(0)
+    , delay_line_(0.5f, 1) // Sized by init(), the default buffer would be cleared and copied with the mesh
     , filter_(0)
+    , friction_coeff_(0)
     , pos_{0, 0}
     , in_(0)
     , out_(0)
@@ -33,15 +42,62 @@ Rimguide::Rimguide()
     , nonlinear_factor_(0.5f)
     , use_nonlinear_allpass_(false)
     , nonlinear_allpass_(0.f, 0.f)
+    , diffusion_mix_(1.f)
     , modulator_(nullptr)
     , mod_amp_(0)
 {
 }
 
+Rimguide::Rimguide(const Rimguide& rimguide)
+    : junction_(rimguide.junction_)
+    , delay_(rimguide.delay_)
+    , round_trip_delay_(rimguide.round_trip_delay_)
+    , max_delay_(rimguide.max_delay_)
+    , delay_line_(rimguide.delay_line_)
+    , filter_(rimguide.filter_)
+    , friction_coeff_(rimguide.friction_coeff_)
+    , pos_(rimguide.pos_)
+    , in_(rimguide.in_)
+    , out_(rimguide.out_)
+    , phase_reversal_(rimguide.phase_reversal_)
+    , use_automatic_pitch_bend_(rimguide.use_automatic_pitch_bend_)
+    , pitch_bend_amount_(rimguide.pitch_bend_amount_)
+    , use_square_law_nonlinearity_(rimguide.use_square_law_nonlinearity_)
+    , nonlinear_factor_(rimguide.nonlinear_factor_)
+    , use_nonlinear_allpass_(rimguide.use_nonlinear_allpass_)
+    , nonlinear_allpass_(rimguide.nonlinear_allpass_)
+    , diffusion_filters_(rimguide.diffusion_filters_)
+    , diffusion_mix_(rimguide.diffusion_mix_)
+    , modulator_(nullptr)
+    , mod_amp_(0)
+    , env_follower_(rimguide.env_follower_)
+    , noise_(rimguide.noise_)
+{
+}
+
+std::unique_ptr<Rimguide> Rimguide::clone(Junction* junction) const
+{
+    if (modulator_)
+    {
+        return nullptr;
+    }
+
+    auto rimguide = std::unique_ptr<Rimguide>(new Rimguide(*this));
+    if (junction_ != nullptr)
+    {
+        rimguide->junction_ = junction;
+    }
+    return rimguide;
+}
+
 void Rimguide::clear()
 {
     delay_line_.clear();
     filter_.clear();
+    for (auto& filter : diffusion_filters_)
+    {
+        filter.clear();
+    }
     in_ = 0;
     out_ = 0;
 }
@@ -58,13 +114,19 @@ void Rimguide::init(const RimguideInfo& info, Junction* junction)
 
     // The delay is doubled to account for the round trip
     // 1 is subtracted to account for the delay built-in the junction
-    delay_ = delay_ * 2 - 1 - info.friction_delay;
+    round_trip_delay_ = delay_ * 2 - 1;
+    delay_ = round_trip_delay_ - info.friction_delay;
 
-    const uint32_t max_delay = pow(2, ceil(log2(delay_ + 1)));
-    delay_line_.setMaximumDelay(max_delay);
+    // Sized for the whole round trip, so the friction delay can go down later without the delay being clamped
+    const float longest_delay = std::max(round_trip_delay_, delay_);
+    const uint32_t max_delay = std::bit_ceil(static_cast<uint32_t>(std::ceil(std::max(longest_delay, 0.f))) + 1);
+    max_delay_ = static_cast<float>(max_delay);
+    const bool is_modulated = modulator_ != nullptr || info.use_automatic_pitch_bend;
+    delay_line_.setMaximumDelay(is_modulated ? kMaxModulatedDelay : max_delay);
     delay_line_.setDelay(delay_);
 
-    filter_.setPole(info.friction_coeff);
+    friction_coeff_ = info.friction_coeff;
+    filter_.setPole(friction_coeff_);
 
     phase_reversal_ = info.is_solid_boundary ? -1.f : 1.f;
 
@@ -86,6 +148,7 @@ void Rimguide::init(const RimguideInfo& info, Junction* junction)
     use_nonlinear_allpass_ = info.use_nonlinear_allpass;
     nonlinear_allpass_.setA(info.nonlinear_allpass_coeffs[0], info.nonlinear_allpass_coeffs[1]);
 
+    diffusion_filters_.clear();
     if (info.use_extra_diffusion_filters)
     {
         for (float coeff : info.diffusion_coeffs)
@@ -109,9 +172,17 @@ void Rimguide::init_center()
     phase_reversal_ = 1.f;
 
     delay_ = 2.5;
+    round_trip_delay_ = delay_;
+    max_delay_ = 8;
     delay_line_.setMaximumDelay(8);
     delay_line_.setDelay(delay_);
-    filter_.setPole(0.0f);
+    friction_coeff_ = 0.f;
+    filter_.setPole(friction_coeff_);
+}
+
+bool Rimguide::is_center() const
+{
+    return junction_ == nullptr;
 }
 
 void Rimguide::process_scatter(float input)
@@ -143,12 +214,14 @@ void Rimguide::process_delay()
     {
         in_ = nonlinear_allpass_.process(in_);
     }
-    if (!diffusion_filters_.empty())
+    if (!diffusion_filters_.empty() && diffusion_mix_ > 0.f)
     {
+        float diffused = in_;
         for (auto& filter : diffusion_filters_)
         {
-            in_ = filter.tick(in_);
+            diffused = filter.tick(diffused);
         }
+        in_ = diffusion_mix_ < 1.f ? in_ + (diffused - in_) * diffusion_mix_ : diffused;
     }
 
     out_ = delay_line_.tick(filter_.tick(in_ * phase_reversal_));
@@ -164,13 +237,96 @@ float Rimguide::last_out() const
     return out_;
 }
 
+void Rimguide::count_subnormals(DenormalCounter& counter) const
+{
+    counter.add(in_);
+    counter.add(out_);
+
+    // The STK state is only reachable through the last outputs
+    counter.add(static_cast<float>(filter_.lastOut()));
+    counter.add(static_cast<float>(delay_line_.lastOut()));
+    for (const auto& filter : diffusion_filters_)
+    {
+        counter.add(static_cast<float>(filter.lastOut()));
+    }
+}
+
 Vec2Df Rimguide::get_pos() const
 {
     return pos_;
 }
 
+float Rimguide::get_delay() const
+{
+    return delay_;
+}
+
+float Rimguide::get_friction_coeff() const
+{
+    return friction_coeff_;
+}
+
+float Rimguide::get_phase_reversal() const
+{
+    return phase_reversal_;
+}
+
+bool Rimguide::is_linear() const
+{
+    return modulator_ == nullptr && !use_automatic_pitch_bend_ && !use_square_law_nonlinearity_ &&
+           !use_nonlinear_allpass_ && diffusion_filters_.empty();
+}
+
+bool Rimguide::has_modulator() const
+{
+    return modulator_ != nullptr;
+}
+
 void Rimguide::set_modulator(std::unique_ptr<stk::Generator> modulator, float mod_amp)
 {
+    delay_line_.setMaximumDelay(kMaxModulatedDelay);
     modulator_ = std::move(modulator);
     mod_amp_ = mod_amp;
+}
+
+void Rimguide::set_friction(float friction_coeff, float friction_delay)
+{
+    if (junction_ == nullptr)
+    {
+        return;
+    }
+
+    // The maximum delay has room for the round trip, resizing it would clear the delay line
+    delay_ = std::clamp(round_trip_delay_ - friction_delay, 0.5f, max_delay_);
+    delay_line_.setDelay(delay_);
+
+    friction_coeff_ = friction_coeff;
+    filter_.setPole(friction_coeff_);
+}
+
+void Rimguide::set_pitch_bend_amount(float amount)
+{
+    pitch_bend_amount_ = amount;
+}
+
+void Rimguide::set_nonlinear_factor(float factor)
+{
+    nonlinear_factor_ = factor;
+}
+
+bool Rimguide::has_diffusion_filters() const
+{
+    return !diffusion_filters_.empty();
+}
+
+void Rimguide::set_diffusion_mix(float mix)
+{
+    if (diffusion_mix_ == 0.f && mix > 0.f)
+    {
+        for (auto& filter : diffusion_filters_)
+        {
+            filter.clear();
+        }
+    }
+    diffusion_mix_ = mix;
 }
\ No newline at end of file
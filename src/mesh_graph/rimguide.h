@@ -13,6 +13,7 @@
 #include <functional>
 #include <memory>
 
+class DenormalCounter;
 class Junction;
 
 /// @brief Configuration parameters for a rim guide waveguide
@@ -50,14 +51,24 @@ class Rimguide
     /// @brief Default constructor
     Rimguide();
 
+    /// @brief Copy the rimguide for the junction of a cloned mesh, state included
+    /// @param junction Junction owning the copy, ignored by a center rimguide
+    /// @return The copy, or nullptr if the rimguide has a modulator, which can not be copied
+    std::unique_ptr<Rimguide> clone(Junction* junction) const;
+
     /// @brief Initialize the rimguide with configuration parameters
     /// @param info Configuration parameters
     /// @param junction Connected junction point
+    /// @note Can be called again to reconfigure the rimguide, the modulator is kept
     void init(const RimguideInfo& info, Junction* junction);
 
     /// @brief Initialize center position
     void init_center();
 
+    /// @brief Check if the rimguide clamps the center, see init_center()
+    /// @return True if the rimguide is not on the boundary of the membrane
+    bool is_center() const;
+
     /// @brief Clear internal state
     void clear();
 
@@ -76,20 +87,72 @@ class Rimguide
     /// @return Last output sample value
     float last_out() const;
 
+    /// @brief Add the waves and the last outputs of the filters and delay line to a subnormal counter
+    /// @param counter Counter of the sampled state
+    void count_subnormals(DenormalCounter& counter) const;
+
     /// @brief Get current position
     /// @return 2D position vector
     Vec2Df get_pos() const;
 
+    /// @brief Get the delay of the delay line
+    /// @return Delay in samples
+    float get_delay() const;
+
+    /// @brief Get the pole of the friction filter
+    /// @return Friction coefficient
+    float get_friction_coeff() const;
+
+    /// @brief Get the sign applied to the reflected wave
+    /// @return -1 for a solid boundary, 1 otherwise
+    float get_phase_reversal() const;
+
+    /// @brief Check whether the rimguide is a plain filtered delay line
+    /// @return False if any nonlinearity, modulation or extra filter is enabled
+    bool is_linear() const;
+
+    /// @brief Check whether a modulator was set
+    /// @return True if the delay is modulated by a generator
+    bool has_modulator() const;
+
     /// @brief Set modulation generator
     /// @param modulator Unique pointer to generator
     /// @param mod_amp Modulation amplitude
     void set_modulator(std::unique_ptr<stk::Generator> modulator, float mod_amp);
 
+    /// @brief Update the friction filter without reinitializing the rimguide
+    /// @param friction_coeff Pole of the friction filter
+    /// @param friction_delay Delay of the friction filter, taken off the delay line
+    /// @note The delay line keeps its state and maximum delay. Does nothing for a center rimguide.
+    void set_friction(float friction_coeff, float friction_delay);
+
+    /// @brief Set the amount of automatic pitch bend
+    /// @param amount Pitch bend amount
+    void set_pitch_bend_amount(float amount);
+
+    /// @brief Set the factor of the square law nonlinearity
+    /// @param factor Nonlinear factor
+    void set_nonlinear_factor(float factor);
+
+    /// @brief Check whether the rimguide has extra diffusion filters
+    /// @return True if RimguideInfo::use_extra_diffusion_filters added at least one filter
+    bool has_diffusion_filters() const;
+
+    /// @brief Blend the output of the diffusion filters with their input
+    /// @param mix 1 for the filtered wave, 0 for the dry wave. At 0 the filters are not ticked.
+    /// @note The filters are cleared when the mix leaves 0, their state is stale by then.
+    void set_diffusion_mix(float mix);
+
   private:
+    Rimguide(const Rimguide& rimguide);
+
     Junction* junction_;
     float delay_;
+    float round_trip_delay_; ///< Delay of the round trip to the rim, before the friction delay is taken off
+    float max_delay_;
     stk::DelayA delay_line_;
     stk::OnePole filter_;
+    float friction_coeff_;
     Vec2Df pos_;
 
     float in_;
@@ -104,6 +167,7 @@ class Rimguide
     bool use_nonlinear_allpass_;
     NonLinearAllpass nonlinear_allpass_;
     std::vector<stk::PoleZero> diffusion_filters_;
+    float diffusion_mix_;
 
     std::unique_ptr<stk::Generator> modulator_;
     float mod_amp_;
@@ -0,0 +1,337 @@
+#include "listener.h"
+#include "rimguide.h"
+#include "rimguide_utils.h"
+#include "trimesh.h"
+#include "voice_engine.h"
+#include "wave_math.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <numbers>
+#include <string>
+#include <vector>
+
+// Renders a few seconds of every real-time path with an allocation hook armed, and fails if the heap is touched.
+// Everything is built and started before the hook is armed: the ticks, the listener and the blocks of the voice engine
+// must then run without allocating.
+
+constexpr float kSampleRate = 11025;
+
+constexpr float kDensity = 0.262;
+constexpr float kTension = 3325.f;
+constexpr float kDecay = 25.f;
+
+constexpr float kRenderSeconds = 3.f;
+constexpr size_t kBlockSize = 64;
+
+namespace
+{
+std::atomic_bool is_armed = false;
+std::atomic<size_t> allocation_count = 0;
+
+void* allocate(size_t size)
+{
+    if (is_armed.load(std::memory_order_relaxed))
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* ptr = std::malloc(size > 0 ? size : 1);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* allocate_aligned(size_t size, std::align_val_t alignment)
+{
+    if (is_armed.load(std::memory_order_relaxed))
+    {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const size_t align = static_cast<size_t>(alignment);
+    void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+/**
+ * @brief Counts the allocations made by any thread while it is alive.
+ */
+class AllocationGuard
+{
+  public:
+    AllocationGuard()
+    {
+        allocation_count = 0;
+        is_armed = true;
+    }
+
+    ~AllocationGuard()
+    {
+        is_armed = false;
+    }
+
+    size_t get_allocation_count() const
+    {
+        return allocation_count;
+    }
+};
+} // namespace
+
+void* operator new(size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+#ifdef __GLIBC__
+// The C allocations are caught too, through the entry points glibc keeps for this purpose
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+
+    void* malloc(size_t size)
+    {
+        if (is_armed.load(std::memory_order_relaxed))
+        {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        if (is_armed.load(std::memory_order_relaxed))
+        {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size)
+    {
+        if (is_armed.load(std::memory_order_relaxed))
+        {
+            allocation_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return __libc_realloc(ptr, size);
+    }
+}
+#endif
+
+std::unique_ptr<Mesh2D> create_drum(float radius)
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(radius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(radius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(radius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, radius, std::placeholders::_1);
+
+    auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+    auto mask = mesh->get_mask_for_radius(max_radius);
+
+    mesh->init(mask);
+    mesh->init_boundary(info);
+
+    mesh->set_input(0.1f * radius, {0.f, 0.f});
+    mesh->set_output(0.5, 0.5);
+    return mesh;
+}
+
+bool report(const std::string& name, size_t count)
+{
+    std::cout << name << ": " << count << " allocations" << std::endl;
+    return count == 0;
+}
+
+/**
+ * @brief Renders a hit on a drum through a listener, the way the offline renders do.
+ */
+bool test_mesh(const std::string& name, float radius, float activity_threshold)
+{
+    auto mesh = create_drum(radius);
+    mesh->set_activity_threshold(activity_threshold);
+    mesh->start_threads();
+
+    ListenerInfo listener_info{};
+    listener_info.type = ListenerType::ALL;
+    listener_info.samplerate = kSampleRate;
+    listener_info.position = {-0.4f, 0.f, 0.8f};
+    Listener listener;
+    listener.init(*mesh, listener_info);
+
+    const size_t frame_count = static_cast<size_t>(kRenderSeconds * kSampleRate);
+    std::vector<float> output(frame_count, 0.f);
+
+    size_t count = 0;
+    {
+        AllocationGuard guard;
+        for (size_t i = 0; i < frame_count; ++i)
+        {
+            mesh->tick(i < 32 ? -1.f : 0.f);
+            output[i] = listener.tick();
+        }
+
+        // Cleared the way a voice is retriggered
+        mesh->clear();
+        for (size_t i = 0; i < kBlockSize; ++i)
+        {
+            mesh->tick(i < 32 ? -1.f : 0.f);
+        }
+        count = guard.get_allocation_count();
+    }
+
+    return report(name + " (" + std::to_string(mesh->get_junction_count()) + " junctions)", count);
+}
+
+/**
+ * @brief Plays overlapping hits on a voice engine, one block at a time like an audio callback.
+ */
+bool test_voice_engine()
+{
+    VoiceEngine engine(2, kBlockSize);
+    for (float radius : {0.1f, 0.18f})
+    {
+        VoicePreset preset;
+        preset.create_mesh = [radius] { return create_drum(radius); };
+        preset.excitation.assign(32, -1.f);
+        preset.voice_count = 2;
+        engine.add_preset(preset);
+    }
+
+    // Queued up front, trigger() may allocate on the thread calling it
+    for (size_t i = 0; i < 8; ++i)
+    {
+        engine.trigger({i % 2, 1.f});
+    }
+
+    const size_t block_count = static_cast<size_t>(kRenderSeconds * kSampleRate) / kBlockSize;
+    std::vector<float> block(kBlockSize, 0.f);
+
+    size_t count = 0;
+    {
+        AllocationGuard guard;
+        for (size_t i = 0; i < block_count; ++i)
+        {
+            engine.process(block.data(), block.size());
+        }
+        count = guard.get_allocation_count();
+    }
+    return report("VoiceEngine::process", count);
+}
+
+int main()
+{
+    bool success = true;
+    success &= test_mesh("TriMesh::tick_st", 0.1f, 0.f);
+    success &= test_mesh("TriMesh::tick_mt", 0.4f, 0.f);
+    success &= test_mesh("TriMesh::tick_mt with tiles", 0.4f, 1e-6f);
+    success &= test_voice_engine();
+
+    if (!success)
+    {
+        std::cerr << "Allocations found on the real-time path" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -8,6 +8,8 @@
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <numbers>
 #include <vector>
 
@@ -17,6 +19,7 @@ TriMesh::TriMesh(size_t lx, size_t ly, float sample_distance)
 {
     lx_ = lx;
     ly_ = ly;
+    sample_distance_ = sample_distance;
 
     if (lx_ == 0 || ly_ == 0)
     {
@@ -127,12 +130,30 @@ void TriMesh::init(const Mat2D<uint8_t>& mask)
         }
     }
 
+    init_symmetry();
+
     for (auto& j : junctions_.container())
     {
         j.init_junction_type();
     }
 }
 
+float TriMesh::get_sector_angle() const
+{
+    // The hexagonal lattice has a mirror plane every 30 degrees
+    return std::numbers::pi_v<float> / 6.f;
+}
+
+std::unique_ptr<Mesh2D> TriMesh::clone() const
+{
+    auto mesh = std::unique_ptr<TriMesh>(new TriMesh());
+    if (!mesh->copy_from(*this))
+    {
+        return nullptr;
+    }
+    return mesh;
+}
+
 void TriMesh::clamp_center_with_rimguide()
 {
     Junction* center = nullptr;
@@ -154,26 +175,26 @@ void TriMesh::clamp_center_with_rimguide()
         std::cerr << "Center junction not found" << std::endl;
     }
 
-    center->get_neighbor(NEIGHBORS::EAST)->remove_neighbor(NEIGHBORS::WEST);
-    center->get_neighbor(NEIGHBORS::NORTH_EAST)->remove_neighbor(NEIGHBORS::SOUTH_WEST);
-    center->get_neighbor(NEIGHBORS::SOUTH_EAST)->remove_neighbor(NEIGHBORS::NORTH_WEST);
-    center->get_neighbor(NEIGHBORS::WEST)->remove_neighbor(NEIGHBORS::EAST);
-    center->get_neighbor(NEIGHBORS::NORTH_WEST)->remove_neighbor(NEIGHBORS::SOUTH_EAST);
-    center->get_neighbor(NEIGHBORS::SOUTH_WEST)->remove_neighbor(NEIGHBORS::NORTH_EAST);
-
-    center->get_neighbor(NEIGHBORS::EAST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::NORTH_EAST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::SOUTH_EAST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::WEST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::NORTH_WEST)->init_inner_boundary();
-    center->get_neighbor(NEIGHBORS::SOUTH_WEST)->init_inner_boundary();
-
-    center->remove_neighbor(NEIGHBORS::WEST);
-    center->remove_neighbor(NEIGHBORS::EAST);
-    center->remove_neighbor(NEIGHBORS::NORTH_WEST);
-    center->remove_neighbor(NEIGHBORS::SOUTH_WEST);
-    center->remove_neighbor(NEIGHBORS::NORTH_EAST);
-    center->remove_neighbor(NEIGHBORS::SOUTH_EAST);
+    constexpr NEIGHBORS kDirections[] = {NEIGHBORS::EAST,       NEIGHBORS::NORTH_EAST, NEIGHBORS::SOUTH_EAST,
+                                         NEIGHBORS::WEST,       NEIGHBORS::NORTH_WEST, NEIGHBORS::SOUTH_WEST};
+    constexpr NEIGHBORS kOpposites[] = {NEIGHBORS::WEST,       NEIGHBORS::SOUTH_WEST, NEIGHBORS::NORTH_WEST,
+                                        NEIGHBORS::EAST,       NEIGHBORS::SOUTH_EAST, NEIGHBORS::NORTH_EAST};
+
+    // With a symmetry mode, some of the neighbors are mirror images and are not connected
+    for (size_t i = 0; i < std::size(kDirections); ++i)
+    {
+        Junction* neighbor = center->get_neighbor(kDirections[i]);
+        if (neighbor != nullptr)
+        {
+            neighbor->remove_neighbor(kOpposites[i]);
+            neighbor->init_inner_boundary();
+        }
+    }
+
+    for (const auto dir : kDirections)
+    {
+        center->remove_neighbor(dir);
+    }
 
     assert(center->get_type() == 0);
 
@@ -4,6 +4,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 
 /**
  * @brief A triangular mesh representation in 2D space
@@ -38,6 +39,11 @@ class TriMesh : public Mesh2D
      */
     void init(const Mat2D<uint8_t>& mask) override;
 
+    /**
+     * @brief Copies the mesh, state included, see Mesh2D::clone().
+     */
+    std::unique_ptr<Mesh2D> clone() const override;
+
     /**
      * @brief Clamp the center position using rim guidance
      */
@@ -64,4 +70,13 @@ class TriMesh : public Mesh2D
      * @brief Print general information about the mesh
      */
     void print_info() const;
+
+  protected:
+    float get_sector_angle() const override;
+
+  private:
+    /**
+     * @brief Constructs an empty mesh, filled by clone()
+     */
+    TriMesh() = default;
 };
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "voice_engine.h"
+
+#include "denormal.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+
+VoiceEngine::VoiceEngine(size_t worker_count, size_t block_size)
+    : threadpool_(worker_count)
+    , block_size_(std::max<size_t>(block_size, 1))
+    , next_active_voice_(0)
+{
+    for (size_t i = 0; i < worker_count; ++i)
+    {
+        worker_tasks_.emplace_back([this] { render_worker(); });
+    }
+}
+
+bool VoiceEngine::add_preset(const VoicePreset& preset)
+{
+    if (!preset.create_mesh || preset.voice_count == 0)
+    {
+        std::cerr << "A preset needs a mesh and at least one voice" << std::endl;
+        return false;
+    }
+
+    std::vector<Voice> voices(preset.voice_count);
+    for (auto& voice : voices)
+    {
+        // The first mesh is built, the next ones are copied from it when the mesh supports it
+        if (&voice != &voices.front())
+        {
+            voice.mesh = voices.front().mesh->clone();
+        }
+        if (!voice.mesh)
+        {
+            voice.mesh = preset.create_mesh();
+        }
+        if (!voice.mesh)
+        {
+            std::cerr << "Failed to build the mesh of preset " << presets_.size() << std::endl;
+            return false;
+        }
+        voice.preset = presets_.size();
+        voice.output.assign(block_size_, 0.f);
+    }
+
+    preset_first_voice_.push_back(voices_.size());
+    presets_.push_back(preset);
+    std::move(voices.begin(), voices.end(), std::back_inserter(voices_));
+    active_voices_.reserve(voices_.size());
+
+    // Started before playing, process() must not allocate them
+    if (!worker_tasks_.empty())
+    {
+        threadpool_.start_threads();
+    }
+
+    return true;
+}
+
+bool VoiceEngine::trigger(const VoiceTrigger& trigger)
+{
+    if (trigger.preset >= presets_.size())
+    {
+        std::cerr << "Invalid preset: " << trigger.preset << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(trigger_mutex_);
+    pending_triggers_.push_back(trigger);
+    return true;
+}
+
+void VoiceEngine::process(float* output, size_t frame_count)
+{
+    // The workers flush the subnormals on their own, a voice rendered on the calling thread must as well
+    ScopedFlushDenormals flush_denormals;
+    std::fill(output, output + frame_count, 0.f);
+
+    for (size_t offset = 0; offset < frame_count; offset += block_size_)
+    {
+        start_triggered_voices();
+
+        active_voices_.clear();
+        for (size_t i = 0; i < voices_.size(); ++i)
+        {
+            if (voices_[i].active)
+            {
+                active_voices_.push_back(i);
+            }
+        }
+
+        if (active_voices_.empty())
+        {
+            continue;
+        }
+
+        block_frame_count_ = std::min(block_size_, frame_count - offset);
+        next_active_voice_ = 0;
+
+        // Handing a single voice to a worker only adds the synchronization cost
+        if (worker_tasks_.empty() || active_voices_.size() == 1)
+        {
+            render_worker();
+        }
+        else
+        {
+            threadpool_.enqueue_batch_and_wait(worker_tasks_);
+        }
+
+        for (auto idx : active_voices_)
+        {
+            auto& voice = voices_[idx];
+            const float gain = presets_[voice.preset].gain;
+            if (voice.is_stolen)
+            {
+                for (size_t i = 0; i < block_frame_count_; ++i)
+                {
+                    const size_t fade_position = std::min(voice.fade_position + i, kStealFadeFrameCount);
+                    const float fade = 1.f - static_cast<float>(fade_position) / kStealFadeFrameCount;
+                    output[offset + i] += gain * fade * voice.output[i];
+                }
+
+                voice.fade_position += block_frame_count_;
+                if (voice.fade_position >= kStealFadeFrameCount)
+                {
+                    start_voice(voice, voice.next_velocity);
+                }
+                continue;
+            }
+
+            for (size_t i = 0; i < block_frame_count_; ++i)
+            {
+                output[offset + i] += gain * voice.output[i];
+            }
+
+            if (voice.position >= presets_[voice.preset].excitation.size() && voice.energy < energy_threshold_)
+            {
+                voice.active = false;
+            }
+        }
+    }
+}
+
+void VoiceEngine::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(trigger_mutex_);
+        pending_triggers_.clear();
+    }
+
+    for (auto& voice : voices_)
+    {
+        voice.active = false;
+        voice.is_stolen = false;
+    }
+}
+
+void VoiceEngine::set_energy_threshold(float threshold)
+{
+    energy_threshold_ = threshold;
+}
+
+size_t VoiceEngine::get_preset_count() const
+{
+    return presets_.size();
+}
+
+size_t VoiceEngine::get_voice_count() const
+{
+    return voices_.size();
+}
+
+size_t VoiceEngine::get_active_voice_count() const
+{
+    return std::count_if(voices_.begin(), voices_.end(), [](const Voice& voice) { return voice.active; });
+}
+
+size_t VoiceEngine::get_stolen_voice_count() const
+{
+    return stolen_voice_count_;
+}
+
+size_t VoiceEngine::get_block_size() const
+{
+    return block_size_;
+}
+
+void VoiceEngine::start_triggered_voices()
+{
+    {
+        // The audio thread never waits for trigger(), the hits it is queuing start on the next block
+        std::unique_lock<std::mutex> lock(trigger_mutex_, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            return;
+        }
+        std::swap(triggers_, pending_triggers_);
+    }
+
+    for (const auto& trigger : triggers_)
+    {
+        const size_t first = preset_first_voice_[trigger.preset];
+        const size_t last = first + presets_[trigger.preset].voice_count;
+
+        // A free voice if there is one, otherwise the quietest one
+        Voice* selected = nullptr;
+        for (size_t i = first; i < last; ++i)
+        {
+            auto& voice = voices_[i];
+            if (!voice.active)
+            {
+                selected = &voice;
+                break;
+            }
+            if (selected == nullptr || voice.energy < selected->energy)
+            {
+                selected = &voice;
+            }
+        }
+
+        assert(selected != nullptr);
+        if (selected->active)
+        {
+            ++stolen_voice_count_;
+
+            // A voice that has not played yet has nothing to fade out
+            if (selected->position > 0)
+            {
+                if (!selected->is_stolen)
+                {
+                    selected->is_stolen = true;
+                    selected->fade_position = 0;
+                }
+                selected->next_velocity = trigger.velocity;
+                continue;
+            }
+        }
+
+        start_voice(*selected, trigger.velocity);
+    }
+
+    triggers_.clear();
+}
+
+void VoiceEngine::start_voice(Voice& voice, float velocity)
+{
+    voice.mesh->clear();
+    voice.active = true;
+    voice.velocity = velocity;
+    voice.position = 0;
+    voice.energy = 0.f;
+    voice.is_stolen = false;
+}
+
+void VoiceEngine::render_voice(Voice& voice, size_t frame_count)
+{
+    const auto& excitation = presets_[voice.preset].excitation;
+    Mesh2D& mesh = *voice.mesh;
+    const auto& inputs = mesh.inputs_;
+
+    for (size_t i = 0; i < frame_count; ++i)
+    {
+        float input = 0.f;
+        if (voice.position < excitation.size())
+        {
+            input = voice.velocity * excitation[voice.position];
+            for (auto* j : inputs)
+            {
+                j->add_input(input);
+            }
+        }
+        ++voice.position;
+
+        // The voices are already spread over the workers, each mesh is processed on a single thread
+        voice.output[i] = mesh.tick_st(input);
+    }
+
+    voice.energy = mesh.get_energy();
+}
+
+void VoiceEngine::render_worker()
+{
+    for (size_t i = next_active_voice_++; i < active_voices_.size(); i = next_active_voice_++)
+    {
+        render_voice(voices_[active_voices_[i]], block_frame_count_);
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "mesh_2d.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A drum played by a VoiceEngine.
+ */
+struct VoicePreset
+{
+    std::function<std::unique_ptr<Mesh2D>()> create_mesh; ///< Builds a mesh with its boundary, input and output set
+    std::vector<float> excitation;                        ///< Input signal of a hit at full velocity
+    size_t voice_count = 1;                               ///< Number of hits of this drum that can overlap
+    float gain = 1.f;                                     ///< Gain applied to the output of the voices
+};
+
+/**
+ * @brief A hit to be played by a VoiceEngine.
+ */
+struct VoiceTrigger
+{
+    size_t preset = 0;    ///< Index of the preset, in the order they were added
+    float velocity = 1.f; ///< Scales the excitation of the preset
+};
+
+/**
+ * @class VoiceEngine
+ * @brief Plays overlapping hits on a pool of meshes.
+ *
+ * Each preset owns a fixed number of voices, every voice being a mesh built when the preset is added, so no mesh is
+ * built or allocated while playing. The mesh of the first voice is built by the preset, the other voices are clones of
+ * it, see Mesh2D::clone(). A trigger is given to a free voice of its preset, or steals the quietest voice of the
+ * preset if they are all playing. Clearing a ringing mesh would click, so a stolen voice first fades out over
+ * kStealFadeFrameCount samples, then its mesh is cleared and the new hit starts at the next block.
+ *
+ * The output is rendered in blocks of a fixed size. Triggers are applied at the start of a block, then the active
+ * voices are shared between the workers, each worker rendering a whole block of a voice before taking the next one.
+ * A voice is released once its excitation is over and the energy left in its mesh falls below a threshold.
+ *
+ * @note Nothing plays the engine in real time yet, it is only driven offline by voice_engine_test and the perf tests.
+ * The GUI streams a single drum through a MeshStreamSource, where the hits already add up in the same mesh, so
+ * AudioProcessor::Hit() goes to that source and not to an engine.
+ */
+class VoiceEngine
+{
+  public:
+    static constexpr size_t kStealFadeFrameCount = 64;
+
+    /**
+     * @brief Constructs a VoiceEngine object.
+     * @param worker_count The number of threads rendering the voices. With 0, the voices are rendered by the thread
+     * calling process().
+     * @param block_size The number of samples rendered by a voice before the workers are synchronized.
+     */
+    VoiceEngine(size_t worker_count, size_t block_size = 64);
+    ~VoiceEngine() = default;
+
+    VoiceEngine(const VoiceEngine& engine) = delete;
+    VoiceEngine& operator=(const VoiceEngine& engine) = delete;
+
+    /**
+     * @brief Adds a preset and builds its voices.
+     * @param preset The preset.
+     * @return False if a mesh could not be built.
+     * @note Must not be called while process() is running.
+     */
+    bool add_preset(const VoicePreset& preset);
+
+    /**
+     * @brief Queues a hit, played at the start of the next block.
+     * @param trigger The hit.
+     * @return False if the preset does not exist.
+     * @note Can be called from any thread.
+     */
+    bool trigger(const VoiceTrigger& trigger);
+
+    /**
+     * @brief Renders the sum of every active voice.
+     * @param output The output buffer.
+     * @param frame_count The number of samples to render. A multiple of the block size keeps the triggers aligned
+     * with the calls.
+     * @note Neither allocates, waits for a lock nor prints, once the presets are added.
+     */
+    void process(float* output, size_t frame_count);
+
+    /**
+     * @brief Releases every voice and drops the queued triggers.
+     */
+    void reset();
+
+    /**
+     * @brief Sets the energy below which a voice is released.
+     * @param threshold The threshold, compared to Mesh2D::get_energy().
+     */
+    void set_energy_threshold(float threshold);
+
+    size_t get_preset_count() const;
+    size_t get_voice_count() const;
+    size_t get_active_voice_count() const;
+
+    /**
+     * @brief Gets the number of hits that took a playing voice since the engine was created.
+     * @return The number of stolen voices.
+     */
+    size_t get_stolen_voice_count() const;
+
+    size_t get_block_size() const;
+
+  private:
+    struct Voice
+    {
+        std::unique_ptr<Mesh2D> mesh;
+        size_t preset = 0;
+        bool active = false;
+        float velocity = 0.f;
+        size_t position = 0;       ///< Samples rendered since the hit
+        float energy = 0.f;        ///< Energy of the mesh at the end of the last block
+        std::vector<float> output; ///< Output of the last block
+
+        bool is_stolen = false;    ///< Fading out, the next hit starts once the fade is over
+        float next_velocity = 0.f; ///< Velocity of the hit that stole the voice
+        size_t fade_position = 0;  ///< Samples faded out since the voice was stolen
+    };
+
+    /**
+     * @brief Clears the mesh of a voice and starts a hit on it.
+     */
+    void start_voice(Voice& voice, float velocity);
+
+    /**
+     * @brief Gives the queued triggers to the voices.
+     */
+    void start_triggered_voices();
+
+    /**
+     * @brief Renders a block of a voice.
+     * @param voice The voice.
+     * @param frame_count The number of samples to render, at most the block size.
+     */
+    void render_voice(Voice& voice, size_t frame_count);
+
+    /**
+     * @brief Takes the next active voice to render until there are none left.
+     */
+    void render_worker();
+
+    ThreadPool threadpool_;
+    std::vector<std::function<void()>> worker_tasks_;
+
+    size_t block_size_;
+    float energy_threshold_ = 1e-7f;
+
+    std::vector<VoicePreset> presets_;
+    std::vector<size_t> preset_first_voice_; ///< Index in voices_ of the first voice of each preset
+    std::vector<Voice> voices_;
+
+    std::vector<size_t> active_voices_;     ///< Indices of the voices rendered in the current block
+    std::atomic<size_t> next_active_voice_; ///< Next entry of active_voices_ to be taken by a worker
+    size_t block_frame_count_ = 0;
+
+    std::mutex trigger_mutex_;
+    std::vector<VoiceTrigger> pending_triggers_;
+    std::vector<VoiceTrigger> triggers_;
+    size_t stolen_voice_count_ = 0;
+};
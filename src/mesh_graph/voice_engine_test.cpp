@@ -0,0 +1,196 @@
+#include "gaussian.h"
+#include "rimguide.h"
+#include "rimguide_utils.h"
+#include "trimesh.h"
+#include "voice_engine.h"
+#include "wave_math.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <sndfile.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Plays the hits listed in a trigger file, one "<time in seconds> <preset> <velocity>" per line. Lines starting with
+// '#' are ignored. Without a file argument, or with "-", the triggers are read from stdin so they can be piped in.
+
+constexpr float kSampleRate = 11025;
+
+constexpr float kDensity = 0.262;
+constexpr float kTension = 3325.f;
+constexpr float kDecay = 25.f;
+
+constexpr std::array kPresetRadius = {0.1f, 0.18f, 0.32f};
+constexpr size_t kVoicesPerPreset = 4;
+
+constexpr float kTailSeconds = 2.0f;
+constexpr size_t kBlockSize = 64;
+constexpr const char kOutputFile[] = "voice_engine.wav";
+
+struct TimedTrigger
+{
+    float time;
+    VoiceTrigger trigger;
+};
+
+std::unique_ptr<Mesh2D> create_drum(float radius)
+{
+    float c = get_wave_speed(kTension, kDensity);
+    float sample_distance = get_sample_distance(c, kSampleRate);
+    float f0 = get_fundamental_frequency(radius, c, kSampleRate);
+    float friction_coeff = get_friction_coeff(radius, c, kDecay, f0);
+    float friction_delay = get_friction_delay(friction_coeff, f0);
+    float max_radius = get_max_radius(radius, friction_delay, sample_distance);
+    auto grid_size = get_grid_size(max_radius, sample_distance, 2.f / std::numbers::sqrt3_v<float>);
+
+    RimguideInfo info{};
+    info.friction_coeff = -friction_coeff;
+    info.friction_delay = friction_delay;
+    info.wave_speed = c;
+    info.sample_rate = kSampleRate;
+    info.is_solid_boundary = true;
+    info.get_rimguide_pos = std::bind(get_boundary_position, radius, std::placeholders::_1);
+
+    auto mesh = std::make_unique<TriMesh>(grid_size[0], grid_size[1], sample_distance);
+    auto mask = mesh->get_mask_for_radius(max_radius);
+
+    mesh->init(mask);
+    mesh->init_boundary(info);
+
+    mesh->set_input(0.1f * radius, {0.f, 0.f});
+    mesh->set_output(0.5, 0.5);
+    return mesh;
+}
+
+bool read_triggers(std::istream& stream, std::vector<TimedTrigger>& triggers)
+{
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(stream, line))
+    {
+        ++line_number;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream line_stream(line);
+        TimedTrigger trigger{};
+        if (!(line_stream >> trigger.time >> trigger.trigger.preset >> trigger.trigger.velocity) ||
+            trigger.time < 0.f || trigger.trigger.preset >= kPresetRadius.size())
+        {
+            std::cerr << "Invalid trigger on line " << line_number << ": " << line << std::endl;
+            return false;
+        }
+        triggers.push_back(trigger);
+    }
+
+    std::stable_sort(triggers.begin(), triggers.end(),
+                     [](const TimedTrigger& a, const TimedTrigger& b) { return a.time < b.time; });
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<TimedTrigger> triggers;
+    if (argc < 2 || std::string(argv[1]) == "-")
+    {
+        if (!read_triggers(std::cin, triggers))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        std::ifstream file(argv[1]);
+        if (!file)
+        {
+            std::cerr << "Failed to open trigger file " << argv[1] << std::endl;
+            return 1;
+        }
+        if (!read_triggers(file, triggers))
+        {
+            return 1;
+        }
+    }
+
+    if (triggers.empty())
+    {
+        std::cerr << "No trigger to play" << std::endl;
+        return 1;
+    }
+
+    VoiceEngine engine(std::thread::hardware_concurrency(), kBlockSize);
+    for (auto radius : kPresetRadius)
+    {
+        VoicePreset preset{};
+        preset.create_mesh = [radius] { return create_drum(radius); };
+        preset.excitation = raised_cosine(100, kSampleRate);
+        for (auto& sample : preset.excitation)
+        {
+            sample = -sample;
+        }
+        preset.voice_count = kVoicesPerPreset;
+        preset.gain = 0.5f;
+
+        if (!engine.add_preset(preset))
+        {
+            return 1;
+        }
+    }
+    std::cout << "Voices: " << engine.get_voice_count() << std::endl;
+
+    const size_t output_size = static_cast<size_t>((triggers.back().time + kTailSeconds) * kSampleRate);
+    std::vector<float> out_buffer(output_size, 0.f);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    size_t next_trigger = 0;
+    size_t max_active_voices = 0;
+    for (size_t offset = 0; offset < output_size; offset += kBlockSize)
+    {
+        const float block_time = static_cast<float>(offset) / kSampleRate;
+        while (next_trigger < triggers.size() && triggers[next_trigger].time <= block_time)
+        {
+            engine.trigger(triggers[next_trigger].trigger);
+            ++next_trigger;
+        }
+
+        engine.process(out_buffer.data() + offset, std::min(kBlockSize, output_size - offset));
+        max_active_voices = std::max(max_active_voices, engine.get_active_voice_count());
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto render_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "Render time: " << render_time << " ms for " << output_size / kSampleRate << " s" << std::endl;
+    std::cout << "Max active voices: " << max_active_voices << std::endl;
+    std::cout << "Stolen voices: " << engine.get_stolen_voice_count() << std::endl;
+    std::cout << "Active voices at the end: " << engine.get_active_voice_count() << std::endl;
+
+    SF_INFO out_sf_info{0};
+    out_sf_info.channels = 1;
+    out_sf_info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+    out_sf_info.samplerate = static_cast<int>(kSampleRate);
+    out_sf_info.frames = static_cast<sf_count_t>(output_size);
+
+    SNDFILE* out_file = sf_open(kOutputFile, SFM_WRITE, &out_sf_info);
+    if (!out_file)
+    {
+        std::cerr << "Failed to open output file" << std::endl;
+        return 1;
+    }
+
+    sf_writef_float(out_file, out_buffer.data(), output_size);
+    sf_write_sync(out_file);
+    sf_close(out_file);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+/**
+ * @brief Floating point control state of the current thread.
+ */
+inline uintptr_t get_float_control_state()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    return _mm_getcsr();
+#elif defined(__aarch64__)
+    uintptr_t fpcr = 0;
+    asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+#else
+    return 0;
+#endif
+}
+
+inline void set_float_control_state(uintptr_t state)
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    _mm_setcsr(static_cast<unsigned int>(state));
+#elif defined(__aarch64__)
+    asm volatile("msr fpcr, %0" : : "r"(state));
+#else
+    (void)state;
+#endif
+}
+
+/**
+ * @brief Flushes the subnormal results to zero and reads the subnormal inputs as zero on the current thread.
+ *
+ * A decaying mesh spends its tail in the subnormal range, where every operation is many times slower on most CPUs.
+ * The flag is per thread: every thread ticking a mesh, a rimguide or a listener must call this first.
+ */
+inline void enable_flush_denormals()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    constexpr uintptr_t kFlushToZero = 0x8000;
+    constexpr uintptr_t kDenormalsAreZero = 0x0040;
+    set_float_control_state(get_float_control_state() | kFlushToZero | kDenormalsAreZero);
+#elif defined(__aarch64__)
+    // A single bit flushes both the inputs and the results
+    constexpr uintptr_t kFlushToZero = uintptr_t{1} << 24;
+    set_float_control_state(get_float_control_state() | kFlushToZero);
+#endif
+}
+
+/**
+ * @class ScopedFlushDenormals
+ * @brief Enables enable_flush_denormals() on the current thread for the lifetime of the object.
+ *
+ * For threads that are not owned by the simulation, such as the caller of a synchronous render.
+ */
+class ScopedFlushDenormals
+{
+  public:
+    ScopedFlushDenormals()
+        : previous_state_(get_float_control_state())
+    {
+        enable_flush_denormals();
+    }
+
+    ~ScopedFlushDenormals()
+    {
+        set_float_control_state(previous_state_);
+    }
+
+    ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+    ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+  private:
+    uintptr_t previous_state_;
+};
+
+/**
+ * @brief Checks the bits of a value, not affected by the flush to zero mode.
+ */
+inline bool is_subnormal(float value)
+{
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    return (bits & 0x7f800000u) == 0 && (bits & 0x007fffffu) != 0;
+}
+
+/**
+ * @class DenormalCounter
+ * @brief Counts the subnormal values among the sampled state of a simulation.
+ */
+class DenormalCounter
+{
+  public:
+    void add(float value)
+    {
+        subnormal_count_ += is_subnormal(value) ? 1 : 0;
+        ++sample_count_;
+    }
+
+    void add(std::span<const float> values)
+    {
+        for (float value : values)
+        {
+            add(value);
+        }
+    }
+
+    void reset()
+    {
+        subnormal_count_ = 0;
+        sample_count_ = 0;
+    }
+
+    size_t get_subnormal_count() const
+    {
+        return subnormal_count_;
+    }
+
+    size_t get_sample_count() const
+    {
+        return sample_count_;
+    }
+
+    /**
+     * @brief Gets the fraction of the values added since the last reset that were subnormal.
+     */
+    float get_ratio() const
+    {
+        return sample_count_ > 0 ? static_cast<float>(subnormal_count_) / static_cast<float>(sample_count_) : 0.f;
+    }
+
+  private:
+    size_t subnormal_count_ = 0;
+    size_t sample_count_ = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @brief Checks for a NaN or an infinity from the bits of a value, unlike std::isfinite() this is not affected by
+ * -ffast-math.
+ */
+inline bool is_non_finite(float value)
+{
+    return (std::bit_cast<uint32_t>(value) & 0x7f800000u) == 0x7f800000u;
+}
+
+/**
+ * @brief Finds the first NaN or infinity of an array.
+ * @return The index of the value, values.size() if every value is finite.
+ * @note The values are checked in blocks without branches so the compiler can vectorize the scan, only the block
+ * holding a non-finite value is searched again.
+ */
+inline size_t find_non_finite(std::span<const float> values)
+{
+    constexpr size_t kBlockSize = 64;
+    for (size_t start = 0; start < values.size(); start += kBlockSize)
+    {
+        const size_t end = start + kBlockSize < values.size() ? start + kBlockSize : values.size();
+
+        uint32_t found = 0;
+        for (size_t i = start; i < end; ++i)
+        {
+            found |= (std::bit_cast<uint32_t>(values[i]) & 0x7f800000u) == 0x7f800000u;
+        }
+
+        if (found != 0)
+        {
+            for (size_t i = start; i < end; ++i)
+            {
+                if (is_non_finite(values[i]))
+                {
+                    return i;
+                }
+            }
+        }
+    }
+    return values.size();
+}
@@ -0,0 +1,205 @@
+#include "rt_log.h"
+
+#include <algorithm>
+#include <bit>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+namespace
+{
+const char* get_level_name(RtLogLevel level)
+{
+    switch (level)
+    {
+    case RtLogLevel::INFO:
+        return "info";
+    case RtLogLevel::WARNING:
+        return "warning";
+    case RtLogLevel::ERROR:
+        return "error";
+    }
+    return "";
+}
+} // namespace
+
+RtLog::RtLog(std::ostream& stream, size_t capacity, size_t max_lines_per_second)
+    : stream_(stream)
+    , max_lines_per_second_(max_lines_per_second)
+    , start_time_(std::chrono::steady_clock::now())
+    , window_start_(start_time_)
+{
+    capacity = std::bit_ceil(std::max<size_t>(capacity, 2));
+    slots_ = std::make_unique<Slot[]>(capacity);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    thread_ = std::thread([this] { worker_thread(); });
+}
+
+RtLog::~RtLog()
+{
+    stop_ = true;
+    thread_.join();
+}
+
+bool RtLog::push(const RtLogRecord& record)
+{
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    while (true)
+    {
+        slot = &slots_[position & mask_];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            // The slot is free, the position is ours if no other producer took it first
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // The consumer has not read this slot since the last lap
+            dropped_count_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool RtLog::pop(RtLogRecord& record)
+{
+    Slot& slot = slots_[dequeue_position_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_position_ + 1)
+    {
+        return false;
+    }
+
+    record = slot.record;
+    slot.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_position_;
+    return true;
+}
+
+void RtLog::flush()
+{
+    const size_t position = enqueue_position_.load(std::memory_order_acquire);
+    while (flushed_position_.load(std::memory_order_acquire) < position && !stop_)
+    {
+        std::this_thread::sleep_for(kPollInterval);
+    }
+}
+
+size_t RtLog::get_written_count() const
+{
+    return written_count_.load(std::memory_order_relaxed);
+}
+
+size_t RtLog::get_dropped_count() const
+{
+    return dropped_count_.load(std::memory_order_relaxed);
+}
+
+size_t RtLog::get_suppressed_count() const
+{
+    return suppressed_count_.load(std::memory_order_relaxed);
+}
+
+void RtLog::worker_thread()
+{
+    while (!stop_)
+    {
+        write_records(false);
+        std::this_thread::sleep_for(kPollInterval);
+    }
+
+    // What was queued before the destruction is still written
+    write_records(true);
+}
+
+void RtLog::write_records(bool is_last)
+{
+    RtLogRecord record;
+    bool has_written = false;
+    while (pop(record))
+    {
+        write_record(record);
+        has_written = true;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - window_start_ >= std::chrono::seconds(1) || is_last)
+    {
+        if (window_suppressed_count_ > 0)
+        {
+            stream_ << "[rt_log] " << window_suppressed_count_ << " messages suppressed" << '\n';
+            has_written = true;
+        }
+        window_start_ = now;
+        window_line_count_ = 0;
+        window_suppressed_count_ = 0;
+    }
+
+    const size_t dropped_count = dropped_count_.load(std::memory_order_relaxed);
+    if (dropped_count != reported_dropped_count_)
+    {
+        stream_ << "[rt_log] " << dropped_count - reported_dropped_count_ << " messages dropped, the queue was full"
+                << '\n';
+        reported_dropped_count_ = dropped_count;
+        has_written = true;
+    }
+
+    if (has_written)
+    {
+        stream_.flush();
+    }
+    flushed_position_.store(dequeue_position_, std::memory_order_release);
+}
+
+void RtLog::write_record(const RtLogRecord& record)
+{
+    if (window_line_count_ >= max_lines_per_second_)
+    {
+        ++window_suppressed_count_;
+        suppressed_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    ++window_line_count_;
+
+    std::string message;
+    try
+    {
+        message = std::vformat(record.format, std::make_format_args(record.args[0], record.args[1], record.args[2],
+                                                                    record.args[3]));
+    }
+    catch (const std::exception&)
+    {
+        // A bad format string is still worth seeing as it is
+        message = record.format;
+    }
+
+    const float seconds = std::chrono::duration<float>(record.time - start_time_).count();
+    stream_ << std::format("[{} {:.3f}s] ", get_level_name(record.level), seconds) << message << '\n';
+    written_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+RtLog& get_rt_log()
+{
+    static RtLog log(std::cerr);
+    return log;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <thread>
+
+enum class RtLogLevel : uint8_t
+{
+    INFO,
+    WARNING,
+    ERROR,
+};
+
+/**
+ * @brief A message logged from a real-time thread, formatted later by the logging thread.
+ */
+struct RtLogRecord
+{
+    static constexpr size_t kMaxArgCount = 4;
+
+    const char* format = nullptr; ///< String literal, formatted with std::format, "{}" for each argument
+    std::array<double, kMaxArgCount> args{};
+    RtLogLevel level = RtLogLevel::INFO;
+    std::chrono::steady_clock::time_point time;
+};
+
+/**
+ * @class RtLog
+ * @brief Logging for the audio and simulation threads, which must never block on a stdio lock.
+ *
+ * A real-time thread only copies a fixed size record into a bounded lock-free queue: no allocation, no lock and no
+ * formatting. Several threads can log at once, each slot of the queue carries a sequence number telling the producers
+ * and the consumer whose turn it is. When the queue is full the record is dropped and counted.
+ *
+ * A background thread polls the queue, formats the records and writes them. It writes at most a given number of
+ * lines per second, a message repeated every audio callback would otherwise flood the output, and reports how many
+ * messages were suppressed and dropped.
+ */
+class RtLog
+{
+  public:
+    /**
+     * @brief Constructs a RtLog object and starts its thread.
+     * @param stream The output, only written by the logging thread.
+     * @param capacity The number of records the queue holds, rounded up to a power of two.
+     * @param max_lines_per_second The number of messages written per second before the rest are suppressed.
+     */
+    RtLog(std::ostream& stream, size_t capacity = 1024, size_t max_lines_per_second = 20);
+    ~RtLog();
+
+    RtLog(const RtLog& log) = delete;
+    RtLog& operator=(const RtLog& log) = delete;
+
+    /**
+     * @brief Queues a message, never blocks.
+     * @param format A string literal, it is read after the call returns.
+     * @param args Up to RtLogRecord::kMaxArgCount numbers.
+     * @return False if the queue was full and the message dropped.
+     */
+    template <typename... Args>
+    bool log(RtLogLevel level, const char* format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= RtLogRecord::kMaxArgCount, "Too many arguments for a RtLogRecord");
+
+        RtLogRecord record;
+        record.format = format;
+        record.args = {static_cast<double>(args)...};
+        record.level = level;
+        record.time = std::chrono::steady_clock::now();
+        return push(record);
+    }
+
+    /**
+     * @brief Waits until every queued message is written.
+     * @note Not real-time safe.
+     */
+    void flush();
+
+    size_t get_written_count() const;
+
+    /**
+     * @brief Gets the number of messages lost because the queue was full.
+     */
+    size_t get_dropped_count() const;
+
+    /**
+     * @brief Gets the number of messages not written because of the rate limit.
+     */
+    size_t get_suppressed_count() const;
+
+  private:
+    static constexpr size_t kCacheLineSize = 64;
+    static constexpr std::chrono::milliseconds kPollInterval{10};
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence; ///< Position of the record it holds plus one, or of the next record to hold
+        RtLogRecord record;
+    };
+
+    bool push(const RtLogRecord& record);
+    bool pop(RtLogRecord& record);
+
+    void worker_thread();
+
+    /**
+     * @brief Writes the queued records, then the drops and suppressions not reported yet.
+     * @param is_last True once stopping, the suppressions are reported without waiting for the end of the second.
+     */
+    void write_records(bool is_last);
+    void write_record(const RtLogRecord& record);
+
+    std::ostream& stream_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;
+    size_t max_lines_per_second_;
+    std::chrono::steady_clock::time_point start_time_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_position_ = 0;
+    std::atomic<size_t> dropped_count_ = 0;
+
+    // Logging thread
+    alignas(kCacheLineSize) size_t dequeue_position_ = 0;
+    std::chrono::steady_clock::time_point window_start_;
+    size_t window_line_count_ = 0;
+    size_t window_suppressed_count_ = 0;
+    size_t reported_dropped_count_ = 0;
+    std::atomic<size_t> written_count_ = 0;
+    std::atomic<size_t> suppressed_count_ = 0;
+    std::atomic<size_t> flushed_position_ = 0; ///< Records written so far, see flush()
+
+    std::atomic_bool stop_ = false;
+    std::thread thread_;
+};
+
+/**
+ * @brief Gets the log shared by the audio and simulation threads, writing to std::cerr.
+ * @note The first call starts the logging thread, it must not happen on a real-time thread.
+ */
+RtLog& get_rt_log();
@@ -0,0 +1,145 @@
+#include "rt_log.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Several threads log into a queue much smaller than what they send, every message has to be accounted for: written,
+// suppressed by the rate limit or dropped because the queue was full, and the summaries have to agree with the counts.
+
+constexpr size_t kCapacity = 16;
+constexpr size_t kMaxLinesPerSecond = 20;
+constexpr size_t kThreadCount = 4;
+constexpr size_t kMessageCount = 20000;
+constexpr size_t kBurstSize = 500;                   // Sent at once, far more than the queue holds
+constexpr std::chrono::milliseconds kBurstPause{15}; // Longer than the poll interval, the queue drains in between
+constexpr std::chrono::seconds kFlushTimeout{5};
+
+// Waits for flush() on another thread, a flush that never returns fails the test instead of hanging it
+bool flush_returns(RtLog& log)
+{
+    auto flushed = std::async(std::launch::async, [&log] { log.flush(); });
+    if (flushed.wait_for(kFlushTimeout) != std::future_status::ready)
+    {
+        std::cerr << "RtLog::flush() did not return" << std::endl;
+        std::quick_exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+// Sums the counts of the "[rt_log] <count> messages <what>" lines
+size_t get_reported_count(const std::string& output, const std::string& what)
+{
+    size_t count = 0;
+    std::istringstream lines(output);
+    std::string line;
+    const std::string prefix = "[rt_log] ";
+    while (std::getline(lines, line))
+    {
+        if (line.starts_with(prefix) && line.find(" messages " + what) != std::string::npos)
+        {
+            count += std::stoul(line.substr(prefix.size()));
+        }
+    }
+    return count;
+}
+
+size_t get_line_count(const std::string& output, const std::string& prefix)
+{
+    size_t count = 0;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        count += line.starts_with(prefix);
+    }
+    return count;
+}
+
+bool test_empty_flush()
+{
+    std::ostringstream stream;
+    RtLog log(stream);
+    const bool success = flush_returns(log) && log.get_written_count() == 0;
+
+    std::cout << "Empty flush: " << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+bool test_overflow()
+{
+    std::ostringstream stream;
+    std::vector<size_t> accepted_counts(kThreadCount, 0);
+    size_t written_count = 0;
+    size_t suppressed_count = 0;
+    size_t dropped_count = 0;
+    bool success = true;
+    {
+        RtLog log(stream, kCapacity, kMaxLinesPerSecond);
+
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < kThreadCount; ++t)
+        {
+            producers.emplace_back([&log, &accepted_counts, t] {
+                for (size_t i = 0; i < kMessageCount; ++i)
+                {
+                    accepted_counts[t] += log.log(RtLogLevel::INFO, "Thread {} message {}", t, i);
+                    if ((i + 1) % kBurstSize == 0)
+                    {
+                        std::this_thread::sleep_for(kBurstPause);
+                    }
+                }
+            });
+        }
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+
+        success &= flush_returns(log);
+        written_count = log.get_written_count();
+        suppressed_count = log.get_suppressed_count();
+        dropped_count = log.get_dropped_count();
+    }
+
+    // The queued messages are either written or suppressed, the rest were dropped
+    size_t accepted_count = 0;
+    for (size_t count : accepted_counts)
+    {
+        accepted_count += count;
+    }
+    const size_t message_count = kThreadCount * kMessageCount;
+    success &= written_count + suppressed_count == accepted_count;
+    success &= written_count + suppressed_count + dropped_count == message_count;
+    success &= dropped_count > 0 && suppressed_count > 0 && written_count > 0;
+
+    // The stream is read once the log is destroyed, its thread writes the last summaries when it stops
+    const std::string output = stream.str();
+    success &= get_line_count(output, "[info ") == written_count;
+    success &= get_reported_count(output, "suppressed") == suppressed_count;
+    success &= get_reported_count(output, "dropped") == dropped_count;
+
+    std::cout << "Overflow: " << message_count << " messages, " << written_count << " written, " << suppressed_count
+              << " suppressed, " << dropped_count << " dropped, " << (success ? "passed" : "failed") << std::endl;
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+    success &= test_empty_flush();
+    success &= test_overflow();
+
+    if (!success)
+    {
+        std::cerr << "RtLog test failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
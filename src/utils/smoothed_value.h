@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief A value moving linearly towards its target over a fixed number of ticks.
+ *
+ * Used to apply parameter changes to a running simulation without audible steps.
+ */
+class SmoothedValue
+{
+  public:
+    SmoothedValue(float value = 0.f)
+        : value_(value)
+        , target_(value)
+    {
+    }
+
+    /**
+     * @brief Jumps to a value, cancelling any ramp in progress.
+     */
+    void reset(float value)
+    {
+        value_ = value;
+        target_ = value;
+        step_ = 0.f;
+        remaining_ = 0;
+    }
+
+    /**
+     * @brief Starts a ramp from the current value to a new target.
+     * @param ramp_length Number of ticks to reach the target, 0 to jump to it on the next tick.
+     */
+    void set_target(float target, uint32_t ramp_length)
+    {
+        if (target == target_)
+        {
+            return;
+        }
+
+        target_ = target;
+        remaining_ = ramp_length > 0 ? ramp_length : 1;
+        step_ = (target_ - value_) / static_cast<float>(remaining_);
+    }
+
+    /**
+     * @brief Advances the ramp by one step.
+     * @return The new value.
+     */
+    float tick()
+    {
+        if (remaining_ > 0)
+        {
+            // Land exactly on the target, whatever the rounding of the steps
+            value_ = --remaining_ == 0 ? target_ : value_ + step_;
+        }
+        return value_;
+    }
+
+    bool is_ramping() const
+    {
+        return remaining_ > 0;
+    }
+
+    float get_value() const
+    {
+        return value_;
+    }
+
+    float get_target() const
+    {
+        return target_;
+    }
+
+  private:
+    float value_ = 0.f;
+    float target_ = 0.f;
+    float step_ = 0.f;
+    uint32_t remaining_ = 0;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+
+/**
+ * @brief A vector of at most N elements, stored inline so it never touches the heap.
+ *
+ * Holds the ports of a junction: the junctions of a mesh are then a single block of memory, copied without allocating
+ * when the mesh is cloned, and their waves are read without following a pointer.
+ */
+template <typename T, size_t N>
+class StaticVector
+{
+  public:
+    StaticVector() = default;
+
+    StaticVector(std::initializer_list<T> values)
+    {
+        assert(values.size() <= N);
+        for (const auto& value : values)
+        {
+            data_[size_++] = value;
+        }
+    }
+
+    StaticVector(size_t size, const T& value)
+    {
+        resize(size, value);
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    void clear()
+    {
+        size_ = 0;
+    }
+
+    /**
+     * @brief Sets the number of elements, the new ones are set to @p value.
+     */
+    void resize(size_t size, const T& value = T{})
+    {
+        assert(size <= N);
+        for (size_t i = size_; i < size; ++i)
+        {
+            data_[i] = value;
+        }
+        size_ = size;
+    }
+
+    void push_back(const T& value)
+    {
+        assert(size_ < N);
+        data_[size_++] = value;
+    }
+
+    T& operator[](size_t idx)
+    {
+        assert(idx < size_);
+        return data_[idx];
+    }
+
+    const T& operator[](size_t idx) const
+    {
+        assert(idx < size_);
+        return data_[idx];
+    }
+
+    T* begin()
+    {
+        return data_.data();
+    }
+
+    T* end()
+    {
+        return data_.data() + size_;
+    }
+
+    const T* begin() const
+    {
+        return data_.data();
+    }
+
+    const T* end() const
+    {
+        return data_.data() + size_;
+    }
+
+  private:
+    std::array<T, N> data_{};
+    size_t size_ = 0;
+};
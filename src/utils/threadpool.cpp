@@ -1,22 +1,17 @@
 #include "threadpool.h"
 
-#include <cassert>
+#include "denormal.h"
 
-ThreadPool::ThreadPool(size_t n_threads) : stop_(false)
+ThreadPool::ThreadPool(size_t n_threads)
+    : n_threads_(n_threads)
 {
-    for (size_t i = 0; i < n_threads; ++i)
-    {
-        threads_.emplace_back([this] { this->worker_thread(); });
-    }
 }
 
 ThreadPool::~ThreadPool()
 {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        stop_ = true;
-    }
-    condition_.notify_all();
+    stop_ = true;
+    generation_.fetch_add(1, std::memory_order_release);
+    generation_.notify_all();
 
     for (auto& t : threads_)
     {
@@ -24,56 +19,73 @@ ThreadPool::~ThreadPool()
     }
 }
 
-void ThreadPool::enqueue(std::function<void()> f)
+void ThreadPool::enqueue_batch_and_wait(const std::vector<std::function<void()>>& tasks)
 {
+    if (n_threads_ == 0)
     {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        tasks_.emplace(f);
+        for (const auto& task : tasks)
+        {
+            task();
+        }
+        return;
     }
-    condition_.notify_one();
-}
 
-void ThreadPool::enqueue_batch_and_wait(std::vector<std::function<void()>>& tasks)
-{
+    start_threads();
+
+    // Every worker left the previous batch, nothing reads these until the generation changes
+    batch_ = &tasks;
+    next_task_.store(0, std::memory_order_relaxed);
+    done_worker_count_.store(0, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    generation_.notify_all();
+
+    // Waiting for every worker, not only for the tasks, keeps a late worker from claiming a task of the next batch
+    uint32_t done_count = done_worker_count_.load(std::memory_order_acquire);
+    while (done_count != n_threads_)
     {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
+        done_worker_count_.wait(done_count, std::memory_order_acquire);
+        done_count = done_worker_count_.load(std::memory_order_acquire);
+    }
+}
 
-        assert(tasks_.empty());
-        done_count_ = 0;
-        for (auto& task : tasks)
+void ThreadPool::start_threads()
+{
+    std::call_once(start_flag_, [this] {
+        threads_.reserve(n_threads_);
+        for (size_t i = 0; i < n_threads_; ++i)
         {
-            tasks_.emplace(task);
+            threads_.emplace_back([this] { this->worker_thread(); });
         }
-    }
-    condition_.notify_all();
-
-    std::unique_lock<std::mutex> lock(queue_mutex_);
-    worker_cv_.wait(lock, [this, &tasks] { return done_count_ == tasks.size(); });
+    });
 }
 
 void ThreadPool::worker_thread()
 {
+    // The pool ticks meshes, their tails must not fall into the subnormal range
+    enable_flush_denormals();
+
+    // The threads start with the first batch, which may already be published
+    uint32_t generation = 0;
     while (true)
     {
-        std::function<void()> task;
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        generation_.wait(generation, std::memory_order_acquire);
+        generation = generation_.load(std::memory_order_acquire);
 
-            if (stop_ && tasks_.empty())
-            {
-                return;
-            }
+        if (stop_)
+        {
+            return;
+        }
 
-            task = tasks_.front();
-            tasks_.pop();
+        const auto& tasks = *batch_;
+        for (size_t i = next_task_.fetch_add(1, std::memory_order_relaxed); i < tasks.size();
+             i = next_task_.fetch_add(1, std::memory_order_relaxed))
+        {
+            tasks[i]();
         }
 
-        task();
+        if (done_worker_count_.fetch_add(1, std::memory_order_acq_rel) + 1 == n_threads_)
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            done_count_.fetch_add(1);
-            worker_cv_.notify_one();
+            done_worker_count_.notify_one();
         }
     }
-}
\ No newline at end of file
+}
@@ -1,39 +1,59 @@
 #pragma once
 
 #include <atomic>
-#include <condition_variable>
 #include <cstddef>
 #include <functional>
 #include <mutex>
-#include <queue>
 #include <stdint.h>
 #include <thread>
 #include <vector>
 
+/**
+ * @brief A fixed size pool of worker threads running batches of tasks.
+ * @note The threads are only started by the first batch, so objects owning a pool they may never use (a mesh too
+ * small to be processed in parallel, the voices of a VoiceEngine) do not keep idle threads around.
+ *
+ * A batch runs on the audio thread once per sample, so it neither allocates nor locks: the tasks are read in place,
+ * claimed by the workers with an atomic index, and the workers are woken and waited for with atomic wait/notify.
+ */
 class ThreadPool
 {
   public:
     ThreadPool(size_t n_threads);
     ~ThreadPool();
 
-    void enqueue(std::function<void()> f);
+    ThreadPool(const ThreadPool& pool) = delete;
+    ThreadPool& operator=(const ThreadPool& pool) = delete;
 
-    void enqueue_batch_and_wait(std::vector<std::function<void()>>& tasks);
+    /**
+     * @brief Runs every task on the workers and returns once they are all done.
+     * @param tasks The tasks, built once by the caller and not copied.
+     * @note A single batch runs at a time. Only the first call allocates, if the threads were not started.
+     */
+    void enqueue_batch_and_wait(const std::vector<std::function<void()>>& tasks);
+
+    /**
+     * @brief Starts the threads ahead of the first batch, which would otherwise allocate them.
+     */
+    void start_threads();
 
     size_t get_num_threads() const
     {
-        return threads_.size();
+        return n_threads_;
     }
 
   private:
     void worker_thread();
 
+    size_t n_threads_;
+    std::once_flag start_flag_;
     std::vector<std::thread> threads_;
-    std::queue<std::function<void()>> tasks_;
-
-    std::mutex queue_mutex_;
-    std::condition_variable condition_;
-    std::condition_variable worker_cv_;
-    bool stop_;
-    std::atomic<uint32_t> done_count_;
-};
\ No newline at end of file
+
+    // Written before the generation is incremented, read by the workers once they see it
+    const std::vector<std::function<void()>>* batch_ = nullptr;
+    bool stop_ = false;
+
+    std::atomic<uint32_t> generation_ = 0;        ///< Incremented to wake the workers for a batch or to stop
+    std::atomic<size_t> next_task_ = 0;           ///< Next task of the batch to be claimed by a worker
+    std::atomic<uint32_t> done_worker_count_ = 0; ///< Workers that found no task left in the batch
+};